@@ -0,0 +1,90 @@
+#ifndef ASM_REWRITER_H
+#define ASM_REWRITER_H
+
+#include "asm_rewriter/junk_templates.h"
+#include <cstdint>
+#include <iosfwd>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace obfuscator {
+
+// 汇编重写器：在编译器生成的 GAS 汇编（AT&T 或 .intel_syntax）中插入花指令
+class AsmRewriter {
+public:
+    AsmRewriter();
+    explicit AsmRewriter(uint32_t seed);
+
+    // 在汇编代码中插入垃圾指令
+    std::string insertJunkInstructions(const std::string& asmCode, float density = 0.3f);
+
+    // 生成不透明谓词跳转
+    std::string insertOpaqueJump(const std::string& asmCode);
+
+    // 添加栈平衡的垃圾指令
+    std::string addStackJunk();
+
+    // 每条指令之前插入花指令的概率
+    void setDensity(float density) { m_density = density; }
+
+    // 并行改写的线程数，0 表示使用硬件线程数
+    void setThreads(unsigned threads) { m_threads = threads; }
+
+    // 每个并行任务攒够多少字节的函数再提交，也决定了在途数据的上限
+    void setBatchBytes(size_t bytes) { m_batchBytes = bytes; }
+
+    // 按哪种微架构的开销表挑选花指令
+    void setCpuModel(CpuModel model) { m_cpu = model; }
+
+    // 每个基本块中花指令的开销上限：吞吐周期与编码字节
+    void setBlockBudget(double cycles, unsigned bytes) {
+        m_blockCycles = cycles;
+        m_blockBytes = bytes;
+    }
+
+    // 用花指令代替无上限对齐伪指令（.p2align 4）前由汇编器填充的 NOP
+    void setAlignmentPadding(bool enabled) { m_alignmentPadding = enabled; }
+
+    // 流式改写：逐行读取 .s 文件，按函数（.type name,@function 的标签到 .size name）
+    // 分批并行改写，再按原顺序写出。内存占用只与在途批次和最大的函数有关，
+    // 与文件大小无关。每个函数的随机数流只由种子和函数名决定，输出与线程数无关
+    bool rewriteStream(std::istream& in, std::ostream& out);
+
+    struct Statistics {
+        size_t lines = 0;
+        size_t functions = 0;
+        size_t inserted = 0;        // 插入的花指令条数
+        double cycles = 0.0;        // 花指令的估计吞吐开销之和
+        size_t bytes = 0;           // 花指令的估计编码长度之和
+        size_t paddingBytes = 0;    // 其中代替对齐填充的字节
+        size_t peakPendingBytes = 0;  // 在途批次占用的最大字节数
+    };
+
+    // 改写单个函数的文本（从函数标签到 .size），只读取成员，可在多个线程中同时调用。
+    // stats 非空时累加 inserted/cycles/bytes
+    std::string rewriteFunction(const std::string& name, const std::string& body,
+                                bool intelSyntax, Statistics* stats = nullptr) const;
+    Statistics getStatistics() const { return m_stats; }
+
+private:
+    std::mt19937 m_gen;
+    uint32_t m_seed;
+    float m_density = 0.3f;
+    unsigned m_threads = 0;
+    size_t m_batchBytes = 64 * 1024;
+    CpuModel m_cpu = CpuModel::GENERIC;
+    double m_blockCycles = 1.0;
+    unsigned m_blockBytes = 16;
+    bool m_alignmentPadding = false;
+    Statistics m_stats;
+
+    bool shouldInsertJunk(float density);
+    bool isLabel(const std::string& line);
+    std::string generateJunkInstruction();
+    int randomInt(int min, int max);
+};
+
+} // namespace obfuscator
+
+#endif // ASM_REWRITER_H
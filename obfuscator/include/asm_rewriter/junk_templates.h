@@ -0,0 +1,66 @@
+#ifndef JUNK_TEMPLATES_H
+#define JUNK_TEMPLATES_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace obfuscator {
+
+// 开销表覆盖的微架构
+enum class CpuModel {
+    GENERIC,    // 取下列各微架构中最差的开销
+    SKYLAKE,
+    ICELAKE,
+    ZEN2,
+    ZEN3,
+};
+constexpr int kCpuModelCount = 4;   // 不含 GENERIC
+
+// "generic"/"skylake"/"icelake"/"zen2"/"zen3"，不认识的名称返回 false
+bool parseCpuModel(const std::string& name, CpuModel& model);
+const char* cpuModelName(CpuModel model);
+
+// 模板在某个微架构上的开销
+struct JunkCost {
+    uint8_t uops;           // 融合域微操作数（前端占用）
+    uint8_t latency;        // 结果延迟（周期）
+    uint8_t portCount;      // 可执行的端口数，0 表示在重命名阶段消除，不占执行端口
+    const char* ports;      // 端口说明，如 "p0156"
+};
+
+// 模板改写的状态
+enum JunkRequirement : uint8_t {
+    JUNK_NEEDS_NOTHING = 0,
+    JUNK_NEEDS_DEAD_REGISTER = 1,   // 改写 {d32}/{d64}
+    JUNK_NEEDS_DEAD_FLAGS = 2,      // 改写 EFLAGS
+};
+
+// 花指令模板。格式串中 {d32}/{d64} 为死寄存器，{s32}/{s64} 为只读取的任一寄存器，
+// {imm} 为 1-127 的立即数，{label} 为新的局部标签；多条指令以 "\n\t" 分隔
+struct JunkTemplate {
+    const char* name;
+    const char* att;
+    const char* intel;
+    uint8_t requirements;
+    uint8_t bytes;              // 只用到 rax-rdi 时的编码长度
+    bool rex32;                 // 32 位操作数形式，用到 r8-r15 时多一个 REX 前缀
+    bool zeroDisplacement;      // 以 {s64} 为基址且没有位移，rbp/r13 需要额外的 disp8
+    JunkCost costs[kCpuModelCount];     // 依次为 SKYLAKE ICELAKE ZEN2 ZEN3
+};
+
+const std::vector<JunkTemplate>& junkTemplates();
+
+// 吞吐开销（周期）：前端占用（微操作数 / 分配宽度）与执行端口占用取大者。
+// 花指令的结果没有使用者，不在关键路径上，延迟不计入
+double junkCycles(const JunkTemplate& junk, CpuModel model);
+
+// 是否在重命名阶段消除（归零惯用法、NOP、mov 消除）
+bool junkEliminated(const JunkTemplate& junk, CpuModel model);
+
+// 使用给定寄存器编号时的编码长度
+unsigned junkBytes(const JunkTemplate& junk, int dest, int source);
+
+} // namespace obfuscator
+
+#endif // JUNK_TEMPLATES_H
@@ -2,6 +2,7 @@
 #define OBFUSCATION_ENGINE_H
 
 #include "strategy/obfuscation_strategy.h"
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <string>
@@ -69,6 +70,15 @@ public:
     bool obfuscateBatch(const std::vector<std::string>& inputFiles,
                        const std::vector<std::string>& outputFiles);
 
+    // 合并模式批量处理：多个源文件合并为一个翻译单元后统一混淆，
+    // 按翻译单元进行的处理（如字符串去重）因此覆盖整批文件
+    bool obfuscateAmalgamated(const std::vector<std::string>& inputFiles,
+                              const std::string& outputFile);
+
+    // 读取多个源文件，用 #line 标记拼接为一个翻译单元；
+    // 文件作用域的 static 名字与其他文件的顶层名字冲突时报错并返回 false
+    static bool amalgamate(const std::vector<std::string>& inputFiles, std::string& combined);
+
     // 设置是否保留调试信息
     void setPreserveDebugInfo(bool preserve) { m_preserveDebugInfo = preserve; }
 
@@ -104,27 +114,66 @@ class ControlFlowRewriter {
 public:
     ControlFlowRewriter();
 
-    // 平坦化控制流
+    // 平坦化控制流：输入为函数体（花括号内的语句）。按语句拆分基本块，
+    // 局部变量声明提到分发结构之前，块之间通过状态跳转；无法安全改写时原样返回
     std::string flattenControlFlow(const std::string& code);
 
-    // 添加虚假分支
+    // GCC/Clang 下每个块以 goto *表[状态] 结束（标签地址），各自拥有独立的
+    // 间接跳转；其他编译器回退到 switch 分发。关闭后只生成 switch 版本
+    void setComputedGoto(bool enable) { m_computedGoto = enable; }
+
+    // 块布局的局部性（0.0-1.0）：热块链中每条相邻关系以此概率保留。
+    // 0 为均匀随机排列；1 时热路径按落空顺序连续排布，只随机化冷块和链的位置
+    void setLayoutLocality(float locality) { m_layoutLocality = locality; }
+
+    // 添加虚假分支：在函数体的语句之后插入条件永假、但编译器无法折叠的分支。
+    // 条件读取 volatile 状态，标注为不太可能执行，分支体是冷区中的外联函数调用
     std::string addFakeBranches(const std::string& code, float probability = 0.2f);
 
+    // 虚假分支依赖的宏、状态变量和冷函数，放在文件作用域；未插入分支时为空
+    std::string fakeBranchSupport() const;
+
+    // 分支提示宏 OBF_FB_UNLIKELY / OBF_FB_UNLIKELY_ATTR / OBF_FB_COLD 的定义（可重复包含）
+    static std::string branchHintMacros();
+
     // 分割基本块
     std::vector<std::string> splitBasicBlocks(const std::string& code);
 
     // 重组基本块（随机化顺序）
     std::string shuffleBasicBlocks(const std::vector<std::string>& blocks);
 
+    // 按剖析计数重组：计数高的相邻块保持原有的落空顺序，冷块随机排列
+    std::string shuffleBasicBlocks(const std::vector<std::string>& blocks,
+                                   const std::vector<uint64_t>& profile);
+
 private:
     struct BasicBlock {
         std::string label;
-        std::string code;
-        std::vector<std::string> successors;
+        std::string code;                   // 块内语句，不含末尾的跳转
+        std::string condition;              // 非空时跳转到 condition ? successors[0] : successors[1]
+        std::vector<size_t> successors;     // 为空表示块以 return 结束
+        bool exit = false;                  // 函数体末尾的出口块
+        unsigned loopDepth = 0;             // 所在循环的嵌套深度，用于估计热度
     };
 
-    std::vector<BasicBlock> extractBasicBlocks(const std::string& code);
-    std::string generateSwitchDispatcher(const std::vector<BasicBlock>& blocks);
+    bool m_computedGoto = true;
+    float m_layoutLocality = 0.75f;
+
+    std::string m_fakeBranchId;         // 虚假分支辅助符号的随机后缀
+    uint32_t m_fakeBranchState = 0;     // volatile 状态的初值，谓词据此构造
+    size_t m_fakeBranchCount = 0;
+
+    std::string generateFakeCondition();
+
+    // 热度感知的块布局：返回块的输出顺序。pinEntry 时下标0固定在最前
+    std::vector<size_t> layoutBlocks(const std::vector<double>& weights,
+                                     const std::vector<std::vector<size_t>>& successors,
+                                     bool pinEntry) const;
+
+    // 拆分基本块（下标0为入口块），hoisted 接收需要提前的声明；失败时返回空
+    std::vector<BasicBlock> extractBasicBlocks(const std::string& code, std::string& hoisted);
+    std::string generateDispatcher(const std::vector<BasicBlock>& blocks,
+                                   const std::string& hoisted);
 };
 
 // 代码验证器
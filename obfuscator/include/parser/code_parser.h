@@ -4,7 +4,11 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <cstdint>
 #include <memory>
+#include <string_view>
+#include <functional>
 
 namespace obfuscator {
 
@@ -43,6 +47,43 @@ struct FunctionInfo {
     int complexity;  // 圈复杂度
 };
 
+// 字符串字面量信息（由词法扫描得到）
+struct StringLiteralInfo {
+    std::string raw;        // 引号内的原始文本
+    std::string value;      // 展开转义后的字节序列
+    size_t startPos = 0;        // 字面量起始位置（含前缀）
+    size_t endPos = 0;          // 闭引号之后的位置
+    int lineNumber = 0;
+    bool rewritable = false;    // 能否安全替换为 const char* 表达式
+    size_t declInsertPos = 0;   // 此前最近的顶层安全插入点（用于放置辅助声明）
+};
+
+// 数值初始化的数据数组信息（如 unsigned char blob[] = {0x12, 0x34, ...};）
+struct DataArrayInfo {
+    std::string name;
+    std::string elementType;    // 元素类型（已去掉 static/const 等修饰）
+    bool isStatic = false;
+    size_t declStart = 0;       // 声明语句起始位置
+    size_t bodyStart = 0;       // '{' 的位置
+    size_t bodyEnd = 0;         // '}' 之后的位置
+    size_t elementCount = 0;
+    int lineNumber = 0;
+    size_t declInsertPos = 0;   // 此前最近的顶层安全插入点
+};
+
+// 文件作用域声明的函数或变量名（由词法扫描得到）
+struct FileScopeName {
+    std::string name;
+    bool isStatic = false;      // 内部链接（static/constexpr/thread_local 声明）
+    int lineNumber = 0;
+};
+
+// 函数体中可以插入新语句的位置（一条完整语句所在行之后）
+struct StatementSlot {
+    size_t offset = 0;      // 该行换行符之后的位置
+    std::string indent;     // 该行的缩进
+};
+
 // C/C++代码解析器
 class CodeParser {
 public:
@@ -64,6 +105,36 @@ public:
     // 获取所有字符串字面量
     std::vector<std::string> getStringLiterals() const;
 
+    // 获取字符串字面量的详细信息
+    const std::vector<StringLiteralInfo>& getStringLiteralInfos() const { return m_literalInfos; }
+
+    // 词法扫描源码中的字符串字面量（跳过注释、字符常量，识别上下文）
+    static std::vector<StringLiteralInfo> scanStringLiterals(const std::string& sourceCode);
+
+    // 扫描顶层的数值初始化数组，只返回元素数不少于 minElements 的
+    static std::vector<DataArrayInfo> scanDataArrays(const std::string& sourceCode,
+                                                     size_t minElements = 0);
+
+    // 扫描顶层声明的函数与变量名（不含结构体内、命名空间内和初始化式中的名字）
+    static std::vector<FileScopeName> scanFileScopeNames(const std::string& sourceCode);
+
+    // 统计标识符在 [begin, end) 中出现的次数（含预处理行，不含注释、字符串和字符常量）
+    static size_t countIdentifier(const std::string& sourceCode, const std::string& name,
+                                  size_t begin = 0, size_t end = std::string::npos);
+
+    // 标识符在 [begin, end) 中各次出现的起始位置（跳过规则同 countIdentifier）
+    static std::vector<size_t> findIdentifier(const std::string& sourceCode, const std::string& name,
+                                              size_t begin = 0, size_t end = std::string::npos);
+
+    // 将数组初始化列表 {...} 解码为字节序列（每个元素截断为8位）
+    static bool decodeByteList(const std::string& sourceCode, const DataArrayInfo& array,
+                               std::string& bytes);
+
+    // 逐行扫描函数体（不含外层花括号），找出可以追加一条语句的行：
+    // 以分号结束、不在聚合初始化/结构体/跨行表达式/预处理指令中，
+    // 不是无花括号分支体，也不是跳转语句（其后代码不可达）
+    static std::vector<StatementSlot> findStatementSlots(const std::string& body);
+
     // 提取控制流图
     struct ControlFlowGraph {
         struct Node {
@@ -87,8 +158,13 @@ private:
     std::vector<FunctionInfo> m_functions;
     std::map<std::string, std::vector<std::string>> m_variables;
     std::vector<std::string> m_stringLiterals;
+    std::vector<StringLiteralInfo> m_literalInfos;
     std::shared_ptr<CodeElement> m_ast;
 
+    // 元素数达到此值的数据数组在函数/变量解析时跳过
+    static constexpr size_t kLargeArrayElements = 256;
+
+    std::vector<std::pair<size_t, size_t>> codeSegments() const;
     void parseFunctions();
     void parseVariables();
     void parseStringLiterals();
@@ -97,6 +173,15 @@ private:
     std::string extractFunctionBody(size_t startPos);
 };
 
+// 汇编源码行的类别
+enum class AsmLineKind {
+    BLANK,
+    COMMENT,
+    LABEL,          // name: / .L3: / 1:
+    DIRECTIVE,      // 以 . 开头的伪指令
+    INSTRUCTION
+};
+
 // 汇编代码解析器
 class AssemblyParser {
 public:
@@ -105,19 +190,135 @@ public:
     // 解析汇编代码
     bool parse(const std::string& asmCode);
 
-    // 指令信息
+    // 判断一行 GAS 汇编的类别（不需要上下文，可用于流式处理）
+    static AsmLineKind classifyLine(const std::string& line);
+
+    // ".type name, @function" 中的函数名，".size name, ..." 中的符号名；其他行返回空
+    static std::string functionTypeDirective(const std::string& line);
+    static std::string sizeDirective(const std::string& line);
+
+    // 助记符驻留为进程内共享的操作码编号（按小写），同名助记符总是同一个编号，
+    // 可在多个线程中同时驻留与查询
+    using Opcode = uint16_t;
+    static constexpr Opcode kNoOpcode = 0xFFFF;
+    static Opcode internOpcode(const std::string& mnemonic);
+    static Opcode findOpcode(const std::string& mnemonic);     // 没有驻留过时返回 kNoOpcode
+    static const std::string& opcodeName(Opcode opcode);
+
+    // 标签与操作数中的符号表达式驻留为本次解析内的符号编号
+    using SymbolId = uint32_t;
+    static constexpr SymbolId kNoSymbol = 0xFFFFFFFF;
+    std::string_view symbolName(SymbolId symbol) const;
+    SymbolId findSymbol(std::string_view name) const;          // 没有出现过时返回 kNoSymbol
+
+    // 指令前缀
+    enum InstructionPrefix : uint8_t {
+        PREFIX_REP = 1 << 0,        // rep/repe/repz/xrelease（F3）
+        PREFIX_REPNE = 1 << 1,      // repne/repnz/xacquire（F2）
+        PREFIX_LOCK = 1 << 2,
+        PREFIX_NOTRACK = 1 << 3,
+        PREFIX_BND = 1 << 4,
+        PREFIX_DATA16 = 1 << 5,
+        PREFIX_ADDR32 = 1 << 6,
+        PREFIX_REX64 = 1 << 7,
+    };
+
+    // 操作数类别
+    enum class OperandKind : uint8_t {
+        NONE,
+        REGISTER,           // 通用寄存器，base 为编号
+        VECTOR_REGISTER,    // xmm/ymm/zmm/mm，base 为编号
+        OTHER_REGISTER,     // k/st/段寄存器等
+        IMMEDIATE,          // $imm、$sym，Intel 的数字与 OFFSET FLAT:sym
+        MEMORY,             // disp(base,index,scale)、[base+index*scale+disp] 或绝对地址
+        TARGET,             // 直接跳转/调用的目标
+        UNKNOWN,            // 无法解析，按读取全部寄存器处理
+    };
+    static constexpr unsigned kNoRegister = 31;
+    static constexpr unsigned kRipRegister = 16;     // rip 相对寻址的 base
+
+    // 定长的操作数描述符（8 字节）。value 是立即数或位移；symbolic 时为符号编号，
+    // wide 时为 64 位常量表的下标，读取时用 operandValue()/operandSymbol()
+    struct Operand {
+        OperandKind kind : 3;
+        uint32_t widthLog : 3;      // 位宽为 4 << widthLog（8-512），0 表示未知
+        uint32_t base : 5;          // 寄存器编号或基址，kNoRegister 表示没有
+        uint32_t index : 5;         // 变址，kNoRegister 表示没有
+        uint32_t scale : 2;         // 变址比例的 log2
+        uint32_t segment : 3;       // 段前缀：0 无，1-6 依次为 es cs ss ds fs gs
+        uint32_t indirect : 1;      // AT&T 的 *
+        uint32_t symbolic : 1;
+        uint32_t wide : 1;
+        uint32_t byteRex : 1;       // spl/bpl/sil/dil，需要 REX
+        uint32_t highByte : 1;      // ah/bh/ch/dh
+        int32_t value;
+
+        Operand()
+            : kind(OperandKind::NONE), widthLog(0), base(kNoRegister), index(kNoRegister),
+              scale(0), segment(0), indirect(0), symbolic(0), wide(0), byteRex(0), highByte(0),
+              value(0) {}
+        int width() const { return widthLog ? 4 << widthLog : 0; }
+        bool hasBase() const { return base != kNoRegister; }
+        bool hasIndex() const { return index != kNoRegister; }
+    };
+
+    // 指令（16 字节），操作数连续存放在解析器的操作数表中，用 operands() 读取
     struct Instruction {
-        std::string mnemonic;
-        std::vector<std::string> operands;
-        size_t address;
-        std::string rawBytes;
+        uint32_t address = 0;       // 估计的节内偏移
+        uint32_t line = 0;          // 所在行（从0开始）
+        uint32_t firstOperand = 0;
+        Opcode opcode = kNoOpcode;
+        uint8_t prefixes = 0;       // InstructionPrefix 的组合
+        uint8_t operandCount : 3;
+        uint8_t intelSyntax : 1;
+        uint8_t size : 4;           // 估计的编码长度（不超过 15）
+
+        Instruction() : operandCount(0), intelSyntax(0), size(0) {}
     };
 
     // 获取所有指令
-    std::vector<Instruction> getInstructions() const { return m_instructions; }
+    const std::vector<Instruction>& getInstructions() const { return m_instructions; }
+
+    // 一段连续存放的操作数
+    struct OperandRange {
+        const Operand* first;
+        const Operand* last;
+        const Operand* begin() const { return first; }
+        const Operand* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        bool empty() const { return first == last; }
+        const Operand& operator[](size_t i) const { return first[i]; }
+        const Operand& front() const { return *first; }
+        const Operand& back() const { return last[-1]; }
+    };
+    OperandRange operands(const Instruction& instr) const {
+        const Operand* first = m_operands.data() + instr.firstOperand;
+        return {first, first + instr.operandCount};
+    }
+
+    // 立即数或位移的数值（符号按 0 计），以及其中的符号（没有时为 kNoSymbol）
+    int64_t operandValue(const Operand& operand) const;
+    SymbolId operandSymbol(const Operand& operand) const {
+        return operand.symbolic ? static_cast<SymbolId>(operand.value) : kNoSymbol;
+    }
+
+    // 初始语法，解析过程中仍跟随 .intel_syntax/.att_syntax 切换
+    void setIntelSyntax(bool intelSyntax) { m_intelSyntax = intelSyntax; }
+
+    // 一段连续的编号
+    struct IndexRange {
+        const uint32_t* first;
+        const uint32_t* last;
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+    };
 
-    // 查找特定指令
-    std::vector<Instruction> findInstructions(const std::string& mnemonic);
+    // 某个操作码的全部指令下标（按指令顺序），按操作码建立的索引，开销只与结果数量有关
+    IndexRange instructionsWithOpcode(Opcode opcode) const;
+
+    // 查找特定指令（助记符不区分大小写）
+    std::vector<Instruction> findInstructions(const std::string& mnemonic) const;
 
     // 获取基本块
     struct BasicBlock {
@@ -127,25 +328,125 @@ public:
     };
     std::vector<BasicBlock> getBasicBlocks();
 
+    // 控制流图。块按指令顺序排列，块首为函数入口、标签、跳转的下一条指令；
+    // 后继与前驱以 CSR 形式存放：块 b 的后继为
+    // successors[succOffsets[b] .. succOffsets[b + 1])，前驱同理
+    struct ControlFlowGraph {
+        struct Block {
+            uint32_t firstInstruction = 0;
+            uint32_t endInstruction = 0;        // 最后一条指令之后
+            SymbolId label = kNoSymbol;         // 块首的第一个标签
+            int function = -1;                  // 在 findFunctionBoundaries() 中的下标
+            bool unknownSuccessors = false;     // 间接跳转或跳出函数（尾调用）
+        };
+
+        using Range = IndexRange;
+
+        std::vector<Block> blocks;
+        std::vector<uint32_t> succOffsets;
+        std::vector<uint32_t> successors;
+        std::vector<uint32_t> predOffsets;
+        std::vector<uint32_t> predecessors;
+
+        Range successorsOf(size_t block) const {
+            return {successors.data() + succOffsets[block], successors.data() + succOffsets[block + 1]};
+        }
+        Range predecessorsOf(size_t block) const {
+            return {predecessors.data() + predOffsets[block],
+                    predecessors.data() + predOffsets[block + 1]};
+        }
+    };
+    const ControlFlowGraph& getCFG() const { return m_cfg; }
+
     // 查找跳转目标
     std::vector<size_t> findJumpTargets();
 
-    // 查找函数边界
+    // 对齐伪指令（.p2align/.balign/.align）
+    struct Alignment {
+        size_t line = 0;
+        size_t nextInstruction = 0;     // 其后第一条指令的下标
+        size_t address = 0;             // 填充之前的估计地址
+        unsigned boundary = 1;          // 对齐字节数
+        unsigned maxSkip = 0;           // 最多填充的字节数，需要更多时不对齐
+        unsigned padding = 0;           // 估计的填充字节数
+    };
+    const std::vector<Alignment>& getAlignments() const { return m_alignments; }
+
+    // 解析对齐伪指令，不是对齐伪指令时返回 false
+    static bool parseAlignment(const std::string& line, unsigned& boundary, unsigned& maxSkip);
+
+    // 估计指令的编码长度（前缀、REX/VEX、操作码、ModRM/SIB、位移与立即数）。
+    // 直接跳转默认按 rel8 计，nearBranch 时按 rel32；parse() 中按目标距离选择
+    unsigned estimateSize(const Instruction& instr, bool nearBranch = false) const;
+
+    // 查找函数边界（.type name,@function 的标签到 .size name；
+    // 没有 .type 时以非局部标签为函数入口）
     struct FunctionBoundary {
         std::string name;
         size_t startAddr;
         size_t endAddr;
+        size_t firstInstruction = 0;
+        size_t endInstruction = 0;
     };
     std::vector<FunctionBoundary> findFunctionBoundaries();
 
+    // 指令的控制流类别（由操作码决定，兼容 AT&T 的 q/l 后缀）
+    enum class BranchKind {
+        NONE,
+        CALL,
+        JUMP,           // 无条件跳转
+        CONDITIONAL,    // 条件跳转、loop、jrcxz
+        RETURN,         // ret 以及 ud2/hlt 等不会继续执行的指令
+    };
+    static BranchKind branchKind(const Instruction& instr);
+
+    // 寄存器集合：位 0-15 依次为 rax rcx rdx rbx rsp rbp rsi rdi r8-r15（硬件编号），
+    // 位 16 为 EFLAGS（整体跟踪，只改写部分标志位的指令不算定值）
+    using RegisterMask = uint32_t;
+    static constexpr RegisterMask kFlagsMask = 1u << 16;
+    static constexpr RegisterMask kAllRegisters = 0x1FFFF;
+
+    // 通用寄存器名（可带 %）的编号与位宽，不是通用寄存器时返回 -1
+    static int registerIndex(const std::string& name, int* width = nullptr);
+    static std::string registerName(int index, int width);
+
+    // 指令读取的寄存器与完整改写的寄存器。只能多报读取、少报改写：
+    // 不认识的指令视为读取全部寄存器，部分改写（8/16位、条件改写）只算读取
+    struct RegisterEffects {
+        RegisterMask uses = 0;
+        RegisterMask defs = 0;
+    };
+    RegisterEffects registerEffects(const Instruction& instr) const;
+
+    // 在 CFG 上做逆向活跃性分析，返回每条指令之前活跃的寄存器。
+    // call/ret、间接跳转和跳出函数处视为全部活跃：-fipa-ra 编译的调用者可能依赖
+    // 被调函数不改写某些调用者保存寄存器，异常着陆块也从调用点继承寄存器
+    std::vector<RegisterMask> computeLiveness() const;
+
 private:
-    std::string m_asmCode;
     std::vector<Instruction> m_instructions;
-    std::map<std::string, size_t> m_labels;
-
-    Instruction parseInstruction(const std::string& line);
+    std::vector<Operand> m_operands;
+    std::vector<int64_t> m_wideValues;                      // 超出 32 位的立即数与位移
+    std::string m_symbolText;                   // 全部符号名首尾相接
+    std::vector<uint32_t> m_symbolOffsets;      // 符号 i 的名字为 [offsets[i], offsets[i + 1])
+    std::vector<uint32_t> m_symbolSlots;        // 开放寻址的名字索引，存符号编号 + 1，0 为空
+    std::vector<uint32_t> m_labelTargets;   // 符号编号 -> 标签之后第一条指令，不是标签时为 UINT32_MAX
+    std::unordered_map<Opcode, uint32_t> m_opcodeSlots;     // 操作码 -> 索引中的槽位
+    std::vector<uint32_t> m_opcodeOffsets;
+    std::vector<uint32_t> m_opcodeInstructions;
+    std::vector<FunctionBoundary> m_functionBounds;
+    std::vector<Alignment> m_alignments;
+    ControlFlowGraph m_cfg;
+    bool m_intelSyntax = false;
+
+    SymbolId internSymbol(std::string_view name);
+    size_t symbolSlot(std::string_view name) const;
+    void buildCFG(const std::vector<std::pair<uint32_t, SymbolId>>& labelOrder);
+    void buildOpcodeIndex();
+    Instruction parseInstruction(const std::string& line, bool intelSyntax);
+    Operand parseOperand(std::string text, bool intelSyntax);
+    void setOperandValue(Operand& operand, const std::string& text);
     bool isLabel(const std::string& line);
-    bool isJumpInstruction(const std::string& mnemonic);
 };
 
 // 抽象语法树构建器
@@ -0,0 +1,126 @@
+#ifndef OBF_RESOURCE_H
+#define OBF_RESOURCE_H
+
+/* 加密资源的流式解密（仅头文件，C99 / C++ 均可使用）
+ *
+ * 用法:
+ *   static const unsigned char blob[] = {0x12, 0x34, ...};
+ *   OBF_RESOURCE_PLAIN(blob);
+ *
+ *   unsigned char buf[4096];
+ *   size_t off = 0, n;
+ *   while ((n = obf_resource_read(&blob_resource, off, buf, sizeof(buf))) > 0) {
+ *       consume(buf, n);
+ *       off += n;
+ *   }
+ *
+ * 密文使用计数器模式的流密码：每64字节一个分块，分块内16个32位密钥流字
+ * 互相独立，可被编译器展开为向量运算。任意偏移都可以直接定位到所在分块，
+ * 因此解密只写入调用者提供的缓冲区，不会在内存中生成完整的明文副本。
+ *
+ * OBF_RESOURCE_PLAIN 在混淆前直接以明文数组定义 blob_resource，源码不经混淆
+ * 也能编译运行；--encrypt-resources 把数组和这一行一起替换为密文和加密描述符。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define OBF_RESOURCE_CHUNK 64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define OBF_RESOURCE_RESTRICT __restrict
+#else
+#define OBF_RESOURCE_RESTRICT
+#endif
+
+typedef struct obf_resource {
+    const unsigned char* data;  /* 密文 */
+    size_t size;                /* 明文字节数 */
+    uint32_t key[4];
+    uint32_t nonce;
+    uint32_t plain;             /* 非0: OBF_RESOURCE_PLAIN 的明文回退，data 即明文 */
+} obf_resource;
+
+#define OBF_RESOURCE_PLAIN(name)                                                  \
+    static const obf_resource name##_resource = {                                 \
+        (const unsigned char*)(name), sizeof(name), {0u, 0u, 0u, 0u}, 0u, 1u      \
+    }
+
+static inline uint32_t obf_resource_mix(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/* 生成第 chunk 个分块的64字节密钥流（小端序） */
+static inline void obf_resource_keystream(const obf_resource* r, uint64_t chunk,
+                                          unsigned char out[OBF_RESOURCE_CHUNK]) {
+    uint32_t base = (uint32_t)(chunk * 16u);
+    int j;
+    for (j = 0; j < 16; ++j) {
+        uint32_t x = (base + (uint32_t)j) ^ r->key[j & 3];
+        x = obf_resource_mix(x + r->nonce);
+        x ^= r->key[(j + 1) & 3];
+        x = obf_resource_mix(x);
+        out[4 * j + 0] = (unsigned char)(x);
+        out[4 * j + 1] = (unsigned char)(x >> 8);
+        out[4 * j + 2] = (unsigned char)(x >> 16);
+        out[4 * j + 3] = (unsigned char)(x >> 24);
+    }
+}
+
+static inline size_t obf_resource_size(const obf_resource* r) {
+    return r->size;
+}
+
+/* 从 offset 处解密最多 n 字节到 dst，返回实际写入的字节数（到达末尾时为0） */
+static inline size_t obf_resource_read(const obf_resource* r, size_t offset,
+                                       void* dst, size_t n) {
+    unsigned char* OBF_RESOURCE_RESTRICT out = (unsigned char*)dst;
+    unsigned char ks[OBF_RESOURCE_CHUNK];
+    size_t done = 0;
+
+    if (offset >= r->size) {
+        return 0;
+    }
+    if (n > r->size - offset) {
+        n = r->size - offset;
+    }
+    if (r->plain) {
+        memcpy(out, r->data + offset, n);
+        return n;
+    }
+
+    while (done < n) {
+        size_t pos = offset + done;
+        size_t in = pos % OBF_RESOURCE_CHUNK;
+        size_t take = OBF_RESOURCE_CHUNK - in;
+        const unsigned char* OBF_RESOURCE_RESTRICT src = r->data + pos;
+        unsigned char* OBF_RESOURCE_RESTRICT d = out + done;
+        size_t j;
+
+        if (take > n - done) {
+            take = n - done;
+        }
+        obf_resource_keystream(r, pos / OBF_RESOURCE_CHUNK, ks);
+
+        if (take == OBF_RESOURCE_CHUNK) {
+            /* 整块：固定次数的循环，编译为向量异或 */
+            for (j = 0; j < OBF_RESOURCE_CHUNK; ++j) {
+                d[j] = (unsigned char)(src[j] ^ ks[j]);
+            }
+        } else {
+            for (j = 0; j < take; ++j) {
+                d[j] = (unsigned char)(src[j] ^ ks[in + j]);
+            }
+        }
+        done += take;
+    }
+    return done;
+}
+
+#endif /* OBF_RESOURCE_H */
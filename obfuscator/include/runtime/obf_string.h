@@ -0,0 +1,144 @@
+#ifndef OBF_STRING_H
+#define OBF_STRING_H
+
+// 编译期字符串加密（仅头文件，C++17 起可用）
+//
+// 用法:
+//   puts(OBF_STR("secret message"));
+//
+// 密文在编译期由 constexpr 生成，二进制中不出现明文；首次访问时解密到静态缓冲区，
+// 之后每次访问只有一次 acquire 读取和一次分支。不提供以字符串为非类型模板实参的
+// 接口：模板实参会原样出现在修饰后的符号名中。
+// 定义 OBF_SEED 可改变所有密钥（例如每次发布使用不同的种子）。
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef OBF_SEED
+#define OBF_SEED 0x9e3779b97f4a7c15ULL
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define OBF_STR_LIKELY(x) __builtin_expect(!!(x), 1)
+#define OBF_STR_NOINLINE __attribute__((noinline))
+#define OBF_STR_RESTRICT __restrict
+#else
+#define OBF_STR_LIKELY(x) (x)
+#define OBF_STR_NOINLINE
+#define OBF_STR_RESTRICT
+#endif
+
+namespace obf {
+namespace detail {
+
+constexpr std::size_t kBlockSize = 16;
+
+constexpr std::size_t paddedSize(std::size_t n) {
+    return (n + kBlockSize - 1) / kBlockSize * kBlockSize;
+}
+
+constexpr std::uint64_t fnv1a(const char* s, std::size_t n) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (std::size_t i = 0; i < n; ++i) {
+        h = (h ^ static_cast<unsigned char>(s[i])) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+constexpr std::uint64_t splitmix64(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+constexpr std::uint64_t makeSeed(std::uint64_t file, std::uint64_t counter, std::uint64_t line) {
+    return splitmix64(OBF_SEED ^ file ^ splitmix64(counter << 32 | line));
+}
+
+constexpr unsigned char keyByte(std::uint64_t seed, std::size_t i) {
+    return static_cast<unsigned char>(splitmix64(seed + i / 8) >> (8 * (i % 8)));
+}
+
+// 编译期密文：明文连同结尾'\0'补齐到16字节整数倍后与16字节密钥异或
+template <std::size_t N, std::uint64_t Seed>
+struct EncryptedString {
+    static constexpr std::size_t kSize = paddedSize(N);
+
+    alignas(16) unsigned char data[kSize] = {};
+    unsigned char key[kBlockSize] = {};
+
+    constexpr explicit EncryptedString(const char (&str)[N]) {
+        for (std::size_t j = 0; j < kBlockSize; ++j) {
+            key[j] = keyByte(Seed, j);
+        }
+        for (std::size_t i = 0; i < kSize; ++i) {
+            unsigned char plain = i < N ? static_cast<unsigned char>(str[i])
+                                        : keyByte(Seed ^ 0xa5a5a5a5ULL, i);
+            data[i] = static_cast<unsigned char>(plain ^ key[i % kBlockSize]);
+        }
+    }
+};
+
+// 按16字节分块异或：块内循环次数固定且无别名，可被编译为单条向量异或
+inline void xorBlocks(unsigned char* OBF_STR_RESTRICT dst,
+                      const unsigned char* OBF_STR_RESTRICT src,
+                      const unsigned char* OBF_STR_RESTRICT key,
+                      std::size_t n) {
+    for (std::size_t c = 0; c < n; c += kBlockSize) {
+        unsigned char* d = dst + c;
+        const unsigned char* s = src + c;
+        for (std::size_t j = 0; j < kBlockSize; ++j) {
+            d[j] = static_cast<unsigned char>(s[j] ^ key[j]);
+        }
+    }
+}
+
+// 解密缓存。状态: 0=未解密, 1=解密中, 2=已解密
+// 所有成员都有常量初始化，函数内的静态实例不需要 __cxa_guard 检查
+template <std::size_t Size>
+struct DecryptedBuffer {
+    alignas(16) unsigned char data[Size]{};
+    std::atomic<int> state{0};
+};
+
+template <std::size_t Size>
+OBF_STR_NOINLINE const char* decryptOnce(DecryptedBuffer<Size>& buffer,
+                                         const unsigned char* src,
+                                         const unsigned char* key) {
+    int expected = 0;
+    if (buffer.state.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+        xorBlocks(buffer.data, src, key, Size);
+        buffer.state.store(2, std::memory_order_release);
+    } else {
+        while (buffer.state.load(std::memory_order_acquire) != 2) {
+        }
+    }
+    return reinterpret_cast<const char*>(buffer.data);
+}
+
+template <std::size_t N, std::uint64_t Seed>
+inline const char* get(const EncryptedString<N, Seed>& enc,
+                       DecryptedBuffer<EncryptedString<N, Seed>::kSize>& buffer) {
+    if (OBF_STR_LIKELY(buffer.state.load(std::memory_order_acquire) == 2)) {
+        return reinterpret_cast<const char*>(buffer.data);
+    }
+    return decryptOnce(buffer, enc.data, enc.key);
+}
+
+} // namespace detail
+} // namespace obf
+
+// 每个展开点是一个独立的lambda，拥有各自的密钥、密文和解密缓存
+#define OBF_STR(str)                                                                     \
+    ([]() -> const char* {                                                               \
+        constexpr std::uint64_t obf_seed_ = ::obf::detail::makeSeed(                     \
+            ::obf::detail::fnv1a(__FILE__, sizeof(__FILE__)), __COUNTER__, __LINE__);    \
+        static constexpr ::obf::detail::EncryptedString<sizeof(str), obf_seed_> obf_enc_(str); \
+        static ::obf::detail::DecryptedBuffer<                                           \
+            ::obf::detail::EncryptedString<sizeof(str), obf_seed_>::kSize> obf_buf_;     \
+        return ::obf::detail::get(obf_enc_, obf_buf_);                                   \
+    }())
+
+#endif // OBF_STRING_H
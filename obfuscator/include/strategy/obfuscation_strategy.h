@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstdint>
 
 namespace obfuscator {
 
@@ -70,10 +71,15 @@ public:
 
     void setFlattenDepth(int depth) { m_flattenDepth = depth; }
     void setAddFakeBranches(bool add) { m_addFakeBranches = add; }
+    void setFakeBranchProbability(float probability) { m_fakeBranchProbability = probability; }
+    // 块布局保留热路径局部性的程度（0=完全随机，1=热循环连续排布）
+    void setLayoutLocality(float locality) { m_layoutLocality = locality; }
 
 private:
     int m_flattenDepth = 2;
     bool m_addFakeBranches = true;
+    float m_fakeBranchProbability = 0.2f;
+    float m_layoutLocality = 0.75f;
 };
 
 // 不透明谓词策略
@@ -88,10 +94,26 @@ public:
     enum class Complexity { LOW, MEDIUM, HIGH };
     void setComplexity(Complexity c) { m_complexity = c; }
 
+    // 每个函数的谓词开销预算（估算周期数），0 表示按 Complexity 取默认值（--predicate-cycles）
+    void setCostBudget(int cycles) { m_costBudget = cycles; }
+    // 启用指针别名类谓词（--pointer-aliasing）
+    void setPointerAliasing(bool enable) { m_pointerAliasing = enable; }
+
 private:
     Complexity m_complexity = Complexity::MEDIUM;
-
-    std::string generateOpaquePredicate(bool alwaysTrue);
+    int m_costBudget = 0;
+    bool m_pointerAliasing = false;
+
+    // 谓词的输入来自文件作用域的不变量表，值在生成时已知，
+    // 只有永不执行的冷函数会改写它们，编译器因此无法折叠
+    static constexpr size_t kTableSize = 8;
+    std::string m_id;
+    uint32_t m_table[kTableSize] = {};
+    size_t m_aliasIndex[2] = {};
+
+    // 生成开销不超过 maxCycles 的谓词表达式，cycles 返回其开销；没有可用谓词时返回空串
+    std::string generateOpaquePredicate(bool alwaysTrue, int maxCycles, int& cycles);
+    std::string generateSupportCode() const;
 };
 
 // 字符串加密策略
@@ -107,11 +129,52 @@ public:
     void setAlgorithm(Algorithm algo) { m_algorithm = algo; }
     void setMinLength(int len) { m_minLength = len; }
 
+    // 密文存储方式：每个字符串独立数组，或整个翻译单元共用一个连续的字符串池
+    enum class Storage { PER_STRING, POOLED };
+    void setStorage(Storage storage) { m_storage = storage; }
+
+    // 字符串池的解密时机：启动时整体解密、首次使用时按字符串解密、按页解密
+    enum class DecryptPolicy { EAGER, LAZY_STRING, LAZY_PAGE };
+    void setDecryptPolicy(DecryptPolicy policy) { m_decryptPolicy = policy; }
+
+    // 按页解密时的页大小
+    static constexpr size_t kPoolPageSize = 4096;
+
+    // C++ 目标：字面量替换为 OBF_STR("...")，由编译期加密头文件完成加密，
+    // 不再生成解密桩代码
+    void setCompileTimeEncryption(bool enable) { m_compileTime = enable; }
+    void setRuntimeHeader(const std::string& header) { m_runtimeHeader = header; }
+
+    // 资源模式：顶层的大型 static 字节数组（static unsigned char blob[] = {...}）以流密码加密，
+    // 运行时通过 obf_resource_read() 分块解密到调用者的缓冲区；源码中紧随其后的
+    // OBF_RESOURCE_PLAIN(blob); 明文回退一并删除，数组名还有其他引用时跳过
+    void setResourceEncryption(bool enable) { m_encryptResources = enable; }
+    void setResourceMinSize(size_t bytes) { m_resourceMinSize = bytes; }
+    void setResourceHeader(const std::string& header) { m_resourceHeader = header; }
+
 private:
     Algorithm m_algorithm = Algorithm::XOR;
     int m_minLength = 4;
-
-    std::string encryptString(const std::string& str, uint8_t key);
+    Storage m_storage = Storage::PER_STRING;
+    DecryptPolicy m_decryptPolicy = DecryptPolicy::LAZY_STRING;
+    bool m_compileTime = false;
+    std::string m_runtimeHeader = "<obfuscator/runtime/obf_string.h>";
+    bool m_encryptResources = false;
+    size_t m_resourceMinSize = 4096;
+    std::string m_resourceHeader = "<obfuscator/runtime/obf_resource.h>";
+
+    std::string encryptString(const std::string& str, const std::vector<uint8_t>& key);
+
+    // 生成声明代码，并返回每个字符串对应的访问函数名
+    std::string generatePerStringCode(const std::vector<std::string>& values,
+                                      const std::string& tag,
+                                      std::vector<std::string>& accessors);
+    std::string generatePooledCode(const std::vector<std::string>& values,
+                                   const std::string& tag,
+                                   std::vector<std::string>& accessors);
+
+    // 生成替换原数组声明的密文数组和 obf_resource 描述符
+    std::string generateResourceCode(const std::string& name, const std::string& bytes);
 };
 
 // 符号混淆策略
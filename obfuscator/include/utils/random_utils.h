@@ -5,6 +5,8 @@
 #include <vector>
 #include <random>
 #include <cstdint>
+#include <algorithm>
+#include <stdexcept>
 
 namespace obfuscator {
 namespace utils {
@@ -101,9 +103,32 @@ public:
     // 简单的替换加密（Caesar cipher变体）
     static std::string substitutionEncrypt(const std::string& data, int shift);
 
-    // 生成解密代码片段（用于运行时解密）
+    // 运行时解密的分块大小（密文按此长度对齐，便于编译器向量化）
+    static constexpr size_t kDecryptBlockSize = 16;
+
+    // 将明文补齐为分块大小的整数倍（含结尾'\0'，填充随机字节）
+    static std::string padToBlock(const std::string& data);
+
+    // 以C数组初始化列表形式格式化字节序列（每行16字节）
+    static std::string formatByteList(const std::string& data);
+
+    // 资源流密码的分块大小（与 runtime/obf_resource.h 的 OBF_RESOURCE_CHUNK 一致）
+    static constexpr size_t kStreamChunkSize = 64;
+
+    // 计数器模式流密码：第 chunk 块的密钥流由 key、nonce 和块号独立导出，
+    // 加密与解密是同一操作，运行时可从任意偏移开始流式解密
+    static void streamKeystream(const uint32_t key[4], uint32_t nonce, uint64_t chunk,
+                                uint8_t out[kStreamChunkSize]);
+    static std::string streamEncrypt(const std::string& data, const uint32_t key[4],
+                                     uint32_t nonce);
+
+    // 生成运行时解密支持代码（每个翻译单元只需输出一次）
+    static std::string generateDecryptionRuntime();
+
+    // 生成解密一次的访问函数 varName()，返回解密后的字符串
+    // encryptedData 长度须为 kDecryptBlockSize 的整数倍，key 长度为 kDecryptBlockSize
     static std::string generateDecryptionCode(const std::string& encryptedData,
-                                             uint8_t key,
+                                             const std::vector<uint8_t>& key,
                                              const std::string& varName);
 };
 
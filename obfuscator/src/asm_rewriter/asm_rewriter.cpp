@@ -1,96 +1,628 @@
-#include <string>
-#include <vector>
-#include <sstream>
+#include "asm_rewriter/asm_rewriter.h"
+#include "parser/code_parser.h"
+#include "utils/logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <deque>
+#include <future>
 #include <iostream>
-#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace obfuscator {
 
-// 汇编重写器实现
-class AsmRewriter {
-public:
-    AsmRewriter() : m_gen(std::random_device{}()) {}
+namespace {
+
+// FNV-1a：与平台无关的字符串哈希，用于从函数名派生随机种子
+uint32_t fnv1a(const std::string& text) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
 
-    // 在汇编代码中插入垃圾指令
-    std::string insertJunkInstructions(const std::string& asmCode, float density = 0.3f) {
-        std::vector<std::string> lines = splitLines(asmCode);
-        std::stringstream result;
+std::string trimmed(const std::string& line) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = line.find_last_not_of(" \t\r");
+    return line.substr(start, end - start + 1);
+}
 
-        for (const auto& line : lines) {
-            result << line << "\n";
+// 指令行的助记符（小写）
+std::string mnemonicOf(const std::string& line) {
+    std::string text = trimmed(line);
+    size_t end = text.find_first_of(" \t");
+    std::string mnemonic = text.substr(0, end);
+    std::transform(mnemonic.begin(), mnemonic.end(), mnemonic.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return mnemonic;
+}
 
-            // 随机决定是否插入垃圾指令
-            if (shouldInsertJunk(density) && !isLabel(line)) {
-                result << generateJunkInstruction() << "\n";
-            }
+// 单独成行的前缀修饰下一条指令，二者之间不能插入任何指令
+bool isPrefixOnly(const std::string& line) {
+    static const std::unordered_set<std::string> prefixes = {
+        "rep", "repe", "repz", "repne", "repnz", "lock", "notrack", "bnd",
+        "data16", "addr32", "rex64", "xacquire", "xrelease"
+    };
+    std::string text = trimmed(line);
+    return text.find_first_of(" \t") == std::string::npos && prefixes.count(mnemonicOf(text)) > 0;
+}
+
+// 一条选中的花指令及其开销
+struct JunkChoice {
+    std::string text;
+    double cycles = 0.0;
+    unsigned bytes = 0;
+    bool usesLabel = false;
+};
+
+std::string formatJunk(std::string text, bool intelSyntax, int dest, int source,
+                       const std::string& imm, const std::string& label) {
+    auto reg = [intelSyntax](int index, int width) {
+        return (intelSyntax ? "" : "%") + AssemblyParser::registerName(index, width);
+    };
+    const std::pair<const char*, std::string> fields[] = {
+        {"{d32}", dest >= 0 ? reg(dest, 32) : ""}, {"{d64}", dest >= 0 ? reg(dest, 64) : ""},
+        {"{s32}", reg(source, 32)}, {"{s64}", reg(source, 64)},
+        {"{imm}", imm}, {"{label}", label},
+    };
+    for (const auto& [field, value] : fields) {
+        size_t pos;
+        while ((pos = text.find(field)) != std::string::npos) {
+            text.replace(pos, std::strlen(field), value);
         }
+    }
+    return text;
+}
 
-        return result.str();
+// 按插入点活跃的寄存器和块内剩余预算挑选花指令：只改写死寄存器，标志位活跃时
+// 不用改写标志位的模板，不访问内存和栈。开销越低权重越高，在重命名阶段就被消除的
+// 模板（NOP、归零惯用法、mov 消除）再加权。预算内没有合适的模板时返回 false
+bool chooseJunk(std::mt19937& gen, bool intelSyntax, AssemblyParser::RegisterMask live,
+                CpuModel cpu, double cycleBudget, unsigned byteBudget,
+                const std::string& label, JunkChoice& choice) {
+    const int rsp = 4;
+    std::vector<int> dead;
+    std::vector<int> any;
+    for (int r = 0; r < 16; ++r) {
+        if (r == rsp) {
+            continue;
+        }
+        any.push_back(r);
+        if (!(live & (1u << r))) {
+            dead.push_back(r);
+        }
     }
+    const bool flagsDead = !(live & AssemblyParser::kFlagsMask);
 
-    // 生成不透明谓词跳转
-    std::string insertOpaqueJump(const std::string& asmCode) {
-        std::stringstream result;
-        result << "    xor eax, eax\n";         // eax = 0
-        result << "    test eax, eax\n";        // test if 0
-        result << "    jz .L_continue\n";       // always jump
-        result << "    .byte 0xE8, 0x00, 0x00, 0x00, 0x00\n";  // fake call
-        result << ".L_continue:\n";
-        result << asmCode;
-        return result.str();
+    auto pick = [&gen](const std::vector<int>& regs) {
+        return regs[std::uniform_int_distribution<size_t>(0, regs.size() - 1)(gen)];
+    };
+    const int dest = dead.empty() ? -1 : pick(dead);
+    const int source = pick(any);
+
+    std::vector<const JunkTemplate*> fits;
+    std::vector<double> weights;
+    for (const JunkTemplate& junk : junkTemplates()) {
+        if (((junk.requirements & JUNK_NEEDS_DEAD_REGISTER) && dest < 0) ||
+            ((junk.requirements & JUNK_NEEDS_DEAD_FLAGS) && !flagsDead)) {
+            continue;
+        }
+        double cycles = junkCycles(junk, cpu);
+        if (cycles > cycleBudget + 1e-9 || junkBytes(junk, dest, source) > byteBudget) {
+            continue;
+        }
+        fits.push_back(&junk);
+        weights.push_back((junkEliminated(junk, cpu) ? 3.0 : 1.0) / std::max(cycles, 0.1));
     }
+    if (fits.empty()) {
+        return false;
+    }
+
+    const JunkTemplate& junk = *fits[std::discrete_distribution<size_t>(
+        weights.begin(), weights.end())(gen)];
+    std::string imm = std::to_string(std::uniform_int_distribution<int>(1, 127)(gen));
+    choice.text = "\t" + formatJunk(intelSyntax ? junk.intel : junk.att, intelSyntax,
+                                    dest, source, imm, label);
+    choice.cycles = junkCycles(junk, cpu);
+    choice.bytes = junkBytes(junk, dest, source);
+    choice.usesLabel = std::strstr(junk.att, "{label}") != nullptr;
+    return true;
+}
 
-    // 添加栈平衡的垃圾指令
-    std::string addStackJunk() {
-        std::vector<std::string> templates = {
-            "    push rax\n    pop rax",
-            "    push rbx\n    pop rbx",
-            "    push rcx\n    pop rcx",
-            "    pushf\n    popf"
-        };
-        return templates[randomInt(0, templates.size() - 1)];
+// 用花指令恰好填满 bytes 字节（总能以单字节 nop 收尾），labels 为函数内已用的标签数
+JunkChoice fillJunk(std::mt19937& gen, bool intelSyntax, AssemblyParser::RegisterMask live,
+                    CpuModel cpu, unsigned bytes, const std::string& name, size_t& labels) {
+    JunkChoice total;
+    while (total.bytes < bytes) {
+        JunkChoice choice;
+        std::string label = ".Lj." + name + "." + std::to_string(labels);
+        if (!chooseJunk(gen, intelSyntax, live, cpu, 1e9, bytes - total.bytes, label, choice)) {
+            break;
+        }
+        total.text += choice.text;
+        total.text += '\n';
+        total.cycles += choice.cycles;
+        total.bytes += choice.bytes;
+        labels += choice.usesLabel ? 1 : 0;
     }
+    return total;
+}
 
-private:
-    std::mt19937 m_gen;
+// 非负余数
+unsigned positiveModulo(long long value, unsigned divisor) {
+    long long rest = value % static_cast<long long>(divisor);
+    return static_cast<unsigned>(rest < 0 ? rest + divisor : rest);
+}
 
-    std::vector<std::string> splitLines(const std::string& text) {
-        std::vector<std::string> lines;
-        std::stringstream ss(text);
-        std::string line;
-        while (std::getline(ss, line)) {
-            lines.push_back(line);
+} // namespace
+
+AsmRewriter::AsmRewriter() : AsmRewriter(std::random_device{}()) {
+}
+
+AsmRewriter::AsmRewriter(uint32_t seed) : m_gen(seed), m_seed(seed) {
+}
+
+std::string AsmRewriter::insertJunkInstructions(const std::string& asmCode, float density) {
+    std::istringstream lines(asmCode);
+    std::stringstream result;
+    std::string line;
+
+    while (std::getline(lines, line)) {
+        result << line << "\n";
+
+        // 随机决定是否插入垃圾指令
+        if (shouldInsertJunk(density) && !isLabel(line)) {
+            result << generateJunkInstruction() << "\n";
         }
-        return lines;
     }
 
-    bool shouldInsertJunk(float density) {
-        std::uniform_real_distribution<> dis(0.0, 1.0);
-        return dis(m_gen) < density;
+    return result.str();
+}
+
+std::string AsmRewriter::insertOpaqueJump(const std::string& asmCode) {
+    std::stringstream result;
+    result << "    xor eax, eax\n";         // eax = 0
+    result << "    test eax, eax\n";        // test if 0
+    result << "    jz .L_continue\n";       // always jump
+    result << "    .byte 0xE8, 0x00, 0x00, 0x00, 0x00\n";  // fake call
+    result << ".L_continue:\n";
+    result << asmCode;
+    return result.str();
+}
+
+std::string AsmRewriter::addStackJunk() {
+    // 只移动栈指针，不读写栈内存，也不改变标志位
+    std::vector<std::string> templates = {
+        "    lea rsp, [rsp-8]\n    lea rsp, [rsp+8]",
+        "    lea rsp, [rsp-16]\n    lea rsp, [rsp+16]",
+        "    lea rsp, [rsp+0]"
+    };
+    return templates[randomInt(0, templates.size() - 1)];
+}
+
+// ============================================================================
+// 流式改写
+// ============================================================================
+
+std::string AsmRewriter::rewriteFunction(const std::string& name, const std::string& body,
+                                         bool intelSyntax, Statistics* stats) const {
+    // 每个函数独立的随机数流，结果与处理顺序和线程无关
+    std::seed_seq seq{m_seed, fnv1a(name)};
+    std::mt19937 gen(seq);
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+
+    // 在函数的 CFG 上计算每条指令之前活跃的寄存器，按行号索引
+    struct LineInfo {
+        AssemblyParser::RegisterMask live = AssemblyParser::kAllRegisters;
+        size_t block = SIZE_MAX;
+        bool conditionalBranch = false;
+    };
+    std::vector<LineInfo> lineInfo;
+
+    // 对齐伪指令之后的块首：循环头按 32 字节取指窗口留出的余量
+    struct AlignedLoop {
+        size_t firstLine = 0;
+        size_t lastLine = 0;
+        unsigned slack = 0;
+    };
+    struct AlignmentInfo {
+        AssemblyParser::Alignment alignment;
+        AssemblyParser::RegisterMask live = AssemblyParser::kAllRegisters;
+        bool follows = false;       // 紧跟在同一块首的另一条对齐伪指令之后
+    };
+    std::vector<AlignedLoop> loops;
+    std::unordered_map<size_t, AlignmentInfo> alignments;
+
+    AssemblyParser parser;
+    parser.setIntelSyntax(intelSyntax);
+    if (parser.parse(body)) {
+        std::vector<AssemblyParser::RegisterMask> live = parser.computeLiveness();
+        const auto& instructions = parser.getInstructions();
+        const auto& cfg = parser.getCFG();
+        if (!instructions.empty()) {
+            lineInfo.resize(instructions.back().line + 1);
+        }
+        std::unordered_map<size_t, size_t> blockStarting;
+        for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+            blockStarting[cfg.blocks[b].firstInstruction] = b;
+            for (size_t i = cfg.blocks[b].firstInstruction; i < cfg.blocks[b].endInstruction; ++i) {
+                LineInfo& info = lineInfo[instructions[i].line];
+                info.live = live[i];
+                info.block = b;
+                info.conditionalBranch = AssemblyParser::branchKind(instructions[i]) ==
+                                         AssemblyParser::BranchKind::CONDITIONAL;
+            }
+        }
+
+        // 同一个块首前的多条对齐伪指令（.p2align 4,,10 / .p2align 3）按一次处理，
+        // 循环起点按其中保证生效的最大对齐计算
+        std::unordered_map<size_t, unsigned> headerAlignment;
+        size_t previous = SIZE_MAX;
+        for (const auto& alignment : parser.getAlignments()) {
+            AlignmentInfo info{alignment, AssemblyParser::kAllRegisters,
+                               previous == alignment.nextInstruction};
+            previous = alignment.nextInstruction;
+            if (alignment.nextInstruction < instructions.size()) {
+                info.live = live[alignment.nextInstruction];
+                unsigned& guaranteed = headerAlignment[alignment.nextInstruction];
+                if (alignment.maxSkip + 1 >= alignment.boundary ||
+                    alignment.padding > 0 || alignment.address % alignment.boundary == 0) {
+                    guaranteed = std::max(guaranteed, alignment.boundary);
+                }
+            }
+            alignments[alignment.line] = info;
+        }
+
+        // 回边指向对齐块首的循环：插入后循环跨越的 32 字节窗口数不能增加
+        const unsigned window = 32;
+        for (const auto& [first, boundary] : headerAlignment) {
+            auto header = blockStarting.find(first);
+            if (header == blockStarting.end()) {
+                continue;
+            }
+            // 回边来自块首之后最远的前驱
+            size_t latch = SIZE_MAX;
+            for (uint32_t pred : cfg.predecessorsOf(header->second)) {
+                if (pred >= header->second && (latch == SIZE_MAX || pred > latch)) {
+                    latch = pred;
+                }
+            }
+            if (latch == SIZE_MAX) {
+                continue;
+            }
+            const auto& last = instructions[cfg.blocks[latch].endInstruction - 1];
+            unsigned size = static_cast<unsigned>(last.address + last.size -
+                                                  instructions[first].address);
+            unsigned step = std::min(std::max(boundary, 1u), window);
+            AlignedLoop loop{instructions[first].line, last.line, window};
+            for (unsigned offset = 0; offset < window; offset += step) {
+                long long end = static_cast<long long>(offset) + size;
+                loop.slack = std::min(loop.slack, positiveModulo(-end, window));
+            }
+            loops.push_back(loop);
+        }
     }
+    // 按起始行扫描：activeLoops 是包含当前行的循环，嵌套深度通常很小
+    std::sort(loops.begin(), loops.end(), [](const AlignedLoop& a, const AlignedLoop& b) {
+        return a.firstLine < b.firstLine;
+    });
+    std::vector<unsigned> loopLeft;
+    for (const auto& loop : loops) {
+        loopLeft.push_back(loop.slack);
+    }
+    std::vector<size_t> activeLoops;
+    size_t nextLoop = 0;
+
+    std::istringstream lines(body);
+    std::string result;
+    result.reserve(body.size() + body.size() / 4);
+    std::string line;
+    bool afterPrefix = false;
+    size_t lineNumber = 0;
+    size_t labels = 0;
+    size_t currentBlock = SIZE_MAX;
+    double cyclesLeft = m_blockCycles;
+    unsigned bytesLeft = m_blockBytes;
+    long long shift = 0;        // 估计的累计偏移，用于推算对齐填充
+    Statistics local;
+
+    auto emit = [&](const JunkChoice& choice) {
+        result += choice.text;
+        shift += choice.bytes;
+        local.cycles += choice.cycles;
+        local.bytes += choice.bytes;
+    };
 
-    bool isLabel(const std::string& line) {
-        return line.find(':') != std::string::npos && line.find_first_not_of(" \t") == 0;
+    while (std::getline(lines, line)) {
+        size_t current = lineNumber++;
+        AsmLineKind kind = AssemblyParser::classifyLine(line);
+        if (kind == AsmLineKind::DIRECTIVE) {
+            std::string text = trimmed(line);
+            if (text.compare(0, 13, ".intel_syntax") == 0) {
+                intelSyntax = true;
+            } else if (text.compare(0, 11, ".att_syntax") == 0) {
+                intelSyntax = false;
+            }
+        }
+
+        // 对齐伪指令：插入花指令后，带填充上限的 .p2align 4,,10 可能因为需要的填充超过
+        // 上限而不再对齐。原来对齐了的块首去掉上限，由汇编器保证仍然对齐（入口路径上至多
+        // 多几个字节的 NOP）。花指令会让短跳转变长，按字节数推算的偏移并不可靠，所以不靠
+        // 补齐字节数来维持同余。开启对齐填充时，用花指令代替汇编器在无上限伪指令前填充的
+        // NOP；填充量来自长度估计，估多了也只是多填一轮，因此只替换一组伪指令中的第一条
+        auto found = alignments.find(current);
+        if (found != alignments.end() && !afterPrefix) {
+            const AssemblyParser::Alignment& alignment = found->second.alignment;
+            const unsigned boundary = alignment.boundary;
+            const long long address = static_cast<long long>(alignment.address);
+            bool limited = alignment.maxSkip + 1 < boundary;
+            if (limited && positiveModulo(-address, boundary) <= alignment.maxSkip) {
+                line = line.substr(0, line.find(','));
+                limited = false;
+            }
+            unsigned padding = positiveModulo(-address - shift, boundary);
+            if (!limited && !found->second.follows && m_alignmentPadding && padding > 0) {
+                JunkChoice choice = fillJunk(gen, intelSyntax, found->second.live, m_cpu, padding,
+                                             name, labels);
+                emit(choice);
+                local.inserted += std::count(choice.text.begin(), choice.text.end(), '\n');
+                local.paddingBytes += choice.bytes;
+                padding = positiveModulo(-address - shift, boundary);
+            }
+            if (limited && padding > alignment.maxSkip) {
+                padding = 0;
+            }
+            shift += static_cast<long long>(padding) - alignment.padding;
+        }
+
+        // 花指令放在指令之前：前面的 .cfi 伪指令仍描述原来的地址，
+        // 跳到前面标签的路径也会执行花指令，二者都不受影响。
+        // 条件跳转之前不插入，以免拆开 cmp/test+jcc 的宏融合
+        if (kind == AsmLineKind::INSTRUCTION) {
+            LineInfo info = current < lineInfo.size() ? lineInfo[current] : LineInfo();
+            if (info.block != currentBlock) {
+                currentBlock = info.block;
+                cyclesLeft = m_blockCycles;
+                bytesLeft = m_blockBytes;
+            }
+            // 对齐循环内只用掉 32 字节窗口的余量
+            while (nextLoop < loops.size() && loops[nextLoop].firstLine <= current) {
+                activeLoops.push_back(nextLoop++);
+            }
+            activeLoops.erase(std::remove_if(activeLoops.begin(), activeLoops.end(),
+                                             [&](size_t l) { return loops[l].lastLine < current; }),
+                              activeLoops.end());
+            unsigned allowed = bytesLeft;
+            for (size_t l : activeLoops) {
+                allowed = std::min(allowed, loopLeft[l]);
+            }
+            JunkChoice choice;
+            std::string label = ".Lj." + name + "." + std::to_string(labels);
+            if (!afterPrefix && !info.conditionalBranch && dis(gen) < m_density &&
+                chooseJunk(gen, intelSyntax, info.live, m_cpu, cyclesLeft, allowed, label,
+                           choice)) {
+                choice.text += '\n';
+                emit(choice);
+                cyclesLeft -= choice.cycles;
+                bytesLeft -= choice.bytes;
+                for (size_t l : activeLoops) {
+                    loopLeft[l] -= choice.bytes;
+                }
+                labels += choice.usesLabel ? 1 : 0;
+                ++local.inserted;
+            }
+            afterPrefix = isPrefixOnly(line);
+        }
+
+        result += line;
+        result += '\n';
     }
 
-    std::string generateJunkInstruction() {
-        std::vector<std::string> junkTemplates = {
-            "    add rax, 0x10\n    sub rax, 0x10",
-            "    xor ecx, ecx\n    add ecx, 1\n    sub ecx, 1",
-            "    push rdx\n    pop rdx",
-            "    nop\n    nop",
-            "    xchg rax, rax",
-            "    mov rbx, rbx",
-            "    lea rax, [rax+0]"
-        };
+    if (stats) {
+        stats->inserted += local.inserted;
+        stats->cycles += local.cycles;
+        stats->bytes += local.bytes;
+        stats->paddingBytes += local.paddingBytes;
+    }
+    return result;
+}
+
+bool AsmRewriter::rewriteStream(std::istream& in, std::ostream& out) {
+    m_stats = Statistics();
+    unsigned threads = m_threads ? m_threads : std::max(1u, std::thread::hardware_concurrency());
+    const size_t maxInFlight = threads * 2;
+
+    // 一个批次由按原顺序排列的片段组成：函数需要改写，其余文本原样输出
+    struct Segment {
+        bool function = false;
+        bool intelSyntax = false;
+        std::string name;
+        std::string text;
+    };
+    struct Batch {
+        std::vector<Segment> segments;
+        size_t bytes = 0;
+    };
+    struct Result {
+        std::string text;
+        Statistics stats;
+    };
+
+    auto process = [this](Batch batch) {
+        Result result;
+        for (Segment& segment : batch.segments) {
+            if (segment.function) {
+                result.text += rewriteFunction(segment.name, segment.text, segment.intelSyntax,
+                                               &result.stats);
+            } else {
+                result.text += segment.text;
+            }
+        }
+        return result;
+    };
+
+    auto addStatistics = [this](const Statistics& stats) {
+        m_stats.inserted += stats.inserted;
+        m_stats.cycles += stats.cycles;
+        m_stats.bytes += stats.bytes;
+        m_stats.paddingBytes += stats.paddingBytes;
+    };
+
+    std::deque<std::pair<std::future<Result>, size_t>> window;
+    size_t pendingBytes = 0;
+    auto drainOne = [&]() {
+        Result result = window.front().first.get();
+        pendingBytes -= window.front().second;
+        window.pop_front();
+        out << result.text;
+        addStatistics(result.stats);
+    };
+
+    Batch batch;
+    auto submit = [&]() {
+        if (batch.segments.empty()) {
+            return;
+        }
+        size_t bytes = batch.bytes;
+        if (threads == 1) {
+            Result result = process(std::move(batch));
+            out << result.text;
+            addStatistics(result.stats);
+        } else {
+            window.emplace_back(std::async(std::launch::async, process, std::move(batch)), bytes);
+            pendingBytes += bytes;
+            m_stats.peakPendingBytes = std::max(m_stats.peakPendingBytes, pendingBytes);
+            while (window.size() > maxInFlight) {
+                drainOne();
+            }
+        }
+        batch = Batch();
+    };
+    auto append = [&](Segment segment) {
+        batch.bytes += segment.text.size();
+        if (!segment.function && !batch.segments.empty() && !batch.segments.back().function) {
+            batch.segments.back().text += segment.text;
+        } else {
+            batch.segments.push_back(std::move(segment));
+        }
+        if (batch.bytes >= m_batchBytes) {
+            submit();
+        }
+    };
+
+    std::unordered_set<std::string> declared;   // 已由 .type 声明、尚未出现标签的函数
+    bool intelSyntax = false;
+    bool inFunction = false;
+    Segment function;
+    Segment passthrough;
+    std::string line;
+
+    while (std::getline(in, line)) {
+        ++m_stats.lines;
+        AsmLineKind kind = AssemblyParser::classifyLine(line);
+
+        if (inFunction) {
+            function.text += line;
+            function.text += '\n';
+            if (kind == AsmLineKind::DIRECTIVE &&
+                AssemblyParser::sizeDirective(line) == function.name) {
+                append(std::move(function));
+                function = Segment();
+                inFunction = false;
+            }
+            continue;
+        }
+
+        if (kind == AsmLineKind::DIRECTIVE) {
+            std::string text = trimmed(line);
+            std::string name = AssemblyParser::functionTypeDirective(line);
+            if (!name.empty()) {
+                declared.insert(name);
+            } else if (text.compare(0, 13, ".intel_syntax") == 0) {
+                intelSyntax = true;
+            } else if (text.compare(0, 11, ".att_syntax") == 0) {
+                intelSyntax = false;
+            }
+        } else if (kind == AsmLineKind::LABEL) {
+            std::string name = trimmed(line);
+            name = name.substr(0, name.find(':'));
+            if (declared.erase(name) > 0) {
+                if (!passthrough.text.empty()) {
+                    append(std::move(passthrough));
+                    passthrough = Segment();
+                }
+                ++m_stats.functions;
+                inFunction = true;
+                function.function = true;
+                function.intelSyntax = intelSyntax;
+                function.name = name;
+                function.text = line + "\n";
+                continue;
+            }
+        }
 
-        return junkTemplates[randomInt(0, junkTemplates.size() - 1)];
+        passthrough.text += line;
+        passthrough.text += '\n';
+        // 数据段等大段的非函数文本也按批次写出，不在内存中累积
+        if (passthrough.text.size() >= m_batchBytes) {
+            append(std::move(passthrough));
+            passthrough = Segment();
+        }
     }
 
-    int randomInt(int min, int max) {
-        std::uniform_int_distribution<> dis(min, max);
-        return dis(m_gen);
+    if (inFunction) {
+        LOG_WARNING("Function " + function.name + " has no .size directive");
+        append(std::move(function));
     }
-};
+    if (!passthrough.text.empty()) {
+        append(std::move(passthrough));
+    }
+    submit();
+    while (!window.empty()) {
+        drainOne();
+    }
+
+    if (in.bad() || !out.good()) {
+        LOG_ERROR("Assembly stream I/O failed");
+        return false;
+    }
+    LOG_INFO("Rewrote " + std::to_string(m_stats.functions) + " functions, inserted " +
+             std::to_string(m_stats.inserted) + " junk instructions");
+    return true;
+}
+
+bool AsmRewriter::shouldInsertJunk(float density) {
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    return dis(m_gen) < density;
+}
+
+bool AsmRewriter::isLabel(const std::string& line) {
+    return line.find(':') != std::string::npos && line.find_first_not_of(" \t") == 0;
+}
+
+std::string AsmRewriter::generateJunkInstruction() {
+    // 没有上下文时只能使用不改变寄存器和标志位的形式
+    std::vector<std::string> junkTemplates = {
+        "    nop\n    nop",
+        "    xchg rax, rax",
+        "    mov rbx, rbx",
+        "    lea rax, [rax+0]",
+        "    nop DWORD PTR [rax]"
+    };
+
+    return junkTemplates[randomInt(0, junkTemplates.size() - 1)];
+}
+
+int AsmRewriter::randomInt(int min, int max) {
+    std::uniform_int_distribution<> dis(min, max);
+    return dis(m_gen);
+}
 
 } // namespace obfuscator
@@ -0,0 +1,140 @@
+#include "asm_rewriter/junk_templates.h"
+#include <algorithm>
+
+namespace obfuscator {
+
+namespace {
+
+// 每周期分配（重命名）的融合域微操作数，与 JunkTemplate::costs 同序
+const double kIssueWidth[kCpuModelCount] = {4.0, 5.0, 5.0, 6.0};
+
+const char* const kModelNames[] = {"generic", "skylake", "icelake", "zen2", "zen3"};
+
+// 常用开销：{微操作, 延迟, 端口数, 端口}
+constexpr JunkCost kEliminated = {1, 0, 0, "-"};
+constexpr JunkCost kIntelAlu = {1, 1, 4, "p0156"};
+constexpr JunkCost kZenAlu = {1, 1, 4, "ALU0123"};
+constexpr JunkCost kIntelLea = {1, 1, 2, "p15"};
+
+} // namespace
+
+bool parseCpuModel(const std::string& name, CpuModel& model) {
+    for (int i = 0; i <= kCpuModelCount; ++i) {
+        if (name == kModelNames[i]) {
+            model = static_cast<CpuModel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* cpuModelName(CpuModel model) {
+    return kModelNames[static_cast<int>(model)];
+}
+
+// 数据取自 Intel 优化手册、uops.info 与 Agner Fog 的指令表。
+// Ice Lake 的微码更新关闭了 mov 消除；xchg reg,reg 在 Intel 上为 3 个微操作
+const std::vector<JunkTemplate>& junkTemplates() {
+    static const std::vector<JunkTemplate> templates = {
+        // 多字节 NOP：只占前端，不占执行端口
+        {"nop", "nop", "nop", JUNK_NEEDS_NOTHING, 1, false, false,
+         {kEliminated, kEliminated, kEliminated, kEliminated}},
+        {"nop3", "nopl\t(%rax)", "nop\tDWORD PTR [rax]", JUNK_NEEDS_NOTHING, 3, false, false,
+         {kEliminated, kEliminated, kEliminated, kEliminated}},
+        {"nop4", "nopl\t0x0(%rax,%rax,1)", "nop\tDWORD PTR [rax+rax*1+0x0]",
+         JUNK_NEEDS_NOTHING, 4, false, false,
+         {kEliminated, kEliminated, kEliminated, kEliminated}},
+        {"nop5", "nopw\t0x0(%rax,%rax,1)", "nop\tWORD PTR [rax+rax*1+0x0]",
+         JUNK_NEEDS_NOTHING, 5, false, false,
+         {kEliminated, kEliminated, kEliminated, kEliminated}},
+
+        // 不改变状态的自身运算
+        {"xchg-self", "xchgq\t{s64}, {s64}", "xchg\t{s64}, {s64}", JUNK_NEEDS_NOTHING, 3, false, false,
+         {{3, 2, 4, "p0156"}, {3, 2, 4, "p0156"}, {2, 1, 4, "ALU0123"}, {2, 1, 4, "ALU0123"}}},
+        {"mov-self", "movq\t{s64}, {s64}", "mov\t{s64}, {s64}", JUNK_NEEDS_NOTHING, 3, false, false,
+         {kIntelAlu, kIntelAlu, kZenAlu, kZenAlu}},
+        {"lea-self", "leaq\t({s64}), {s64}", "lea\t{s64}, [{s64}]", JUNK_NEEDS_NOTHING, 3, false, true,
+         {kIntelLea, kIntelLea, kZenAlu, kZenAlu}},
+
+        // 改写死寄存器，不改变标志位
+        {"mov-imm", "movl\t${imm}, {d32}", "mov\t{d32}, {imm}", JUNK_NEEDS_DEAD_REGISTER, 5, true, false,
+         {kIntelAlu, kIntelAlu, kZenAlu, kZenAlu}},
+        {"lea-imm", "leaq\t{imm}({s64}), {d64}", "lea\t{d64}, [{s64}+{imm}]",
+         JUNK_NEEDS_DEAD_REGISTER, 4, false, false,
+         {kIntelLea, kIntelLea, kZenAlu, kZenAlu}},
+        {"mov-reg", "movq\t{s64}, {d64}", "mov\t{d64}, {s64}", JUNK_NEEDS_DEAD_REGISTER, 3, false, false,
+         {kEliminated, kIntelAlu, kEliminated, kEliminated}},
+
+        // 同时改写死寄存器和标志位
+        {"zero-idiom", "xorl\t{d32}, {d32}", "xor\t{d32}, {d32}",
+         JUNK_NEEDS_DEAD_REGISTER | JUNK_NEEDS_DEAD_FLAGS, 2, true, false,
+         {kEliminated, kEliminated, kEliminated, kEliminated}},
+        {"add-imm", "addl\t${imm}, {d32}", "add\t{d32}, {imm}",
+         JUNK_NEEDS_DEAD_REGISTER | JUNK_NEEDS_DEAD_FLAGS, 3, true, false,
+         {kIntelAlu, kIntelAlu, kZenAlu, kZenAlu}},
+        {"imul-imm", "imull\t${imm}, {s32}, {d32}", "imul\t{d32}, {s32}, {imm}",
+         JUNK_NEEDS_DEAD_REGISTER | JUNK_NEEDS_DEAD_FLAGS, 3, true, false,
+         {{1, 3, 1, "p1"}, {1, 3, 1, "p1"}, {1, 3, 1, "ALU1"}, {1, 3, 1, "ALU1"}}},
+
+        // 只改写标志位
+        {"test", "testq\t{s64}, {s64}", "test\t{s64}, {s64}", JUNK_NEEDS_DEAD_FLAGS, 3, false, false,
+         {kIntelAlu, kIntelAlu, kZenAlu, kZenAlu}},
+        {"cmp-imm", "cmpl\t${imm}, {s32}", "cmp\t{s32}, {imm}", JUNK_NEEDS_DEAD_FLAGS, 3, true, false,
+         {kIntelAlu, kIntelAlu, kZenAlu, kZenAlu}},
+        // 宏融合的 test+jcc，跳到紧随其后的标签：一个融合微操作，占用分支端口
+        {"fused-test-jcc", "testl\t{s32}, {s32}\n\tjne\t{label}\n{label}:",
+         "test\t{s32}, {s32}\n\tjne\t{label}\n{label}:", JUNK_NEEDS_DEAD_FLAGS, 4, true, false,
+         {{1, 1, 2, "p06"}, {1, 1, 2, "p06"}, {1, 1, 2, "ALU03"}, {1, 1, 2, "BRU01"}}},
+    };
+    return templates;
+}
+
+double junkCycles(const JunkTemplate& junk, CpuModel model) {
+    auto cyclesOn = [&junk](int index) {
+        const JunkCost& cost = junk.costs[index];
+        double frontEnd = cost.uops / kIssueWidth[index];
+        double backEnd = cost.portCount ? static_cast<double>(cost.uops) / cost.portCount : 0.0;
+        return std::max(frontEnd, backEnd);
+    };
+    if (model != CpuModel::GENERIC) {
+        return cyclesOn(static_cast<int>(model) - 1);
+    }
+    double worst = 0.0;
+    for (int i = 0; i < kCpuModelCount; ++i) {
+        worst = std::max(worst, cyclesOn(i));
+    }
+    return worst;
+}
+
+bool junkEliminated(const JunkTemplate& junk, CpuModel model) {
+    if (model != CpuModel::GENERIC) {
+        return junk.costs[static_cast<int>(model) - 1].portCount == 0;
+    }
+    return std::all_of(junk.costs, junk.costs + kCpuModelCount,
+                       [](const JunkCost& cost) { return cost.portCount == 0; });
+}
+
+unsigned junkBytes(const JunkTemplate& junk, int dest, int source) {
+    unsigned bytes = junk.bytes;
+    // 只有模板里实际出现的寄存器才可能需要 REX
+    std::string att = junk.att;
+    bool usesDest = att.find("{d") != std::string::npos;
+    bool usesSource = att.find("{s") != std::string::npos;
+    if (junk.rex32 && ((usesDest && dest >= 8) || (usesSource && source >= 8))) {
+        ++bytes;
+    }
+    // rbp/r13 作基址时必须带位移，rsp/r12 作基址时需要 SIB 字节
+    if (junk.zeroDisplacement && (source == 5 || source == 13)) {
+        ++bytes;
+    }
+    if (att.find("({s64})") != std::string::npos && source == 12) {
+        ++bytes;
+    }
+    // xchg %rax, %rax 被汇编成单字节的 0x90
+    if (att.compare(0, 4, "xchg") == 0 && source == 0) {
+        bytes = 1;
+    }
+    return bytes;
+}
+
+} // namespace obfuscator
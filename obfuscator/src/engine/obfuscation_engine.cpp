@@ -1,9 +1,14 @@
 #include "engine/obfuscation_engine.h"
 #include "utils/logger.h"
 #include "utils/random_utils.h"
+#include "parser/code_parser.h"
 #include <chrono>
 #include <fstream>
 #include <algorithm>
+#include <sstream>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace obfuscator {
 
@@ -260,6 +265,94 @@ bool ObfuscationEngine::obfuscateBatch(const std::vector<std::string>& inputFile
     return true;
 }
 
+bool ObfuscationEngine::obfuscateAmalgamated(const std::vector<std::string>& inputFiles,
+                                             const std::string& outputFile) {
+    LOG_INFO("Starting amalgamated obfuscation of " + std::to_string(inputFiles.size()) + " files");
+
+    std::string inputCode;
+    if (!amalgamate(inputFiles, inputCode)) {
+        return false;
+    }
+
+    std::string outputCode;
+    if (!obfuscate(inputCode, outputCode)) {
+        LOG_ERROR("Failed to obfuscate amalgamation");
+        return false;
+    }
+
+    std::ofstream outFile(outputFile);
+    if (!outFile.is_open()) {
+        LOG_ERROR("Failed to open output file: " + outputFile);
+        return false;
+    }
+
+    outFile << outputCode;
+    outFile.close();
+
+    LOG_INFO("Amalgamated obfuscation completed: " + outputFile);
+    return true;
+}
+
+bool ObfuscationEngine::amalgamate(const std::vector<std::string>& inputFiles,
+                                   std::string& combined) {
+    combined.clear();
+
+    // 各文件的 static 名字合并后会重定义或遮蔽其他文件的同名符号
+    struct Declaration {
+        size_t file;
+        int line;
+        bool isStatic;
+    };
+    std::unordered_map<std::string, Declaration> declarations;
+    std::unordered_set<std::string> collisions;
+    bool ok = true;
+
+    for (size_t i = 0; i < inputFiles.size(); ++i) {
+        const std::string& inputFile = inputFiles[i];
+        std::ifstream inFile(inputFile);
+        if (!inFile.is_open()) {
+            LOG_ERROR("Failed to open input file: " + inputFile);
+            return false;
+        }
+
+        std::string code((std::istreambuf_iterator<char>(inFile)),
+                         std::istreambuf_iterator<char>());
+
+        for (const auto& name : CodeParser::scanFileScopeNames(code)) {
+            auto inserted = declarations.emplace(name.name, Declaration{i, name.lineNumber, name.isStatic});
+            Declaration& first = inserted.first->second;
+            if (inserted.second) {
+                continue;
+            }
+            if (first.file == i) {
+                first.isStatic = first.isStatic || name.isStatic;
+            } else if ((first.isStatic || name.isStatic) && collisions.insert(name.name).second) {
+                LOG_ERROR("Cannot amalgamate: '" + name.name + "' at " + inputFile + ":" +
+                          std::to_string(name.lineNumber) + " collides with the file-scope " +
+                          "declaration at " + inputFiles[first.file] + ":" +
+                          std::to_string(first.line) + "; rename the static symbol");
+                ok = false;
+            }
+        }
+
+        // #line 使编译诊断仍指向原始文件
+        std::string escaped;
+        for (char c : inputFile) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        combined += "#line 1 \"" + escaped + "\"\n";
+        combined += code;
+        if (!code.empty() && code.back() != '\n') {
+            combined += '\n';
+        }
+    }
+
+    return ok;
+}
+
 bool ObfuscationEngine::validateInput(const std::string& code) {
     if (code.empty()) {
         LOG_ERROR("Input code is empty");
@@ -315,15 +408,1022 @@ void ObfuscationEngine::logMessage(const std::string& message) {
 // ControlFlowRewriter Implementation
 // ============================================================================
 
+namespace {
+
+const size_t npos = std::string::npos;
+
+std::string trimCopy(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == npos) {
+        return "";
+    }
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+bool isIdentChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// 跳过字符串或字符常量，返回闭引号之后的位置
+size_t skipQuoted(const std::string& s, size_t pos) {
+    char quote = s[pos];
+    if (quote == '"' && pos > 0 && s[pos - 1] == 'R') {
+        // 原始字符串 R"delim( ... )delim"
+        size_t open = s.find('(', pos);
+        if (open == npos) {
+            return npos;
+        }
+        std::string close = ")" + s.substr(pos + 1, open - pos - 1) + "\"";
+        size_t end = s.find(close, open);
+        return end == npos ? npos : end + close.size();
+    }
+    for (++pos; pos < s.size(); ++pos) {
+        if (s[pos] == '\\') {
+            ++pos;
+        } else if (s[pos] == quote) {
+            return pos + 1;
+        } else if (s[pos] == '\n') {
+            return npos;
+        }
+    }
+    return npos;
+}
+
+// 从 from 开始寻找括号深度为0的终止字符，跳过字符串、字符常量和注释
+size_t findTopLevel(const std::string& s, size_t from, const std::string& stops) {
+    int depth = 0;
+    size_t p = from;
+    while (p < s.size()) {
+        char c = s[p];
+        // 前一个字符是数字时 ' 为 C++14 数字分隔符
+        if (c == '"' || (c == '\'' && !(p > 0 && std::isdigit(static_cast<unsigned char>(s[p - 1]))))) {
+            p = skipQuoted(s, p);
+            if (p == npos) {
+                return npos;
+            }
+            continue;
+        }
+        if (c == '/' && p + 1 < s.size() && s[p + 1] == '/') {
+            p = s.find('\n', p);
+            continue;
+        }
+        if (c == '/' && p + 1 < s.size() && s[p + 1] == '*') {
+            p = s.find("*/", p + 2);
+            p = (p == npos) ? npos : p + 2;
+            continue;
+        }
+        if (depth == 0 && stops.find(c) != npos) {
+            return p;
+        }
+        if (c == '(' || c == '[' || c == '{') {
+            ++depth;
+        } else if (c == ')' || c == ']' || c == '}') {
+            if (--depth < 0) {
+                return npos;
+            }
+        }
+        ++p;
+    }
+    return npos;
+}
+
+// 文本中是否出现某个标识符（跳过字符串与注释）
+bool containsIdent(const std::string& s, const std::string& ident) {
+    size_t p = 0;
+    while (p < s.size()) {
+        char c = s[p];
+        if (c == '"' || c == '\'') {
+            p = skipQuoted(s, p);
+            if (p == npos) {
+                return false;
+            }
+        } else if (isIdentChar(c)) {
+            size_t start = p;
+            while (p < s.size() && isIdentChar(s[p])) {
+                ++p;
+            }
+            if (s.compare(start, p - start, ident) == 0 && p - start == ident.size()) {
+                return true;
+            }
+        } else {
+            ++p;
+        }
+    }
+    return false;
+}
+
+// 函数体的语句级语法树，只区分影响控制流的语句
+struct Stmt {
+    enum class Kind { SIMPLE, DECL, BLOCK, IF, WHILE, DO, FOR, RETURN, BREAK, CONTINUE };
+
+    Kind kind = Kind::SIMPLE;
+    std::string text;       // SIMPLE/DECL/RETURN 的完整文本（含分号）
+    std::string cond;       // IF/WHILE/DO/FOR 的条件
+    std::string step;       // FOR 的步进表达式
+    size_t pos = 0;
+    size_t end = 0;         // 语句（BLOCK 即作用域）结束位置
+    std::vector<Stmt> children;     // BLOCK: 子语句; IF: then[, else]; DO/WHILE: 循环体; FOR: 初始化, 循环体
+};
+
+// 单个声明符: prefix name suffix = init
+struct Declarator {
+    std::string prefix;     // '*'、cv限定
+    std::string name;
+    std::string suffix;     // 数组维度
+    std::string init;
+};
+
+struct Declaration {
+    std::string type;
+    bool verbatim = false;  // static/extern/typedef：整条语句原样提前
+    std::vector<Declarator> declarators;
+};
+
+enum class DeclParse { NOT_DECL, OK, UNSUPPORTED };
+
+bool isBuiltinTypeWord(const std::string& w) {
+    static const char* words[] = {
+        "void", "char", "short", "int", "long", "float", "double", "signed", "unsigned",
+        "_Bool", "bool", "struct", "union", "enum", "const", "volatile", "static",
+        "extern", "typedef", "register", "auto", "thread_local", "_Thread_local",
+        "wchar_t", "char16_t", "char32_t", "size_t"
+    };
+    return std::find(std::begin(words), std::end(words), w) != std::end(words);
+}
+
+bool isExprWord(const std::string& w) {
+    static const char* words[] = {
+        "return", "delete", "throw", "sizeof", "new", "goto", "break", "continue", "case",
+        "default", "do", "else", "for", "if", "switch", "while", "asm", "__asm", "__asm__",
+        "static_assert", "_Static_assert", "co_return", "co_await", "co_yield", "typeid",
+        "alignof", "_Alignof", "this", "operator", "using", "namespace", "template"
+    };
+    return std::find(std::begin(words), std::end(words), w) != std::end(words);
+}
+
+// 识别并拆解局部变量声明，用于把声明提到分发结构之前
+DeclParse parseDeclaration(const std::string& stmtText, Declaration& decl) {
+    std::string text = trimCopy(stmtText);
+    if (!text.empty() && text.back() == ';') {
+        text.pop_back();
+    }
+    if (text.empty() || !(std::isalpha(static_cast<unsigned char>(text[0])) || text[0] == '_')) {
+        return DeclParse::NOT_DECL;
+    }
+
+    // 记号化：标识符、:: 、<...>、* 、& 、cv 限定
+    struct Tok { std::string text; size_t pos; };
+    std::vector<Tok> head;
+    size_t p = 0;
+    size_t stop = npos;
+    bool sawBuiltin = false;
+    while (p < text.size()) {
+        char c = text[p];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++p;
+        } else if (isIdentChar(c) && !std::isdigit(static_cast<unsigned char>(c))) {
+            size_t start = p;
+            while (p < text.size() && isIdentChar(text[p])) {
+                ++p;
+            }
+            std::string word = text.substr(start, p - start);
+            if (!head.empty() && head.back().text.size() >= 2 &&
+                head.back().text.compare(head.back().text.size() - 2, 2, "::") == 0) {
+                head.back().text += word;       // 限定名视为一个记号
+            } else {
+                head.push_back({word, start});
+            }
+            sawBuiltin |= isBuiltinTypeWord(word);
+        } else if (c == ':' && p + 1 < text.size() && text[p + 1] == ':') {
+            if (!head.empty() && head.back().text != "*" && head.back().text != "&") {
+                head.back().text += "::";
+            } else {
+                head.push_back({"::", p});
+            }
+            p += 2;
+        } else if (c == '*' || c == '&') {
+            head.push_back({std::string(1, c), p});
+            ++p;
+        } else if (c == '<' && !head.empty() && head.back().text != "*") {
+            // 模板实参
+            int depth = 0;
+            size_t start = p;
+            for (; p < text.size(); ++p) {
+                if (text[p] == '<') {
+                    ++depth;
+                } else if (text[p] == '>' && --depth == 0) {
+                    break;
+                } else if (text[p] == ';' || text[p] == '=' || text[p] == '{') {
+                    return DeclParse::NOT_DECL;
+                }
+            }
+            if (p >= text.size()) {
+                return DeclParse::NOT_DECL;
+            }
+            ++p;
+            head.back().text += text.substr(start, p - start);
+        } else if (c == '=' || c == ',' || c == '[') {
+            stop = p;
+            break;
+        } else if (c == '(') {
+            // 函数调用，或函数指针、直接初始化等不支持的声明形式
+            if (head.empty() || isExprWord(head.front().text)) {
+                return DeclParse::NOT_DECL;
+            }
+            return (sawBuiltin || head.size() >= 2) ? DeclParse::UNSUPPORTED
+                                                    : DeclParse::NOT_DECL;
+        } else {
+            return DeclParse::NOT_DECL;
+        }
+    }
+
+    if (head.size() < 2 || isExprWord(head.front().text)) {
+        return DeclParse::NOT_DECL;
+    }
+    const std::string& last = head.back().text;
+    if (!(std::isalpha(static_cast<unsigned char>(last[0])) || last[0] == '_') ||
+        last.find('<') != npos) {
+        return DeclParse::NOT_DECL;
+    }
+
+    // 名字之前的 * & 以及紧跟 * 的 cv 限定属于声明符
+    size_t nameIdx = head.size() - 1;
+    size_t typeEnd = nameIdx;
+    while (typeEnd > 1) {
+        const std::string& t = head[typeEnd - 1].text;
+        bool cvAfterPtr = (t == "const" || t == "volatile") && typeEnd >= 2 &&
+                          head[typeEnd - 2].text == "*";
+        if (t == "*" || t == "&" || cvAfterPtr) {
+            --typeEnd;
+        } else {
+            break;
+        }
+    }
+
+    std::string firstPrefix;
+    for (size_t i = typeEnd; i < nameIdx; ++i) {
+        firstPrefix += head[i].text + (head[i].text == "*" ? "" : " ");
+    }
+
+    decl = Declaration{};
+    for (size_t i = 0; i < typeEnd; ++i) {
+        const std::string& w = head[i].text;
+        if (w == "static" || w == "extern" || w == "typedef" || w == "thread_local" ||
+            w == "_Thread_local") {
+            decl.verbatim = true;
+        }
+        if (w == "auto") {
+            return DeclParse::UNSUPPORTED;
+        }
+        if (w == "register") {
+            continue;
+        }
+        if (!decl.type.empty()) {
+            decl.type += ' ';
+        }
+        decl.type += w;
+    }
+
+    // 逐个解析声明符
+    Declarator d;
+    d.prefix = firstPrefix;
+    d.name = last;
+    p = (stop == npos) ? text.size() : stop;
+    while (true) {
+        while (p < text.size() && text[p] == '[') {
+            size_t close = findTopLevel(text, p + 1, "]");
+            if (close == npos) {
+                return DeclParse::UNSUPPORTED;
+            }
+            d.suffix += text.substr(p, close - p + 1);
+            p = close + 1;
+            while (p < text.size() && std::isspace(static_cast<unsigned char>(text[p]))) {
+                ++p;
+            }
+        }
+        if (p < text.size() && text[p] == '=') {
+            size_t end = findTopLevel(text, p + 1, ",");
+            if (end == npos) {
+                end = text.size();
+            }
+            d.init = trimCopy(text.substr(p + 1, end - p - 1));
+            p = end;
+        }
+        if (d.prefix.find('&') != npos) {
+            return DeclParse::UNSUPPORTED;
+        }
+        decl.declarators.push_back(d);
+
+        if (p >= text.size()) {
+            break;
+        }
+        if (text[p] != ',') {
+            return DeclParse::UNSUPPORTED;
+        }
+
+        // 下一个声明符: [* cv]* name
+        d = Declarator{};
+        ++p;
+        while (p < text.size()) {
+            if (std::isspace(static_cast<unsigned char>(text[p]))) {
+                ++p;
+            } else if (text[p] == '*' || text[p] == '&') {
+                d.prefix += text[p++];
+            } else if (text.compare(p, 5, "const") == 0 && !isIdentChar(text[p + 5])) {
+                d.prefix += "const ";
+                p += 5;
+            } else {
+                break;
+            }
+        }
+        size_t nameStart = p;
+        while (p < text.size() && isIdentChar(text[p])) {
+            ++p;
+        }
+        d.name = text.substr(nameStart, p - nameStart);
+        if (d.name.empty()) {
+            return DeclParse::UNSUPPORTED;
+        }
+        while (p < text.size() && std::isspace(static_cast<unsigned char>(text[p]))) {
+            ++p;
+        }
+    }
+
+    if (!decl.verbatim) {
+        for (const auto& item : decl.declarators) {
+            // 聚合初始化、带初始化的数组以及可变长数组不能拆成赋值
+            if ((!item.init.empty() && (item.init[0] == '{' || !item.suffix.empty()))) {
+                return DeclParse::UNSUPPORTED;
+            }
+            for (char c : item.suffix) {
+                if (std::islower(static_cast<unsigned char>(c))) {
+                    return DeclParse::UNSUPPORTED;
+                }
+            }
+        }
+    }
+    return DeclParse::OK;
+}
+
+class StatementParser {
+public:
+    explicit StatementParser(const std::string& src) : m_src(src) {}
+
+    bool parseAll(std::vector<Stmt>& out) {
+        while (skipSpace()) {
+            out.emplace_back();
+            if (!parseStatement(out.back())) {
+                return false;
+            }
+        }
+        return m_error.empty();
+    }
+
+    const std::string& error() const { return m_error; }
+
+private:
+    const std::string& m_src;
+    size_t m_pos = 0;
+    std::string m_error;
+
+    bool fail(const std::string& why) {
+        if (m_error.empty()) {
+            m_error = why;
+        }
+        return false;
+    }
+
+    // 跳过空白和注释，返回是否还有内容；函数体内的预处理指令无法安全拆分
+    bool skipSpace() {
+        while (m_pos < m_src.size()) {
+            char c = m_src[m_pos];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                ++m_pos;
+            } else if (c == '/' && m_pos + 1 < m_src.size() && m_src[m_pos + 1] == '/') {
+                m_pos = m_src.find('\n', m_pos);
+                if (m_pos == npos) {
+                    m_pos = m_src.size();
+                }
+            } else if (c == '/' && m_pos + 1 < m_src.size() && m_src[m_pos + 1] == '*') {
+                size_t end = m_src.find("*/", m_pos + 2);
+                if (end == npos) {
+                    m_pos = m_src.size();
+                    return fail("unterminated comment");
+                }
+                m_pos = end + 2;
+            } else if (c == '#') {
+                m_pos = m_src.size();
+                return fail("preprocessor directive in function body");
+            } else {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string peekIdent() const {
+        size_t p = m_pos;
+        while (p < m_src.size() && isIdentChar(m_src[p])) {
+            ++p;
+        }
+        if (p == m_pos || std::isdigit(static_cast<unsigned char>(m_src[m_pos]))) {
+            return "";
+        }
+        return m_src.substr(m_pos, p - m_pos);
+    }
+
+    bool expect(char c) {
+        if (!skipSpace() || m_src[m_pos] != c) {
+            return fail(std::string("expected '") + c + "'");
+        }
+        ++m_pos;
+        return true;
+    }
+
+    bool parseParen(std::string& inner) {
+        if (!expect('(')) {
+            return false;
+        }
+        size_t close = findTopLevel(m_src, m_pos, ")");
+        if (close == npos) {
+            return fail("unbalanced parentheses");
+        }
+        inner = trimCopy(m_src.substr(m_pos, close - m_pos));
+        m_pos = close + 1;
+        return true;
+    }
+
+    bool parseSubStatement(Stmt& st) {
+        st.children.emplace_back();
+        return parseStatement(st.children.back());
+    }
+
+    bool parseStatement(Stmt& st) {
+        if (!skipSpace()) {
+            return fail("unexpected end of function body");
+        }
+        st.pos = m_pos;
+        char c = m_src[m_pos];
+
+        if (c == '{') {
+            st.kind = Stmt::Kind::BLOCK;
+            ++m_pos;
+            while (true) {
+                if (!skipSpace()) {
+                    return fail("unbalanced braces");
+                }
+                if (m_src[m_pos] == '}') {
+                    ++m_pos;
+                    break;
+                }
+                if (!parseSubStatement(st)) {
+                    return false;
+                }
+            }
+            st.end = m_pos;
+            return true;
+        }
+
+        std::string kw = peekIdent();
+        if (kw == "if") {
+            st.kind = Stmt::Kind::IF;
+            m_pos += 2;
+            if (!parseParen(st.cond)) {
+                return false;
+            }
+            if (findTopLevel(st.cond, 0, ";") != npos) {
+                return fail("if statement with initializer");
+            }
+            if (!parseSubStatement(st)) {
+                return false;
+            }
+            size_t save = m_pos;
+            if (skipSpace() && peekIdent() == "else") {
+                m_pos += 4;
+                if (!parseSubStatement(st)) {
+                    return false;
+                }
+            } else {
+                m_pos = save;
+            }
+        } else if (kw == "while") {
+            st.kind = Stmt::Kind::WHILE;
+            m_pos += 5;
+            if (!parseParen(st.cond) || !parseSubStatement(st)) {
+                return false;
+            }
+        } else if (kw == "do") {
+            st.kind = Stmt::Kind::DO;
+            m_pos += 2;
+            if (!parseSubStatement(st)) {
+                return false;
+            }
+            if (!skipSpace() || peekIdent() != "while") {
+                return fail("expected 'while' after do body");
+            }
+            m_pos += 5;
+            if (!parseParen(st.cond) || !expect(';')) {
+                return false;
+            }
+        } else if (kw == "for") {
+            st.kind = Stmt::Kind::FOR;
+            m_pos += 3;
+            if (!expect('(')) {
+                return false;
+            }
+            size_t semi1 = findTopLevel(m_src, m_pos, ";)");
+            if (semi1 == npos || m_src[semi1] != ';') {
+                return fail("range-based for");
+            }
+            size_t semi2 = findTopLevel(m_src, semi1 + 1, ";)");
+            if (semi2 == npos || m_src[semi2] != ';') {
+                return fail("malformed for header");
+            }
+            size_t close = findTopLevel(m_src, semi2 + 1, ")");
+            if (close == npos) {
+                return fail("unbalanced parentheses");
+            }
+
+            Stmt init;
+            init.pos = m_pos;
+            init.text = trimCopy(m_src.substr(m_pos, semi1 - m_pos));
+            if (!init.text.empty()) {
+                init.text += ";";
+                Declaration ignored;
+                init.kind = parseDeclaration(init.text, ignored) == DeclParse::NOT_DECL
+                    ? Stmt::Kind::SIMPLE : Stmt::Kind::DECL;
+            }
+            st.children.push_back(init);
+            st.cond = trimCopy(m_src.substr(semi1 + 1, semi2 - semi1 - 1));
+            st.step = trimCopy(m_src.substr(semi2 + 1, close - semi2 - 1));
+            m_pos = close + 1;
+            if (!parseSubStatement(st)) {
+                return false;
+            }
+        } else if (kw == "break" || kw == "continue") {
+            st.kind = kw == "break" ? Stmt::Kind::BREAK : Stmt::Kind::CONTINUE;
+            m_pos += kw.size();
+            if (!expect(';')) {
+                return false;
+            }
+        } else if (kw == "switch") {
+            // switch 作为整体保留；其中的 break 属于 switch 自身
+            m_pos += 6;
+            std::string cond;
+            if (!parseParen(cond) || !expect('{')) {
+                return false;
+            }
+            size_t close = findTopLevel(m_src, m_pos, "}");
+            if (close == npos) {
+                return fail("unbalanced braces");
+            }
+            m_pos = close + 1;
+            st.text = m_src.substr(st.pos, m_pos - st.pos);
+            if (containsIdent(st.text, "continue") || containsIdent(st.text, "goto")) {
+                return fail("continue/goto inside switch");
+            }
+        } else if (kw == "goto" || kw == "case" || kw == "default" || kw == "try" ||
+                   kw == "catch" || kw == "else" || kw == "__label__") {
+            return fail("unsupported statement '" + kw + "'");
+        } else {
+            if (!kw.empty()) {
+                size_t after = m_pos + kw.size();
+                while (after < m_src.size() && std::isspace(static_cast<unsigned char>(m_src[after]))) {
+                    ++after;
+                }
+                if (after < m_src.size() && m_src[after] == ':' &&
+                    (after + 1 >= m_src.size() || m_src[after + 1] != ':')) {
+                    return fail("labeled statement");
+                }
+            }
+            size_t end = findTopLevel(m_src, m_pos, ";");
+            if (end == npos) {
+                return fail("missing ';'");
+            }
+            m_pos = end + 1;
+            st.text = m_src.substr(st.pos, m_pos - st.pos);
+            if (kw == "return") {
+                st.kind = Stmt::Kind::RETURN;
+            } else {
+                Declaration ignored;
+                st.kind = parseDeclaration(st.text, ignored) == DeclParse::NOT_DECL
+                    ? Stmt::Kind::SIMPLE : Stmt::Kind::DECL;
+            }
+        }
+
+        st.end = m_pos;
+        return true;
+    }
+};
+
+// 把语句树降低为基本块：条件语句和循环变成带条件的状态跳转，
+// break/continue 变成到循环出口/继续点的跳转，声明提到分发结构之前
+class FlowLowering {
+public:
+    struct Block {
+        std::string code;
+        std::string condition;
+        std::vector<size_t> successors;
+        bool terminated = false;
+    };
+
+    static constexpr size_t kEntry = 0;
+    static constexpr size_t kExit = 1;
+
+    explicit FlowLowering(const std::string& body) : m_body(body) {}
+
+    bool run(const std::vector<Stmt>& stmts) {
+        newBlock();     // 入口
+        newBlock();     // 出口
+        m_cur = kEntry;
+        for (const auto& st : stmts) {
+            if (!lower(st, npos, npos, m_body.size())) {
+                return false;
+            }
+        }
+        jump(m_cur, kExit);
+        m_blocks[kExit].terminated = true;
+        return checkScopes();
+    }
+
+    std::vector<Block>& blocks() { return m_blocks; }
+    const std::string& error() const { return m_error; }
+
+    std::string hoistedDeclarations() const {
+        std::string out;
+        for (const auto& text : m_verbatim) {
+            out += text + "\n";
+        }
+        for (const auto& name : m_order) {
+            out += m_vars.at(name).decl + "\n";
+        }
+        return out;
+    }
+
+private:
+    struct HoistedVar {
+        std::string decl;
+        std::vector<std::pair<size_t, size_t>> scopes;
+    };
+
+    const std::string& m_body;
+    std::vector<Block> m_blocks;
+    size_t m_cur = kEntry;
+    std::string m_error;
+    std::map<std::string, HoistedVar> m_vars;
+    std::vector<std::string> m_order;
+    std::vector<std::string> m_verbatim;
+
+    bool fail(const std::string& why) {
+        if (m_error.empty()) {
+            m_error = why;
+        }
+        return false;
+    }
+
+    size_t newBlock() {
+        m_blocks.emplace_back();
+        return m_blocks.size() - 1;
+    }
+
+    void append(const std::string& code) {
+        m_blocks[m_cur].code += code + "\n";
+    }
+
+    void jump(size_t from, size_t to) {
+        Block& b = m_blocks[from];
+        if (!b.terminated) {
+            b.successors = {to};
+            b.terminated = true;
+        }
+    }
+
+    void branch(size_t from, const std::string& cond, size_t ifTrue, size_t ifFalse) {
+        Block& b = m_blocks[from];
+        b.condition = cond;
+        b.successors = {ifTrue, ifFalse};
+        b.terminated = true;
+    }
+
+    // 当前块已经结束（return/break/continue），之后的语句放入不可达块
+    void startDeadBlock() {
+        m_cur = newBlock();
+    }
+
+    bool hoist(const Stmt& st, size_t scopeEnd) {
+        Declaration decl;
+        if (parseDeclaration(st.text, decl) != DeclParse::OK) {
+            return fail("unsupported declaration: " + trimCopy(st.text));
+        }
+
+        for (const auto& d : decl.declarators) {
+            HoistedVar& var = m_vars[d.name];
+            std::string type = decl.type;
+            std::string prefix = d.prefix;
+            if (!decl.verbatim) {
+                // 声明变为赋值，顶层 const 必须去掉
+                if (prefix.find('*') == npos) {
+                    std::string stripped;
+                    std::istringstream words(type);
+                    std::string w;
+                    while (words >> w) {
+                        if (w != "const") {
+                            stripped += (stripped.empty() ? "" : " ") + w;
+                        }
+                    }
+                    type = stripped;
+                } else {
+                    size_t star = prefix.rfind('*');
+                    std::string tail = prefix.substr(star + 1);
+                    if (tail.find("const") != npos) {
+                        prefix = prefix.substr(0, star + 1);
+                    }
+                }
+            }
+            std::string declText = type + " " + prefix + d.name + d.suffix + ";";
+
+            if (var.scopes.empty()) {
+                var.decl = declText;
+                if (!decl.verbatim) {
+                    m_order.push_back(d.name);
+                }
+            } else if (decl.verbatim || var.decl != declText) {
+                // 不同作用域中同名但类型不同的变量无法共用一个提前的声明
+                return fail("conflicting declarations of '" + d.name + "'");
+            }
+            var.scopes.emplace_back(st.pos, scopeEnd);
+
+            if (!decl.verbatim && !d.init.empty()) {
+                append(d.name + " = " + d.init + ";");
+            }
+        }
+
+        if (decl.verbatim) {
+            m_verbatim.push_back(trimCopy(st.text));
+        }
+        return true;
+    }
+
+    bool lower(const Stmt& st, size_t breakTo, size_t continueTo, size_t scopeEnd) {
+        switch (st.kind) {
+        case Stmt::Kind::SIMPLE:
+            if (!st.text.empty()) {
+                append(trimCopy(st.text));
+            }
+            return true;
+
+        case Stmt::Kind::DECL:
+            return hoist(st, scopeEnd);
+
+        case Stmt::Kind::RETURN:
+            append(trimCopy(st.text));
+            m_blocks[m_cur].terminated = true;
+            startDeadBlock();
+            return true;
+
+        case Stmt::Kind::BREAK:
+        case Stmt::Kind::CONTINUE: {
+            size_t target = st.kind == Stmt::Kind::BREAK ? breakTo : continueTo;
+            if (target == npos) {
+                return fail("break/continue outside of loop");
+            }
+            jump(m_cur, target);
+            startDeadBlock();
+            return true;
+        }
+
+        case Stmt::Kind::BLOCK:
+            for (const auto& child : st.children) {
+                if (!lower(child, breakTo, continueTo, st.end)) {
+                    return false;
+                }
+            }
+            return true;
+
+        case Stmt::Kind::IF: {
+            size_t thenBlock = newBlock();
+            size_t join = newBlock();
+            size_t elseBlock = st.children.size() > 1 ? newBlock() : join;
+            branch(m_cur, st.cond, thenBlock, elseBlock);
+
+            m_cur = thenBlock;
+            if (!lower(st.children[0], breakTo, continueTo, st.children[0].end)) {
+                return false;
+            }
+            jump(m_cur, join);
+            if (st.children.size() > 1) {
+                m_cur = elseBlock;
+                if (!lower(st.children[1], breakTo, continueTo, st.children[1].end)) {
+                    return false;
+                }
+                jump(m_cur, join);
+            }
+            m_cur = join;
+            return true;
+        }
+
+        case Stmt::Kind::WHILE: {
+            size_t head = newBlock();
+            size_t body = newBlock();
+            size_t exit = newBlock();
+            jump(m_cur, head);
+            branch(head, st.cond, body, exit);
+
+            m_cur = body;
+            if (!lower(st.children[0], exit, head, st.children[0].end)) {
+                return false;
+            }
+            jump(m_cur, head);
+            m_cur = exit;
+            return true;
+        }
+
+        case Stmt::Kind::DO: {
+            size_t body = newBlock();
+            size_t test = newBlock();
+            size_t exit = newBlock();
+            jump(m_cur, body);
+
+            m_cur = body;
+            if (!lower(st.children[0], exit, test, st.children[0].end)) {
+                return false;
+            }
+            jump(m_cur, test);
+            branch(test, st.cond, body, exit);
+            m_cur = exit;
+            return true;
+        }
+
+        case Stmt::Kind::FOR: {
+            // for 初始化部分声明的变量作用域是整个 for 语句
+            if (!lower(st.children[0], breakTo, continueTo, st.end)) {
+                return false;
+            }
+            size_t head = newBlock();
+            size_t body = newBlock();
+            size_t step = newBlock();
+            size_t exit = newBlock();
+            jump(m_cur, head);
+            if (st.cond.empty()) {
+                jump(head, body);
+            } else {
+                branch(head, st.cond, body, exit);
+            }
+
+            m_cur = body;
+            if (!lower(st.children[1], exit, step, st.children[1].end)) {
+                return false;
+            }
+            jump(m_cur, step);
+            if (!st.step.empty()) {
+                m_blocks[step].code = st.step + ";\n";
+            }
+            jump(step, head);
+            m_cur = exit;
+            return true;
+        }
+        }
+        return fail("unknown statement");
+    }
+
+    // 提前后的声明扩大了作用域：被提前的名字只能出现在原声明的作用域内，
+    // 否则会遮蔽同名的外层变量、参数或全局变量
+    bool checkScopes() {
+        if (m_vars.empty()) {
+            return true;
+        }
+        size_t p = 0;
+        while (p < m_body.size()) {
+            char c = m_body[p];
+            if (c == '"' || (c == '\'' && !(p > 0 && std::isdigit(static_cast<unsigned char>(m_body[p - 1]))))) {
+                p = skipQuoted(m_body, p);
+                if (p == npos) {
+                    return fail("unterminated literal");
+                }
+                continue;
+            }
+            if (c == '/' && p + 1 < m_body.size() && (m_body[p + 1] == '/' || m_body[p + 1] == '*')) {
+                p = m_body[p + 1] == '/' ? m_body.find('\n', p) : m_body.find("*/", p + 2);
+                if (p == npos) {
+                    break;
+                }
+                continue;
+            }
+            if (!isIdentChar(c)) {
+                ++p;
+                continue;
+            }
+            size_t start = p;
+            while (p < m_body.size() && isIdentChar(m_body[p])) {
+                ++p;
+            }
+            if (std::isdigit(static_cast<unsigned char>(m_body[start]))) {
+                continue;
+            }
+            // 成员访问 a.x / p->x 中的名字不是变量
+            size_t prev = m_body.find_last_not_of(" \t\r\n", start == 0 ? npos : start - 1);
+            if (start > 0 && prev != npos &&
+                (m_body[prev] == '.' || (m_body[prev] == '>' && prev > 0 && m_body[prev - 1] == '-'))) {
+                continue;
+            }
+
+            auto it = m_vars.find(m_body.substr(start, p - start));
+            if (it == m_vars.end()) {
+                continue;
+            }
+            bool inScope = false;
+            for (const auto& scope : it->second.scopes) {
+                inScope |= start >= scope.first && start < scope.second;
+            }
+            if (!inScope) {
+                return fail("hoisting '" + it->first + "' would change name lookup");
+            }
+        }
+
+        for (const auto& [name, var] : m_vars) {
+            for (size_t i = 0; i < var.scopes.size(); ++i) {
+                for (size_t j = i + 1; j < var.scopes.size(); ++j) {
+                    if (var.scopes[i].first < var.scopes[j].second &&
+                        var.scopes[j].first < var.scopes[i].second) {
+                        return fail("'" + name + "' shadows itself in a nested scope");
+                    }
+                }
+            }
+        }
+        return true;
+    }
+};
+
+// 自然循环的嵌套深度。结构化代码降低后的CFG是可归约的，
+// DFS中指向栈上节点的边即回边，循环体是不经过头结点能到达回边源点的块
+std::vector<unsigned> computeLoopDepths(const std::vector<std::vector<size_t>>& successors) {
+    const size_t n = successors.size();
+    std::vector<unsigned> depth(n, 0);
+    std::vector<int> state(n, 0);   // 0=未访问 1=在栈上 2=完成
+    std::vector<std::pair<size_t, size_t>> stack = {{0, 0}};
+    std::map<size_t, std::vector<size_t>> latches;  // 循环头 -> 回边源点
+    state[0] = 1;
+    while (!stack.empty()) {
+        auto& [b, next] = stack.back();
+        if (next == successors[b].size()) {
+            state[b] = 2;
+            stack.pop_back();
+            continue;
+        }
+        size_t succ = successors[b][next++];
+        if (state[succ] == 1) {
+            latches[succ].push_back(b);
+        } else if (state[succ] == 0) {
+            state[succ] = 1;
+            stack.push_back({succ, 0});
+        }
+    }
+
+    std::vector<std::vector<size_t>> preds(n);
+    for (size_t b = 0; b < n; ++b) {
+        for (size_t succ : successors[b]) {
+            preds[succ].push_back(b);
+        }
+    }
+    for (const auto& [header, sources] : latches) {
+        std::vector<bool> inLoop(n, false);
+        inLoop[header] = true;
+        std::vector<size_t> worklist = sources;
+        while (!worklist.empty()) {
+            size_t b = worklist.back();
+            worklist.pop_back();
+            if (inLoop[b]) {
+                continue;
+            }
+            inLoop[b] = true;
+            worklist.insert(worklist.end(), preds[b].begin(), preds[b].end());
+        }
+        for (size_t b = 0; b < n; ++b) {
+            depth[b] += inLoop[b] ? 1 : 0;
+        }
+    }
+    return depth;
+}
+
+} // namespace
+
 ControlFlowRewriter::ControlFlowRewriter() {
+    auto& rng = RandomGenerator::getInstance();
+    m_fakeBranchId = rng.randomHexString(4);
+    m_fakeBranchState = (static_cast<uint32_t>(rng.randomInt(0, 0xFFFF)) << 16) |
+                        static_cast<uint32_t>(rng.randomInt(0, 0xFFFF));
 }
 
 std::string ControlFlowRewriter::flattenControlFlow(const std::string& code) {
-    // 控制流平坦化的简化实现
     LOG_INFO("Flattening control flow");
 
-    std::vector<BasicBlock> blocks = extractBasicBlocks(code);
-    return generateSwitchDispatcher(blocks);
+    std::string hoisted;
+    std::vector<BasicBlock> blocks = extractBasicBlocks(code, hoisted);
+    if (blocks.empty()) {
+        return code;
+    }
+    return generateDispatcher(blocks, hoisted);
 }
 
 std::string ControlFlowRewriter::addFakeBranches(const std::string& code, float probability) {
@@ -332,19 +1432,96 @@ std::string ControlFlowRewriter::addFakeBranches(const std::string& code, float
     auto& rng = RandomGenerator::getInstance();
     std::stringstream result;
 
-    std::istringstream iss(code);
-    std::string line;
+    size_t cursor = 0;
+    for (const auto& slot : CodeParser::findStatementSlots(code)) {
+        if (!rng.randomBool(probability)) {
+            continue;
+        }
+        result << code.substr(cursor, slot.offset - cursor);
+        cursor = slot.offset;
+        result << slot.indent << "if (OBF_FB_UNLIKELY(" << generateFakeCondition() << ")) "
+               << "OBF_FB_UNLIKELY_ATTR { obf_fb_" << m_fakeBranchId << "_cold("
+               << rng.randomInt(1, 0xFFFF) << "u); }\n";
+        ++m_fakeBranchCount;
+    }
+    result << code.substr(cursor);
 
-    while (std::getline(iss, line)) {
-        result << line << "\n";
+    return result.str();
+}
 
-        if (rng.randomBool(probability)) {
-            // 添加永不执行的虚假分支
-            result << "    if (0) { volatile int __fake = 1; }\n";
+std::string ControlFlowRewriter::generateFakeCondition() {
+    // 状态只在永不执行的冷函数中被改写，因此初值决定了谓词的真假；
+    // volatile 读取使编译器无法把条件折叠为常量
+    auto& rng = RandomGenerator::getInstance();
+    const std::string state = "obf_fb_" + m_fakeBranchId + "_state";
+    const uint32_t s = m_fakeBranchState;
+    auto hex = [](uint32_t v) {
+        std::stringstream ss;
+        ss << "0x" << std::hex << v << "u";
+        return ss.str();
+    };
+    auto randomWord = [&rng]() {
+        return (static_cast<uint32_t>(rng.randomInt(0, 0xFFFF)) << 16) |
+               static_cast<uint32_t>(rng.randomInt(0, 0xFFFF));
+    };
+
+    switch (rng.randomInt(0, 2)) {
+        case 0: {
+            uint32_t k = randomWord();
+            while (k == s) {
+                k = randomWord();
+            }
+            return state + " == " + hex(k);
+        }
+        case 1: {
+            // x >= x/2 对任意 x 成立
+            uint32_t k = randomWord();
+            uint32_t v = s ^ k;
+            return "(" + state + " ^ " + hex(k) + ") < " + hex(v >> 1);
         }
+        default: {
+            uint32_t m = randomWord() | 1u;
+            uint32_t a = randomWord();
+            uint32_t k = randomWord();
+            while (k == s * m + a) {
+                k = randomWord();
+            }
+            return state + " * " + hex(m) + " + " + hex(a) + " == " + hex(k);
+        }
+    }
+}
+
+std::string ControlFlowRewriter::fakeBranchSupport() const {
+    if (m_fakeBranchCount == 0) {
+        return "";
     }
 
-    return result.str();
+    const std::string prefix = "obf_fb_" + m_fakeBranchId + "_";
+    std::stringstream ss;
+    ss << branchHintMacros();
+    ss << "static volatile unsigned " << prefix << "state = 0x" << std::hex
+       << m_fakeBranchState << std::dec << "u;\n";
+    ss << "static OBF_FB_COLD void " << prefix << "cold(unsigned v) {\n";
+    ss << "    " << prefix << "state = (v * 0x9e3779b1u) ^ (" << prefix << "state >> 7);\n";
+    ss << "}\n\n";
+    return ss.str();
+}
+
+std::string ControlFlowRewriter::branchHintMacros() {
+    return "#ifndef OBF_FB_UNLIKELY\n"
+           "#if defined(__GNUC__) || defined(__clang__)\n"
+           "#define OBF_FB_UNLIKELY(x) __builtin_expect(!!(x), 0)\n"
+           "#define OBF_FB_COLD __attribute__((cold, noinline))\n"
+           "#else\n"
+           "#define OBF_FB_UNLIKELY(x) (x)\n"
+           "#define OBF_FB_COLD\n"
+           "#endif\n"
+           "#if defined(__cplusplus) && __cplusplus >= 202002L\n"
+           "#define OBF_FB_UNLIKELY_ATTR [[unlikely]]\n"
+           "#else\n"
+           "#define OBF_FB_UNLIKELY_ATTR\n"
+           "#endif\n"
+           "#endif\n";
 }
 
 std::vector<std::string> ControlFlowRewriter::splitBasicBlocks(const std::string& code) {
@@ -372,51 +1549,304 @@ std::vector<std::string> ControlFlowRewriter::splitBasicBlocks(const std::string
 }
 
 std::string ControlFlowRewriter::shuffleBasicBlocks(const std::vector<std::string>& blocks) {
-    std::vector<std::string> shuffled = blocks;
-    RandomGenerator::getInstance().shuffle(shuffled);
+    // 没有热度信息时所有块都是冷块，即均匀随机排列
+    return shuffleBasicBlocks(blocks, std::vector<uint64_t>(blocks.size(), 0));
+}
+
+std::string ControlFlowRewriter::shuffleBasicBlocks(const std::vector<std::string>& blocks,
+                                                    const std::vector<uint64_t>& profile) {
+    // 输入顺序即落空顺序：每个块的首选后继是下一个块
+    std::vector<double> weights(blocks.size(), 0.0);
+    std::vector<std::vector<size_t>> successors(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (i < profile.size()) {
+            weights[i] = static_cast<double>(profile[i]);
+        }
+        if (i + 1 < blocks.size()) {
+            successors[i].push_back(i + 1);
+        }
+    }
 
     std::stringstream result;
-    for (const auto& block : shuffled) {
-        result << block << "\n";
+    for (size_t i : layoutBlocks(weights, successors, false)) {
+        result << blocks[i] << "\n";
     }
 
     return result.str();
 }
 
+std::vector<size_t> ControlFlowRewriter::layoutBlocks(
+    const std::vector<double>& weights, const std::vector<std::vector<size_t>>& successors,
+    bool pinEntry) const {
+    // 热度不低于最热块 1/kHotRatio 的块视为热块（全部相同则没有热块）
+    constexpr double kHotRatio = 8.0;
+    const size_t n = weights.size();
+    std::vector<size_t> order;
+    if (n == 0) {
+        return order;
+    }
+
+    auto& rng = RandomGenerator::getInstance();
+    const double maxWeight = *std::max_element(weights.begin(), weights.end());
+    const double minWeight = *std::min_element(weights.begin(), weights.end());
+    std::vector<bool> hot(n);
+    for (size_t b = 0; b < n; ++b) {
+        hot[b] = weights[b] > minWeight && weights[b] * kHotRatio > maxWeight;
+    }
+
+    // 自底向上成链（Pettis-Hansen）：按热度从高到低处理热块之间的边，
+    // 边的源点是某条链的尾、目标是另一条链的头时，以 locality 的概率连接两条链
+    std::vector<std::vector<size_t>> chains(n);
+    std::vector<size_t> chainOf(n);
+    for (size_t b = 0; b < n; ++b) {
+        chains[b] = {b};
+        chainOf[b] = b;
+    }
+    std::vector<std::pair<size_t, size_t>> edges;
+    for (size_t b = 0; b < n; ++b) {
+        for (size_t succ : successors[b]) {
+            if (succ < n && hot[b] && hot[succ] && !(pinEntry && succ == 0)) {
+                edges.push_back({b, succ});
+            }
+        }
+    }
+    auto edgeWeight = [&](const std::pair<size_t, size_t>& e) {
+        return std::min(weights[e.first], weights[e.second]);
+    };
+    std::stable_sort(edges.begin(), edges.end(), [&](const auto& x, const auto& y) {
+        return edgeWeight(x) > edgeWeight(y);
+    });
+    for (const auto& [from, to] : edges) {
+        auto& tail = chains[chainOf[from]];
+        auto& head = chains[chainOf[to]];
+        if (chainOf[from] == chainOf[to] || tail.back() != from || head.front() != to ||
+            !rng.randomBool(m_layoutLocality)) {
+            continue;
+        }
+        for (size_t b : head) {
+            chainOf[b] = chainOf[from];
+        }
+        tail.insert(tail.end(), head.begin(), head.end());
+        head.clear();
+    }
+
+    // 链作为整体随机排列，冷块是单元素的链
+    std::vector<size_t> rest;
+    for (size_t c = 0; c < n; ++c) {
+        if (!chains[c].empty() && !(pinEntry && c == chainOf[0])) {
+            rest.push_back(c);
+        }
+    }
+    rng.shuffle(rest);
+    if (pinEntry) {
+        order = chains[chainOf[0]];
+    }
+    for (size_t c : rest) {
+        order.insert(order.end(), chains[c].begin(), chains[c].end());
+    }
+    return order;
+}
+
 std::vector<ControlFlowRewriter::BasicBlock> ControlFlowRewriter::extractBasicBlocks(
-    const std::string& code) {
+    const std::string& code, std::string& hoisted) {
     std::vector<BasicBlock> blocks;
 
-    // 简化实现
-    BasicBlock block;
-    block.label = "entry";
-    block.code = code;
+    std::vector<Stmt> stmts;
+    StatementParser parser(code);
+    if (!parser.parseAll(stmts)) {
+        LOG_WARNING("Control flow not flattened: " + parser.error());
+        return blocks;
+    }
+
+    FlowLowering lowering(code);
+    if (!lowering.run(stmts)) {
+        LOG_WARNING("Control flow not flattened: " + lowering.error());
+        return blocks;
+    }
+    auto& lowered = lowering.blocks();
+
+    // 跳过只含一条无条件跳转的空块，每次状态转移都是一次间接跳转
+    auto forward = [&](size_t b) {
+        for (size_t steps = 0; steps < lowered.size(); ++steps) {
+            const auto& blk = lowered[b];
+            if (b == FlowLowering::kExit || !blk.code.empty() || !blk.condition.empty() ||
+                blk.successors.size() != 1) {
+                break;
+            }
+            b = blk.successors[0];
+        }
+        return b;
+    };
+    for (auto& blk : lowered) {
+        for (auto& succ : blk.successors) {
+            succ = forward(succ);
+        }
+    }
+
+    // 只保留从入口可达的块；出口块放在最后，控制流从这里落到函数末尾
+    std::vector<size_t> index(lowered.size(), npos);
+    std::vector<size_t> order;
+    std::vector<size_t> worklist = {FlowLowering::kEntry};
+    bool exitReachable = false;
+    while (!worklist.empty()) {
+        size_t b = worklist.back();
+        worklist.pop_back();
+        if (index[b] != npos) {
+            continue;
+        }
+        index[b] = 0;
+        if (b == FlowLowering::kExit) {
+            exitReachable = true;
+        } else {
+            order.push_back(b);
+        }
+        for (auto it = lowered[b].successors.rbegin(); it != lowered[b].successors.rend(); ++it) {
+            worklist.push_back(*it);
+        }
+    }
+    if (exitReachable) {
+        order.push_back(FlowLowering::kExit);
+    }
+    if (order.size() < 3) {
+        LOG_INFO("Control flow not flattened: straight-line code");
+        return blocks;
+    }
 
-    blocks.push_back(block);
+    for (size_t i = 0; i < order.size(); ++i) {
+        index[order[i]] = i;
+    }
+    for (size_t b : order) {
+        BasicBlock block;
+        block.label = "bb" + std::to_string(index[b]);
+        block.code = lowered[b].code;
+        block.condition = lowered[b].condition;
+        for (size_t succ : lowered[b].successors) {
+            block.successors.push_back(index[succ]);
+        }
+        block.exit = (b == FlowLowering::kExit);
+        blocks.push_back(block);
+    }
+
+    std::vector<std::vector<size_t>> successors;
+    for (const auto& block : blocks) {
+        successors.push_back(block.successors);
+    }
+    std::vector<unsigned> depths = computeLoopDepths(successors);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        blocks[i].loopDepth = depths[i];
+    }
 
+    hoisted = lowering.hoistedDeclarations();
     return blocks;
 }
 
-std::string ControlFlowRewriter::generateSwitchDispatcher(
-    const std::vector<BasicBlock>& blocks) {
-    std::stringstream ss;
+std::string ControlFlowRewriter::generateDispatcher(const std::vector<BasicBlock>& blocks,
+                                                    const std::string& hoisted) {
+    auto& rng = RandomGenerator::getInstance();
+    const std::string id = rng.randomHexString(4);
+    const std::string prefix = "obf_cf_" + id + "_";
+    const std::string next = "OBF_CF_" + id + "_NEXT";
+    const std::string gnuTest = "defined(__GNUC__) || defined(__clang__)";
+    constexpr double kLoopWeight = 8.0;    // 静态估计：每层循环约执行8次
+
+    // 入口块直接内联在最前面；其余块的状态号是随机排列，与输出顺序无关
+    std::vector<size_t> byState;
+    for (size_t i = 1; i < blocks.size(); ++i) {
+        if (!blocks[i].exit) {
+            byState.push_back(i);
+        }
+    }
+    rng.shuffle(byState);
+    if (blocks.back().exit) {
+        byState.push_back(blocks.size() - 1);
+    }
+    std::vector<size_t> stateOf(blocks.size(), 0);
+    for (size_t s = 0; s < byState.size(); ++s) {
+        stateOf[byState[s]] = s;
+    }
 
-    ss << "int __dispatcher_state = 0;\n";
-    ss << "while (1) {\n";
-    ss << "    switch (__dispatcher_state) {\n";
+    std::stringstream ss;
+    ss << "\n";
+    std::istringstream decls(hoisted);
+    std::string line;
+    while (std::getline(decls, line)) {
+        ss << "    " << line << "\n";
+    }
 
-    for (size_t i = 0; i < blocks.size(); ++i) {
-        ss << "    case " << i << ":\n";
-        ss << blocks[i].code << "\n";
-        ss << "        __dispatcher_state = " << ((i + 1) % blocks.size()) << ";\n";
-        ss << "        break;\n";
+    if (m_computedGoto) {
+        ss << "#if " << gnuTest << "\n";
+        ss << "    static void* const " << prefix << "tbl[] = {";
+        for (size_t s = 0; s < byState.size(); ++s) {
+            ss << (s ? ", " : " ") << "&&" << prefix << s;
+        }
+        ss << " };\n";
+        ss << "#define " << next << "(s) goto *" << prefix << "tbl[s]\n";
+        ss << "#else\n";
+    }
+    ss << "    unsigned " << prefix << "state;\n";
+    ss << "#define " << next << "(s) do { " << prefix << "state = (s); goto "
+       << prefix << "dispatch; } while (0)\n";
+    if (m_computedGoto) {
+        ss << "#endif\n";
     }
 
-    ss << "    default:\n";
-    ss << "        goto __exit;\n";
+    auto emitBlock = [&](const BasicBlock& block) {
+        std::istringstream lines(block.code);
+        while (std::getline(lines, line)) {
+            ss << "    " << line << "\n";
+        }
+        if (block.exit) {
+            ss << "    ;\n";
+        } else if (block.successors.size() == 1) {
+            ss << "    " << next << "(" << stateOf[block.successors[0]] << ");\n";
+        } else if (block.successors.size() == 2) {
+            ss << "    " << next << "((" << block.condition << ") ? "
+               << stateOf[block.successors[0]] << " : " << stateOf[block.successors[1]] << ");\n";
+        }
+    };
+
+    emitBlock(blocks[0]);
+
+    // 可移植的回退：所有块跳回同一个 switch
+    if (m_computedGoto) {
+        ss << "#if !(" << gnuTest << ")\n";
+    }
+    ss << prefix << "dispatch:\n";
+    ss << "    switch (" << prefix << "state) {\n";
+    for (size_t s = 0; s < byState.size(); ++s) {
+        ss << "    case " << s << ": goto " << prefix << s << ";\n";
+    }
     ss << "    }\n";
-    ss << "}\n";
-    ss << "__exit:\n";
+    if (m_computedGoto) {
+        ss << "#endif\n";
+    }
+
+    // 输出顺序：热循环内的块按控制流顺序连续排布，冷块随机打散；出口块必须在最后
+    std::vector<double> weights;
+    std::vector<std::vector<size_t>> successors;
+    for (const auto& block : blocks) {
+        weights.push_back(std::pow(kLoopWeight, block.loopDepth));
+        successors.emplace_back();
+        for (size_t succ : block.successors) {
+            if (!blocks[succ].exit) {
+                successors.back().push_back(succ);
+            }
+        }
+    }
+    if (blocks.back().exit) {
+        weights.pop_back();
+        successors.pop_back();
+    }
+    std::vector<size_t> layout = layoutBlocks(weights, successors, true);
+    if (blocks.back().exit) {
+        layout.push_back(blocks.size() - 1);
+    }
+
+    for (size_t i = 1; i < layout.size(); ++i) {
+        ss << prefix << stateOf[layout[i]] << ":\n";
+        emitBlock(blocks[layout[i]]);
+    }
+    ss << "#undef " << next << "\n";
 
     return ss.str();
 }
@@ -15,57 +15,574 @@
 #ifdef HAVE_LLVM
 
 #include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/GlobPattern.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include <algorithm>
 #include <random>
 
 using namespace llvm;
 
+#define DEBUG_TYPE "obfuscation"
+
+STATISTIC(NumJunkInstructions, "Number of junk instructions inserted");
+STATISTIC(NumOpaquePredicates, "Number of opaque predicates inserted");
+STATISTIC(NumFlattenedFunctions, "Number of functions flattened");
+STATISTIC(NumDispatchedBlocks, "Number of blocks reached through the dispatcher");
+STATISTIC(NumDispatchedEdges, "Number of CFG edges routed through the dispatcher");
+STATISTIC(NumDemotedValues, "Number of values demoted to stack by flattening");
+STATISTIC(NumEncryptedStrings, "Number of constant strings encrypted");
+STATISTIC(NumStringChecks, "Number of lazy decryption checks inserted");
+STATISTIC(NumRenamedSymbols, "Number of internal symbols renamed");
+
+static cl::opt<bool> FlattenSkipInnerLoops(
+    "obf-cff-skip-inner-loops", cl::init(false),
+    cl::desc("Leave blocks inside innermost loops unflattened"));
+
+static cl::opt<bool> FlattenReport(
+    "obf-cff-report", cl::init(false),
+    cl::desc("Print the dispatch cost added to each flattened function"));
+
+static cl::opt<unsigned> JunkOverhead(
+    "obf-junk-overhead", cl::init(10),
+    cl::desc("Junk instruction budget as a percentage of the estimated cost of each "
+             "function and of each loop body"));
+
+static cl::opt<double> JunkBlockProbability(
+    "obf-junk-probability", cl::init(0.3),
+    cl::desc("Probability of inserting a junk chain into a basic block"));
+
+static cl::opt<double> OpaqueBlockProbability(
+    "obf-opaque-probability", cl::init(0.3),
+    cl::desc("Probability of inserting an opaque predicate into a basic block"));
+
+static cl::opt<bool> JunkReport(
+    "obf-junk-report", cl::init(false),
+    cl::desc("Print the junk cost added to each function"));
+
+static cl::list<std::string> FunctionGlobs(
+    "obf-functions", cl::CommaSeparated,
+    cl::desc("Only obfuscate functions whose names match one of these globs "
+             "(obf: annotations always take precedence)"));
+
+static cl::list<std::string> ExcludeGlobs(
+    "obf-exclude", cl::CommaSeparated,
+    cl::desc("Never obfuscate functions whose names match one of these globs, "
+             "unless they carry an obf: annotation"));
+
+static cl::opt<std::string> RenameMapFile(
+    "obf-rename-map", cl::init(""),
+    cl::desc("Append the new -> original name mapping of renamed symbols to this file"));
+
+static cl::opt<uint64_t> ObfSeed(
+    "obf-seed", cl::init(0),
+    cl::desc("Module-level seed; every pass derives its per-function random stream from "
+             "this seed and a stable hash of the function name"));
+
 namespace {
 
+// 每个函数的随机数流只由 -obf-seed、Pass 名和函数名决定：同样的输入总是
+// 生成同样的 IR，ccache/sccache/ThinLTO 缓存可以命中，也不需要为每个函数
+// 读取 random_device。xxHash64 的结果与进程和平台无关
+static std::mt19937 seededRNG(StringRef PassName, StringRef Name) {
+    uint64_t X = ObfSeed ^ xxHash64(PassName) ^ (xxHash64(Name) * 0x9e3779b97f4a7c15ULL);
+    // splitmix64 终混，把 64 位种子压成 mt19937 的 seed_seq
+    X += 0x9e3779b97f4a7c15ULL;
+    X = (X ^ (X >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    X = (X ^ (X >> 27)) * 0x94d049bb133111ebULL;
+    X ^= X >> 31;
+    std::seed_seq Seq{static_cast<uint32_t>(X), static_cast<uint32_t>(X >> 32)};
+    return std::mt19937(Seq);
+}
+
+static std::mt19937 functionRNG(const Function &F, StringRef PassName) {
+    return seededRNG(PassName, F.getName());
+}
+
+// ============================================================================
+// 开销备注
+// ============================================================================
+//
+// 每个 Pass 修改函数后发出一条优化备注（-Rpass=obf，-fsave-optimization-record
+// 写入 YAML），参数固定为 InstructionsInserted、EstimatedCycles、BlocksFlattened
+// 和 SizeDelta，便于跨版本按函数跟踪混淆开销。周期数按 TTI 的倒数吞吐量估计，
+// 大小按 TCK_CodeSize 估计，都是静态的前后差值。未启用备注时不做统计。
+
+struct FunctionSize {
+    int64_t Instructions = 0;
+    int64_t Cycles = 0;
+    int64_t CodeSize = 0;
+};
+
+static FunctionSize measureFunction(const Function &F, const TargetTransformInfo &TTI) {
+    FunctionSize Size;
+    for (const BasicBlock &BB : F) {
+        for (const Instruction &I : BB) {
+            auto Cycles = TTI.getInstructionCost(&I, TargetTransformInfo::TCK_RecipThroughput).getValue();
+            auto Bytes = TTI.getInstructionCost(&I, TargetTransformInfo::TCK_CodeSize).getValue();
+            ++Size.Instructions;
+            Size.Cycles += Cycles ? *Cycles : 0;
+            Size.CodeSize += Bytes ? *Bytes : 0;
+        }
+    }
+    return Size;
+}
+
+static void emitObfuscationRemark(OptimizationRemarkEmitter &ORE, const char *PassName,
+                                  Function &F, const TargetTransformInfo &TTI,
+                                  const FunctionSize &Before, unsigned BlocksFlattened) {
+    if (!ORE.enabled()) {
+        return;
+    }
+    FunctionSize After = measureFunction(F, TTI);
+    ORE.emit([&]() {
+        return OptimizationRemark(PassName, "Obfuscated", &F)
+               << "obfuscated " << ore::NV("Function", &F) << ": "
+               << ore::NV("InstructionsInserted", After.Instructions - Before.Instructions)
+               << " instructions, ~" << ore::NV("EstimatedCycles", After.Cycles - Before.Cycles)
+               << " cycles, " << ore::NV("BlocksFlattened", BlocksFlattened)
+               << " blocks flattened, size delta "
+               << ore::NV("SizeDelta", After.CodeSize - Before.CodeSize);
+    });
+}
+
+// ============================================================================
+// 函数选择
+// ============================================================================
+//
+// 每个 Pass 对每个函数分别决定是否运行以及强度：
+//   1. 带有 __attribute__((annotate("obf:flatten,junk=2")))（记录在
+//      llvm.global.annotations 中）的函数只运行注解列出的 Pass，"obf:none" 表示不混淆；
+//   2. 未注解的函数：匹配 -obf-exclude 的不混淆；给出 -obf-functions 时只混淆匹配的；
+//   3. 其余函数按默认设置运行。
+// junk=N 把垃圾指令预算放大为 -obf-junk-overhead 的 N 倍；flatten=1 保留最内层循环，
+// flatten=2 及以上全部平坦化。未写强度时沿用命令行设置。
+
+static constexpr unsigned LevelOff = 0;         // 不运行
+static constexpr unsigned LevelDefault = ~0u;   // 沿用命令行设置
+
+static bool matchesAny(StringRef Name, const cl::list<std::string> &Globs) {
+    for (const std::string &Glob : Globs) {
+        Expected<GlobPattern> Pattern = GlobPattern::create(Glob);
+        if (!Pattern) {
+            consumeError(Pattern.takeError());
+            if (Name == Glob) {
+                return true;
+            }
+        } else if (Pattern->match(Name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 收集 F 上以 "obf:" 开头的注解（去掉前缀）；没有时返回 false
+static bool getObfAnnotations(const Function &F, SmallVectorImpl<StringRef> &Specs) {
+    const GlobalVariable *Annotations = F.getParent()->getNamedGlobal("llvm.global.annotations");
+    if (!Annotations || !Annotations->hasInitializer()) {
+        return false;
+    }
+    const auto *Array = dyn_cast<ConstantArray>(Annotations->getInitializer());
+    if (!Array) {
+        return false;
+    }
+    // 每一项为 { 被注解的值, 注解字符串, 文件名, 行号, 参数 }
+    for (const Use &Op : Array->operands()) {
+        const auto *Entry = dyn_cast<ConstantStruct>(Op.get());
+        if (!Entry || Entry->getNumOperands() < 2 ||
+            Entry->getOperand(0)->stripPointerCasts() != &F) {
+            continue;
+        }
+        const auto *Str = dyn_cast<GlobalVariable>(Entry->getOperand(1)->stripPointerCasts());
+        const auto *Data = Str && Str->hasInitializer()
+                               ? dyn_cast<ConstantDataArray>(Str->getInitializer())
+                               : nullptr;
+        if (!Data || !Data->isCString()) {
+            continue;
+        }
+        StringRef Text = Data->getAsCString().trim();
+        if (Text.consume_front("obf:")) {
+            Specs.push_back(Text);
+        }
+    }
+    return !Specs.empty();
+}
+
+// Pass（junk / flatten / opaque-pred）在 F 上的强度；EnabledByDefault 决定未注解的函数是否运行
+static unsigned obfuscationLevel(const Function &F, StringRef PassName, bool EnabledByDefault) {
+    SmallVector<StringRef, 2> Specs;
+    if (getObfAnnotations(F, Specs)) {
+        unsigned Level = LevelOff;
+        for (StringRef Spec : Specs) {
+            SmallVector<StringRef, 4> Items;
+            Spec.split(Items, ',', -1, false);
+            for (StringRef Item : Items) {
+                auto [Name, Value] = Item.split('=');
+                if (Name.trim() != PassName) {
+                    continue;
+                }
+                Value = Value.trim();
+                unsigned N = 0;
+                if (Value.empty()) {
+                    Level = LevelDefault;
+                } else if (!Value.getAsInteger(10, N)) {
+                    Level = N;
+                } else {
+                    errs() << "obf: " << F.getName() << ": ignoring invalid level in '"
+                           << Item << "'\n";
+                }
+            }
+        }
+        return Level;
+    }
+    if (!EnabledByDefault || matchesAny(F.getName(), ExcludeGlobs) ||
+        (!FunctionGlobs.empty() && !matchesAny(F.getName(), FunctionGlobs))) {
+        return LevelOff;
+    }
+    return LevelDefault;
+}
+
+static unsigned junkOverhead(unsigned Level) {
+    return Level == LevelDefault ? JunkOverhead : JunkOverhead * Level;
+}
+
+static bool flattenSkipsInnerLoops(unsigned Level) {
+    return Level == LevelDefault ? FlattenSkipInnerLoops : Level < 2;
+}
+
+// ============================================================================
+// 垃圾指令
+// ============================================================================
+//
+// 垃圾指令是以块内已有的整数值为输入的算术链，结果交给一条空的内联汇编
+// （call void asm sideeffect "", "r"(%v)）。内联汇编不产生任何机器指令，
+// 但迫使结果在寄存器中算出，后端无法删除；整个链不经过栈，也不引入 alloca。
+// 每条垃圾指令按 TTI 的吞吐开销计费，函数和其所在的每一层循环各有一份
+// 按原有开销比例给出的预算。
+
+// 按倒数吞吐量计算开销：垃圾链不在原有数据流的关键路径上
+static int64_t throughputCost(const TargetTransformInfo &TTI, const Instruction *I) {
+    auto Cost = TTI.getInstructionCost(I, TargetTransformInfo::TCK_RecipThroughput).getValue();
+    return Cost ? *Cost : 0;
+}
+
+static int64_t blockCost(const TargetTransformInfo &TTI, const BasicBlock &BB) {
+    int64_t Cost = 0;
+    for (const Instruction &I : BB) {
+        Cost += throughputCost(TTI, &I);
+    }
+    return Cost;
+}
+
+static bool isJunkOperandType(const Type *Ty) {
+    return Ty->isIntegerTy(8) || Ty->isIntegerTy(16) || Ty->isIntegerTy(32) ||
+           Ty->isIntegerTy(64);
+}
+
+// 垃圾链插在终结指令之前。不插入的块：
+//   - unreachable 结尾（冷路径）；
+//   - musttail 调用之后只能紧跟 ret（可带 bitcast）；
+//   - invoke/callbr 的结果在后继中才可用，catchswitch 必须是块中第一条非 PHI 指令
+static bool canHoldJunk(const BasicBlock &BB) {
+    const Instruction *Term = BB.getTerminator();
+    return !isa<UnreachableInst>(Term) && !isa<InvokeInst>(Term) && !isa<CallBrInst>(Term) &&
+           !isa<CatchSwitchInst>(Term) && !BB.getTerminatingMustTailCall();
+}
+
+static bool insertJunk(Function &F, LoopInfo &LI, const TargetTransformInfo &TTI,
+                       OptimizationRemarkEmitter &ORE, unsigned Overhead, std::mt19937 &Gen) {
+    if (F.isDeclaration()) {
+        return false;
+    }
+    FunctionSize Before = ORE.enabled() ? measureFunction(F, TTI) : FunctionSize();
+
+    // 预算: 函数总开销和每个循环体开销的 Overhead%
+    int64_t FunctionCost = 0;
+    DenseMap<const BasicBlock *, int64_t> CostOf;
+    for (BasicBlock &BB : F) {
+        CostOf[&BB] = blockCost(TTI, BB);
+        FunctionCost += CostOf[&BB];
+    }
+    int64_t FunctionBudget = FunctionCost * Overhead / 100;
+    DenseMap<const Loop *, int64_t> LoopBudget;
+    for (Loop *L : LI.getLoopsInPreorder()) {
+        int64_t LoopCost = 0;
+        for (BasicBlock *BB : L->blocks()) {
+            LoopCost += CostOf[BB];
+        }
+        LoopBudget[L] = LoopCost * Overhead / 100;
+    }
+
+    // 是否还能在 BB 中花费 Cost
+    auto affordable = [&](const BasicBlock *BB, int64_t Cost) {
+        if (Cost > FunctionBudget) {
+            return false;
+        }
+        for (const Loop *L = LI.getLoopFor(BB); L; L = L->getParentLoop()) {
+            if (Cost > LoopBudget[L]) {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto charge = [&](const BasicBlock *BB, int64_t Cost) {
+        FunctionBudget -= Cost;
+        for (const Loop *L = LI.getLoopFor(BB); L; L = L->getParentLoop()) {
+            LoopBudget[L] -= Cost;
+        }
+    };
+
+    SmallVector<BasicBlock *, 32> Blocks;
+    for (BasicBlock &BB : F) {
+        Blocks.push_back(&BB);
+    }
+    std::shuffle(Blocks.begin(), Blocks.end(), Gen);
+
+    std::uniform_real_distribution<> Dis(0.0, 1.0);
+    std::uniform_int_distribution<int> OpDis(0, 5);
+    std::uniform_int_distribution<int> LenDis(1, 4);
+    std::uniform_int_distribution<uint32_t> ConstDis;
+
+    unsigned Inserted = 0;
+    int64_t Spent = 0;
+    for (BasicBlock *BB : Blocks) {
+        if (FunctionBudget <= 0) {
+            break;
+        }
+        if (Dis(Gen) >= JunkBlockProbability || !canHoldJunk(*BB)) {
+            continue;
+        }
+
+        // 可用的输入: 参数和本块中终结指令之前定义的整数值，它们都支配插入点
+        SmallVector<Value *, 16> Inputs;
+        for (Argument &Arg : F.args()) {
+            if (isJunkOperandType(Arg.getType())) {
+                Inputs.push_back(&Arg);
+            }
+        }
+        for (Instruction &I : *BB) {
+            if (I.isTerminator()) {
+                break;
+            }
+            if (isJunkOperandType(I.getType())) {
+                Inputs.push_back(&I);
+            }
+        }
+        if (Inputs.empty()) {
+            continue;
+        }
+
+        IRBuilder<> Builder(BB->getTerminator());
+        std::uniform_int_distribution<size_t> InputDis(0, Inputs.size() - 1);
+        Value *Acc = Inputs[InputDis(Gen)];
+        Value *First = Acc;
+        int Length = LenDis(Gen);
+        for (int N = 0; N < Length; ++N) {
+            Type *Ty = Acc->getType();
+            Instruction *Last = BB->getTerminator()->getPrevNode();
+            Value *Other = Inputs[InputDis(Gen)];
+            if (Other->getType() != Ty) {
+                Other = ConstantInt::get(Ty, ConstDis(Gen) | 1);
+            }
+            Value *Shift = ConstantInt::get(Ty, ConstDis(Gen) % Ty->getIntegerBitWidth());
+            Value *Next = nullptr;
+            switch (OpDis(Gen)) {
+            case 0: Next = Builder.CreateAdd(Acc, Other, "obf.junk"); break;
+            case 1: Next = Builder.CreateXor(Acc, Other, "obf.junk"); break;
+            case 2: Next = Builder.CreateSub(Other, Acc, "obf.junk"); break;
+            case 3: Next = Builder.CreateOr(Acc, Builder.CreateLShr(Other, Shift, "obf.junk"), "obf.junk"); break;
+            case 4: Next = Builder.CreateShl(Acc, Shift, "obf.junk"); break;
+            default: Next = Builder.CreateMul(Acc, ConstantInt::get(Ty, ConstDis(Gen) | 1), "obf.junk"); break;
+            }
+            // IRBuilder 可能折叠常量运算，只计费实际插在终结指令前的新指令
+            SmallVector<Instruction *, 2> Created;
+            for (Instruction *I = Last ? Last->getNextNode() : &BB->front();
+                 I != BB->getTerminator(); I = I->getNextNode()) {
+                Created.push_back(I);
+            }
+            int64_t Cost = 0;
+            for (Instruction *I : Created) {
+                Cost += throughputCost(TTI, I);
+            }
+            if (!affordable(BB, Cost)) {
+                for (Instruction *I : Created) {
+                    I->eraseFromParent();
+                }
+                break;
+            }
+            charge(BB, Cost);
+            Spent += Cost;
+            Inserted += Created.size();
+            Acc = Next;
+        }
+        if (Acc == First) {
+            continue;
+        }
+
+        // 空内联汇编把链的结果固定在寄存器里，本身不产生指令，不计费
+        auto *SinkTy = FunctionType::get(Builder.getVoidTy(), {Acc->getType()}, false);
+        Builder.CreateCall(InlineAsm::get(SinkTy, "", "r", /*hasSideEffects=*/true), {Acc});
+    }
+
+    NumJunkInstructions += Inserted;
+    if (JunkReport) {
+        errs() << "obf-junk: " << F.getName() << ": " << Inserted << " instructions, ~"
+               << Spent << " cycles added to ~" << FunctionCost << " (budget "
+               << FunctionCost * Overhead / 100 << ")\n";
+    }
+    if (Inserted > 0) {
+        emitObfuscationRemark(ORE, "obf-junk", F, TTI, Before, 0);
+    }
+    return Inserted > 0;
+}
+
 // 垃圾指令插入Pass
 struct JunkInstructionPass : public FunctionPass {
     static char ID;
     JunkInstructionPass() : FunctionPass(ID) {}
 
     bool runOnFunction(Function &F) override {
-        bool modified = false;
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dis(0.0, 1.0);
+        unsigned Level = obfuscationLevel(F, "junk", true);
+        if (Level == LevelOff) {
+            return false;
+        }
+        std::mt19937 gen = functionRNG(F, "junk");
+        LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+        const TargetTransformInfo &TTI =
+            getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+        OptimizationRemarkEmitter &ORE =
+            getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
+        return insertJunk(F, LI, TTI, ORE, junkOverhead(Level), gen);
+    }
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+        AU.addRequired<LoopInfoWrapperPass>();
+        AU.addRequired<TargetTransformInfoWrapperPass>();
+        AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
+        AU.setPreservesCFG();
+    }
+};
+
+// ============================================================================
+// 不透明谓词
+// ============================================================================
+//
+// 在块中随机选一个分割点，插入一条恒真的条件跳转，条件取自模块级全局变量：
+//
+//   %obf.x    = load i32, i32* @obf.opaque
+//   %obf.xx1  = mul i32 %obf.x, (add i32 %obf.x, 1)    ; 相邻两数之积必为偶数
+//   %obf.pred = icmp eq i32 (and i32 %obf.xx1, 1), 0
+//   br i1 %obf.pred, label %obf.cont, label %obf.bogus
+//   obf.bogus: store i32 (xor i32 %obf.x, K), i32* @obf.opaque; br label %obf.cont
+//
+// 伪分支从不执行，但它写入 @obf.opaque，优化器不能把这个全局变量当作常量
+// 折叠掉；不变式对任意 x 都成立，与初值和其他线程无关。值都在 SSA 寄存器中，
+// 不引入 alloca。伪分支标为极不可能，布局时放在热路径之外。
 
-        // 遍历所有基本块
-        for (auto &BB : F) {
-            // 在基本块中随机插入垃圾指令
-            if (dis(gen) < 0.3) {  // 30%概率
-                insertJunkInstructions(BB);
-                modified = true;
+static GlobalVariable *getOpaqueGlobal(Module &M) {
+    if (GlobalVariable *GV = M.getGlobalVariable("obf.opaque", /*AllowInternal=*/true)) {
+        return GV;
+    }
+    std::mt19937 Gen = seededRNG("opaque-pred", M.getSourceFileName());
+    Type *Int32Ty = Type::getInt32Ty(M.getContext());
+    return new GlobalVariable(M, Int32Ty, /*isConstant=*/false, GlobalValue::InternalLinkage,
+                              ConstantInt::get(Int32Ty, Gen()), "obf.opaque");
+}
+
+// 不插入的块：
+//   - unreachable 结尾（冷路径）；
+//   - EH pad，以及以 catchswitch 结尾的块：普通跳转不能进入 EH pad；
+//   - musttail 调用之后只能紧跟 ret（可带 bitcast）
+static bool canHoldOpaquePredicate(const BasicBlock &BB) {
+    const Instruction *Term = BB.getTerminator();
+    return !isa<UnreachableInst>(Term) && !Term->isEHPad() && !BB.isEHPad() &&
+           !BB.getTerminatingMustTailCall();
+}
+
+static bool insertOpaquePredicates(Function &F, const TargetTransformInfo &TTI,
+                                   OptimizationRemarkEmitter &ORE, std::mt19937 &Gen) {
+    if (F.isDeclaration()) {
+        return false;
+    }
+    FunctionSize Before = ORE.enabled() ? measureFunction(F, TTI) : FunctionSize();
+
+    SmallVector<BasicBlock *, 32> Blocks;
+    for (BasicBlock &BB : F) {
+        if (canHoldOpaquePredicate(BB)) {
+            Blocks.push_back(&BB);
+        }
+    }
+
+    std::uniform_real_distribution<> Dis(0.0, 1.0);
+    std::uniform_int_distribution<uint32_t> ConstDis;
+    MDNode *Likely = MDBuilder(F.getContext()).createBranchWeights(1 << 20, 1);
+    GlobalVariable *Opaque = nullptr;
+    unsigned Inserted = 0;
+    for (BasicBlock *BB : Blocks) {
+        if (Dis(Gen) >= OpaqueBlockProbability) {
+            continue;
+        }
+        // 入口块只在终结指令前分割：静态 alloca 必须留在入口块
+        SmallVector<Instruction *, 16> Points;
+        if (BB == &F.getEntryBlock()) {
+            Points.push_back(BB->getTerminator());
+        } else {
+            for (auto It = BB->getFirstInsertionPt(); It != BB->end(); ++It) {
+                Points.push_back(&*It);
             }
         }
+        std::uniform_int_distribution<size_t> PointDis(0, Points.size() - 1);
+        Instruction *SplitPt = Points[PointDis(Gen)];
 
-        return modified;
-    }
+        if (!Opaque) {
+            Opaque = getOpaqueGlobal(*F.getParent());
+        }
+        // 分割点之前的指令都留在 BB 中，支配 obf.cont，后者不需要 PHI
+        BasicBlock *Cont = BB->splitBasicBlock(SplitPt, "obf.cont");
+        BasicBlock *Bogus = BasicBlock::Create(F.getContext(), "obf.bogus", &F, Cont);
+        Instruction *OldBr = BB->getTerminator();
+        IRBuilder<> Builder(OldBr);
+        Value *X = Builder.CreateLoad(Opaque->getValueType(), Opaque, "obf.x");
+        Value *Product = Builder.CreateMul(X, Builder.CreateAdd(X, Builder.getInt32(1), "obf.x1"),
+                                           "obf.xx1");
+        Value *Cond = Builder.CreateICmpEQ(Builder.CreateAnd(Product, 1, "obf.low"),
+                                           Builder.getInt32(0), "obf.pred");
+        Builder.CreateCondBr(Cond, Cont, Bogus, Likely);
+        OldBr->eraseFromParent();
 
-private:
-    void insertJunkInstructions(BasicBlock &BB) {
-        IRBuilder<> Builder(&BB);
-        Builder.SetInsertPoint(&BB, BB.getFirstInsertionPt());
+        Builder.SetInsertPoint(Bogus);
+        Builder.CreateStore(Builder.CreateXor(X, ConstDis(Gen), "obf.bogus.x"), Opaque);
+        Builder.CreateBr(Cont);
+        ++Inserted;
+    }
 
-        // 插入无意义的算术操作
-        // 例如: temp = 5; temp = temp + 10; temp = temp - 10;
-        Type *Int32Ty = Type::getInt32Ty(BB.getContext());
-        Value *temp = Builder.CreateAlloca(Int32Ty);
-        Builder.CreateStore(Builder.getInt32(5), temp);
-        Value *loaded = Builder.CreateLoad(Int32Ty, temp);
-        Value *added = Builder.CreateAdd(loaded, Builder.getInt32(10));
-        Value *subbed = Builder.CreateSub(added, Builder.getInt32(10));
-        Builder.CreateStore(subbed, temp);
+    NumOpaquePredicates += Inserted;
+    if (Inserted > 0) {
+        emitObfuscationRemark(ORE, "obf-opaque-pred", F, TTI, Before, 0);
     }
-};
+    return Inserted > 0;
+}
 
 // 不透明谓词插入Pass
 struct OpaquePredicatePass : public FunctionPass {
@@ -73,54 +590,252 @@ struct OpaquePredicatePass : public FunctionPass {
     OpaquePredicatePass() : FunctionPass(ID) {}
 
     bool runOnFunction(Function &F) override {
-        bool modified = false;
+        if (obfuscationLevel(F, "opaque-pred", true) == LevelOff) {
+            return false;
+        }
+        std::mt19937 gen = functionRNG(F, "opaque-pred");
+        const TargetTransformInfo &TTI =
+            getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+        OptimizationRemarkEmitter &ORE =
+            getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
+        return insertOpaquePredicates(F, TTI, ORE, gen);
+    }
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+        AU.addRequired<TargetTransformInfoWrapperPass>();
+        AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
+    }
+};
 
-        for (auto &BB : F) {
-            // 在基本块前插入永真谓词
-            if (insertOpaquePredicate(BB)) {
-                modified = true;
+// ============================================================================
+// 控制流平坦化
+// ============================================================================
+//
+// 所有被平坦化的块通过一个分发块 obf.dispatch 互相跳转：
+//
+//   entry:         ...; br obf.dispatch
+//   obf.dispatch:  %obf.state = phi i32 [...]
+//                  switch %obf.state, label %obf.default [0..N-1]
+//   obf.default:   unreachable
+//
+// 状态值是 0..N-1 的随机排列，且 default 不可达，后端会将其降低为没有
+// 范围检查的稠密跳转表；状态保存在SSA寄存器中，条件跳转改为 select 后
+// 无分支地选出下一个状态。后端的尾复制会把这条间接跳转复制到各个前驱，
+// 每个块拥有独立的 BTB 表项，而不是所有跳转共用一条难以预测的分支。
+
+// 是否保留 From -> To 这条边不经过分发块
+static bool keepEdgeDirect(BasicBlock *From, BasicBlock *To,
+                           const DenseMap<BasicBlock *, Loop *> &KeptLoops) {
+    auto It = KeptLoops.find(To);
+    if (It == KeptLoops.end()) {
+        return false;
+    }
+    Loop *L = It->second;
+    if (L->contains(From)) {
+        return true;
+    }
+    // 唯一的循环前驱无条件跳入循环头时直接相连，循环头的PHI无需降级
+    return To == L->getHeader() && L->getLoopPredecessor() == From &&
+           From->getSingleSuccessor() == To;
+}
+
+static int64_t costOf(const TargetTransformInfo &TTI, const Instruction *I) {
+    auto Cost = TTI.getInstructionCost(I, TargetTransformInfo::TCK_Latency).getValue();
+    return Cost ? *Cost : 0;
+}
+
+static bool flattenFunction(Function &F, LoopInfo &LI, const TargetTransformInfo &TTI,
+                            OptimizationRemarkEmitter &ORE, bool SkipInnerLoops,
+                            std::mt19937 &Gen) {
+    if (F.isDeclaration() || F.size() < 3) {
+        return false;
+    }
+
+    // 异常处理、间接跳转和取地址的块无法经由分发块到达
+    for (BasicBlock &BB : F) {
+        const Instruction *T = BB.getTerminator();
+        if (BB.isEHPad() || BB.hasAddressTaken() ||
+            !(isa<BranchInst>(T) || isa<SwitchInst>(T) || isa<ReturnInst>(T) ||
+              isa<UnreachableInst>(T))) {
+            return false;
+        }
+    }
+
+    DenseMap<BasicBlock *, Loop *> KeptLoops;
+    if (SkipInnerLoops) {
+        for (Loop *L : LI.getLoopsInPreorder()) {
+            if (L->isInnermost()) {
+                for (BasicBlock *BB : L->blocks()) {
+                    KeptLoops[BB] = L;
+                }
+            }
+        }
+    }
+
+    // 收集需要经过分发块的边，目标块即为分发目标
+    SmallVector<BasicBlock *, 32> Blocks;
+    SmallVector<BasicBlock *, 32> Targets;
+    DenseMap<BasicBlock *, uint32_t> StateOf;
+    for (BasicBlock &BB : F) {
+        Blocks.push_back(&BB);
+        for (BasicBlock *Succ : successors(&BB)) {
+            if (!keepEdgeDirect(&BB, Succ, KeptLoops) && !StateOf.count(Succ)) {
+                StateOf[Succ] = 0;
+                Targets.push_back(Succ);
             }
         }
+    }
+    if (Targets.size() < 2) {
+        return false;
+    }
+    FunctionSize Before = ORE.enabled() ? measureFunction(F, TTI) : FunctionSize();
+
+    std::shuffle(Targets.begin(), Targets.end(), Gen);
+    for (uint32_t I = 0; I < Targets.size(); ++I) {
+        StateOf[Targets[I]] = I;
+    }
+
+    // 分发目标的前驱都变成分发块，其PHI必须降级到栈上
+    unsigned Demoted = 0;
+    for (BasicBlock *Target : Targets) {
+        SmallVector<PHINode *, 8> Phis;
+        for (PHINode &PN : Target->phis()) {
+            Phis.push_back(&PN);
+        }
+        for (PHINode *PN : Phis) {
+            DemotePHIToStack(PN);
+            ++Demoted;
+        }
+    }
+
+    LLVMContext &Ctx = F.getContext();
+    Type *StateTy = Type::getInt32Ty(Ctx);
+    BasicBlock *Entry = &F.getEntryBlock();
 
-        return modified;
+    BasicBlock *Dispatch = BasicBlock::Create(Ctx, "obf.dispatch", &F, Entry->getNextNode());
+    BasicBlock *Default = BasicBlock::Create(Ctx, "obf.default", &F);
+    new UnreachableInst(Ctx, Default);
+    PHINode *State = PHINode::Create(StateTy, Targets.size(), "obf.state", Dispatch);
+    SwitchInst *Switch = SwitchInst::Create(State, Default, Targets.size(), Dispatch);
+    for (BasicBlock *Target : Targets) {
+        Switch->addCase(ConstantInt::get(Ctx, APInt(32, StateOf[Target])), Target);
     }
 
-private:
-    bool insertOpaquePredicate(BasicBlock &BB) {
-        IRBuilder<> Builder(&BB);
-        Builder.SetInsertPoint(&BB, BB.getFirstInsertionPt());
+    auto stateConst = [&](BasicBlock *BB) {
+        return ConstantInt::get(StateTy, StateOf[BB]);
+    };
 
-        // 创建永真条件: (x * x >= 0)
-        Type *Int32Ty = Type::getInt32Ty(BB.getContext());
-        Value *x = Builder.CreateAlloca(Int32Ty);
-        Builder.CreateStore(Builder.getInt32(5), x);
+    unsigned Edges = 0;
+    int64_t SelectCost = 0;
+    int64_t JumpCost = 0;
+    for (BasicBlock *BB : Blocks) {
+        Instruction *T = BB->getTerminator();
+        if (T->getNumSuccessors() == 0) {
+            continue;
+        }
 
-        Value *loaded = Builder.CreateLoad(Int32Ty, x);
-        Value *squared = Builder.CreateMul(loaded, loaded);
-        Value *cond = Builder.CreateICmpSGE(squared, Builder.getInt32(0));
+        auto *Br = dyn_cast<BranchInst>(T);
+        bool AllRouted = true;
+        for (BasicBlock *Succ : successors(BB)) {
+            AllRouted &= !keepEdgeDirect(BB, Succ, KeptLoops);
+        }
 
-        // 这个条件总是为真，但静态分析难以确定
-        // 可以在true分支放真实代码，false分支放垃圾代码
+        if (Br && AllRouted) {
+            Value *Next = stateConst(Br->getSuccessor(0));
+            if (Br->isConditional()) {
+                auto *Sel = SelectInst::Create(Br->getCondition(), Next,
+                                               stateConst(Br->getSuccessor(1)), "obf.next", Br);
+                SelectCost += costOf(TTI, Sel);
+                Next = Sel;
+            }
+            State->addIncoming(Next, BB);
+            JumpCost = costOf(TTI, BranchInst::Create(Dispatch, Br));
+            Edges += Br->getNumSuccessors();
+            Br->eraseFromParent();
+            continue;
+        }
 
-        return true;
+        // switch 或只有部分边需要分发（如离开保留循环的边）：经由中转块进入分发块
+        DenseMap<BasicBlock *, BasicBlock *> Stubs;
+        for (unsigned I = 0; I < T->getNumSuccessors(); ++I) {
+            BasicBlock *Succ = T->getSuccessor(I);
+            if (keepEdgeDirect(BB, Succ, KeptLoops)) {
+                continue;
+            }
+            BasicBlock *&Stub = Stubs[Succ];
+            if (!Stub) {
+                Stub = BasicBlock::Create(Ctx, "obf.edge", &F, Default);
+                BranchInst::Create(Dispatch, Stub);
+                State->addIncoming(stateConst(Succ), Stub);
+            }
+            T->setSuccessor(I, Stub);
+            ++Edges;
+        }
     }
-};
 
-// 控制流平坦化Pass（简化版）
+    // 原来的支配关系已被打破，跨块使用不再被支配的值降级到栈上
+    DominatorTree DT(F);
+    SmallVector<Instruction *, 32> Broken;
+    for (BasicBlock &BB : F) {
+        for (Instruction &I : BB) {
+            if (isa<AllocaInst>(I) && &BB == Entry) {
+                continue;
+            }
+            for (const Use &U : I.uses()) {
+                if (!DT.dominates(&I, U)) {
+                    Broken.push_back(&I);
+                    break;
+                }
+            }
+        }
+    }
+    for (Instruction *I : Broken) {
+        DemoteRegToStack(*I);
+    }
+    Demoted += Broken.size();
+
+    ++NumFlattenedFunctions;
+    NumDispatchedBlocks += Targets.size();
+    NumDispatchedEdges += Edges;
+    NumDemotedValues += Demoted;
+
+    if (FlattenReport) {
+        // 每次经由分发块的跳转额外执行: 跳到分发块 + 跳转表间接跳转（+ 条件边的 select）
+        int64_t PerTransfer = JumpCost + costOf(TTI, Switch);
+        errs() << "obf-cff: " << F.getName() << ": " << Targets.size()
+               << " blocks dispatched, " << Edges << " edges via dispatcher, "
+               << KeptLoops.size() << " blocks kept in innermost loops, " << Demoted
+               << " values demoted, ~" << PerTransfer
+               << " cycles per dispatched transfer (+" << SelectCost
+               << " in selects)\n";
+    }
+    emitObfuscationRemark(ORE, "obf-flatten", F, TTI, Before, Targets.size());
+    return true;
+}
+
+// 控制流平坦化Pass
 struct ControlFlowFlatteningPass : public FunctionPass {
     static char ID;
     ControlFlowFlatteningPass() : FunctionPass(ID) {}
 
     bool runOnFunction(Function &F) override {
-        // 控制流平坦化的完整实现较复杂
-        // 需要：
-        // 1. 提取所有基本块
-        // 2. 创建switch分发器
-        // 3. 为每个块分配状态值
-        // 4. 重写跳转为状态更新
+        unsigned Level = obfuscationLevel(F, "flatten", true);
+        if (Level == LevelOff) {
+            return false;
+        }
+        std::mt19937 gen = functionRNG(F, "flatten");
+        LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+        const TargetTransformInfo &TTI =
+            getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+        OptimizationRemarkEmitter &ORE =
+            getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
+        return flattenFunction(F, LI, TTI, ORE, flattenSkipsInnerLoops(Level), gen);
+    }
 
-        errs() << "Control Flow Flattening Pass (Skeleton)\n";
-        return false;  // 骨架实现
+    void getAnalysisUsage(AnalysisUsage &AU) const override {
+        AU.addRequired<LoopInfoWrapperPass>();
+        AU.addRequired<TargetTransformInfoWrapperPass>();
+        AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
     }
 };
 
@@ -136,8 +851,696 @@ static RegisterPass<OpaquePredicatePass> Y("opaque-pred",
 static RegisterPass<ControlFlowFlatteningPass> Z("flatten-cfg",
     "Flatten control flow", false, false);
 
+// ============================================================================
+// 字符串加密
+// ============================================================================
+//
+// 只在函数中使用的内部常量 C 字符串（[N x i8]，以 0 结尾）被加密后合并到
+// 一张模块级的表中，每个模块只有一个解密函数：
+//
+//   @obf.str.enc    加密后的字节（只读）
+//   @obf.str.data   解密后的字节（.bss，原字符串的地址都指向这里）
+//   @obf.str.ready  每个字符串的状态：0 未解密，1 正在解密，2 已解密
+//   @obf.str.table  每个字符串的 { 偏移, 长度, 密钥 }
+//   @obf.str.decrypt(i32 idx)  冷的外联慢路径：cmpxchg 0 -> 1 选出唯一的解密线程，
+//                              解密到 data 后 release 写入 2；其余线程 acquire 读取直到 2
+//
+// 快路径直接内联在使用之前：acquire 读取状态，不为 2 时调用 decrypt。被同一字符串
+// 另一个检查支配的使用不再检查。与源码级运行时（generateDecryptionRuntime）的
+// 协议相同：明文只由一个线程写一次，读到 2 的线程不会与写入竞争。
+
+struct EncryptedString {
+    GlobalVariable *GV;
+    uint32_t Offset;
+    uint32_t Length;
+    uint32_t Key;
+};
+
+// 收集 V 在指令中的使用位置（经由常量表达式）；被全局初始化等非指令使用时返回 false
+static bool collectStringUses(Value *V, SmallVectorImpl<Instruction *> &Points) {
+    for (User *U : V->users()) {
+        if (auto *PN = dyn_cast<PHINode>(U)) {
+            // PHI 的值在前驱块末尾就需要可用
+            for (unsigned I = 0; I < PN->getNumIncomingValues(); ++I) {
+                if (PN->getIncomingValue(I) == V) {
+                    Points.push_back(PN->getIncomingBlock(I)->getTerminator());
+                }
+            }
+        } else if (auto *Inst = dyn_cast<Instruction>(U)) {
+            if (Inst->isEHPad()) {
+                return false;
+            }
+            Points.push_back(Inst);
+        } else if (auto *CE = dyn_cast<ConstantExpr>(U)) {
+            if (!collectStringUses(CE, Points)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool isEncryptableString(const GlobalVariable &GV) {
+    if (!GV.hasLocalLinkage() || !GV.isConstant() || !GV.hasInitializer() || GV.hasSection() ||
+        GV.isThreadLocal()) {
+        return false;
+    }
+    const auto *Data = dyn_cast<ConstantDataArray>(GV.getInitializer());
+    return Data && Data->isCString();
+}
+
+// 流密码：每个字节与 32 位 LCG 状态的低字节异或，解密函数中的循环与此一致
+static uint32_t nextKeyState(uint32_t K) {
+    return K * 1103515245u + 12345u;
+}
+
+static Function *createStringDecryptor(Module &M, GlobalVariable *Enc, GlobalVariable *Data,
+                                       GlobalVariable *Ready, GlobalVariable *Table) {
+    LLVMContext &Ctx = M.getContext();
+    Type *I8Ty = Type::getInt8Ty(Ctx);
+    Type *I32Ty = Type::getInt32Ty(Ctx);
+    auto *FnTy = FunctionType::get(Type::getVoidTy(Ctx), {I32Ty}, false);
+    Function *F = Function::Create(FnTy, GlobalValue::InternalLinkage, "obf.str.decrypt", M);
+    F->addFnAttr(Attribute::NoInline);
+    F->addFnAttr(Attribute::Cold);
+    F->addFnAttr(Attribute::NoUnwind);
+
+    BasicBlock *Entry = BasicBlock::Create(Ctx, "entry", F);
+    BasicBlock *Claimed = BasicBlock::Create(Ctx, "claimed", F);
+    BasicBlock *Loop = BasicBlock::Create(Ctx, "loop", F);
+    BasicBlock *Exit = BasicBlock::Create(Ctx, "exit", F);
+    BasicBlock *Wait = BasicBlock::Create(Ctx, "wait", F);
+    BasicBlock *Done = BasicBlock::Create(Ctx, "done", F);
+
+    IRBuilder<> B(Entry);
+    Value *Idx = F->getArg(0);
+    Type *TableTy = Table->getValueType();
+    Value *Zero = B.getInt32(0);
+    Value *State = B.CreateInBoundsGEP(Ready->getValueType(), Ready, {Zero, Idx});
+    AtomicCmpXchgInst *Claim = B.CreateAtomicCmpXchg(State, B.getInt8(0), B.getInt8(1), MaybeAlign(1),
+                                                     AtomicOrdering::Acquire, AtomicOrdering::Acquire);
+    B.CreateCondBr(B.CreateExtractValue(Claim, 1), Claimed, Wait);
+
+    B.SetInsertPoint(Claimed);
+    auto field = [&](unsigned N) {
+        Value *P = B.CreateInBoundsGEP(TableTy, Table, {Zero, Idx, B.getInt32(N)});
+        return B.CreateLoad(I32Ty, P);
+    };
+    Value *Offset = field(0);
+    Value *Length = field(1);
+    Value *Key = field(2);
+    B.CreateBr(Loop);
+
+    B.SetInsertPoint(Loop);
+    PHINode *I = B.CreatePHI(I32Ty, 2, "i");
+    PHINode *K = B.CreatePHI(I32Ty, 2, "k");
+    Value *Pos = B.CreateAdd(Offset, I);
+    Value *Src = B.CreateInBoundsGEP(Enc->getValueType(), Enc, {Zero, Pos});
+    Value *Dst = B.CreateInBoundsGEP(Data->getValueType(), Data, {Zero, Pos});
+    Value *Plain = B.CreateXor(B.CreateLoad(I8Ty, Src), B.CreateTrunc(K, I8Ty));
+    B.CreateStore(Plain, Dst);
+    Value *NextK = B.CreateAdd(B.CreateMul(K, B.getInt32(1103515245u)), B.getInt32(12345u));
+    Value *NextI = B.CreateAdd(I, B.getInt32(1));
+    B.CreateCondBr(B.CreateICmpULT(NextI, Length), Loop, Exit);
+    I->addIncoming(Zero, Claimed);
+    I->addIncoming(NextI, Loop);
+    K->addIncoming(Key, Claimed);
+    K->addIncoming(NextK, Loop);
+
+    B.SetInsertPoint(Exit);
+    StoreInst *Publish = B.CreateStore(B.getInt8(2), State);
+    Publish->setAtomic(AtomicOrdering::Release);
+    Publish->setAlignment(Align(1));
+    B.CreateBr(Done);
+
+    // 另一个线程正在解密：等它写入 2
+    B.SetInsertPoint(Wait);
+    LoadInst *Current = B.CreateLoad(I8Ty, State);
+    Current->setAtomic(AtomicOrdering::Acquire);
+    Current->setAlignment(Align(1));
+    B.CreateCondBr(B.CreateICmpEQ(Current, B.getInt8(2)), Done, Wait);
+
+    B.SetInsertPoint(Done);
+    B.CreateRetVoid();
+    return F;
+}
+
+static bool encryptStrings(Module &M) {
+    SmallVector<EncryptedString, 32> Strings;
+    DenseMap<GlobalVariable *, SmallVector<Instruction *, 8>> UsesOf;
+    uint32_t Size = 0;
+    Align MaxAlign(1);
+    std::mt19937 Gen = seededRNG("strings", M.getSourceFileName());
+
+    for (GlobalVariable &GV : M.globals()) {
+        if (!isEncryptableString(GV)) {
+            continue;
+        }
+        SmallVector<Instruction *, 8> Points;
+        if (!collectStringUses(&GV, Points) || Points.empty()) {
+            continue;
+        }
+        Align A = GV.getAlign().valueOrOne();
+        Size = alignTo(Size, A);
+        MaxAlign = std::max(MaxAlign, A);
+        uint32_t Length = cast<ConstantDataArray>(GV.getInitializer())->getNumElements();
+        Strings.push_back({&GV, Size, Length, static_cast<uint32_t>(Gen())});
+        UsesOf[&GV] = std::move(Points);
+        Size += Length;
+    }
+    if (Strings.empty()) {
+        return false;
+    }
+
+    LLVMContext &Ctx = M.getContext();
+    Type *I8Ty = Type::getInt8Ty(Ctx);
+    Type *I32Ty = Type::getInt32Ty(Ctx);
+
+    // 密文与描述表
+    std::vector<uint8_t> Cipher(Size, 0);
+    std::vector<Constant *> Rows;
+    auto *RowTy = StructType::get(Ctx, {I32Ty, I32Ty, I32Ty});
+    for (const EncryptedString &S : Strings) {
+        StringRef Plain = cast<ConstantDataArray>(S.GV->getInitializer())->getRawDataValues();
+        uint32_t K = S.Key;
+        for (uint32_t I = 0; I < S.Length; ++I) {
+            Cipher[S.Offset + I] = static_cast<uint8_t>(Plain[I]) ^ static_cast<uint8_t>(K);
+            K = nextKeyState(K);
+        }
+        Rows.push_back(ConstantStruct::get(RowTy, {ConstantInt::get(I32Ty, S.Offset),
+                                                   ConstantInt::get(I32Ty, S.Length),
+                                                   ConstantInt::get(I32Ty, S.Key)}));
+    }
+    auto *DataTy = ArrayType::get(I8Ty, Size);
+    auto *Enc = new GlobalVariable(M, DataTy, true, GlobalValue::PrivateLinkage,
+                                   ConstantDataArray::get(Ctx, Cipher), "obf.str.enc");
+    auto *Data = new GlobalVariable(M, DataTy, false, GlobalValue::InternalLinkage,
+                                    ConstantAggregateZero::get(DataTy), "obf.str.data");
+    Data->setAlignment(MaxAlign);
+    auto *ReadyTy = ArrayType::get(I8Ty, Strings.size());
+    auto *Ready = new GlobalVariable(M, ReadyTy, false, GlobalValue::InternalLinkage,
+                                     ConstantAggregateZero::get(ReadyTy), "obf.str.ready");
+    auto *TableTy = ArrayType::get(RowTy, Strings.size());
+    auto *Table = new GlobalVariable(M, TableTy, true, GlobalValue::PrivateLinkage,
+                                     ConstantArray::get(TableTy, Rows), "obf.str.table");
+    Function *Decrypt = createStringDecryptor(M, Enc, Data, Ready, Table);
+
+    // 先在原始 CFG 上为所有字符串选好检查点，再统一插入。检查点都是原有指令，
+    // 拆块不改变它们之间的支配关系
+    DenseMap<Function *, std::unique_ptr<DominatorTree>> Trees;
+    std::vector<SmallVector<Instruction *, 8>> ChecksOf(Strings.size());
+    for (uint32_t Idx = 0; Idx < Strings.size(); ++Idx) {
+        MapVector<Function *, SmallVector<Instruction *, 8>> ByFunction;
+        for (Instruction *I : UsesOf[Strings[Idx].GV]) {
+            ByFunction[I->getFunction()].push_back(I);
+        }
+        for (auto &[F, Points] : ByFunction) {
+            std::unique_ptr<DominatorTree> &DT = Trees[F];
+            if (!DT) {
+                DT = std::make_unique<DominatorTree>(*F);
+                DT->updateDFSNumbers();
+            }
+            // 不可达的使用不会执行，无需检查
+            llvm::erase_if(Points, [&](Instruction *I) {
+                return !DT->isReachableFromEntry(I->getParent());
+            });
+            // 按支配树先序排列，支配者排在被支配者之前
+            llvm::sort(Points, [&](Instruction *A, Instruction *B) {
+                if (A->getParent() != B->getParent()) {
+                    return (*DT)[A->getParent()]->getDFSNumIn() < (*DT)[B->getParent()]->getDFSNumIn();
+                }
+                return A != B && A->comesBefore(B);
+            });
+            Points.erase(std::unique(Points.begin(), Points.end()), Points.end());
+            SmallVector<Instruction *, 8> &Chosen = ChecksOf[Idx];
+            size_t First = Chosen.size();
+            for (Instruction *P : Points) {
+                bool Covered = std::any_of(Chosen.begin() + First, Chosen.end(),
+                                           [&](Instruction *C) { return DT->dominates(C, P); });
+                if (!Covered) {
+                    Chosen.push_back(P);
+                }
+            }
+        }
+    }
+
+    MDNode *Unlikely = MDBuilder(Ctx).createBranchWeights(1, 1 << 20);
+    for (uint32_t Idx = 0; Idx < Strings.size(); ++Idx) {
+        const EncryptedString &S = Strings[Idx];
+        for (Instruction *Before : ChecksOf[Idx]) {
+            IRBuilder<> B(Before);
+            Value *Flag = B.CreateInBoundsGEP(ReadyTy, Ready, {B.getInt32(0), B.getInt32(Idx)});
+            LoadInst *Loaded = B.CreateLoad(I8Ty, Flag, "obf.str.ready");
+            Loaded->setAtomic(AtomicOrdering::Acquire);
+            Loaded->setAlignment(Align(1));
+            Value *Cold = B.CreateICmpNE(Loaded, B.getInt8(2));
+            Instruction *Then = SplitBlockAndInsertIfThen(Cold, Before, false, Unlikely);
+            IRBuilder<>(Then).CreateCall(Decrypt, {ConstantInt::get(I32Ty, Idx)});
+        }
+        NumStringChecks += ChecksOf[Idx].size();
+
+        Constant *Plain = ConstantExpr::getInBoundsGetElementPtr(
+            DataTy, Data,
+            ArrayRef<Constant *>{ConstantInt::get(I32Ty, 0), ConstantInt::get(I32Ty, S.Offset)});
+        S.GV->replaceAllUsesWith(ConstantExpr::getPointerCast(Plain, S.GV->getType()));
+        S.GV->eraseFromParent();
+    }
+    NumEncryptedStrings += Strings.size();
+    return true;
+}
+
+// 字符串加密Pass
+struct StringEncryptionPass : public ModulePass {
+    static char ID;
+    StringEncryptionPass() : ModulePass(ID) {}
+
+    bool runOnModule(Module &M) override {
+        return encryptStrings(M);
+    }
+};
+
+char StringEncryptionPass::ID = 0;
+
+static RegisterPass<StringEncryptionPass> S("encrypt-strings",
+    "Encrypt constant C strings", false, false);
+
+// ============================================================================
+// 符号重命名
+// ============================================================================
+//
+// 内部链接的函数、全局变量和别名改为由短名分配器生成的名字（a, b, ..., z, aa, ab, ...），
+// 所有函数中的基本块、参数和指令名被清除。分配顺序由 -obf-seed 和源文件名决定，
+// 相同输入总是得到相同的名字。名字只影响符号表，生成的代码完全不变。
+// -obf-rename-map 给出时，把"新名字 原名字"追加到映射文件，用于还原崩溃栈。
+
+// 第 N 个短名：双射的 26 进制（a..z, aa..zz, ...），首字符总是字母
+static std::string shortName(uint64_t N) {
+    std::string Name;
+    do {
+        Name.insert(Name.begin(), static_cast<char>('a' + N % 26));
+        N = N / 26;
+    } while (N-- > 0);
+    return Name;
+}
+
+static bool isRenamable(const GlobalValue &GV, StringRef ModuleAsm) {
+    if (!GV.hasLocalLinkage() || !GV.hasName() || GV.getName().startswith("llvm.")) {
+        return false;
+    }
+    if (const auto *GO = dyn_cast<GlobalObject>(&GV)) {
+        // comdat 以名字关联，llvm.metadata 等特殊段按名字引用
+        if (GO->hasComdat() || GO->getSection() == "llvm.metadata") {
+            return false;
+        }
+    }
+    // 模块级内联汇编按名字引用符号
+    return !ModuleAsm.contains(GV.getName());
+}
+
+static bool renameSymbols(Module &M) {
+    bool Changed = false;
+    for (Function &F : M) {
+        for (Argument &Arg : F.args()) {
+            Changed |= Arg.hasName();
+            Arg.setName("");
+        }
+        for (BasicBlock &BB : F) {
+            Changed |= BB.hasName();
+            BB.setName("");
+            for (Instruction &I : BB) {
+                Changed |= I.hasName();
+                I.setName("");
+            }
+        }
+    }
+
+    std::vector<GlobalValue *> Symbols;
+    for (GlobalValue &GV : M.global_values()) {
+        if (isRenamable(GV, M.getModuleInlineAsm())) {
+            Symbols.push_back(&GV);
+        }
+    }
+    if (Symbols.empty()) {
+        return Changed;
+    }
+
+    // 先全部置为匿名，分配时只需避开其余仍在使用的名字
+    std::vector<std::string> Original;
+    for (GlobalValue *GV : Symbols) {
+        Original.push_back(GV->getName().str());
+        GV->setName("");
+    }
+    std::vector<size_t> Order(Symbols.size());
+    for (size_t I = 0; I < Order.size(); ++I) {
+        Order[I] = I;
+    }
+    std::mt19937 Gen = seededRNG("rename", M.getSourceFileName());
+    std::shuffle(Order.begin(), Order.end(), Gen);
+
+    std::string Mapping;
+    raw_string_ostream OS(Mapping);
+    OS << "# " << M.getSourceFileName() << "\n";
+    uint64_t Next = 0;
+    for (size_t I : Order) {
+        std::string Name;
+        do {
+            Name = shortName(Next++);
+        } while (M.getNamedValue(Name));
+        Symbols[I]->setName(Name);
+        OS << Name << "\t" << Original[I] << "\n";
+    }
+    NumRenamedSymbols += Symbols.size();
+
+    if (!RenameMapFile.empty()) {
+        // ThinLTO 后端并行写同一个文件：每个模块只做一次追加写
+        std::error_code EC;
+        raw_fd_ostream File(RenameMapFile, EC, sys::fs::OF_Append | sys::fs::OF_Text);
+        if (EC) {
+            errs() << "obf-rename: cannot open " << RenameMapFile << ": " << EC.message() << "\n";
+        } else {
+            File << OS.str();
+        }
+    }
+    return true;
+}
+
+// 符号重命名Pass
+struct SymbolRenamingPass : public ModulePass {
+    static char ID;
+    SymbolRenamingPass() : ModulePass(ID) {}
+
+    bool runOnModule(Module &M) override {
+        return renameSymbols(M);
+    }
+};
+
+char SymbolRenamingPass::ID = 0;
+
+static RegisterPass<SymbolRenamingPass> R("rename-symbols",
+    "Rename internal symbols and strip value names", false, false);
+
+// ============================================================================
+// 新 Pass 管理器插件
+// ============================================================================
+//
+// 作为 -fpass-plugin / -load-pass-plugin 加载时，在 -obf-pipeline-ep 指定的扩展点
+// 按 strings -> opaque-pred -> flatten -> junk -> rename 的顺序加入 Pass；未注解的函数只运行
+// -obf-passes 选中的 Pass，带 obf: 注解的函数按注解运行。默认在
+// OptimizerLast（向量化之后、代码生成之前）运行：前面的优化不受混淆影响，
+// 之后也没有优化会把混淆撤销。每个 Pass 是独立的新 PM Pass，-ftime-report /
+// -time-passes 会分别计时。也可以在 -passes= 中直接使用 obf-junk、obf-opaque-pred、
+// obf-flatten 和模块 Pass obf-strings、obf-rename。
+//
+// LTO/ThinLTO 构建中只在链接期混淆一次：编译期用 -obf-lto 加载插件时，预链接流水线
+// 中的 OptimizerLast 只给模块打上 "obf.stage" 标记，真正的混淆留给链接期。
+// ThinLTO 后端对每个分区各自运行 OptimizerLast，混淆因此在跨模块内联之后进行，
+// 并分摊到 ThinLTO 线程池；完整 LTO 没有链接期扩展点，用自定义流水线
+// lto<O2>,obf 在合并后的模块上运行。已混淆的模块同样带有标记，不会被再次混淆。
+
+// 不生成代码的函数（声明、available_externally 导入的副本）不需要混淆
+static bool skipFunction(const Function &F) {
+    return F.isDeclaration() || F.hasAvailableExternallyLinkage();
+}
+
+// EnabledByDefault: 是否处理未注解的函数。-passes= 中直接使用时为 true
+struct ObfJunkPass : PassInfoMixin<ObfJunkPass> {
+    static StringRef name() { return "ObfJunkPass"; }
+
+    explicit ObfJunkPass(bool EnabledByDefault = true) : EnabledByDefault(EnabledByDefault) {}
+    bool EnabledByDefault;
+
+    PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+        if (skipFunction(F)) {
+            return PreservedAnalyses::all();
+        }
+        unsigned Level = obfuscationLevel(F, "junk", EnabledByDefault);
+        if (Level == LevelOff) {
+            return PreservedAnalyses::all();
+        }
+        std::mt19937 gen = functionRNG(F, "junk");
+        if (!insertJunk(F, FAM.getResult<LoopAnalysis>(F), FAM.getResult<TargetIRAnalysis>(F),
+                        FAM.getResult<OptimizationRemarkEmitterAnalysis>(F),
+                        junkOverhead(Level), gen)) {
+            return PreservedAnalyses::all();
+        }
+        PreservedAnalyses PA;
+        PA.preserveSet<CFGAnalyses>();
+        return PA;
+    }
+};
+
+struct ObfOpaquePredicatePass : PassInfoMixin<ObfOpaquePredicatePass> {
+    static StringRef name() { return "ObfOpaquePredicatePass"; }
+
+    explicit ObfOpaquePredicatePass(bool EnabledByDefault = true) : EnabledByDefault(EnabledByDefault) {}
+    bool EnabledByDefault;
+
+    PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+        if (skipFunction(F) || obfuscationLevel(F, "opaque-pred", EnabledByDefault) == LevelOff) {
+            return PreservedAnalyses::all();
+        }
+        std::mt19937 gen = functionRNG(F, "opaque-pred");
+        if (!insertOpaquePredicates(F, FAM.getResult<TargetIRAnalysis>(F),
+                                    FAM.getResult<OptimizationRemarkEmitterAnalysis>(F), gen)) {
+            return PreservedAnalyses::all();
+        }
+        return PreservedAnalyses::none();
+    }
+};
+
+struct ObfFlattenPass : PassInfoMixin<ObfFlattenPass> {
+    static StringRef name() { return "ObfFlattenPass"; }
+
+    explicit ObfFlattenPass(bool EnabledByDefault = true) : EnabledByDefault(EnabledByDefault) {}
+    bool EnabledByDefault;
+
+    PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+        if (skipFunction(F)) {
+            return PreservedAnalyses::all();
+        }
+        unsigned Level = obfuscationLevel(F, "flatten", EnabledByDefault);
+        if (Level == LevelOff) {
+            return PreservedAnalyses::all();
+        }
+        std::mt19937 gen = functionRNG(F, "flatten");
+        if (!flattenFunction(F, FAM.getResult<LoopAnalysis>(F), FAM.getResult<TargetIRAnalysis>(F),
+                             FAM.getResult<OptimizationRemarkEmitterAnalysis>(F),
+                             flattenSkipsInnerLoops(Level), gen)) {
+            return PreservedAnalyses::all();
+        }
+        return PreservedAnalyses::none();
+    }
+};
+
+struct ObfStringEncryptionPass : PassInfoMixin<ObfStringEncryptionPass> {
+    static StringRef name() { return "ObfStringEncryptionPass"; }
+
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &) {
+        return encryptStrings(M) ? PreservedAnalyses::none() : PreservedAnalyses::all();
+    }
+};
+
+struct ObfRenamePass : PassInfoMixin<ObfRenamePass> {
+    static StringRef name() { return "ObfRenamePass"; }
+
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &) {
+        // 只改名字，所有分析结果仍然有效
+        renameSymbols(M);
+        return PreservedAnalyses::all();
+    }
+};
+
+enum class PipelineEP { OptimizerLast, VectorizerStart, ScalarOptimizerLate, None };
+
+static cl::opt<PipelineEP> PipelineExtensionPoint(
+    "obf-pipeline-ep", cl::init(PipelineEP::OptimizerLast),
+    cl::desc("Where the plugin inserts the obfuscation passes into the default pipeline"),
+    cl::values(
+        clEnumValN(PipelineEP::OptimizerLast, "optimizer-last",
+                   "After the vectorizer, right before code generation (default)"),
+        clEnumValN(PipelineEP::VectorizerStart, "vectorizer-start",
+                   "Before the loop/SLP vectorizers"),
+        clEnumValN(PipelineEP::ScalarOptimizerLate, "scalar-late",
+                   "At the end of the function simplification pipeline"),
+        clEnumValN(PipelineEP::None, "none",
+                   "Do not extend the default pipeline (use -passes= instead)")));
+
+static cl::list<std::string> PipelinePasses(
+    "obf-passes", cl::CommaSeparated,
+    cl::desc("Obfuscation passes added to the default pipeline: junk, opaque-pred, flatten, "
+             "strings, rename (default: flatten,junk)"));
+
+static bool enabled(StringRef Name) {
+    if (PipelinePasses.empty()) {
+        return Name == "flatten" || Name == "junk";
+    }
+    return std::find(PipelinePasses.begin(), PipelinePasses.end(), Name.str()) !=
+           PipelinePasses.end();
+}
+
+static void addObfuscationPasses(FunctionPassManager &FPM) {
+    // 三个函数 Pass 都加入，带注解的函数可以选用 -obf-passes 之外的 Pass
+    FPM.addPass(ObfOpaquePredicatePass(enabled("opaque-pred")));
+    FPM.addPass(ObfFlattenPass(enabled("flatten")));
+    FPM.addPass(ObfJunkPass(enabled("junk")));
+}
+
+static cl::opt<bool> DeferToLTO(
+    "obf-lto", cl::init(false),
+    cl::desc("Compile step of an LTO/ThinLTO build: only mark the module, obfuscation "
+             "runs once in the link-time (post-link) pipeline"));
+
+// 模块标记 "obf.stage"：1 表示留待链接期混淆，2 表示已经混淆。
+// 合并行为取 Max，完整 LTO 合并模块时保留最靠后的阶段。3 只在一条流水线内
+// 出现：函数级扩展点上的混淆 Pass 已在本流水线中开始运行，随后由
+// OptimizerLast 的 ObfModulePass 改为 2
+enum ObfStage : uint32_t { StageNone = 0, StageDeferred = 1, StageApplied = 2, StageRunning = 3 };
+
+static uint32_t getObfStage(const Module &M) {
+    auto *Stage = mdconst::extract_or_null<ConstantInt>(M.getModuleFlag("obf.stage"));
+    return Stage ? static_cast<uint32_t>(Stage->getZExtValue()) : StageNone;
+}
+
+static void setObfStage(Module &M, uint32_t Stage) {
+    M.setModuleFlag(Module::Max, "obf.stage",
+                    ConstantAsMetadata::get(ConstantInt::get(Type::getInt32Ty(M.getContext()), Stage)));
+}
+
+// 按模块标记决定是否运行内部的混淆流水线，每个模块只混淆一次
+struct ObfModulePass : PassInfoMixin<ObfModulePass> {
+    static StringRef name() { return "ObfModulePass"; }
+
+    ModulePassManager Passes;
+    // 函数 Pass 在更早的函数级扩展点运行时为 true：只有本流水线已经开始
+    // 混淆（StageRunning）才运行，否则留给函数 Pass 实际运行的那条流水线
+    bool AfterFunctionEP = false;
+
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &MAM) {
+        uint32_t Stage = getObfStage(M);
+        if (Stage == StageNone && DeferToLTO) {
+            setObfStage(M, StageDeferred);
+            return PreservedAnalyses::all();
+        }
+        if (Stage == StageApplied || (AfterFunctionEP && Stage != StageRunning)) {
+            return PreservedAnalyses::all();
+        }
+        PreservedAnalyses PA = Passes.run(M, MAM);
+        setObfStage(M, StageApplied);
+        return PA;
+    }
+};
+
+// 函数级扩展点上的混淆 Pass 与 ObfModulePass 使用同样的阶段判断：已混淆的模块
+// 跳过，-obf-lto 的编译期流水线留给链接期
+struct ObfFunctionStagePass : PassInfoMixin<ObfFunctionStagePass> {
+    static StringRef name() { return "ObfFunctionStagePass"; }
+
+    FunctionPassManager Passes;
+
+    PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+        Module &M = *F.getParent();
+        uint32_t Stage = getObfStage(M);
+        if (Stage == StageApplied || (Stage == StageNone && DeferToLTO)) {
+            return PreservedAnalyses::all();
+        }
+        if (Stage != StageRunning) {
+            setObfStage(M, StageRunning);
+        }
+        return Passes.run(F, FAM);
+    }
+};
+
+static ObfModulePass createObfModulePass(bool AfterFunctionEP = false) {
+    ObfModulePass Pass;
+    Pass.AfterFunctionEP = AfterFunctionEP;
+    if (enabled("strings")) {
+        Pass.Passes.addPass(ObfStringEncryptionPass());
+    }
+    if (!AfterFunctionEP) {
+        FunctionPassManager FPM;
+        addObfuscationPasses(FPM);
+        Pass.Passes.addPass(createModuleToFunctionPassAdaptor(std::move(FPM)));
+    }
+    if (enabled("rename")) {
+        Pass.Passes.addPass(ObfRenamePass());
+    }
+    return Pass;
+}
+
+static ObfFunctionStagePass createObfFunctionStagePass() {
+    ObfFunctionStagePass Pass;
+    addObfuscationPasses(Pass.Passes);
+    return Pass;
+}
+
+static void registerObfuscationPasses(PassBuilder &PB) {
+    PB.registerPipelineParsingCallback(
+        [](StringRef Name, ModulePassManager &MPM, ArrayRef<PassBuilder::PipelineElement>) {
+            if (Name == "obf") {
+                MPM.addPass(createObfModulePass());
+            } else if (Name == "obf-strings") {
+                MPM.addPass(ObfStringEncryptionPass());
+            } else if (Name == "obf-rename") {
+                MPM.addPass(ObfRenamePass());
+            } else {
+                return false;
+            }
+            return true;
+        });
+
+    PB.registerPipelineParsingCallback(
+        [](StringRef Name, FunctionPassManager &FPM, ArrayRef<PassBuilder::PipelineElement>) {
+            if (Name == "obf-junk") {
+                FPM.addPass(ObfJunkPass());
+            } else if (Name == "obf-opaque-pred") {
+                FPM.addPass(ObfOpaquePredicatePass());
+            } else if (Name == "obf-flatten") {
+                FPM.addPass(ObfFlattenPass());
+            } else {
+                return false;
+            }
+            return true;
+        });
+
+    switch (PipelineExtensionPoint) {
+    case PipelineEP::OptimizerLast:
+        // ThinLTO 预链接和后端流水线都会调用 OptimizerLast，由 ObfModulePass 按标记取舍
+        PB.registerOptimizerLastEPCallback([](ModulePassManager &MPM, OptimizationLevel) {
+            MPM.addPass(createObfModulePass());
+        });
+        break;
+    case PipelineEP::VectorizerStart:
+        PB.registerVectorizerStartEPCallback([](FunctionPassManager &FPM, OptimizationLevel) {
+            FPM.addPass(createObfFunctionStagePass());
+        });
+        break;
+    case PipelineEP::ScalarOptimizerLate:
+        PB.registerScalarOptimizerLateEPCallback([](FunctionPassManager &FPM, OptimizationLevel) {
+            FPM.addPass(createObfFunctionStagePass());
+        });
+        break;
+    case PipelineEP::None:
+        break;
+    }
+    // 函数级扩展点放不下模块 Pass：字符串加密、重命名和阶段标记仍在 OptimizerLast。
+    // ThinLTO 预链接流水线不经过 VectorizerStart，此时模块保持未标记，留给后端
+    if (PipelineExtensionPoint == PipelineEP::VectorizerStart ||
+        PipelineExtensionPoint == PipelineEP::ScalarOptimizerLate) {
+        PB.registerOptimizerLastEPCallback([](ModulePassManager &MPM, OptimizationLevel) {
+            MPM.addPass(createObfModulePass(/*AfterFunctionEP=*/true));
+        });
+    }
+}
+
 } // namespace
 
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo() {
+    return {LLVM_PLUGIN_API_VERSION, "ObfuscationPass", LLVM_VERSION_STRING,
+            registerObfuscationPasses};
+}
+
 #else
 
 // 如果没有LLVM，提供占位符
@@ -8,6 +8,7 @@
 #include <iomanip>
 
 // 引入混淆器头文件
+#include "asm_rewriter/asm_rewriter.h"
 #include "engine/obfuscation_engine.h"
 #include "strategy/obfuscation_strategy.h"
 #include "utils/logger.h"
@@ -21,17 +22,31 @@ void printUsage(const char* programName) {
     std::cout << "Code Obfuscator - C/C++ 花指令混淆器\n\n";
     std::cout << "用法: " << programName << " [选项]\n\n";
     std::cout << "选项:\n";
-    std::cout << "  -i, --input <file>      输入源文件\n";
+    std::cout << "  -i, --input <file>      输入源文件（配合 --amalgamate 可多次指定）\n";
     std::cout << "  -o, --output <file>     输出文件\n";
     std::cout << "  -c, --config <file>     配置文件 (默认: config.json)\n";
     std::cout << "  -l, --level <1-4>       混淆等级 (1=轻度, 4=极限)\n";
+    std::cout << "  --string-pool <policy>  字符串池化存储 (eager=启动时解密, lazy=按字符串解密, page=按页解密)\n";
+    std::cout << "  --encrypt-resources     加密大型字节数组资源，运行时流式解密（等级3及以上）\n";
+    std::cout << "  --predicate-cycles <n>  每个函数不透明谓词的周期预算 (默认: 0=按复杂度取值)\n";
+    std::cout << "  --pointer-aliasing      不透明谓词中加入指针别名类模板\n";
+    std::cout << "  --layout-locality <f>   平坦化后块布局的热路径局部性 0.0-1.0 (默认: 0.75)\n";
+    std::cout << "  --amalgamate            将多个输入文件合并为一个翻译单元后混淆（跨文件字符串去重）\n";
+    std::cout << "  --mode <source|asm>     输入类型 (source=C/C++源码, asm=编译器生成的 .s 汇编，流式处理)\n";
+    std::cout << "  --threads <n>           asm 模式的并行线程数 (默认: 0=硬件线程数)\n";
+    std::cout << "  --cpu <model>           asm 模式按此微架构估算花指令开销 (generic|skylake|icelake|zen2|zen3)\n";
+    std::cout << "  --block-cycles <c>      asm 模式每个基本块花指令的吞吐周期上限 (默认: 1.0)\n";
+    std::cout << "  --block-bytes <n>       asm 模式每个基本块花指令的字节上限 (默认: 16)\n";
+    std::cout << "  --align-pad             asm 模式用花指令代替 .p2align 前的对齐填充\n";
     std::cout << "  -v, --verbose           详细输出\n";
     std::cout << "  -h, --help              显示此帮助信息\n";
     std::cout << "  --version               显示版本信息\n\n";
     std::cout << "示例:\n";
     std::cout << "  " << programName << " -i input.c -o output.c\n";
     std::cout << "  " << programName << " -i input.c -o output.c -l 3\n";
-    std::cout << "  " << programName << " -i input.c -o output.c -c custom.json\n\n";
+    std::cout << "  " << programName << " -i input.c -o output.c -c custom.json\n";
+    std::cout << "  " << programName << " -i a.c -i b.c --amalgamate -o all.c -l 3\n";
+    std::cout << "  " << programName << " -i input.s -o output.s --mode asm -l 2\n\n";
     std::cout << "警告: 本工具仅用于合法的软件保护和教育目的！\n";
 }
 
@@ -54,7 +69,24 @@ void printBanner() {
 }
 
 // 真实的混淆函数
-std::string obfuscateCode(const std::string& code, int level, bool verbose) {
+// 根据扩展名判断是否为C++源文件
+bool isCxxSource(const std::string& path) {
+    static const std::vector<std::string> extensions = {
+        ".cpp", ".cc", ".cxx", ".c++", ".C", ".hpp", ".hh", ".hxx"
+    };
+    for (const auto& ext : extensions) {
+        if (path.size() > ext.size() &&
+            path.compare(path.size() - ext.size(), ext.size(), ext) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string obfuscateCode(const std::string& code, int level, bool verbose,
+                          const std::string& stringPool, bool cxxTarget,
+                          bool encryptResources, float layoutLocality,
+                          int predicateCycles, bool pointerAliasing) {
     // 创建混淆引擎
     ObfuscationEngine engine;
     engine.setObfuscationLevel(level);
@@ -72,6 +104,8 @@ std::string obfuscateCode(const std::string& code, int level, bool verbose) {
     if (level >= 2) {
         // Level 2: 中度混淆 - 添加不透明谓词
         auto opaqueStrategy = std::make_unique<OpaquePredicateStrategy>();
+        opaqueStrategy->setCostBudget(predicateCycles);
+        opaqueStrategy->setPointerAliasing(pointerAliasing);
         engine.addStrategy(std::move(opaqueStrategy));
     }
 
@@ -79,12 +113,27 @@ std::string obfuscateCode(const std::string& code, int level, bool verbose) {
         // Level 3: 重度混淆 - 添加字符串加密
         auto stringStrategy = std::make_unique<StringEncryptionStrategy>();
         stringStrategy->setMinLength(4);
+        stringStrategy->setResourceEncryption(encryptResources);
+        if (cxxTarget && stringPool.empty()) {
+            // C++ 目标使用编译期加密头文件，无需生成解密桩代码
+            stringStrategy->setCompileTimeEncryption(true);
+        } else if (!stringPool.empty()) {
+            stringStrategy->setStorage(StringEncryptionStrategy::Storage::POOLED);
+            if (stringPool == "eager") {
+                stringStrategy->setDecryptPolicy(StringEncryptionStrategy::DecryptPolicy::EAGER);
+            } else if (stringPool == "page") {
+                stringStrategy->setDecryptPolicy(StringEncryptionStrategy::DecryptPolicy::LAZY_PAGE);
+            } else {
+                stringStrategy->setDecryptPolicy(StringEncryptionStrategy::DecryptPolicy::LAZY_STRING);
+            }
+        }
         engine.addStrategy(std::move(stringStrategy));
     }
 
     if (level >= 4) {
         // Level 4: 极限混淆 - 添加控制流平坦化
         auto cfgStrategy = std::make_unique<ControlFlowFlatteningStrategy>();
+        cfgStrategy->setLayoutLocality(layoutLocality);
         engine.addStrategy(std::move(cfgStrategy));
     }
 
@@ -120,13 +169,69 @@ std::string obfuscateCode(const std::string& code, int level, bool verbose) {
     return result.str();
 }
 
+// 汇编模式：逐行流式改写，不把整个文件读入内存
+int rewriteAssembly(const std::string& inputFile, const std::string& outputFile,
+                    int level, unsigned threads, CpuModel cpu, double blockCycles,
+                    unsigned blockBytes, bool alignPadding, bool verbose) {
+    std::ifstream inFile(inputFile);
+    if (!inFile.is_open()) {
+        std::cerr << "错误: 无法打开输入文件: " << inputFile << "\n";
+        return 1;
+    }
+    std::ofstream outFile(outputFile);
+    if (!outFile.is_open()) {
+        std::cerr << "错误: 无法创建输出文件: " << outputFile << "\n";
+        return 1;
+    }
+
+    AsmRewriter rewriter(static_cast<uint32_t>(RandomGenerator::getInstance().randomInt(0, INT32_MAX)));
+    rewriter.setDensity(0.1f * level);
+    rewriter.setThreads(threads);
+    rewriter.setCpuModel(cpu);
+    rewriter.setBlockBudget(blockCycles, blockBytes);
+    rewriter.setAlignmentPadding(alignPadding);
+    if (!rewriter.rewriteStream(inFile, outFile)) {
+        std::cerr << "错误: 汇编改写失败\n";
+        return 1;
+    }
+    outFile.close();
+
+    AsmRewriter::Statistics stats = rewriter.getStatistics();
+    if (verbose) {
+        std::cout << "\n=== 完成 ===\n";
+        std::cout << "处理行数: " << stats.lines << "\n";
+        std::cout << "改写函数: " << stats.functions << "\n";
+        std::cout << "插入花指令: " << stats.inserted << "\n";
+        std::cout << "估计开销 (" << cpuModelName(cpu) << "): " << std::fixed
+                  << std::setprecision(2) << stats.cycles << " 周期, " << stats.bytes << " 字节\n";
+        std::cout << "代替对齐填充: " << stats.paddingBytes << " 字节\n";
+        std::cout << "在途数据峰值: " << stats.peakPendingBytes << " 字节\n";
+        std::cout << "输出已保存到: " << outputFile << "\n";
+    } else {
+        std::cout << "成功: " << inputFile << " -> " << outputFile << "\n";
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     // 解析命令行参数
-    std::string inputFile;
+    std::vector<std::string> inputFiles;
     std::string outputFile;
     std::string configFile = "config.json";
     int obfuscationLevel = 2;
     bool verbose = false;
+    std::string stringPool;
+    bool amalgamateInputs = false;
+    bool encryptResources = false;
+    float layoutLocality = 0.75f;
+    int predicateCycles = 0;
+    bool pointerAliasing = false;
+    std::string mode = "source";
+    unsigned threads = 0;
+    CpuModel cpu = CpuModel::GENERIC;
+    double blockCycles = 1.0;
+    unsigned blockBytes = 16;
+    bool alignPadding = false;
 
     // 如果没有参数，显示帮助
     if (argc == 1) {
@@ -147,7 +252,7 @@ int main(int argc, char* argv[]) {
             return 0;
         } else if (arg == "-i" || arg == "--input") {
             if (i + 1 < argc) {
-                inputFile = argv[++i];
+                inputFiles.push_back(argv[++i]);
             } else {
                 std::cerr << "错误: -i 需要指定文件名\n";
                 return 1;
@@ -177,6 +282,103 @@ int main(int argc, char* argv[]) {
                 std::cerr << "错误: -l 需要指定等级 (1-4)\n";
                 return 1;
             }
+        } else if (arg == "--string-pool") {
+            if (i + 1 < argc) {
+                stringPool = argv[++i];
+                if (stringPool != "eager" && stringPool != "lazy" && stringPool != "page") {
+                    std::cerr << "错误: --string-pool 必须是 eager、lazy 或 page\n";
+                    return 1;
+                }
+            } else {
+                std::cerr << "错误: --string-pool 需要指定策略\n";
+                return 1;
+            }
+        } else if (arg == "--encrypt-resources") {
+            encryptResources = true;
+        } else if (arg == "--predicate-cycles") {
+            if (i + 1 < argc) {
+                predicateCycles = std::stoi(argv[++i]);
+                if (predicateCycles < 0) {
+                    std::cerr << "错误: --predicate-cycles 不能为负数\n";
+                    return 1;
+                }
+            } else {
+                std::cerr << "错误: --predicate-cycles 需要指定数值\n";
+                return 1;
+            }
+        } else if (arg == "--pointer-aliasing") {
+            pointerAliasing = true;
+        } else if (arg == "--layout-locality") {
+            if (i + 1 < argc) {
+                layoutLocality = std::stof(argv[++i]);
+                if (layoutLocality < 0.0f || layoutLocality > 1.0f) {
+                    std::cerr << "错误: --layout-locality 必须在 0.0 到 1.0 之间\n";
+                    return 1;
+                }
+            } else {
+                std::cerr << "错误: --layout-locality 需要指定数值\n";
+                return 1;
+            }
+        } else if (arg == "--amalgamate") {
+            amalgamateInputs = true;
+        } else if (arg == "--mode") {
+            if (i + 1 < argc) {
+                mode = argv[++i];
+                if (mode != "source" && mode != "asm") {
+                    std::cerr << "错误: --mode 必须是 source 或 asm\n";
+                    return 1;
+                }
+            } else {
+                std::cerr << "错误: --mode 需要指定类型\n";
+                return 1;
+            }
+        } else if (arg == "--threads") {
+            if (i + 1 < argc) {
+                int value = std::stoi(argv[++i]);
+                if (value < 0) {
+                    std::cerr << "错误: --threads 不能为负数\n";
+                    return 1;
+                }
+                threads = static_cast<unsigned>(value);
+            } else {
+                std::cerr << "错误: --threads 需要指定数值\n";
+                return 1;
+            }
+        } else if (arg == "--cpu") {
+            if (i + 1 < argc) {
+                if (!parseCpuModel(argv[++i], cpu)) {
+                    std::cerr << "错误: --cpu 必须是 generic、skylake、icelake、zen2 或 zen3\n";
+                    return 1;
+                }
+            } else {
+                std::cerr << "错误: --cpu 需要指定微架构\n";
+                return 1;
+            }
+        } else if (arg == "--block-cycles") {
+            if (i + 1 < argc) {
+                blockCycles = std::stod(argv[++i]);
+                if (blockCycles < 0.0) {
+                    std::cerr << "错误: --block-cycles 不能为负数\n";
+                    return 1;
+                }
+            } else {
+                std::cerr << "错误: --block-cycles 需要指定数值\n";
+                return 1;
+            }
+        } else if (arg == "--block-bytes") {
+            if (i + 1 < argc) {
+                int value = std::stoi(argv[++i]);
+                if (value < 0) {
+                    std::cerr << "错误: --block-bytes 不能为负数\n";
+                    return 1;
+                }
+                blockBytes = static_cast<unsigned>(value);
+            } else {
+                std::cerr << "错误: --block-bytes 需要指定数值\n";
+                return 1;
+            }
+        } else if (arg == "--align-pad") {
+            alignPadding = true;
         } else if (arg == "-v" || arg == "--verbose") {
             verbose = true;
         } else {
@@ -187,16 +389,26 @@ int main(int argc, char* argv[]) {
     }
 
     // 验证必需参数
-    if (inputFile.empty()) {
+    if (inputFiles.empty()) {
         std::cerr << "错误: 必须指定输入文件 (-i)\n";
         return 1;
     }
 
+    if (inputFiles.size() > 1 && !amalgamateInputs) {
+        std::cerr << "错误: 多个输入文件需要配合 --amalgamate 使用\n";
+        return 1;
+    }
+
     if (outputFile.empty()) {
         std::cerr << "错误: 必须指定输出文件 (-o)\n";
         return 1;
     }
 
+    if (mode == "asm" && amalgamateInputs) {
+        std::cerr << "错误: --mode asm 不支持 --amalgamate\n";
+        return 1;
+    }
+
     // 配置日志系统
     Logger& logger = Logger::getInstance();
     if (verbose) {
@@ -208,17 +420,35 @@ int main(int argc, char* argv[]) {
         logger.setConsoleOutput(false);
     }
 
-    // 读取输入文件
-    std::ifstream inFile(inputFile);
-    if (!inFile.is_open()) {
-        std::cerr << "错误: 无法打开输入文件: " << inputFile << "\n";
-        return 1;
+    if (mode == "asm") {
+        return rewriteAssembly(inputFiles[0], outputFile, obfuscationLevel, threads, cpu,
+                               blockCycles, blockBytes, alignPadding, verbose);
+    }
+
+    // 读取输入文件（合并模式下拼接为一个翻译单元）
+    std::string sourceCode;
+    if (amalgamateInputs) {
+        if (!ObfuscationEngine::amalgamate(inputFiles, sourceCode)) {
+            std::cerr << "错误: 无法合并输入文件（文件无法读取，或 static 名字与其他文件冲突；-v 显示详情）\n";
+            return 1;
+        }
+    } else {
+        std::ifstream inFile(inputFiles[0]);
+        if (!inFile.is_open()) {
+            std::cerr << "错误: 无法打开输入文件: " << inputFiles[0] << "\n";
+            return 1;
+        }
+
+        std::stringstream buffer;
+        buffer << inFile.rdbuf();
+        sourceCode = buffer.str();
+        inFile.close();
     }
 
-    std::stringstream buffer;
-    buffer << inFile.rdbuf();
-    std::string sourceCode = buffer.str();
-    inFile.close();
+    std::string inputFile = inputFiles[0];
+    if (inputFiles.size() > 1) {
+        inputFile += " (+" + std::to_string(inputFiles.size() - 1) + ")";
+    }
 
     if (verbose) {
         std::cout << "\n=== 配置信息 ===\n";
@@ -230,7 +460,10 @@ int main(int argc, char* argv[]) {
     }
 
     // 执行混淆
-    std::string obfuscatedCode = obfuscateCode(sourceCode, obfuscationLevel, verbose);
+    std::string obfuscatedCode = obfuscateCode(sourceCode, obfuscationLevel, verbose,
+                                               stringPool, isCxxSource(inputFiles[0]),
+                                               encryptResources, layoutLocality,
+                                               predicateCycles, pointerAliasing);
 
     // 写入输出文件
     std::ofstream outFile(outputFile);
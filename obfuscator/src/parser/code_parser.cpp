@@ -4,11 +4,696 @@
 #include <sstream>
 #include <algorithm>
 #include <functional>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <bitset>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
 
 namespace obfuscator {
 
 using namespace utils;
 
+namespace {
+
+// 轻量级C/C++词法扫描器
+// 识别注释、预处理行、字符常量和字符串字面量，并跟踪括号上下文，
+// 用于判断一个字符串字面量能否被安全地替换为函数调用表达式
+class LiteralScanner {
+public:
+    explicit LiteralScanner(const std::string& src) : m_src(src) {}
+
+    std::vector<StringLiteralInfo> run();
+
+    // run() 期间识别出的纯数值初始化数组
+    const std::vector<DataArrayInfo>& dataArrays() const { return m_arrays; }
+
+    // run() 期间识别出的顶层函数/变量名
+    const std::vector<FileScopeName>& fileScopeNames() const { return m_fileScopeNames; }
+
+private:
+    enum class TokenKind { NONE, IDENT, PUNCT, STRING, OTHER };
+    enum class BraceKind { CODE, CONSTEXPR, INIT, OTHER };
+
+    struct Token {
+        TokenKind kind = TokenKind::NONE;
+        std::string text;
+    };
+
+    const std::string& m_src;
+    size_t m_pos = 0;
+    int m_line = 1;
+    bool m_atLineStart = true;
+
+    Token m_prev;
+    bool m_prevQualified = false;   // m_prev 是 :: 之后的限定名
+    std::vector<BraceKind> m_braces;
+    std::vector<std::string> m_parenOpeners;
+    std::unordered_set<std::string> m_functionMacros;  // #define 出的函数式宏
+    int m_condDepth = 0;
+    size_t m_safeInsertPos = 0;
+
+    // 当前语句状态
+    bool m_stmtStatic = false;
+    bool m_stmtConstexpr = false;           // constexpr/consteval 函数（不含 if constexpr）
+    bool m_stmtSawAssign = false;
+    bool m_stmtArrayDecl = false;
+    bool m_stmtInInitializer = false;       // 顶层 '=' 之后、下一个 ',' 之前
+    size_t m_stmtStart = std::string::npos;
+    std::vector<std::string> m_stmtDeclIdents;  // 第一个 '[' 之前的标识符
+    size_t m_tokenStart = 0;
+
+    std::vector<DataArrayInfo> m_arrays;
+    std::vector<FileScopeName> m_fileScopeNames;
+
+    // 等待下一个记号以确定是否可替换的字面量
+    std::vector<StringLiteralInfo> m_literals;
+    bool m_pending = false;
+    size_t m_pendingIndex = 0;
+
+    bool atEnd() const { return m_pos >= m_src.size(); }
+    char peek(size_t off = 0) const {
+        return m_pos + off < m_src.size() ? m_src[m_pos + off] : '\0';
+    }
+
+    static bool isIdentStart(char c) {
+        return std::isalpha(static_cast<unsigned char>(c)) || c == '_' ||
+               static_cast<unsigned char>(c) >= 0x80;
+    }
+    static bool isIdentChar(char c) {
+        return isIdentStart(c) || std::isdigit(static_cast<unsigned char>(c));
+    }
+
+    void skipLineComment();
+    void skipBlockComment();
+    void skipDirective();
+    bool lexQuoted(char quote, bool raw, StringLiteralInfo& info);
+    void lexNumber();
+    void emitToken(TokenKind kind, const std::string& text);
+    void finishPending(const Token& next);
+    void addLiteral(StringLiteralInfo& info);
+    void recordFileScopeName(const std::string& punct);
+    bool skipDataInitializer();
+    bool contextAllowsRewrite() const;
+    BraceKind classifyBrace() const;
+    void resetStatement();
+};
+
+std::vector<StringLiteralInfo> LiteralScanner::run() {
+    while (!atEnd()) {
+        char c = peek();
+
+        if (c == '\n') {
+            ++m_line;
+            ++m_pos;
+            m_atLineStart = true;
+            continue;
+        }
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++m_pos;
+            continue;
+        }
+        if (c == '/' && peek(1) == '/') {
+            skipLineComment();
+            continue;
+        }
+        if (c == '/' && peek(1) == '*') {
+            skipBlockComment();
+            continue;
+        }
+        if (c == '#' && m_atLineStart) {
+            skipDirective();
+            continue;
+        }
+
+        m_atLineStart = false;
+        m_tokenStart = m_pos;
+
+        if (isIdentStart(c)) {
+            size_t start = m_pos;
+            while (!atEnd() && isIdentChar(peek())) {
+                ++m_pos;
+            }
+            std::string ident = m_src.substr(start, m_pos - start);
+
+            // 带前缀的字符串/字符常量: L"", u8"", R"()", L'' ...
+            static const char* prefixes[] = {
+                "L", "u", "U", "u8", "R", "LR", "uR", "UR", "u8R"
+            };
+            bool isPrefix = std::find(std::begin(prefixes), std::end(prefixes), ident)
+                            != std::end(prefixes);
+            if (isPrefix && (peek() == '"' || peek() == '\'')) {
+                StringLiteralInfo info;
+                info.startPos = start;
+                info.lineNumber = m_line;
+                bool raw = ident.back() == 'R';
+                char quote = peek();
+                lexQuoted(quote, raw && quote == '"', info);
+                if (quote == '"') {
+                    info.rewritable = false;
+                    emitToken(TokenKind::STRING, "\"");
+                    addLiteral(info);
+                } else {
+                    emitToken(TokenKind::OTHER, "'");
+                }
+                continue;
+            }
+
+            emitToken(TokenKind::IDENT, ident);
+            continue;
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(c)) ||
+            (c == '.' && std::isdigit(static_cast<unsigned char>(peek(1))))) {
+            lexNumber();
+            emitToken(TokenKind::OTHER, "0");
+            continue;
+        }
+
+        if (c == '"') {
+            StringLiteralInfo info;
+            info.startPos = m_pos;
+            info.lineNumber = m_line;
+            bool ok = lexQuoted('"', false, info);
+            // 紧跟标识符的是用户自定义字面量后缀，不能替换
+            bool hasSuffix = !atEnd() && isIdentStart(peek());
+            info.rewritable = ok && !hasSuffix && contextAllowsRewrite();
+            emitToken(TokenKind::STRING, "\"");
+            addLiteral(info);
+            if (info.rewritable) {
+                m_pending = true;
+                m_pendingIndex = m_literals.size() - 1;
+            }
+            continue;
+        }
+
+        if (c == '\'') {
+            StringLiteralInfo ignored;
+            lexQuoted('\'', false, ignored);
+            emitToken(TokenKind::OTHER, "'");
+            continue;
+        }
+
+        // 标点符号（区分 = 与 ==、<= 等复合运算符）
+        std::string punct(1, c);
+        static const std::string compoundFirst = "=!<>+-*/%&|^";
+        if (peek(1) == '=' && compoundFirst.find(c) != std::string::npos) {
+            punct += '=';
+        } else if ((c == '-' && peek(1) == '>') || (c == ':' && peek(1) == ':') ||
+                   (c == '&' && peek(1) == '&') || (c == '|' && peek(1) == '|') ||
+                   (c == '+' && peek(1) == '+') || (c == '-' && peek(1) == '-') ||
+                   (c == '<' && peek(1) == '<') || (c == '>' && peek(1) == '>')) {
+            punct += peek(1);
+        }
+        m_pos += punct.size();
+
+        // 数值初始化的数组（可能有数MB）走快速路径，不逐个生成记号
+        if (punct == "{" && skipDataInitializer()) {
+            continue;
+        }
+
+        emitToken(TokenKind::PUNCT, punct);
+    }
+
+    if (m_pending) {
+        finishPending(Token{});
+    }
+
+    return std::move(m_literals);
+}
+
+void LiteralScanner::skipLineComment() {
+    while (!atEnd() && peek() != '\n') {
+        ++m_pos;
+    }
+}
+
+void LiteralScanner::skipBlockComment() {
+    m_pos += 2;
+    while (!atEnd() && !(peek() == '*' && peek(1) == '/')) {
+        if (peek() == '\n') {
+            ++m_line;
+        }
+        ++m_pos;
+    }
+    m_pos = std::min(m_pos + 2, m_src.size());
+}
+
+void LiteralScanner::skipDirective() {
+    // 预处理指令对记号流透明；其中的字符串一律不可替换
+    ++m_pos;
+    while (!atEnd() && (peek() == ' ' || peek() == '\t')) {
+        ++m_pos;
+    }
+    size_t nameStart = m_pos;
+    while (!atEnd() && isIdentChar(peek())) {
+        ++m_pos;
+    }
+    std::string name = m_src.substr(nameStart, m_pos - nameStart);
+
+    // 函数式宏可能把实参与其他字面量拼接或字符串化，其实参中的字面量不能替换
+    if (name == "define") {
+        while (!atEnd() && (peek() == ' ' || peek() == '\t')) {
+            ++m_pos;
+        }
+        size_t macroStart = m_pos;
+        while (!atEnd() && isIdentChar(peek())) {
+            ++m_pos;
+        }
+        if (m_pos > macroStart && peek() == '(') {
+            m_functionMacros.insert(m_src.substr(macroStart, m_pos - macroStart));
+        }
+    }
+
+    while (!atEnd() && peek() != '\n') {
+        char c = peek();
+        if (c == '\\' && peek(1) == '\n') {
+            m_pos += 2;
+            ++m_line;
+        } else if (c == '\\' && peek(1) == '\r' && peek(2) == '\n') {
+            m_pos += 3;
+            ++m_line;
+        } else if (c == '/' && peek(1) == '*') {
+            skipBlockComment();
+        } else if (c == '/' && peek(1) == '/') {
+            skipLineComment();
+        } else if (c == '"' || c == '\'') {
+            StringLiteralInfo info;
+            info.startPos = m_pos;
+            info.lineNumber = m_line;
+            lexQuoted(c, false, info);
+            if (c == '"') {
+                info.rewritable = false;
+                addLiteral(info);
+            }
+        } else {
+            ++m_pos;
+        }
+    }
+
+    if (name == "if" || name == "ifdef" || name == "ifndef") {
+        ++m_condDepth;
+    } else if (name == "endif" && m_condDepth > 0) {
+        --m_condDepth;
+    }
+
+    // 顶层且不在条件编译块内的指令之后是放置辅助声明的安全位置
+    if (m_braces.empty() && m_parenOpeners.empty() && m_condDepth == 0) {
+        m_safeInsertPos = atEnd() ? m_pos : m_pos + 1;
+    }
+}
+
+bool LiteralScanner::lexQuoted(char quote, bool raw, StringLiteralInfo& info) {
+    bool ok = true;
+
+    if (raw) {
+        // R"delim( ... )delim"
+        ++m_pos;
+        size_t delimStart = m_pos;
+        while (!atEnd() && peek() != '(') {
+            ++m_pos;
+        }
+        std::string close = ")" + m_src.substr(delimStart, m_pos - delimStart) + "\"";
+        size_t end = m_src.find(close, m_pos);
+        end = (end == std::string::npos) ? m_src.size() : end + close.size();
+        for (size_t i = m_pos; i < end; ++i) {
+            if (m_src[i] == '\n') {
+                ++m_line;
+            }
+        }
+        info.raw = m_src.substr(delimStart - 1, end - delimStart + 1);
+        m_pos = end;
+        info.endPos = m_pos;
+        return false;
+    }
+
+    ++m_pos;
+    size_t contentStart = m_pos;
+    std::string value;
+
+    while (!atEnd() && peek() != quote) {
+        char c = peek();
+        if (c == '\n') {
+            // 未闭合的字面量
+            ok = false;
+            break;
+        }
+        if (c != '\\') {
+            value += c;
+            ++m_pos;
+            continue;
+        }
+
+        char e = peek(1);
+        m_pos += 2;
+        switch (e) {
+        case 'n': value += '\n'; break;
+        case 't': value += '\t'; break;
+        case 'r': value += '\r'; break;
+        case 'a': value += '\a'; break;
+        case 'b': value += '\b'; break;
+        case 'f': value += '\f'; break;
+        case 'v': value += '\v'; break;
+        case '\\': value += '\\'; break;
+        case '\'': value += '\''; break;
+        case '"': value += '"'; break;
+        case '?': value += '?'; break;
+        case 'x': {
+            unsigned int v = 0;
+            int digits = 0;
+            while (!atEnd() && std::isxdigit(static_cast<unsigned char>(peek()))) {
+                char h = peek();
+                v = v * 16 + (std::isdigit(static_cast<unsigned char>(h))
+                              ? h - '0' : (std::tolower(h) - 'a' + 10));
+                ++m_pos;
+                ++digits;
+            }
+            if (digits == 0 || v > 0xFF) {
+                ok = false;
+            }
+            value += static_cast<char>(v & 0xFF);
+            break;
+        }
+        case '\n':
+            // 行接续
+            ++m_line;
+            break;
+        default:
+            if (e >= '0' && e <= '7') {
+                unsigned int v = e - '0';
+                for (int i = 0; i < 2 && peek() >= '0' && peek() <= '7'; ++i) {
+                    v = v * 8 + (peek() - '0');
+                    ++m_pos;
+                }
+                value += static_cast<char>(v & 0xFF);
+            } else {
+                // \u、\U 等通用字符名暂不处理
+                ok = false;
+            }
+            break;
+        }
+    }
+
+    info.raw = m_src.substr(contentStart, m_pos - contentStart);
+    info.value = value;
+    if (!atEnd() && peek() == quote) {
+        ++m_pos;
+    } else {
+        ok = false;
+    }
+    info.endPos = m_pos;
+    return ok;
+}
+
+void LiteralScanner::lexNumber() {
+    // pp-number: 数字、字母、下划线、点、指数符号以及C++14数字分隔符
+    while (!atEnd()) {
+        char c = peek();
+        if ((c == 'e' || c == 'E' || c == 'p' || c == 'P') &&
+            (peek(1) == '+' || peek(1) == '-')) {
+            m_pos += 2;
+        } else if (isIdentChar(c) || c == '.' ||
+                   (c == '\'' && std::isalnum(static_cast<unsigned char>(peek(1))))) {
+            ++m_pos;
+        } else {
+            break;
+        }
+    }
+}
+
+void LiteralScanner::emitToken(TokenKind kind, const std::string& text) {
+    Token tok{kind, text};
+
+    if (m_pending) {
+        finishPending(tok);
+    }
+
+    if (m_stmtStart == std::string::npos) {
+        m_stmtStart = m_tokenStart;
+    }
+    if (kind == TokenKind::IDENT && !m_stmtArrayDecl && !m_stmtSawAssign) {
+        m_stmtDeclIdents.push_back(text);
+    }
+
+    if (kind == TokenKind::PUNCT) {
+        recordFileScopeName(text);
+    }
+
+    if (kind == TokenKind::PUNCT) {
+        if (text == "(") {
+            m_parenOpeners.push_back(m_prev.kind == TokenKind::IDENT ? m_prev.text : "");
+        } else if (text == ")") {
+            if (!m_parenOpeners.empty()) {
+                m_parenOpeners.pop_back();
+            }
+        } else if (text == "{") {
+            m_braces.push_back(classifyBrace());
+            resetStatement();
+        } else if (text == "}") {
+            if (!m_braces.empty()) {
+                m_braces.pop_back();
+            }
+            resetStatement();
+        } else if (text == ";") {
+            resetStatement();
+        } else if (text == "=") {
+            m_stmtSawAssign = true;
+        } else if (text == "[") {
+            if (!m_stmtSawAssign) {
+                m_stmtArrayDecl = true;
+            }
+        }
+    } else if (kind == TokenKind::IDENT) {
+        if (text == "static" || text == "constexpr" || text == "thread_local") {
+            m_stmtStatic = true;
+        }
+        if ((text == "constexpr" && !(m_prev.kind == TokenKind::IDENT && m_prev.text == "if")) ||
+            text == "consteval") {
+            m_stmtConstexpr = true;
+        }
+    }
+
+    m_prevQualified = kind == TokenKind::IDENT && m_prev.kind == TokenKind::PUNCT && m_prev.text == "::";
+    m_prev = tok;
+}
+
+void LiteralScanner::finishPending(const Token& next) {
+    m_pending = false;
+
+    static const char* allowedNext[] = { ")", ",", ";", ":", "[" };
+    bool ok = next.kind == TokenKind::PUNCT &&
+              std::find(std::begin(allowedNext), std::end(allowedNext), next.text)
+              != std::end(allowedNext);
+
+    if (!ok) {
+        m_literals[m_pendingIndex].rewritable = false;
+    }
+}
+
+void LiteralScanner::addLiteral(StringLiteralInfo& info) {
+    info.declInsertPos = m_safeInsertPos;
+    m_literals.push_back(info);
+}
+
+bool LiteralScanner::contextAllowsRewrite() const {
+    // 只替换函数体内、非初始化列表中的字面量
+    if (m_braces.empty() || m_braces.back() != BraceKind::CODE) {
+        return false;
+    }
+    // static 局部变量需要常量初始化；字符数组需要字面量初始化
+    if (m_stmtStatic || m_stmtArrayDecl) {
+        return false;
+    }
+
+    static const char* blockedOpeners[] = {
+        "asm", "__asm", "__asm__", "volatile", "goto", "__attribute__",
+        "__declspec", "_Pragma", "static_assert", "_Static_assert", "sizeof",
+        "alignof", "_Alignof", "__builtin_constant_p", "_Generic",
+        "deprecated", "nodiscard"
+    };
+    for (const auto& opener : m_parenOpeners) {
+        if (std::find(std::begin(blockedOpeners), std::end(blockedOpeners), opener)
+            != std::end(blockedOpeners) || m_functionMacros.count(opener)) {
+            return false;
+        }
+    }
+
+    if (m_prev.kind == TokenKind::PUNCT) {
+        return m_prev.text == "(" || m_prev.text == "," || m_prev.text == "=" ||
+               m_prev.text == "?" || m_prev.text == ":";
+    }
+    return m_prev.kind == TokenKind::IDENT && m_prev.text == "return";
+}
+
+LiteralScanner::BraceKind LiteralScanner::classifyBrace() const {
+    bool inCode = !m_braces.empty() && m_braces.back() == BraceKind::CODE;
+
+    if (!m_braces.empty() && m_braces.back() == BraceKind::INIT) {
+        return BraceKind::INIT;
+    }
+    // 常量求值的函数体（及其中的块）不能调用运行时访问函数
+    if (m_stmtConstexpr || (!m_braces.empty() && m_braces.back() == BraceKind::CONSTEXPR)) {
+        return BraceKind::CONSTEXPR;
+    }
+
+    if (m_prev.kind == TokenKind::PUNCT) {
+        const std::string& p = m_prev.text;
+        if (p == "=" || p == "," || p == "(" || p == "[") {
+            return BraceKind::INIT;
+        }
+        if (p == ")") {
+            return BraceKind::CODE;
+        }
+        return inCode ? BraceKind::CODE : BraceKind::OTHER;
+    }
+
+    if (m_prev.kind == TokenKind::IDENT) {
+        const std::string& t = m_prev.text;
+        if (t == "return") {
+            return BraceKind::INIT;
+        }
+        if (t == "const" || t == "noexcept" || t == "override" || t == "final" ||
+            t == "else" || t == "do" || t == "try") {
+            return BraceKind::CODE;
+        }
+    }
+
+    // 函数体内的结构体定义等按代码块处理，其余（命名空间、类、枚举）为声明作用域
+    return inCode ? BraceKind::CODE : BraceKind::OTHER;
+}
+
+void LiteralScanner::recordFileScopeName(const std::string& punct) {
+    // 顶层声明中紧跟 ( = , ; [ 的标识符是声明的名字；初始化式中的标识符不是
+    if (!m_braces.empty() || !m_parenOpeners.empty()) {
+        return;
+    }
+    bool declarator = punct == "(" || punct == "=" || punct == "," || punct == ";" || punct == "[";
+    if (declarator && !m_stmtInInitializer && m_prev.kind == TokenKind::IDENT && !m_prevQualified) {
+        static const char* notNames[] = {
+            "__attribute__", "__declspec", "alignas", "_Alignas", "asm", "__asm", "__asm__",
+            "static_assert", "_Static_assert", "decltype", "typeof", "__typeof__", "operator"
+        };
+        if (std::find(std::begin(notNames), std::end(notNames), m_prev.text) == std::end(notNames)) {
+            m_fileScopeNames.push_back({m_prev.text, m_stmtStatic, m_line});
+        }
+    }
+    if (punct == "=") {
+        m_stmtInInitializer = true;
+    } else if (punct == ",") {
+        m_stmtInInitializer = false;
+    }
+}
+
+void LiteralScanner::resetStatement() {
+    m_stmtStatic = false;
+    m_stmtConstexpr = false;
+    m_stmtSawAssign = false;
+    m_stmtArrayDecl = false;
+    m_stmtInInitializer = false;
+    m_stmtStart = std::string::npos;
+    m_stmtDeclIdents.clear();
+}
+
+bool LiteralScanner::skipDataInitializer() {
+    // 仅处理顶层（或命名空间/extern "C" 内）形如 T name[...] = { 数值, ... } 的声明
+    if (!(m_prev.kind == TokenKind::PUNCT && m_prev.text == "=") || !m_stmtArrayDecl ||
+        m_stmtDeclIdents.empty() || !m_parenOpeners.empty()) {
+        return false;
+    }
+    for (BraceKind kind : m_braces) {
+        if (kind != BraceKind::OTHER) {
+            return false;
+        }
+    }
+
+    size_t pos = m_pos;
+    int lines = 0;
+    size_t count = 0;
+    bool expectElement = true;
+    const size_t size = m_src.size();
+
+    while (pos < size) {
+        char c = m_src[pos];
+        if (c == '}') {
+            break;
+        }
+        if (c == ',') {
+            expectElement = true;
+            ++pos;
+        } else if (c == '\n') {
+            ++lines;
+            ++pos;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            ++pos;
+        } else if (c == '/' && pos + 1 < size && (m_src[pos + 1] == '/' || m_src[pos + 1] == '*')) {
+            bool block = m_src[pos + 1] == '*';
+            size_t end = block ? m_src.find("*/", pos + 2) : m_src.find('\n', pos);
+            if (end == std::string::npos) {
+                return false;
+            }
+            lines += static_cast<int>(std::count(m_src.begin() + pos, m_src.begin() + end, '\n'));
+            pos = block ? end + 2 : end;
+        } else if (c == '\'') {
+            // 字符常量
+            size_t end = pos + 1;
+            while (end < size && m_src[end] != '\'' && m_src[end] != '\n') {
+                end += (m_src[end] == '\\') ? 2 : 1;
+            }
+            if (end >= size || m_src[end] != '\'' || !expectElement) {
+                return false;
+            }
+            ++count;
+            expectElement = false;
+            pos = end + 1;
+        } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+') {
+            if (!expectElement) {
+                return false;
+            }
+            ++count;
+            expectElement = false;
+            ++pos;
+            while (pos < size && std::isalnum(static_cast<unsigned char>(m_src[pos]))) {
+                ++pos;
+            }
+        } else {
+            // 宏、表达式、嵌套初始化等：交给常规扫描
+            return false;
+        }
+    }
+
+    if (pos >= size) {
+        return false;
+    }
+
+    DataArrayInfo info;
+    info.name = m_stmtDeclIdents.back();
+    for (size_t i = 0; i + 1 < m_stmtDeclIdents.size(); ++i) {
+        const std::string& ident = m_stmtDeclIdents[i];
+        if (ident == "static") {
+            info.isStatic = true;
+        } else if (ident != "const" && ident != "extern" && ident != "volatile") {
+            info.elementType += (info.elementType.empty() ? "" : " ") + ident;
+        }
+    }
+    info.declStart = m_stmtStart;
+    info.bodyStart = m_pos - 1;
+    info.bodyEnd = pos + 1;
+    info.elementCount = count;
+    info.lineNumber = m_line;
+    info.declInsertPos = m_safeInsertPos;
+    m_arrays.push_back(info);
+
+    m_line += lines;
+    m_pos = pos + 1;
+    m_prev = Token{TokenKind::PUNCT, "}"};
+    return true;
+}
+
+} // namespace
+
 // ============================================================================
 // CodeParser Implementation
 // ============================================================================
@@ -31,6 +716,7 @@ bool CodeParser::parse(const std::string& sourceCode) {
     m_functions.clear();
     m_variables.clear();
     m_stringLiterals.clear();
+    m_literalInfos.clear();
 
     // 解析各种元素
     parseFunctions();
@@ -125,6 +811,18 @@ int CodeParser::calculateCyclomaticComplexity(const std::string& functionName) {
     return complexity;
 }
 
+std::vector<std::pair<size_t, size_t>> CodeParser::codeSegments() const {
+    // 大型数据数组的初始化列表不含函数或变量定义，正则匹配时整体跳过
+    std::vector<std::pair<size_t, size_t>> segments;
+    size_t segStart = 0;
+    for (const auto& array : scanDataArrays(m_sourceCode, kLargeArrayElements)) {
+        segments.emplace_back(segStart, array.bodyStart);
+        segStart = array.bodyEnd;
+    }
+    segments.emplace_back(segStart, m_sourceCode.size());
+    return segments;
+}
+
 void CodeParser::parseFunctions() {
     // 简化的函数解析：使用正则表达式
     // 格式: returnType functionName(parameters) { body }
@@ -134,39 +832,42 @@ void CodeParser::parseFunctions() {
     );
 
     std::smatch match;
-    std::string::const_iterator searchStart(m_sourceCode.cbegin());
-
-    while (std::regex_search(searchStart, m_sourceCode.cend(), match, funcPattern)) {
-        FunctionInfo func;
-        func.returnType = match[1].str();
-        func.name = match[2].str();
-
-        // 解析参数
-        std::string params = match[3].str();
-        if (!params.empty()) {
-            std::stringstream ss(params);
-            std::string param;
-            while (std::getline(ss, param, ',')) {
-                // 移除前后空白
-                param.erase(0, param.find_first_not_of(" \t"));
-                param.erase(param.find_last_not_of(" \t") + 1);
-                if (!param.empty()) {
-                    func.parameters.push_back(param);
+    for (const auto& [segStart, segEnd] : codeSegments()) {
+        std::string::const_iterator searchStart(m_sourceCode.cbegin() + segStart);
+        std::string::const_iterator searchEnd(m_sourceCode.cbegin() + segEnd);
+
+        while (std::regex_search(searchStart, searchEnd, match, funcPattern)) {
+            FunctionInfo func;
+            func.returnType = match[1].str();
+            func.name = match[2].str();
+
+            // 解析参数
+            std::string params = match[3].str();
+            if (!params.empty()) {
+                std::stringstream ss(params);
+                std::string param;
+                while (std::getline(ss, param, ',')) {
+                    // 移除前后空白
+                    param.erase(0, param.find_first_not_of(" \t"));
+                    param.erase(param.find_last_not_of(" \t") + 1);
+                    if (!param.empty()) {
+                        func.parameters.push_back(param);
+                    }
                 }
             }
-        }
 
-        // 获取函数体的起始位置
-        func.startPos = match.position() + match.length();
+            // 获取函数体的起始位置
+            func.startPos = (match[0].second - m_sourceCode.cbegin());
 
-        // 提取函数体
-        func.body = extractFunctionBody(func.startPos);
+            // 提取函数体
+            func.body = extractFunctionBody(func.startPos);
 
-        func.endPos = func.startPos + func.body.length();
+            func.endPos = func.startPos + func.body.length();
 
-        m_functions.push_back(func);
+            m_functions.push_back(func);
 
-        searchStart = match.suffix().first;
+            searchStart = match.suffix().first;
+        }
     }
 
     LOG_INFO("Found " + std::to_string(m_functions.size()) + " functions");
@@ -179,133 +880,2055 @@ void CodeParser::parseVariables() {
     std::regex varPattern(R"((int|char|float|double|void\*|long)\s+(\w+))");
 
     std::smatch match;
-    std::string::const_iterator searchStart(m_sourceCode.cbegin());
+    for (const auto& [segStart, segEnd] : codeSegments()) {
+        std::string::const_iterator searchStart(m_sourceCode.cbegin() + segStart);
+        std::string::const_iterator searchEnd(m_sourceCode.cbegin() + segEnd);
 
-    while (std::regex_search(searchStart, m_sourceCode.cend(), match, varPattern)) {
-        std::string varName = match[2].str();
+        while (std::regex_search(searchStart, searchEnd, match, varPattern)) {
+            std::string varName = match[2].str();
 
-        // 简化：将变量添加到全局列表
-        m_variables["global"].push_back(varName);
+            // 简化：将变量添加到全局列表
+            m_variables["global"].push_back(varName);
 
-        searchStart = match.suffix().first;
+            searchStart = match.suffix().first;
+        }
     }
 
     LOG_INFO("Found " + std::to_string(m_variables["global"].size()) + " variables");
 }
 
 void CodeParser::parseStringLiterals() {
-    // 查找所有字符串字面量
-
-    std::regex stringPattern("\"([^\"]*)\"");
-
-    std::smatch match;
-    std::string::const_iterator searchStart(m_sourceCode.cbegin());
+    // 查找所有字符串字面量（词法扫描，忽略注释和字符常量中的引号）
 
-    while (std::regex_search(searchStart, m_sourceCode.cend(), match, stringPattern)) {
-        m_stringLiterals.push_back(match[1].str());
-        searchStart = match.suffix().first;
+    m_literalInfos = scanStringLiterals(m_sourceCode);
+    for (const auto& literal : m_literalInfos) {
+        m_stringLiterals.push_back(literal.raw);
     }
 
     LOG_INFO("Found " + std::to_string(m_stringLiterals.size()) + " string literals");
 }
 
-bool CodeParser::skipWhitespace(size_t& pos) {
-    while (pos < m_sourceCode.length() &&
-           std::isspace(m_sourceCode[pos])) {
-        pos++;
-    }
-    return pos < m_sourceCode.length();
-}
+std::vector<StatementSlot> CodeParser::findStatementSlots(const std::string& body) {
+    std::vector<StatementSlot> slots;
 
-bool CodeParser::matchKeyword(const std::string& keyword, size_t pos) {
-    if (pos + keyword.length() > m_sourceCode.length()) {
+    auto trim = [](const std::string& s) {
+        size_t b = s.find_first_not_of(" \t\r");
+        return b == std::string::npos ? std::string()
+                                      : s.substr(b, s.find_last_not_of(" \t\r") - b + 1);
+    };
+    auto hasWord = [](const std::string& s, const std::string& word) {
+        static const std::string identChars =
+            "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+        for (size_t p = s.find(word); p != std::string::npos; p = s.find(word, p + 1)) {
+            size_t e = p + word.size();
+            if ((p == 0 || identChars.find(s[p - 1]) == std::string::npos) &&
+                (e == s.size() || identChars.find(s[e]) == std::string::npos)) {
+                return true;
+            }
+        }
         return false;
-    }
+    };
 
-    return m_sourceCode.substr(pos, keyword.length()) == keyword;
-}
+    struct Line {
+        std::string text;       // 去掉首尾空白
+        size_t start;
+        size_t end;             // 换行符的位置，最后一行没有换行时为 npos
+    };
+    std::vector<Line> lines;
+    for (size_t pos = 0; pos < body.size();) {
+        size_t nl = body.find('\n', pos);
+        size_t stop = (nl == std::string::npos) ? body.size() : nl;
+        lines.push_back({trim(body.substr(pos, stop - pos)), pos, nl});
+        pos = stop + 1;
+    }
+    auto neighbour = [&](size_t n, int dir) -> const std::string* {
+        for (size_t k = n + dir; k < lines.size(); k += dir) {
+            if (!lines[k].text.empty()) {
+                return &lines[k].text;
+            }
+        }
+        return nullptr;
+    };
 
-std::string CodeParser::extractFunctionBody(size_t startPos) {
-    // 提取从 { 到匹配的 } 之间的内容
+    enum class Brace { CODE, DATA };
+    std::vector<Brace> braces;
+    int parenDepth = 0;
+    bool continuation = false;
+    bool inComment = false;
+
+    for (size_t n = 0; n < lines.size(); ++n) {
+        const std::string& text = lines[n].text;
+        const bool directive = continuation || (!text.empty() && text[0] == '#');
+        continuation = !text.empty() && text.back() == '\\';
+        if (directive) {
+            continue;
+        }
 
-    int braceCount = 1;
-    size_t pos = startPos;
+        for (size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            if (inComment) {
+                if (c == '*' && i + 1 < text.size() && text[i + 1] == '/') {
+                    inComment = false;
+                    ++i;
+                }
+            } else if (c == '"' || c == '\'') {
+                for (++i; i < text.size() && text[i] != c; ++i) {
+                    i += (text[i] == '\\') ? 1 : 0;
+                }
+            } else if (c == '/' && i + 1 < text.size() && text[i + 1] == '/') {
+                break;
+            } else if (c == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+                inComment = true;
+                ++i;
+            } else if (c == '(') {
+                ++parenDepth;
+            } else if (c == ')') {
+                --parenDepth;
+            } else if (c == '{') {
+                std::string before = trim(text.substr(0, i));
+                bool data = !before.empty() &&
+                            (before.back() == '=' || before.back() == ',' || before.back() == '{' ||
+                             hasWord(before, "struct") || hasWord(before, "union") ||
+                             hasWord(before, "enum"));
+                if (!braces.empty() && braces.back() == Brace::DATA) {
+                    data = true;
+                }
+                braces.push_back(data ? Brace::DATA : Brace::CODE);
+            } else if (c == '}' && !braces.empty()) {
+                braces.pop_back();
+            }
+        }
 
-    while (pos < m_sourceCode.length() && braceCount > 0) {
-        if (m_sourceCode[pos] == '{') {
-            braceCount++;
-        } else if (m_sourceCode[pos] == '}') {
-            braceCount--;
+        if (inComment || text.empty() || text.back() != ';' || parenDepth != 0 ||
+            lines[n].end == std::string::npos ||
+            (!braces.empty() && braces.back() != Brace::CODE)) {
+            continue;
+        }
+        // 上一行是无花括号的 if/for/while 头部时，本行是它的分支体
+        const std::string* prev = neighbour(n, -1);
+        if (prev && prev->back() != ';' && prev->back() != '{' && prev->back() != '}' &&
+            prev->back() != ':' && (*prev)[0] != '#') {
+            continue;
+        }
+        // 其后是 else/while 时插入会拆开 if-else 和 do-while
+        const std::string* next = neighbour(n, 1);
+        if (next && (next->compare(0, 4, "else") == 0 || next->compare(0, 5, "while") == 0)) {
+            continue;
+        }
+        // 跳转之后的代码不可达，会被编译器直接删除
+        std::string first = text.substr(0, text.find_first_not_of(
+            "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_"));
+        if (first == "return" || first == "goto" || first == "break" || first == "continue" ||
+            first == "throw" || first == "case" || first == "default" ||
+            first.compare(0, 7, "OBF_CF_") == 0) {
+            continue;
         }
-        pos++;
-    }
 
-    if (braceCount != 0) {
-        LOG_ERROR("Unmatched braces in function body");
-        return "";
+        StatementSlot slot;
+        slot.offset = lines[n].end + 1;
+        size_t indentEnd = body.find_first_not_of(" \t", lines[n].start);
+        slot.indent = body.substr(lines[n].start, indentEnd - lines[n].start);
+        slots.push_back(slot);
     }
 
-    return m_sourceCode.substr(startPos, pos - startPos - 1);
+    return slots;
 }
 
-// ============================================================================
-// AssemblyParser Implementation
-// ============================================================================
+std::vector<StringLiteralInfo> CodeParser::scanStringLiterals(const std::string& sourceCode) {
+    return LiteralScanner(sourceCode).run();
+}
 
-AssemblyParser::AssemblyParser() {
+std::vector<FileScopeName> CodeParser::scanFileScopeNames(const std::string& sourceCode) {
+    LiteralScanner scanner(sourceCode);
+    scanner.run();
+    return scanner.fileScopeNames();
 }
 
-bool AssemblyParser::parse(const std::string& asmCode) {
-    if (asmCode.empty()) {
+size_t CodeParser::countIdentifier(const std::string& sourceCode, const std::string& name,
+                                   size_t begin, size_t end) {
+    return findIdentifier(sourceCode, name, begin, end).size();
+}
+
+std::vector<size_t> CodeParser::findIdentifier(const std::string& sourceCode,
+                                               const std::string& name,
+                                               size_t begin, size_t end) {
+    auto identChar = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' ||
+               static_cast<unsigned char>(c) >= 0x80;
+    };
+
+    end = std::min(end, sourceCode.size());
+    std::vector<size_t> positions;
+    size_t pos = begin;
+    while (pos < end) {
+        char c = sourceCode[pos];
+        if (c == '/' && pos + 1 < end && sourceCode[pos + 1] == '/') {
+            pos = sourceCode.find('\n', pos);
+            pos = (pos == std::string::npos) ? end : pos;
+        } else if (c == '/' && pos + 1 < end && sourceCode[pos + 1] == '*') {
+            pos = sourceCode.find("*/", pos + 2);
+            pos = (pos == std::string::npos) ? end : pos + 2;
+        } else if (c == '"' || c == '\'') {
+            ++pos;
+            while (pos < end && sourceCode[pos] != c && sourceCode[pos] != '\n') {
+                pos += (sourceCode[pos] == '\\') ? 2 : 1;
+            }
+            ++pos;
+        } else if (std::isdigit(static_cast<unsigned char>(c))) {
+            while (pos < end && (identChar(sourceCode[pos]) || sourceCode[pos] == '.')) {
+                ++pos;
+            }
+        } else if (identChar(c)) {
+            size_t start = pos;
+            while (pos < end && identChar(sourceCode[pos])) {
+                ++pos;
+            }
+            if (sourceCode.compare(start, pos - start, name) == 0) {
+                positions.push_back(start);
+            } else if (pos < end && sourceCode[pos] == '"' && sourceCode[pos - 1] == 'R') {
+                // 原始字符串 R"delim( ... )delim"
+                size_t open = sourceCode.find('(', pos);
+                if (open == std::string::npos) {
+                    break;
+                }
+                std::string close = ")" + sourceCode.substr(pos + 1, open - pos - 1) + "\"";
+                pos = sourceCode.find(close, open);
+                pos = (pos == std::string::npos) ? end : pos + close.size();
+            }
+        } else {
+            ++pos;
+        }
+    }
+    return positions;
+}
+
+std::vector<DataArrayInfo> CodeParser::scanDataArrays(const std::string& sourceCode,
+                                                      size_t minElements) {
+    LiteralScanner scanner(sourceCode);
+    scanner.run();
+
+    std::vector<DataArrayInfo> arrays;
+    for (const auto& array : scanner.dataArrays()) {
+        if (array.elementCount >= minElements) {
+            arrays.push_back(array);
+        }
+    }
+    return arrays;
+}
+
+bool CodeParser::decodeByteList(const std::string& sourceCode, const DataArrayInfo& array,
+                                std::string& bytes) {
+    bytes.clear();
+    bytes.reserve(array.elementCount);
+
+    size_t pos = array.bodyStart + 1;
+    const size_t end = array.bodyEnd - 1;
+    while (pos < end) {
+        char c = sourceCode[pos];
+        if (c == '/' && pos + 1 < end && (sourceCode[pos + 1] == '/' || sourceCode[pos + 1] == '*')) {
+            size_t next = sourceCode[pos + 1] == '*' ? sourceCode.find("*/", pos + 2) + 2
+                                                     : sourceCode.find('\n', pos);
+            pos = std::min(next, end);
+            continue;
+        }
+        if (c == '\'') {
+            // 字符常量，复用字符串字面量的转义解析
+            size_t close = pos + 1;
+            while (close < end && sourceCode[close] != '\'') {
+                close += (sourceCode[close] == '\\') ? 2 : 1;
+            }
+            std::string content = sourceCode.substr(pos + 1, close - pos - 1);
+            if (content == "\"") {
+                content = "\\\"";
+            }
+            std::vector<StringLiteralInfo> lit = scanStringLiterals("\"" + content + "\"");
+            if (lit.size() != 1 || lit[0].value.size() != 1) {
+                return false;
+            }
+            bytes += lit[0].value[0];
+            pos = close + 1;
+            continue;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+') {
+            bool negative = false;
+            while (c == '-' || c == '+') {
+                negative ^= (c == '-');
+                c = sourceCode[++pos];
+            }
+            size_t numEnd = pos;
+            while (numEnd < end && std::isalnum(static_cast<unsigned char>(sourceCode[numEnd]))) {
+                ++numEnd;
+            }
+            // strtoull 自动识别 0x/0 前缀，剩余部分只允许整数后缀
+            std::string text = sourceCode.substr(pos, numEnd - pos);
+            char* suffix = nullptr;
+            unsigned long long value = std::strtoull(text.c_str(), &suffix, 0);
+            if (suffix == text.c_str() ||
+                std::string(suffix).find_first_not_of("uUlL") != std::string::npos) {
+                return false;
+            }
+            if (negative) {
+                value = 0ULL - value;
+            }
+            bytes += static_cast<char>(value & 0xFF);
+            pos = numEnd;
+            continue;
+        }
+        ++pos;
+    }
+
+    return bytes.size() == array.elementCount;
+}
+
+bool CodeParser::skipWhitespace(size_t& pos) {
+    while (pos < m_sourceCode.length() &&
+           std::isspace(m_sourceCode[pos])) {
+        pos++;
+    }
+    return pos < m_sourceCode.length();
+}
+
+bool CodeParser::matchKeyword(const std::string& keyword, size_t pos) {
+    if (pos + keyword.length() > m_sourceCode.length()) {
+        return false;
+    }
+
+    return m_sourceCode.substr(pos, keyword.length()) == keyword;
+}
+
+std::string CodeParser::extractFunctionBody(size_t startPos) {
+    // 提取从 { 到匹配的 } 之间的内容
+
+    int braceCount = 1;
+    size_t pos = startPos;
+
+    while (pos < m_sourceCode.length() && braceCount > 0) {
+        if (m_sourceCode[pos] == '{') {
+            braceCount++;
+        } else if (m_sourceCode[pos] == '}') {
+            braceCount--;
+        }
+        pos++;
+    }
+
+    if (braceCount != 0) {
+        LOG_ERROR("Unmatched braces in function body");
+        return "";
+    }
+
+    return m_sourceCode.substr(startPos, pos - startPos - 1);
+}
+
+// ============================================================================
+// AssemblyParser Implementation
+// ============================================================================
+
+namespace {
+
+std::string trimAsm(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+std::string lowered(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+// 伪指令的参数部分，如 ".type\tf, @function" -> "f, @function"；不是该伪指令时返回空
+std::string directiveArgs(const std::string& line, const std::string& directive) {
+    std::string text = trimAsm(line);
+    if (text.compare(0, directive.size(), directive) != 0 || text.size() == directive.size() ||
+        (text[directive.size()] != ' ' && text[directive.size()] != '\t')) {
+        return "";
+    }
+    return trimAsm(text.substr(directive.size()));
+}
+
+// 切换节的伪指令是否进入代码节：.text 及其子节，或带 x 标志的 .section
+bool isCodeSection(const std::string& line) {
+    if (line.compare(0, 5, ".text") == 0) {
+        return true;
+    }
+    std::string args = directiveArgs(line, ".section");
+    if (args.empty()) {
+        args = directiveArgs(line, ".pushsection");
+    }
+    if (args.empty()) {
+        return false;
+    }
+    std::string name = trimAsm(args.substr(0, args.find(',')));
+    if (name.compare(0, 5, ".text") == 0) {
+        return true;
+    }
+    size_t quote = args.find('"');
+    if (quote == std::string::npos) {
+        return false;
+    }
+    std::string flags = args.substr(quote + 1, args.find('"', quote + 1) - quote - 1);
+    return flags.find('x') != std::string::npos;
+}
+
+// .L 开头或纯数字的局部标签
+bool isLocalLabel(const std::string& label) {
+    return label.compare(0, 2, ".L") == 0 ||
+           std::all_of(label.begin(), label.end(),
+                       [](unsigned char c) { return std::isdigit(c) != 0; });
+}
+
+// 指令前缀对应的位，不是前缀时返回 0
+uint8_t instructionPrefix(const std::string& word) {
+    using P = AssemblyParser::InstructionPrefix;
+    static const std::unordered_map<std::string, uint8_t> prefixes = {
+        {"rep", P::PREFIX_REP}, {"repe", P::PREFIX_REP}, {"repz", P::PREFIX_REP},
+        {"xrelease", P::PREFIX_REP}, {"repne", P::PREFIX_REPNE}, {"repnz", P::PREFIX_REPNE},
+        {"xacquire", P::PREFIX_REPNE}, {"lock", P::PREFIX_LOCK}, {"notrack", P::PREFIX_NOTRACK},
+        {"bnd", P::PREFIX_BND}, {"data16", P::PREFIX_DATA16}, {"addr32", P::PREFIX_ADDR32},
+        {"rex64", P::PREFIX_REX64},
+    };
+    auto it = prefixes.find(lowered(word));
+    return it == prefixes.end() ? 0 : it->second;
+}
+
+// 寄存器名表，行为位宽 8/16/32/64，列为硬件编号
+const char* const kRegisterNames[4][16] = {
+    {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+     "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"},
+    {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
+     "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w"},
+    {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+     "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"},
+    {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+     "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"},
+};
+
+// 寄存器活跃性分析用到的指令类别
+enum class RegOp {
+    MOV,            // 目的操作数 := f(源操作数)
+    MOV_FLAGS,      // 同上，并改写全部标志位（andn、bzhi 等）
+    ALU,            // 目的 := 目的 op 源，改写全部标志位
+    ALU_CARRY,      // adc/sbb：另外读取 CF
+    COMPARE,        // cmp/test
+    INC_DEC,        // 不改写 CF
+    NEG,
+    NOT,
+    SHIFT,          // 以 %cl 为位数时位数可能为 0，标志位不变
+    ROTATE,         // 只改写 CF/OF
+    ROTATE_CARRY,
+    IMUL,
+    MUL_DIV,
+    BIT_SCAN,       // bsf/bsr：源为 0 时目的不变
+    BIT_COUNT,      // popcnt/lzcnt/tzcnt
+    BIT_TEST,       // bt：只改写 CF
+    BIT_MODIFY,     // bts/btr/btc
+    EXCHANGE,
+    EXCHANGE_FLAGS, // xadd/cmpxchg
+    SIGN_EXTEND_RAX,    // cltq/cwtl
+    SIGN_EXTEND_RDX,    // cqto/cltd
+    PUSH,
+    POP,
+    PUSHF,
+    POPF,
+    LEAVE,
+    READ_FLAGS,     // lahf/cmc
+    NO_EFFECT,      // nop/endbr64/fence/clc 等
+};
+
+const std::unordered_map<std::string, RegOp>& regOpTable() {
+    static const std::unordered_map<std::string, RegOp> table = {
+        {"mov", RegOp::MOV}, {"movabs", RegOp::MOV}, {"movd", RegOp::MOV},
+        {"movzx", RegOp::MOV}, {"movsx", RegOp::MOV}, {"movsxd", RegOp::MOV},
+        {"movzbw", RegOp::MOV}, {"movzbl", RegOp::MOV}, {"movzbq", RegOp::MOV},
+        {"movzwl", RegOp::MOV}, {"movzwq", RegOp::MOV}, {"movsbw", RegOp::MOV},
+        {"movsbl", RegOp::MOV}, {"movsbq", RegOp::MOV}, {"movswl", RegOp::MOV},
+        {"movswq", RegOp::MOV}, {"movslq", RegOp::MOV}, {"lea", RegOp::MOV},
+        {"sarx", RegOp::MOV}, {"shlx", RegOp::MOV}, {"shrx", RegOp::MOV},
+        {"rorx", RegOp::MOV}, {"pdep", RegOp::MOV}, {"pext", RegOp::MOV},
+        {"andn", RegOp::MOV_FLAGS}, {"bzhi", RegOp::MOV_FLAGS}, {"blsi", RegOp::MOV_FLAGS},
+        {"blsr", RegOp::MOV_FLAGS}, {"blsmsk", RegOp::MOV_FLAGS},
+        {"add", RegOp::ALU}, {"sub", RegOp::ALU}, {"and", RegOp::ALU},
+        {"or", RegOp::ALU}, {"xor", RegOp::ALU},
+        {"adc", RegOp::ALU_CARRY}, {"sbb", RegOp::ALU_CARRY},
+        {"cmp", RegOp::COMPARE}, {"test", RegOp::COMPARE},
+        {"inc", RegOp::INC_DEC}, {"dec", RegOp::INC_DEC}, {"bswap", RegOp::INC_DEC},
+        {"neg", RegOp::NEG}, {"not", RegOp::NOT},
+        {"shl", RegOp::SHIFT}, {"sal", RegOp::SHIFT}, {"shr", RegOp::SHIFT},
+        {"sar", RegOp::SHIFT}, {"shld", RegOp::SHIFT}, {"shrd", RegOp::SHIFT},
+        {"rol", RegOp::ROTATE}, {"ror", RegOp::ROTATE},
+        {"rcl", RegOp::ROTATE_CARRY}, {"rcr", RegOp::ROTATE_CARRY},
+        {"imul", RegOp::IMUL}, {"mul", RegOp::MUL_DIV}, {"div", RegOp::MUL_DIV},
+        {"idiv", RegOp::MUL_DIV},
+        {"bsf", RegOp::BIT_SCAN}, {"bsr", RegOp::BIT_SCAN},
+        {"popcnt", RegOp::BIT_COUNT}, {"lzcnt", RegOp::BIT_COUNT}, {"tzcnt", RegOp::BIT_COUNT},
+        {"bt", RegOp::BIT_TEST}, {"bts", RegOp::BIT_MODIFY}, {"btr", RegOp::BIT_MODIFY},
+        {"btc", RegOp::BIT_MODIFY},
+        {"xchg", RegOp::EXCHANGE}, {"xadd", RegOp::EXCHANGE_FLAGS},
+        {"cmpxchg", RegOp::EXCHANGE_FLAGS},
+        {"cltq", RegOp::SIGN_EXTEND_RAX}, {"cdqe", RegOp::SIGN_EXTEND_RAX},
+        {"cwtl", RegOp::SIGN_EXTEND_RAX}, {"cwde", RegOp::SIGN_EXTEND_RAX},
+        {"cbtw", RegOp::SIGN_EXTEND_RAX}, {"cbw", RegOp::SIGN_EXTEND_RAX},
+        {"cqto", RegOp::SIGN_EXTEND_RDX}, {"cqo", RegOp::SIGN_EXTEND_RDX},
+        {"cltd", RegOp::SIGN_EXTEND_RDX}, {"cdq", RegOp::SIGN_EXTEND_RDX},
+        {"cwtd", RegOp::SIGN_EXTEND_RDX}, {"cwd", RegOp::SIGN_EXTEND_RDX},
+        {"push", RegOp::PUSH}, {"pop", RegOp::POP},
+        {"pushf", RegOp::PUSHF}, {"pushfq", RegOp::PUSHF},
+        {"popf", RegOp::POPF}, {"popfq", RegOp::POPF},
+        {"leave", RegOp::LEAVE}, {"leaveq", RegOp::LEAVE},
+        {"lahf", RegOp::READ_FLAGS}, {"cmc", RegOp::READ_FLAGS},
+        {"nop", RegOp::NO_EFFECT}, {"endbr64", RegOp::NO_EFFECT}, {"endbr32", RegOp::NO_EFFECT},
+        {"pause", RegOp::NO_EFFECT}, {"lfence", RegOp::NO_EFFECT}, {"mfence", RegOp::NO_EFFECT},
+        {"sfence", RegOp::NO_EFFECT}, {"ud2", RegOp::NO_EFFECT}, {"hlt", RegOp::NO_EFFECT},
+        {"int3", RegOp::NO_EFFECT}, {"clc", RegOp::NO_EFFECT}, {"stc", RegOp::NO_EFFECT},
+        {"cld", RegOp::NO_EFFECT}, {"std", RegOp::NO_EFFECT},
+    };
+    return table;
+}
+
+// SSE/AVX 指令：不隐式读取通用寄存器，也不读取标志位
+bool isVectorMnemonic(const std::string& m) {
+    if (m.empty()) {
+        return false;
+    }
+    static const std::vector<std::string> extra = {
+        "movdqa", "movdqu", "movntdq", "movntdqa", "lddqu", "movhps", "movlps",
+        "movhpd", "movlpd", "ldmxcsr", "stmxcsr", "emms", "movddup"
+    };
+    auto endsWith = [&m](const char* suffix) {
+        size_t n = std::strlen(suffix);
+        return m.size() > n + 1 && m.compare(m.size() - n, n, suffix) == 0;
+    };
+    if (m.compare(0, 7, "pcmpest") == 0 || m.compare(0, 7, "pcmpist") == 0 ||
+        m.compare(0, 10, "maskmovdqu") == 0 || m.compare(0, 11, "vpcmpest") == 0) {
+        return false;   // 隐式使用 rax/rdx/rcx/rdi
+    }
+    // 同样以 p 开头或以 ps 结尾的通用指令与 x87 指令（fstps 等）
+    static const std::vector<std::string> general = {
+        "push", "pop", "pause", "prefetch", "pdep", "pext", "ptwrite"
+    };
+    for (const auto& prefix : general) {
+        if (m.compare(0, prefix.size(), prefix) == 0) {
+            return false;
+        }
+    }
+    if (m[0] == 'f') {
+        return false;
+    }
+    return m[0] == 'v' || m[0] == 'p' || m.compare(0, 3, "cvt") == 0 ||
+           endsWith("ss") || endsWith("sd") || endsWith("ps") || endsWith("pd") ||
+           std::find(extra.begin(), extra.end(), m) != extra.end();
+}
+
+bool parseInteger(const std::string& text, long long& value) {
+    std::string digits = trimAsm(text);
+    char* end = nullptr;
+    value = std::strtoll(digits.c_str(), &end, 0);
+    return !digits.empty() && *end == '\0';
+}
+
+bool fitsInt8(long long value) {
+    return value >= -128 && value <= 127;
+}
+
+// 按源码顺序记录的布局，解析结束后据此分配地址（每个节单独计数）
+struct LayoutEvent {
+    enum Kind : uint8_t { INSTRUCTION, ALIGNMENT, LABEL, FUNCTION_START, FUNCTION_END };
+    Kind kind;
+    uint32_t section;
+    uint32_t index;             // 指令、对齐、符号或函数边界的下标
+};
+
+// 操作码的静态属性：驻留时按助记符计算一次，之后按编号直接读取
+struct OpcodeInfo {
+    std::string name;
+    AssemblyParser::BranchKind branch = AssemblyParser::BranchKind::NONE;
+    int regOp = -1;                 // 精确匹配的 RegOp，-1 表示没有
+    int suffixedRegOp = -1;         // 去掉 AT&T 的 b/w/l/q 后缀后匹配的 RegOp
+    bool stringOp = false;          // movs/stos/lods/scas/cmps，没有操作数时才是串操作
+    bool conditionalWrite = false;  // cmov/set
+    bool countsRcx = false;         // loop/jrcxz/jecxz
+    bool noEffect = false;          // prefetch 与 nop 族
+    bool vector = false;
+    bool vex = false;               // v 开头的 VEX 编码，不需要单独的 REX
+    bool vectorFlags = false;       // comis/ptest 改写标志位
+    bool zeroIdiom = false;         // xor/sub：两个操作数是同一寄存器时为清零惯用法
+    bool byteSignExtend = false;    // cbw：只改写 ax
+    bool wordSignExtend = false;    // cwd：只改写 dx
+
+    // 长度估计
+    unsigned implicitSize = 1;      // 没有操作数时的长度
+    unsigned suffixWidth = 0;       // AT&T 后缀给出的位宽
+    unsigned opcodeBytes = 1;       // 0F 转义为 2，popcnt 族为 3
+    unsigned shortBranch = 2;       // 直接跳转的短形式（jecxz 带 67，xbegin 只有 rel32）
+    unsigned nearBranch = 0;        // rel32 形式：jmp 5，jcc 6；0 表示没有
+    bool imul = false;              // 两操作数形式为 0F AF
+    bool pushPop = false;
+    bool movImmediate = false;      // mov 立即数到寄存器没有 ModRM
+    bool movabs = false;
+    bool movsx = false;             // Intel 的 movsx r64, r/m32 为 63 /r（movsxd）
+    bool shortImmediate = false;    // 移位、bt 与向量指令的 imm8
+    bool signExtendedImmediate = false;     // ALU/imul/push 可用 imm8
+    bool accumulator = false;       // ALU 与 test 对 al/ax/eax/rax 的立即数形式没有 ModRM
+    bool test = false;              // test 没有 imm8 形式
+    bool exchange = false;          // xchg 与 ax/eax/rax 交换为 90+r
+    bool x87 = false;               // 没有 66 与 REX.W
+    // 向量指令：传统编码为 [66/F2/F3] [REX] 0F [38/3A] 操作码，VEX 编码把前缀与转义并入 VEX
+    bool mandatoryPrefix = false;   // ps 族与 MMX 没有强制前缀
+    bool threeByteMap = false;      // 0F 38 / 0F 3A 转义，VEX 只能用 3 字节形式
+    bool vectorWide = false;        // 带 q 后缀的 cvtsi2sd/pinsr/pextr 等需要 REX.W / VEX.W
+    bool vexMove = false;           // 寄存器间的 VEX mov 可换成存储形式，以用 2 字节 VEX
+};
+
+OpcodeInfo describeOpcode(const std::string& m) {
+    using BranchKind = AssemblyParser::BranchKind;
+    OpcodeInfo info;
+    info.name = m;
+    if (m.empty()) {
+        return info;
+    }
+    auto startsWith = [&m](const char* prefix) { return m.compare(0, std::strlen(prefix), prefix) == 0; };
+
+    // 控制流
+    if (m == "call" || m == "callq" || m == "calll") {
+        info.branch = BranchKind::CALL;
+    } else if (m == "ret" || m == "retq" || m == "retl" || m == "retn" || m == "iret" ||
+               m == "iretq" || m == "iretd" || m == "ud2" || m == "hlt") {
+        info.branch = BranchKind::RETURN;
+    } else if (m == "jmp" || m == "jmpq" || m == "jmpl" || m == "ljmp") {
+        info.branch = BranchKind::JUMP;
+    } else if ((m.size() > 1 && m[0] == 'j') || startsWith("loop") || m == "xbegin") {
+        info.branch = BranchKind::CONDITIONAL;
+    }
+
+    // 寄存器效果的类别：精确匹配、串操作、去掉 AT&T 的 b/w/l/q 后缀
+    const auto& table = regOpTable();
+    auto it = table.find(m);
+    if (it != table.end()) {
+        info.regOp = static_cast<int>(it->second);
+    }
+    for (const char* base : {"movs", "stos", "lods", "scas", "cmps"}) {
+        info.stringOp = info.stringOp || (startsWith(base) && m.size() <= 5);
+    }
+    info.conditionalWrite = startsWith("cmov") || startsWith("set");
+    std::string stripped;
+    if (m.size() > 2 && std::strchr("bwlq", m.back()) && !info.conditionalWrite) {
+        stripped = m.substr(0, m.size() - 1);
+        auto suffixed = table.find(stripped);
+        if (suffixed != table.end()) {
+            info.suffixedRegOp = static_cast<int>(suffixed->second);
+        }
+    }
+    info.zeroIdiom = m == "xor" || m == "sub" ||
+                     (info.regOp < 0 && (stripped == "xor" || stripped == "sub"));
+    info.countsRcx = startsWith("loop") || m == "jrcxz" || m == "jecxz";
+    info.noEffect = startsWith("prefetch") || startsWith("nop");
+    info.vector = isVectorMnemonic(m);
+    static const std::vector<std::string> bmi = {
+        "andn", "bzhi", "pdep", "pext", "sarx", "shlx", "shrx", "rorx", "blsi", "blsr", "blsmsk",
+        "bextr", "mulx"
+    };
+    bool vexGeneral = std::find(bmi.begin(), bmi.end(), m) != bmi.end();
+    info.vex = (info.vector && m[0] == 'v') || vexGeneral;
+    info.vectorFlags = m.find("comis") != std::string::npos || m.find("ptest") != std::string::npos;
+    info.byteSignExtend = m == "cbw" || m == "cbtw";
+    info.wordSignExtend = m == "cwd" || m == "cwtd";
+
+    // 长度估计
+    static const std::unordered_map<std::string, unsigned> implicit = {
+        {"endbr64", 4}, {"endbr32", 4}, {"syscall", 2}, {"cpuid", 2}, {"rdtsc", 2},
+        {"pause", 2}, {"cltq", 2}, {"cdqe", 2}, {"cqto", 2}, {"cqo", 2},
+        {"lfence", 3}, {"mfence", 3}, {"sfence", 3}, {"pushfq", 1}, {"popfq", 1},
+        {"emms", 2}, {"vzeroupper", 3}, {"vzeroall", 3}, {"fwait", 1}, {"wait", 1},
+        {"finit", 3}, {"fninit", 2}, {"rdtscp", 3}, {"xgetbv", 3}, {"xend", 3}, {"xtest", 3},
+    };
+    info.x87 = m[0] == 'f';
+    auto size = implicit.find(m);
+    info.implicitSize = size != implicit.end() ? size->second : info.x87 ? 2 : 1;
+    if (info.stringOp && m.size() == 5 && (m.back() == 'q' || m.back() == 'w')) {
+        info.implicitSize = 2;      // REX.W / 66
+    }
+    if (m.size() > 1 && info.regOp < 0) {
+        char suffix = m.back();
+        info.suffixWidth = suffix == 'q' ? 64 : suffix == 'w' ? 16 : suffix == 'b' ? 8 : 32;
+    }
+    bool escaped = startsWith("movz") || (startsWith("movs") && m != "movslq" && m != "movsxd") ||
+                   startsWith("set") || startsWith("cmov") || startsWith("bt") ||
+                   startsWith("bs") || startsWith("xadd") || startsWith("cmpxchg") ||
+                   ((startsWith("shl") || startsWith("shr")) && m.size() > 3 && m[3] == 'd') ||
+                   startsWith("nop") || startsWith("prefetch") || startsWith("movnti");
+    if (startsWith("popcnt") || startsWith("lzcnt") || startsWith("tzcnt")) {
+        info.opcodeBytes = 3;       // F3 0F xx
+    } else {
+        info.opcodeBytes = escaped ? 2 : 1;
+    }
+    if (info.branch == BranchKind::JUMP) {
+        info.nearBranch = 5;        // E9 rel32
+    } else if (info.branch == BranchKind::CONDITIONAL && !info.countsRcx) {
+        info.nearBranch = 6;        // 0F 8x rel32
+    }
+    info.shortBranch = m == "jecxz" ? 3 : m == "xbegin" ? 6 : 2;
+
+    // 向量指令的编码形式（VEX 指令按去掉 v 的名字判断）
+    std::string base = info.vex && m[0] == 'v' ? m.substr(1) : m;
+    auto baseStarts = [&base](const char* prefix) {
+        return base.compare(0, std::strlen(prefix), prefix) == 0;
+    };
+    auto baseEnds = [&base](const char* suffix) {
+        size_t n = std::strlen(suffix);
+        return base.size() > n && base.compare(base.size() - n, n, suffix) == 0;
+    };
+    static const std::vector<std::string> noPrefix = {
+        "comiss", "ucomiss", "cvtdq2ps", "cvtps2pd", "cvtpi2ps", "cvtps2pi", "cvttps2pi",
+        "ldmxcsr", "stmxcsr", "movhps", "movlps"
+    };
+    info.mandatoryPrefix = !(baseEnds("ps") && !baseStarts("cvt")) &&
+                           std::find(noPrefix.begin(), noPrefix.end(), base) == noPrefix.end();
+    static const std::vector<std::string> threeByte = {
+        "pshufb", "phaddw", "phaddd", "phaddsw", "pmaddubsw", "phsubw", "phsubd", "phsubsw",
+        "psignb", "psignw", "psignd", "pmulhrsw", "pblendvb", "blendvps", "blendvpd", "ptest",
+        "pabsb", "pabsw", "pabsd", "pmuldq", "pcmpeqq", "movntdqa", "packusdw", "pcmpgtq",
+        "pminsb", "pminsd", "pminuw", "pminud", "pmaxsb", "pmaxsd", "pmaxuw", "pmaxud",
+        "pmulld", "phminposuw", "roundps", "roundpd", "roundss", "roundsd", "blendps",
+        "blendpd", "pblendw", "palignr", "pextrb", "pextrd", "pextrq", "pinsrb", "pinsrd",
+        "pinsrq", "insertps", "extractps", "dpps", "dppd", "mpsadbw", "pclmulqdq", "pcmpestri",
+        "pcmpestrm", "pcmpistri", "pcmpistrm", "permd", "permps", "permq", "permpd", "pblendd",
+        "psllvd", "psllvq", "psrlvd", "psrlvq", "psravd", "testps", "testpd", "permilps",
+        "permilpd", "cvtph2ps", "cvtps2ph", "maskmovps", "maskmovpd"
+    };
+    info.threeByteMap = vexGeneral ||
+                        std::find(threeByte.begin(), threeByte.end(), base) != threeByte.end();
+    for (const char* family : {"pmovsx", "pmovzx", "fmadd", "fmsub", "fnmadd", "fnmsub", "aes",
+                               "sha1", "sha256", "broadcast", "pbroadcast", "gather", "pgather",
+                               "pmaskmov", "insertf", "inserti", "extractf", "extracti", "perm2"}) {
+        info.threeByteMap = info.threeByteMap || (info.vector && baseStarts(family));
+    }
+    info.vectorWide = (baseStarts("cvt") && base.find("si") != std::string::npos &&
+                       base.back() == 'q') ||
+                      base == "pinsrq" || base == "pextrq";
+    info.vexMove = info.vex && baseStarts("mov");
+    info.imul = startsWith("imul");
+    info.pushPop = startsWith("push") || (startsWith("pop") && !startsWith("popcnt"));
+    info.movImmediate = startsWith("mov");
+    info.movabs = m == "movabs" || m == "movabsq";
+    info.movsx = m == "movsx";
+    info.shortImmediate = startsWith("sh") || startsWith("sa") || startsWith("ro") ||
+                          startsWith("rc") || startsWith("bt") || info.vector;
+    info.signExtendedImmediate = startsWith("add") || startsWith("sub") || startsWith("and") ||
+                                 startsWith("or") || startsWith("xor") || startsWith("cmp") ||
+                                 startsWith("adc") || startsWith("sbb") || info.imul ||
+                                 startsWith("push");
+    for (const char* alu : {"add", "or", "adc", "sbb", "and", "sub", "xor", "cmp", "test"}) {
+        info.accumulator = info.accumulator || m == alu || stripped == alu;
+    }
+    info.test = m == "test" || stripped == "test";
+    info.exchange = m == "xchg" || stripped == "xchg";
+    return info;
+}
+
+// 所有解析器共享的操作码表，只增不删（汇编重写器在多个线程中同时解析）。
+// 条目分块分配，发布后不再移动，按编号读取不需要加锁
+class OpcodeTable {
+public:
+    static OpcodeTable& instance() {
+        static OpcodeTable table;
+        return table;
+    }
+
+    AssemblyParser::Opcode intern(const std::string& mnemonic) {
+        std::string name = lowered(mnemonic);
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            auto it = m_ids.find(name);
+            if (it != m_ids.end()) {
+                return it->second;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_ids.find(name);
+        if (it != m_ids.end()) {
+            return it->second;
+        }
+        if (m_count >= AssemblyParser::kNoOpcode) {
+            return 0;       // 表满时按未知指令处理
+        }
+        size_t id = m_count;
+        std::atomic<OpcodeInfo*>& chunk = m_chunks[id / kChunkSize];
+        if (!chunk.load(std::memory_order_relaxed)) {
+            m_storage.emplace_back(new OpcodeInfo[kChunkSize]);
+            chunk.store(m_storage.back().get(), std::memory_order_release);
+        }
+        chunk.load(std::memory_order_relaxed)[id % kChunkSize] = describeOpcode(name);
+        ++m_count;
+        m_ids.emplace(std::move(name), static_cast<AssemblyParser::Opcode>(id));
+        return static_cast<AssemblyParser::Opcode>(id);
+    }
+
+    AssemblyParser::Opcode find(const std::string& mnemonic) const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_ids.find(lowered(mnemonic));
+        return it == m_ids.end() ? AssemblyParser::kNoOpcode : it->second;
+    }
+
+    const OpcodeInfo& info(AssemblyParser::Opcode opcode) const {
+        size_t id = opcode == AssemblyParser::kNoOpcode ? 0 : opcode;
+        return m_chunks[id / kChunkSize].load(std::memory_order_acquire)[id % kChunkSize];
+    }
+
+private:
+    static constexpr size_t kChunkSize = 256;
+
+    OpcodeTable() {
+        intern("");         // 编号 0：空助记符与表满时的未知指令
+    }
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::string, AssemblyParser::Opcode> m_ids;
+    std::atomic<OpcodeInfo*> m_chunks[(AssemblyParser::kNoOpcode + kChunkSize) / kChunkSize] = {};
+    std::vector<std::unique_ptr<OpcodeInfo[]>> m_storage;
+    size_t m_count = 0;
+};
+
+unsigned widthLog(int width) {
+    switch (width) {
+    case 8: return 1;
+    case 16: return 2;
+    case 32: return 3;
+    case 64: return 4;
+    case 128: return 5;
+    case 256: return 6;
+    case 512: return 7;
+    default: return 0;
+    }
+}
+
+// 段寄存器编号：1-6 依次为 es cs ss ds fs gs，不是段寄存器时返回 0
+unsigned segmentIndex(const std::string& name) {
+    static const char* const segments[] = {"es", "cs", "ss", "ds", "fs", "gs"};
+    for (unsigned i = 0; i < 6; ++i) {
+        if (name == segments[i]) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// 寄存器名（不带 %）填入操作数：通用寄存器、xmm/ymm/zmm/mm，以及 k/st/段寄存器等。
+// 不是寄存器时返回 false
+bool setRegister(AssemblyParser::Operand& operand, const std::string& token) {
+    using Kind = AssemblyParser::OperandKind;
+    std::string name = lowered(token);
+    int width = 0;
+    int index = AssemblyParser::registerIndex(name, &width);
+    if (index >= 0) {
+        operand.kind = Kind::REGISTER;
+        operand.base = static_cast<unsigned>(index);
+        operand.widthLog = widthLog(width);
+        operand.byteRex = name == "spl" || name == "bpl" || name == "sil" || name == "dil";
+        operand.highByte = name == "ah" || name == "bh" || name == "ch" || name == "dh";
+        return true;
+    }
+
+    size_t digits = name.find_first_of("0123456789");
+    std::string bank = name.substr(0, digits);
+    bool numbered = digits != std::string::npos && digits > 0 && name.size() - digits <= 2 &&
+                    name.find_first_not_of("0123456789", digits) == std::string::npos;
+    if (numbered && (bank == "xmm" || bank == "ymm" || bank == "zmm" || bank == "mm")) {
+        operand.kind = Kind::VECTOR_REGISTER;
+        operand.base = static_cast<unsigned>(std::stoi(name.substr(digits))) & 31;
+        operand.widthLog = widthLog(bank == "xmm" ? 128 : bank == "ymm" ? 256 :
+                                    bank == "zmm" ? 512 : 64);
+        return true;
+    }
+    if ((numbered && (bank == "k" || bank == "st" || bank == "cr" || bank == "dr" ||
+                      bank == "bnd")) ||
+        name == "st" || name.compare(0, 3, "st(") == 0 || segmentIndex(name) > 0) {
+        operand.kind = Kind::OTHER_REGISTER;
+        return true;
+    }
+    return false;
+}
+
+// 内存操作数中的寄存器编号（可带 %），rip/eip 为 kRipRegister，不是寄存器时返回 -1
+int addressRegister(const std::string& token) {
+    std::string name = lowered(!token.empty() && token[0] == '%' ? token.substr(1) : token);
+    if (name == "rip" || name == "eip") {
+        return static_cast<int>(AssemblyParser::kRipRegister);
+    }
+    return AssemblyParser::registerIndex(name);
+}
+
+// 变址比例的 log2，不合法时返回 -1
+int scaleLog(const std::string& text) {
+    std::string scale = trimAsm(text);
+    return scale == "1" ? 0 : scale == "2" ? 1 : scale == "4" ? 2 : scale == "8" ? 3 : -1;
+}
+
+// 操作数读取的通用寄存器：寄存器本身或内存操作数的 base/index，无法解析时为全部
+AssemblyParser::RegisterMask operandRegisters(const AssemblyParser::Operand& operand) {
+    using Kind = AssemblyParser::OperandKind;
+    switch (operand.kind) {
+    case Kind::REGISTER:
+        return 1u << operand.base;
+    case Kind::MEMORY: {
+        AssemblyParser::RegisterMask mask = 0;
+        if (operand.hasBase() && operand.base < AssemblyParser::kRipRegister) {
+            mask |= 1u << operand.base;
+        }
+        if (operand.hasIndex() && operand.index < AssemblyParser::kRipRegister) {
+            mask |= 1u << operand.index;
+        }
+        return mask;
+    }
+    case Kind::UNKNOWN:
+        return AssemblyParser::kAllRegisters;
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+static_assert(sizeof(AssemblyParser::Operand) == 8, "operand descriptor must stay 8 bytes");
+static_assert(sizeof(AssemblyParser::Instruction) == 16, "instruction must stay 16 bytes");
+
+AssemblyParser::AssemblyParser() : m_symbolOffsets(1, 0) {
+}
+
+AssemblyParser::Opcode AssemblyParser::internOpcode(const std::string& mnemonic) {
+    return OpcodeTable::instance().intern(mnemonic);
+}
+
+AssemblyParser::Opcode AssemblyParser::findOpcode(const std::string& mnemonic) {
+    return OpcodeTable::instance().find(mnemonic);
+}
+
+const std::string& AssemblyParser::opcodeName(Opcode opcode) {
+    return OpcodeTable::instance().info(opcode).name;
+}
+
+size_t AssemblyParser::symbolSlot(std::string_view name) const {
+    // 线性探测：返回名字所在或应当插入的槽位
+    const size_t mask = m_symbolSlots.size() - 1;
+    size_t slot = std::hash<std::string_view>()(name) & mask;
+    while (m_symbolSlots[slot] != 0 && symbolName(m_symbolSlots[slot] - 1) != name) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+AssemblyParser::SymbolId AssemblyParser::internSymbol(std::string_view name) {
+    const size_t count = m_symbolOffsets.size() - 1;
+    if (m_symbolSlots.size() < 2 * (count + 1)) {
+        // 装载率不超过一半，扩容时按名字重新放入
+        m_symbolSlots.assign(std::max<size_t>(64, m_symbolSlots.size() * 2), 0);
+        for (size_t symbol = 0; symbol < count; ++symbol) {
+            m_symbolSlots[symbolSlot(symbolName(static_cast<SymbolId>(symbol)))] =
+                static_cast<uint32_t>(symbol + 1);
+        }
+    }
+    size_t slot = symbolSlot(name);
+    if (m_symbolSlots[slot] != 0) {
+        return m_symbolSlots[slot] - 1;
+    }
+    m_symbolText.append(name);
+    m_symbolOffsets.push_back(static_cast<uint32_t>(m_symbolText.size()));
+    m_symbolSlots[slot] = static_cast<uint32_t>(count + 1);
+    return static_cast<SymbolId>(count);
+}
+
+std::string_view AssemblyParser::symbolName(SymbolId symbol) const {
+    if (symbol == kNoSymbol || symbol + 1 >= m_symbolOffsets.size()) {
+        return {};
+    }
+    return std::string_view(m_symbolText).substr(
+        m_symbolOffsets[symbol], m_symbolOffsets[symbol + 1] - m_symbolOffsets[symbol]);
+}
+
+AssemblyParser::SymbolId AssemblyParser::findSymbol(std::string_view name) const {
+    if (m_symbolSlots.empty()) {
+        return kNoSymbol;
+    }
+    size_t slot = symbolSlot(name);
+    return m_symbolSlots[slot] != 0 ? m_symbolSlots[slot] - 1 : kNoSymbol;
+}
+
+int64_t AssemblyParser::operandValue(const Operand& operand) const {
+    if (operand.symbolic) {
+        return 0;
+    }
+    return operand.wide ? m_wideValues[static_cast<size_t>(operand.value)] : operand.value;
+}
+
+bool AssemblyParser::parse(const std::string& asmCode) {
+    if (asmCode.empty()) {
         LOG_ERROR("Assembly code is empty");
         return false;
     }
 
-    m_asmCode = asmCode;
     m_instructions.clear();
-    m_labels.clear();
+    m_operands.clear();
+    m_wideValues.clear();
+    m_symbolText.clear();
+    m_symbolOffsets.assign(1, 0);
+    m_symbolSlots.clear();
+    m_labelTargets.clear();
+    m_functionBounds.clear();
+    m_alignments.clear();
+
+    std::vector<std::pair<uint32_t, SymbolId>> labelOrder;     // 按出现顺序：(指令下标, 标签)
+    std::vector<FunctionBoundary> globalLabels;                 // 没有 .type 时的备选函数入口
+    std::vector<std::string> declared;                          // .type 声明、尚未出现标签的函数
+    std::vector<LayoutEvent> layout;
+    std::vector<uint32_t> labelSections;        // 符号 -> 定义所在的节，没有定义时为 UINT32_MAX
+    std::vector<bool> weakSymbols;
+    std::vector<std::pair<SymbolId, SymbolId>> aliases;        // .set alias, target
+    int openFunction = -1;
+    uint32_t openSection = 0;                   // 打开的函数入口所在的节
+    bool intelSyntax = m_intelSyntax;
+
+    // 节按名字编号，各自计算地址（冷路径 .text.unlikely 不占 .text 的偏移）；
+    // 函数中间可能插入跳转表的 .rodata，只有代码节中的对齐影响地址
+    std::vector<std::string> sectionNames = {".text"};
+    std::vector<bool> sectionCode = {true};
+    uint32_t section = 0;
+    uint32_t previousSection = 0;               // .previous 切回的节
+    std::vector<uint32_t> sectionStack;
+    auto enterSection = [&](const std::string& directive) {
+        std::string name = trimAsm(directive.substr(0, directive.find_first_of(" \t,")));
+        if (name == ".section" || name == ".pushsection") {
+            std::string args = trimAsm(directive.substr(name.size()));
+            name = trimAsm(args.substr(0, args.find_first_of(" \t,")));
+        }
+        auto it = std::find(sectionNames.begin(), sectionNames.end(), name);
+        previousSection = section;
+        section = static_cast<uint32_t>(it - sectionNames.begin());
+        if (it == sectionNames.end()) {
+            sectionNames.push_back(name);
+            sectionCode.push_back(isCodeSection(directive));
+        }
+    };
+    auto addEvent = [&](LayoutEvent::Kind kind, size_t index) {
+        layout.push_back({kind, section, static_cast<uint32_t>(index)});
+    };
+
+    // 结束地址取函数自己所在节的当前地址：.size 可能写在切换到其他节之后
+    auto closeFunction = [&]() {
+        if (openFunction >= 0) {
+            m_functionBounds[openFunction].endInstruction = m_instructions.size();
+            layout.push_back({LayoutEvent::FUNCTION_END, openSection,
+                              static_cast<uint32_t>(openFunction)});
+            openFunction = -1;
+        }
+    };
 
     // 逐行解析
     std::istringstream iss(asmCode);
     std::string line;
-    size_t address = 0;
+    size_t lineNumber = 0;
 
     while (std::getline(iss, line)) {
+        size_t current = lineNumber++;
+
         // 移除前后空白
-        line.erase(0, line.find_first_not_of(" \t"));
-        line.erase(line.find_last_not_of(" \t") + 1);
+        line = trimAsm(line);
 
-        if (line.empty() || line[0] == ';') {
-            // 跳过空行和注释
+        AsmLineKind kind = classifyLine(line);
+        if (kind == AsmLineKind::BLANK || kind == AsmLineKind::COMMENT) {
             continue;
         }
 
-        if (isLabel(line)) {
+        if (kind == AsmLineKind::DIRECTIVE) {
+            std::string name = functionTypeDirective(line);
+            if (!name.empty()) {
+                declared.push_back(name);
+            } else if (line.compare(0, 13, ".intel_syntax") == 0) {
+                intelSyntax = true;
+            } else if (line.compare(0, 11, ".att_syntax") == 0) {
+                intelSyntax = false;
+            } else if (openFunction >= 0 &&
+                       sizeDirective(line) == m_functionBounds[openFunction].name) {
+                closeFunction();
+            } else if (line.compare(0, 5, ".weak") == 0 && !directiveArgs(line, ".weak").empty()) {
+                SymbolId symbol = internSymbol(directiveArgs(line, ".weak"));
+                weakSymbols.resize(std::max<size_t>(weakSymbols.size(), symbol + 1));
+                weakSymbols[symbol] = true;
+            } else if (line.compare(0, 4, ".set") == 0 && !directiveArgs(line, ".set").empty()) {
+                std::string args = directiveArgs(line, ".set");
+                size_t comma = args.find(',');
+                std::string target = comma == std::string::npos ? "" : trimAsm(args.substr(comma + 1));
+                if (!target.empty() && classifyLine(target + ":") == AsmLineKind::LABEL) {
+                    aliases.emplace_back(internSymbol(trimAsm(args.substr(0, comma))),
+                                         internSymbol(target));
+                }
+            } else if (line.compare(0, 5, ".text") == 0 || line.compare(0, 5, ".data") == 0 ||
+                       line.compare(0, 4, ".bss") == 0 || line.compare(0, 8, ".section") == 0 ||
+                       line.compare(0, 12, ".pushsection") == 0) {
+                if (line.compare(0, 12, ".pushsection") == 0) {
+                    sectionStack.push_back(section);
+                }
+                enterSection(line);
+            } else if (line.compare(0, 9, ".previous") == 0) {
+                std::swap(section, previousSection);
+            } else if (line.compare(0, 11, ".popsection") == 0 && !sectionStack.empty()) {
+                previousSection = section;
+                section = sectionStack.back();
+                sectionStack.pop_back();
+            } else if (sectionCode[section]) {
+                Alignment alignment;
+                if (parseAlignment(line, alignment.boundary, alignment.maxSkip)) {
+                    alignment.line = current;
+                    alignment.nextInstruction = m_instructions.size();
+                    addEvent(LayoutEvent::ALIGNMENT, m_alignments.size());
+                    m_alignments.push_back(alignment);
+                }
+            }
+            continue;
+        }
+
+        if (kind == AsmLineKind::LABEL) {
             // 记录标签位置
-            std::string label = line.substr(0, line.find(':'));
-            m_labels[label] = address;
+            size_t colon = line.find(':');
+            std::string label = line.substr(0, colon);
+            SymbolId symbol = internSymbol(label);
+            labelOrder.emplace_back(static_cast<uint32_t>(m_instructions.size()), symbol);
+            labelSections.resize(m_symbolOffsets.size() - 1, UINT32_MAX);
+            labelSections[symbol] = section;
+            addEvent(LayoutEvent::LABEL, symbol);
+
+            FunctionBoundary boundary;
+            boundary.name = label;
+            boundary.startAddr = boundary.endAddr = 0;
+            boundary.firstInstruction = boundary.endInstruction = m_instructions.size();
+
+            auto it = std::find(declared.begin(), declared.end(), label);
+            if (it != declared.end()) {
+                declared.erase(it);
+                // gcc 把冷路径拆成另一节中的 f.cold（同样有 .type），它是 f 的一部分，
+                // 不结束 f；同一节中的新入口说明上一个函数没有 .size
+                if (openFunction < 0 || openSection == section) {
+                    closeFunction();
+                    openFunction = static_cast<int>(m_functionBounds.size());
+                    openSection = section;
+                    addEvent(LayoutEvent::FUNCTION_START, m_functionBounds.size());
+                    m_functionBounds.push_back(boundary);
+                }
+            } else if (!isLocalLabel(label)) {
+                globalLabels.push_back(boundary);
+            }
+
+            // 同一行标签之后的指令
+            line = trimAsm(line.substr(colon + 1));
+            if (classifyLine(line) != AsmLineKind::INSTRUCTION) {
+                continue;
+            }
+        }
+
+        // 解析指令
+        Instruction instr = parseInstruction(line, intelSyntax);
+        instr.line = static_cast<uint32_t>(current);
+        instr.size = std::min(estimateSize(instr), 15u);
+        addEvent(LayoutEvent::INSTRUCTION, m_instructions.size());
+        m_instructions.push_back(instr);
+    }
+    closeFunction();
+
+    // 标签 -> 其后第一条指令，重复定义的数字标签以最后一次为准
+    const size_t symbols = m_symbolOffsets.size() - 1;
+    m_labelTargets.assign(symbols, UINT32_MAX);
+    for (const auto& [index, symbol] : labelOrder) {
+        m_labelTargets[symbol] = index;
+    }
+    labelSections.resize(symbols, UINT32_MAX);
+    weakSymbols.resize(symbols);
+
+    // 与汇编器一样先按 rel8 排布直接跳转：目标没有定义、是弱符号或在另一节时只能用 rel32，
+    // 其余在目标超出 rel8 范围时加长。.set 定义的别名（如 C1/C2 构造函数）按其目标处理
+    std::vector<SymbolId> aliasTargets(symbols, kNoSymbol);
+    for (const auto& [alias, target] : aliases) {
+        aliasTargets[alias] = target;
+    }
+    struct Branch {
+        uint32_t instruction;
+        SymbolId target;
+        unsigned nearSize;
+    };
+    std::vector<Branch> relaxable;      // 按指令顺序
+    for (const LayoutEvent& event : layout) {
+        if (event.kind != LayoutEvent::INSTRUCTION) {
+            continue;
+        }
+        Instruction& instr = m_instructions[event.index];
+        BranchKind kind = branchKind(instr);
+        if ((kind != BranchKind::JUMP && kind != BranchKind::CONDITIONAL) ||
+            instr.operandCount == 0 || m_operands[instr.firstOperand].kind != OperandKind::TARGET) {
+            continue;
+        }
+        unsigned nearSize = std::min(estimateSize(instr, true), 15u);
+        if (nearSize == instr.size) {
+            continue;
+        }
+        SymbolId target = operandSymbol(m_operands[instr.firstOperand]);
+        bool weak = false;
+        for (int hops = 0; target < symbols && aliasTargets[target] != kNoSymbol && hops < 8; ++hops) {
+            weak = weak || weakSymbols[target];
+            target = aliasTargets[target];
+        }
+        if (target < symbols && labelSections[target] == event.section && !weak &&
+            !weakSymbols[target]) {
+            relaxable.push_back({event.index, target, nearSize});
         } else {
-            // 解析指令
-            Instruction instr = parseInstruction(line);
-            instr.address = address;
-            m_instructions.push_back(instr);
-            address += 4; // 简化：假设每条指令4字节
+            instr.size = nearSize;
+        }
+    }
+
+    // 一遍排布：按顺序分配地址，加长目标超出 rel8 的跳转，返回是否有加长。与汇编器一样，
+    // 本遍已经过的标签用本遍的地址，之后的标签用上一遍的地址加上本节到此为止的增长，
+    // 但增长可能被中间的对齐填充吸收，跨过对齐时不加。第 0 遍只分配地址；
+    // 跳转只加长不缩短，必然收敛
+    std::vector<uint32_t> sectionEnds(sectionNames.size());
+    std::vector<uint32_t> sectionRegions(sectionNames.size());     // 节内已经过的对齐数
+    std::vector<uint32_t> labelAddresses(symbols, 0);
+    std::vector<uint32_t> labelPasses(symbols, 0);
+    std::vector<uint32_t> labelRegions(symbols, 0);
+    auto layoutPass = [&](uint32_t pass) {
+        std::fill(sectionEnds.begin(), sectionEnds.end(), 0);
+        std::fill(sectionRegions.begin(), sectionRegions.end(), 0);
+        bool changed = false;
+        auto branch = relaxable.begin();
+        for (const LayoutEvent& event : layout) {
+            uint32_t& address = sectionEnds[event.section];
+            switch (event.kind) {
+            case LayoutEvent::INSTRUCTION: {
+                Instruction& instr = m_instructions[event.index];
+                if (branch != relaxable.end() && branch->instruction == event.index) {
+                    SymbolId target = branch->target;
+                    unsigned nearSize = (branch++)->nearSize;
+                    int64_t targetAddress = labelAddresses[target];
+                    int64_t end = static_cast<int64_t>(address) + instr.size;
+                    int64_t stretch = static_cast<int64_t>(address) - instr.address;
+                    bool reachable = false;
+                    if (labelPasses[target] != pass) {
+                        if (stretch < 0 || labelRegions[target] == sectionRegions[event.section]) {
+                            targetAddress += stretch;
+                        } else {
+                            reachable = targetAddress < end - 1;
+                        }
+                    }
+                    if (pass > 0 && instr.size != nearSize && !reachable &&
+                        !fitsInt8(targetAddress - end)) {
+                        instr.size = nearSize;
+                        changed = true;
+                    }
+                }
+                instr.address = address;
+                address += instr.size;
+                break;
+            }
+            case LayoutEvent::ALIGNMENT: {
+                // 与汇编器一样计算填充，超过上限时不对齐
+                Alignment& alignment = m_alignments[event.index];
+                alignment.address = address;
+                unsigned padding = (alignment.boundary - address % alignment.boundary) %
+                                   alignment.boundary;
+                alignment.padding = padding <= alignment.maxSkip ? padding : 0;
+                address += alignment.padding;
+                ++sectionRegions[event.section];
+                break;
+            }
+            case LayoutEvent::LABEL:
+                labelAddresses[event.index] = address;
+                labelPasses[event.index] = pass;
+                labelRegions[event.index] = sectionRegions[event.section];
+                break;
+            case LayoutEvent::FUNCTION_START:
+                m_functionBounds[event.index].startAddr = address;
+                break;
+            case LayoutEvent::FUNCTION_END:
+                m_functionBounds[event.index].endAddr = address;
+                break;
+            }
         }
+        return changed;
+    };
+    for (uint32_t pass = 0; layoutPass(pass) || pass == 0; ++pass) {
+    }
+
+    // 手写汇编往往没有 .type/.size：以非局部标签为入口，到下一个入口为止
+    if (m_functionBounds.empty()) {
+        for (size_t i = 0; i < globalLabels.size(); ++i) {
+            FunctionBoundary boundary = globalLabels[i];
+            SymbolId symbol = findSymbol(boundary.name);
+            boundary.startAddr = labelAddresses[symbol];
+            bool last = i + 1 == globalLabels.size();
+            boundary.endAddr = last ? sectionEnds[labelSections[symbol]]
+                                    : labelAddresses[findSymbol(globalLabels[i + 1].name)];
+            boundary.endInstruction = last ? m_instructions.size()
+                                           : globalLabels[i + 1].firstInstruction;
+            m_functionBounds.push_back(boundary);
+        }
+    }
+    m_instructions.shrink_to_fit();
+    m_operands.shrink_to_fit();
+
+    buildCFG(labelOrder);
+    buildOpcodeIndex();
+
+    LOG_DEBUG("Parsed " + std::to_string(m_instructions.size()) + " instructions, " +
+             std::to_string(m_cfg.blocks.size()) + " basic blocks");
+    return true;
+}
+
+AsmLineKind AssemblyParser::classifyLine(const std::string& line) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return AsmLineKind::BLANK;
+    }
+    char c = line[start];
+    if (c == '#' || c == ';' || line.compare(start, 2, "//") == 0 ||
+        line.compare(start, 2, "/*") == 0) {
+        return AsmLineKind::COMMENT;
+    }
+
+    // 标签: 标识符（可含 . $ @）或数字局部标签后紧跟冒号
+    size_t end = start;
+    while (end < line.size() &&
+           (std::isalnum(static_cast<unsigned char>(line[end])) || line[end] == '_' ||
+            line[end] == '.' || line[end] == '$' || line[end] == '@')) {
+        ++end;
+    }
+    if (end > start && end < line.size() && line[end] == ':') {
+        return AsmLineKind::LABEL;
+    }
+
+    return c == '.' ? AsmLineKind::DIRECTIVE : AsmLineKind::INSTRUCTION;
+}
+
+std::string AssemblyParser::functionTypeDirective(const std::string& line) {
+    std::string args = directiveArgs(line, ".type");
+    size_t comma = args.find(',');
+    if (comma == std::string::npos) {
+        return "";
+    }
+    std::string kind = trimAsm(args.substr(comma + 1));
+    if (kind != "@function" && kind != "%function" && kind != "STT_FUNC") {
+        return "";
+    }
+    return trimAsm(args.substr(0, comma));
+}
+
+std::string AssemblyParser::sizeDirective(const std::string& line) {
+    std::string args = directiveArgs(line, ".size");
+    size_t comma = args.find(',');
+    return comma == std::string::npos ? "" : trimAsm(args.substr(0, comma));
+}
+
+bool AssemblyParser::parseAlignment(const std::string& line, unsigned& boundary,
+                                    unsigned& maxSkip) {
+    // x86 ELF 上 .align 与 .balign 一样以字节计
+    std::string args;
+    bool power = false;
+    for (const char* directive : {".p2align", ".p2alignw", ".p2alignl"}) {
+        if (args.empty()) {
+            args = directiveArgs(line, directive);
+            power = !args.empty();
+        }
+    }
+    for (const char* directive : {".balign", ".balignw", ".balignl", ".align"}) {
+        if (args.empty()) {
+            args = directiveArgs(line, directive);
+        }
+    }
+    if (args.empty()) {
+        return false;
     }
 
-    LOG_INFO("Parsed " + std::to_string(m_instructions.size()) + " instructions");
+    std::vector<std::string> fields;
+    std::istringstream parts(args);
+    std::string field;
+    while (std::getline(parts, field, ',')) {
+        fields.push_back(trimAsm(field));
+    }
+    long long value = 0;
+    if (fields.empty() || !parseInteger(fields[0], value) || value < 0 ||
+        value > (power ? 30 : 1LL << 30)) {
+        return false;
+    }
+    boundary = power ? 1u << value : static_cast<unsigned>(std::max(value, 1LL));
+    maxSkip = boundary - 1;
+    long long limit = 0;
+    if (fields.size() > 2 && parseInteger(fields[2], limit) && limit >= 0) {
+        maxSkip = std::min<unsigned>(maxSkip, static_cast<unsigned>(limit));
+    }
     return true;
 }
 
+unsigned AssemblyParser::estimateSize(const Instruction& instr, bool nearBranch) const {
+    const OpcodeInfo& info = OpcodeTable::instance().info(instr.opcode);
+    if (info.name.empty()) {
+        return 0;
+    }
+    unsigned size = static_cast<unsigned>(std::bitset<8>(instr.prefixes).count());
+    const OperandRange ops = operands(instr);
+
+    // 控制流：直接调用按 rel32，直接跳转按 rel8 或 rel32
+    BranchKind kind = info.branch;
+    if (kind == BranchKind::RETURN) {
+        return size + (info.name == "ud2" ? 2 : ops.empty() ? 1 : 3);
+    }
+    if (kind != BranchKind::NONE && !ops.empty() && ops[0].kind == OperandKind::TARGET) {
+        if (kind == BranchKind::CALL) {
+            return size + 5;
+        }
+        return size + (nearBranch && info.nearBranch ? info.nearBranch : info.shortBranch);
+    }
+    if (ops.empty()) {
+        return size + info.implicitSize;
+    }
+
+    // 内存操作数的 SIB 与位移：base/index 决定是否需要 SIB，位移按 0/1/4 字节
+    auto addressBytes = [this](const Operand& op) {
+        bool rip = op.base == kRipRegister;
+        unsigned dispBytes = 4;
+        if (!rip && op.hasBase() && !op.symbolic) {
+            int64_t value = operandValue(op);
+            dispBytes = value == 0 && (op.base & 7) != 5 ? 0 : fitsInt8(value) ? 1 : 4;
+        }
+        bool sib = !rip && (op.hasIndex() || !op.hasBase() || (op.base & 7) == 4);
+        return dispBytes + (sib ? 1u : 0u);
+    };
+    auto extendedAddress = [](const Operand& op) {
+        return (op.hasBase() && op.base >= 8 && op.base != kRipRegister) ||
+               (op.hasIndex() && op.index >= 8);
+    };
+
+    // 向量指令：操作码与 ModRM 之外只有 imm8。位宽只来自通用寄存器（movq %rax, %xmm0 的
+    // REX.W），AT&T 后缀与内存的 PTR 标注不影响编码。VEX 需要 W、X/B 或 0F38/0F3A 时为
+    // 3 字节；ModRM.rm 是内存操作数，否则是 AT&T 顺序的第一个寄存器
+    bool vectorForm = info.vector || info.vex;
+    for (const Operand& op : ops) {
+        vectorForm = vectorForm || op.kind == OperandKind::VECTOR_REGISTER;
+    }
+    if (vectorForm) {
+        bool wide = info.vectorWide;
+        bool rex = false;
+        bool mmx = false;
+        bool evex = false;
+        const Operand* rm = nullptr;
+        const Operand* dest = nullptr;      // AT&T 顺序的最后一个操作数
+        unsigned body = 2;      // 操作码与 ModRM
+        for (size_t k = 0; k < ops.size(); ++k) {
+            const Operand& op = ops[instr.intelSyntax ? ops.size() - 1 - k : k];
+            size += op.segment ? 1 : 0;
+            switch (op.kind) {
+            case OperandKind::REGISTER:
+                wide = wide || op.width() == 64;
+                rex = rex || op.base >= 8;
+                break;
+            case OperandKind::VECTOR_REGISTER:
+                mmx = mmx || op.width() == 64;
+                evex = evex || op.width() == 512 || op.base >= 16;
+                rex = rex || op.base >= 8;
+                break;
+            case OperandKind::MEMORY:
+                rex = rex || extendedAddress(op);
+                body += addressBytes(op);
+                break;
+            case OperandKind::IMMEDIATE:
+                body += 1;
+                continue;
+            default:
+                break;
+            }
+            if (op.kind == OperandKind::MEMORY || !rm) {
+                rm = &op;
+            }
+            dest = &op;
+        }
+        if (evex) {
+            return size + 4 + body;
+        }
+        if (info.vex) {
+            bool extended = false;
+            if (rm && rm->kind == OperandKind::MEMORY) {
+                extended = extendedAddress(*rm);
+            } else if (rm && rm->base >= 8 && rm->base != kNoRegister) {
+                // 向量寄存器间的 mov：汇编器在目的寄存器低于 8 时换用另一方向的操作码
+                extended = !(info.vexMove && ops.size() == 2 && dest->base < 8 &&
+                             rm->kind == OperandKind::VECTOR_REGISTER &&
+                             dest->kind == OperandKind::VECTOR_REGISTER);
+            }
+            return size + (info.threeByteMap || wide || extended ? 3 : 2) + body;
+        }
+        return size + (info.mandatoryPrefix && !mmx ? 1 : 0) + (rex || wide ? 1 : 0) +
+               (info.threeByteMap ? 2 : 1) + body;
+    }
+
+    // [66] [REX] 操作码 ModRM [SIB] [位移] [立即数]
+    int width = 0;
+    bool rex = false;
+    bool memory = false;
+    const Operand* immediate = nullptr;
+    for (const Operand& op : ops) {
+        size += op.segment ? 1 : 0;
+        switch (op.kind) {
+        case OperandKind::REGISTER:
+            rex |= op.base >= 8 || op.byteRex;
+            width = std::max(width, op.width());
+            break;
+        case OperandKind::IMMEDIATE:
+            immediate = &op;
+            break;
+        case OperandKind::MEMORY:
+            memory = true;
+            rex |= extendedAddress(op);
+            size += addressBytes(op);
+            if (op.width() <= 64) {
+                width = std::max(width, op.width());    // Intel 的 PTR 标注
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    if (width == 0 && !instr.intelSyntax) {
+        width = static_cast<int>(info.suffixWidth);     // AT&T 助记符后缀给出内存操作的位宽
+    }
+    if (width == 0) {
+        width = 32;
+    }
+
+    bool stackDefault = info.pushPop || kind != BranchKind::NONE;  // 默认 64 位操作数
+    if (rex || (width == 64 && !stackDefault && !info.x87)) {
+        size += 1;
+    }
+    if (width == 16 && !info.x87) {
+        size += 1;
+    }
+
+    // 立即数：8 位操作、移位等为 imm8，ALU/imul/push 的小常量可符号扩展为 imm8
+    unsigned immediateBytes = 0;
+    if (immediate) {
+        int64_t value = operandValue(*immediate);
+        if (width == 32 && value >= 0x80000000LL && value <= 0xFFFFFFFFLL) {
+            value -= 0x100000000LL;
+        }
+        if (width == 8 || info.shortImmediate ||
+            (info.signExtendedImmediate && !immediate->symbolic && fitsInt8(value))) {
+            immediateBytes = 1;
+        } else {
+            immediateBytes = width == 16 ? 2 : 4;
+        }
+    }
+
+    // push/pop 寄存器、push 立即数（6A ib / 68 id）与 mov 立即数到寄存器没有 ModRM
+    if (info.pushPop && !memory) {
+        return size + 1 + immediateBytes;
+    }
+    if (info.movImmediate && immediate && !memory) {
+        if (info.movabs) {
+            return size + 1 + 8;
+        }
+        return size + 1 + (width == 8 ? 1 : width == 16 ? 2 : 4) + (width == 64 ? 1 : 0);
+    }
+
+    // ALU 与 test 对 al/ax/eax/rax 的立即数形式（3C ib、3D id、A9 id 等）没有 ModRM，
+    // 汇编器在 8 位操作或立即数放不下 imm8 时选用
+    if (info.accumulator && immediate && ops.size() == 2 && (width == 8 || immediateBytes > 1)) {
+        const Operand& other = ops[immediate == &ops[0] ? 1 : 0];
+        if (other.kind == OperandKind::REGISTER && other.base == 0 && !other.highByte) {
+            return size + 1 + immediateBytes;
+        }
+    }
+
+    // xchg 寄存器与 ax/eax/rax 为 90+r；xchg %rax, %rax 就是 nop，xchg %eax, %eax 要清零
+    // 高 32 位，仍为 87 /r
+    if (info.exchange && ops.size() == 2 && width > 8 && ops[0].kind == OperandKind::REGISTER &&
+        ops[1].kind == OperandKind::REGISTER && (ops[0].base == 0 || ops[1].base == 0)) {
+        if (ops[0].base != ops[1].base) {
+            return size + 1;
+        }
+        if (width == 64) {
+            return static_cast<unsigned>(std::bitset<8>(instr.prefixes).count()) + 1;
+        }
+    }
+
+    unsigned opcodeBytes = info.opcodeBytes;
+    if (info.imul && ops.size() == 2 && !immediate) {
+        opcodeBytes = 2;
+    }
+    if (info.movsx && ops.size() == 2 && ops[instr.intelSyntax ? 1 : 0].width() == 32) {
+        opcodeBytes = 1;
+    }
+    return size + opcodeBytes + 1 + immediateBytes;     // 操作码、ModRM 与立即数
+}
+
+AssemblyParser::BranchKind AssemblyParser::branchKind(const Instruction& instr) {
+    return OpcodeTable::instance().info(instr.opcode).branch;
+}
+
+void AssemblyParser::buildCFG(const std::vector<std::pair<uint32_t, SymbolId>>& labelOrder) {
+    m_cfg = ControlFlowGraph();
+    const size_t count = m_instructions.size();
+
+    // 块首：1 = 普通块首，2 = 函数边界（不能顺序落入）
+    std::vector<uint8_t> leader(count + 1, 0);
+    std::vector<SymbolId> leadLabel(count + 1, kNoSymbol);
+    leader[0] = 1;
+    for (const auto& [index, label] : labelOrder) {
+        leader[index] = std::max<uint8_t>(leader[index], 1);
+        if (leadLabel[index] == kNoSymbol) {
+            leadLabel[index] = label;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        BranchKind kind = branchKind(m_instructions[i]);
+        if (kind != BranchKind::NONE && kind != BranchKind::CALL) {
+            leader[i + 1] = std::max<uint8_t>(leader[i + 1], 1);
+        }
+    }
+    for (const auto& function : m_functionBounds) {
+        leader[function.firstInstruction] = 2;
+        leader[function.endInstruction] = 2;
+    }
+
+    // 切分基本块
+    std::vector<uint32_t> blockOf(count, 0);
+    size_t nextFunction = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (leader[i] || m_cfg.blocks.empty()) {
+            ControlFlowGraph::Block block;
+            block.firstInstruction = static_cast<uint32_t>(i);
+            block.label = leadLabel[i];
+            while (nextFunction < m_functionBounds.size() &&
+                   m_functionBounds[nextFunction].endInstruction <= i) {
+                ++nextFunction;
+            }
+            if (nextFunction < m_functionBounds.size() &&
+                m_functionBounds[nextFunction].firstInstruction <= i) {
+                block.function = static_cast<int>(nextFunction);
+            }
+            m_cfg.blocks.push_back(block);
+        }
+        m_cfg.blocks.back().endInstruction = static_cast<uint32_t>(i + 1);
+        blockOf[i] = static_cast<uint32_t>(m_cfg.blocks.size() - 1);
+    }
+
+    // 跳转目标所在的块；间接跳转、函数外的符号（尾调用）返回 -1
+    auto targetBlock = [&](const ControlFlowGraph::Block& block, const Instruction& instr) {
+        if (instr.operandCount == 0 || m_operands[instr.firstOperand].kind != OperandKind::TARGET) {
+            return -1L;
+        }
+        SymbolId symbol = operandSymbol(m_operands[instr.firstOperand]);
+        if (symbol >= m_labelTargets.size()) {
+            return -1L;
+        }
+        uint32_t index = m_labelTargets[symbol];
+        if (index >= count || m_cfg.blocks[blockOf[index]].function != block.function) {
+            return -1L;
+        }
+        return static_cast<long>(blockOf[index]);
+    };
+
+    // 后继：每个块至多两个，按块顺序直接写入 CSR
+    const size_t blockCount = m_cfg.blocks.size();
+    m_cfg.succOffsets.assign(blockCount + 1, 0);
+    m_cfg.successors.reserve(blockCount * 2);
+    for (size_t b = 0; b < blockCount; ++b) {
+        ControlFlowGraph::Block& block = m_cfg.blocks[b];
+        m_cfg.succOffsets[b] = static_cast<uint32_t>(m_cfg.successors.size());
+        const Instruction& last = m_instructions[block.endInstruction - 1];
+        bool fallsThrough = b + 1 < blockCount && leader[block.endInstruction] != 2;
+
+        BranchKind kind = branchKind(last);
+        if (kind == BranchKind::JUMP || kind == BranchKind::CONDITIONAL) {
+            long target = targetBlock(block, last);
+            if (target >= 0) {
+                m_cfg.successors.push_back(static_cast<uint32_t>(target));
+            } else {
+                block.unknownSuccessors = true;
+            }
+        }
+        if (kind == BranchKind::CONDITIONAL || kind == BranchKind::NONE ||
+            kind == BranchKind::CALL) {
+            if (fallsThrough) {
+                if (m_cfg.successors.size() == m_cfg.succOffsets[b] ||
+                    m_cfg.successors.back() != b + 1) {
+                    m_cfg.successors.push_back(static_cast<uint32_t>(b + 1));
+                }
+            } else if (kind == BranchKind::CONDITIONAL) {
+                block.unknownSuccessors = true;
+            }
+        }
+    }
+    m_cfg.succOffsets[blockCount] = static_cast<uint32_t>(m_cfg.successors.size());
+    m_cfg.blocks.shrink_to_fit();
+    m_cfg.successors.shrink_to_fit();
+
+    // 前驱：计数、前缀和、回填
+    m_cfg.predOffsets.assign(blockCount + 1, 0);
+    for (uint32_t succ : m_cfg.successors) {
+        ++m_cfg.predOffsets[succ + 1];
+    }
+    for (size_t b = 0; b < blockCount; ++b) {
+        m_cfg.predOffsets[b + 1] += m_cfg.predOffsets[b];
+    }
+    m_cfg.predecessors.resize(m_cfg.successors.size());
+    std::vector<uint32_t> fill(m_cfg.predOffsets.begin(), m_cfg.predOffsets.end() - 1);
+    for (size_t b = 0; b < blockCount; ++b) {
+        for (uint32_t succ : m_cfg.successorsOf(b)) {
+            m_cfg.predecessors[fill[succ]++] = static_cast<uint32_t>(b);
+        }
+    }
+}
+
+int AssemblyParser::registerIndex(const std::string& name, int* width) {
+    static const std::unordered_map<std::string, std::pair<int, int>> registers = [] {
+        std::unordered_map<std::string, std::pair<int, int>> table;
+        const int widths[4] = {8, 16, 32, 64};
+        for (int row = 0; row < 4; ++row) {
+            for (int index = 0; index < 16; ++index) {
+                table[kRegisterNames[row][index]] = {index, widths[row]};
+            }
+        }
+        table["ah"] = {0, 8};
+        table["ch"] = {1, 8};
+        table["dh"] = {2, 8};
+        table["bh"] = {3, 8};
+        return table;
+    }();
+
+    std::string reg = lowered(!name.empty() && name[0] == '%' ? name.substr(1) : name);
+    auto it = registers.find(reg);
+    if (it == registers.end()) {
+        return -1;
+    }
+    if (width) {
+        *width = it->second.second;
+    }
+    return it->second.first;
+}
+
+std::string AssemblyParser::registerName(int index, int width) {
+    int row = width == 8 ? 0 : width == 16 ? 1 : width == 32 ? 2 : 3;
+    return kRegisterNames[row][index & 15];
+}
+
+AssemblyParser::RegisterEffects AssemblyParser::registerEffects(const Instruction& instr) const {
+    constexpr RegisterMask rax = 1u << 0, rcx = 1u << 1, rdx = 1u << 2, rsi = 1u << 6,
+                           rdi = 1u << 7, rsp = 1u << 4, rbp = 1u << 5;
+
+    RegisterEffects effects;
+    const OpcodeInfo& info = OpcodeTable::instance().info(instr.opcode);
+    const OperandRange ops = operands(instr);
+    const bool intel = instr.intelSyntax;
+
+    // 类别：精确匹配、串操作、去掉 AT&T 的 b/w/l/q 后缀
+    int regOp = info.regOp;
+    bool stringOp = regOp < 0 && ops.empty() && info.stringOp;
+    if (regOp < 0 && !stringOp) {
+        regOp = info.suffixedRegOp;
+    }
+
+    RegisterMask all = 0;
+    for (const Operand& op : ops) {
+        all |= operandRegisters(op);
+    }
+
+    if (stringOp) {
+        effects.uses = rax | rcx | rsi | rdi;
+        return effects;
+    }
+    if (info.conditionalWrite) {
+        effects.uses = all | kFlagsMask;   // 条件改写：目的只算读取
+        return effects;
+    }
+    BranchKind branch = info.branch;
+    if (branch == BranchKind::CONDITIONAL) {
+        effects.uses = all | kFlagsMask | (info.countsRcx ? rcx : 0);
+        return effects;
+    }
+    if (branch == BranchKind::JUMP) {
+        effects.uses = all;
+        return effects;
+    }
+    if (branch == BranchKind::CALL || (branch == BranchKind::RETURN && regOp < 0)) {
+        effects.uses = kAllRegisters;
+        return effects;
+    }
+    if (regOp < 0) {
+        if (info.noEffect) {
+            return effects;
+        }
+        if (info.vector) {
+            effects.uses = all;
+            effects.defs = info.vectorFlags ? kFlagsMask : 0;
+            return effects;
+        }
+        effects.uses = kAllRegisters;      // 不认识的指令
+        return effects;
+    }
+
+    // 目的操作数：AT&T 为最后一个，Intel 为第一个
+    const size_t destPos = intel ? 0 : ops.size() - 1;
+    RegisterMask sources = 0;
+    for (size_t k = 0; k < ops.size(); ++k) {
+        if (k != destPos) {
+            sources |= operandRegisters(ops[k]);
+        }
+    }
+    int destWidth = 0;
+    int dest = -1;
+    if (!ops.empty() && ops[destPos].kind == OperandKind::REGISTER) {
+        dest = static_cast<int>(ops[destPos].base);
+        destWidth = ops[destPos].width();
+    }
+    RegisterMask destBit = dest >= 0 ? 1u << dest : 0;
+    RegisterMask destAddress = dest < 0 && !ops.empty() ? operandRegisters(ops[destPos]) : 0;
+    bool fullDest = dest >= 0 && destWidth >= 32;   // 32 位写入会清零高 32 位
+
+    auto writeDest = [&](bool readsDest) {
+        effects.uses |= sources | destAddress;
+        if (readsDest || !fullDest) {
+            effects.uses |= destBit;
+        }
+        if (fullDest) {
+            effects.defs |= destBit;
+        }
+    };
+
+    switch (static_cast<RegOp>(regOp)) {
+    case RegOp::MOV:
+        writeDest(false);
+        break;
+    case RegOp::MOV_FLAGS:
+        writeDest(false);
+        effects.defs |= kFlagsMask;
+        break;
+    case RegOp::ALU:
+    case RegOp::ALU_CARRY: {
+        // xor/sub 同一寄存器是清零惯用法，不读取原值
+        bool zeroIdiom = info.zeroIdiom && ops.size() == 2 && fullDest &&
+                         ops[0].kind == OperandKind::REGISTER &&
+                         ops[1].kind == OperandKind::REGISTER && ops[0].base == ops[1].base;
+        writeDest(!zeroIdiom);
+        if (zeroIdiom) {
+            effects.uses &= ~destBit;
+        }
+        effects.defs |= kFlagsMask;
+        if (static_cast<RegOp>(regOp) == RegOp::ALU_CARRY) {
+            effects.uses |= destBit | kFlagsMask;
+        }
+        break;
+    }
+    case RegOp::COMPARE:
+        effects.uses = all;
+        effects.defs = kFlagsMask;
+        break;
+    case RegOp::INC_DEC:
+    case RegOp::NOT:
+    case RegOp::ROTATE:
+    case RegOp::BIT_MODIFY:
+        writeDest(true);
+        break;
+    case RegOp::NEG:
+        writeDest(true);
+        effects.defs |= kFlagsMask;
+        break;
+    case RegOp::SHIFT: {
+        writeDest(true);
+        bool variable = ops.size() >= 2 &&
+                        (intel ? ops.back() : ops.front()).kind == OperandKind::REGISTER &&
+                        (intel ? ops.back() : ops.front()).base == 1;
+        if (!variable) {
+            effects.defs |= kFlagsMask;
+        }
+        break;
+    }
+    case RegOp::ROTATE_CARRY:
+        writeDest(true);
+        effects.uses |= kFlagsMask;
+        break;
+    case RegOp::IMUL:
+        if (ops.size() == 1) {
+            effects.uses = all | rax | rdx;
+        } else {
+            writeDest(ops.size() == 2);
+        }
+        effects.defs |= kFlagsMask;
+        break;
+    case RegOp::MUL_DIV:
+        effects.uses = all | rax | rdx;
+        effects.defs = kFlagsMask;
+        break;
+    case RegOp::BIT_SCAN:
+        writeDest(true);
+        effects.defs |= kFlagsMask;
+        break;
+    case RegOp::BIT_COUNT:
+        writeDest(false);
+        effects.defs |= kFlagsMask;
+        break;
+    case RegOp::BIT_TEST:
+    case RegOp::EXCHANGE:
+        effects.uses = all;
+        break;
+    case RegOp::EXCHANGE_FLAGS:
+        effects.uses = all | rax;
+        effects.defs = kFlagsMask;
+        break;
+    case RegOp::SIGN_EXTEND_RAX:
+        effects.uses = rax;
+        effects.defs = info.byteSignExtend ? 0 : rax;
+        break;
+    case RegOp::SIGN_EXTEND_RDX:
+        effects.uses = rax | (info.wordSignExtend ? rdx : 0);
+        effects.defs = info.wordSignExtend ? 0 : rdx;
+        break;
+    case RegOp::PUSH:
+        effects.uses = all | rsp;
+        break;
+    case RegOp::POP:
+        effects.uses = rsp | destAddress;
+        effects.defs = fullDest || destWidth == 64 ? destBit : 0;
+        break;
+    case RegOp::PUSHF:
+        effects.uses = rsp | kFlagsMask;
+        break;
+    case RegOp::POPF:
+        effects.uses = rsp;
+        effects.defs = kFlagsMask;
+        break;
+    case RegOp::LEAVE:
+        effects.uses = rbp;
+        effects.defs = rsp | rbp;
+        break;
+    case RegOp::READ_FLAGS:
+        effects.uses = kFlagsMask;
+        break;
+    case RegOp::NO_EFFECT:
+        break;
+    }
+    return effects;
+}
+
+std::vector<AssemblyParser::RegisterMask> AssemblyParser::computeLiveness() const {
+    const size_t blockCount = m_cfg.blocks.size();
+    std::vector<RegisterEffects> effects(m_instructions.size());
+    for (size_t i = 0; i < m_instructions.size(); ++i) {
+        effects[i] = registerEffects(m_instructions[i]);
+    }
+
+    // 每个块向上暴露的读取、块内改写，以及出口处固定活跃的寄存器
+    std::vector<RegisterMask> blockUses(blockCount, 0);
+    std::vector<RegisterMask> blockDefs(blockCount, 0);
+    std::vector<RegisterMask> exitLive(blockCount, 0);
+    for (size_t b = 0; b < blockCount; ++b) {
+        const ControlFlowGraph::Block& block = m_cfg.blocks[b];
+        for (size_t i = block.endInstruction; i-- > block.firstInstruction;) {
+            blockUses[b] = effects[i].uses | (blockUses[b] & ~effects[i].defs);
+            blockDefs[b] |= effects[i].defs;
+        }
+        // 去向未知，或没有终结指令却没有后继（落到函数之外）
+        BranchKind kind = branchKind(m_instructions[block.endInstruction - 1]);
+        if (block.unknownSuccessors ||
+            (m_cfg.successorsOf(b).size() == 0 &&
+             (kind == BranchKind::NONE || kind == BranchKind::CALL))) {
+            exitLive[b] = kAllRegisters;
+        }
+    }
+
+    // 逆序工作表迭代到不动点
+    std::vector<RegisterMask> liveIn(blockCount, 0);
+    std::vector<uint32_t> worklist(blockCount);
+    std::vector<uint8_t> queued(blockCount, 1);
+    for (size_t b = 0; b < blockCount; ++b) {
+        worklist[b] = static_cast<uint32_t>(b);
+    }
+    auto liveOut = [&](size_t b) {
+        RegisterMask out = exitLive[b];
+        for (uint32_t succ : m_cfg.successorsOf(b)) {
+            out |= liveIn[succ];
+        }
+        return out;
+    };
+    while (!worklist.empty()) {
+        uint32_t b = worklist.back();
+        worklist.pop_back();
+        queued[b] = 0;
+        RegisterMask in = blockUses[b] | (liveOut(b) & ~blockDefs[b]);
+        if (in != liveIn[b]) {
+            liveIn[b] = in;
+            for (uint32_t pred : m_cfg.predecessorsOf(b)) {
+                if (!queued[pred]) {
+                    queued[pred] = 1;
+                    worklist.push_back(pred);
+                }
+            }
+        }
+    }
+
+    std::vector<RegisterMask> live(m_instructions.size(), kAllRegisters);
+    for (size_t b = 0; b < blockCount; ++b) {
+        const ControlFlowGraph::Block& block = m_cfg.blocks[b];
+        RegisterMask current = liveOut(b);
+        for (size_t i = block.endInstruction; i-- > block.firstInstruction;) {
+            current = effects[i].uses | (current & ~effects[i].defs);
+            live[i] = current;
+        }
+    }
+    return live;
+}
+
+AssemblyParser::IndexRange AssemblyParser::instructionsWithOpcode(Opcode opcode) const {
+    auto it = m_opcodeSlots.find(opcode);
+    if (it == m_opcodeSlots.end()) {
+        return {nullptr, nullptr};
+    }
+    const uint32_t* data = m_opcodeInstructions.data();
+    return {data + m_opcodeOffsets[it->second], data + m_opcodeOffsets[it->second + 1]};
+}
+
+void AssemblyParser::buildOpcodeIndex() {
+    // 与 CFG 的前驱一样：计数、前缀和、回填
+    m_opcodeSlots.clear();
+    m_opcodeOffsets.assign(1, 0);
+    std::vector<uint32_t> slotOf(m_instructions.size());
+    for (size_t i = 0; i < m_instructions.size(); ++i) {
+        auto [it, inserted] = m_opcodeSlots.emplace(
+            m_instructions[i].opcode, static_cast<uint32_t>(m_opcodeOffsets.size() - 1));
+        if (inserted) {
+            m_opcodeOffsets.push_back(0);
+        }
+        slotOf[i] = it->second;
+        ++m_opcodeOffsets[it->second + 1];
+    }
+    for (size_t slot = 1; slot < m_opcodeOffsets.size(); ++slot) {
+        m_opcodeOffsets[slot] += m_opcodeOffsets[slot - 1];
+    }
+    m_opcodeInstructions.resize(m_instructions.size());
+    std::vector<uint32_t> fill(m_opcodeOffsets.begin(), m_opcodeOffsets.end() - 1);
+    for (size_t i = 0; i < m_instructions.size(); ++i) {
+        m_opcodeInstructions[fill[slotOf[i]]++] = static_cast<uint32_t>(i);
+    }
+}
+
 std::vector<AssemblyParser::Instruction> AssemblyParser::findInstructions(
-    const std::string& mnemonic) {
+    const std::string& mnemonic) const {
 
     std::vector<Instruction> result;
+    Opcode opcode = findOpcode(mnemonic);
+    if (opcode == kNoOpcode) {
+        return result;
+    }
 
-    for (const auto& instr : m_instructions) {
-        if (instr.mnemonic == mnemonic) {
-            result.push_back(instr);
-        }
+    IndexRange matches = instructionsWithOpcode(opcode);
+    result.reserve(matches.size());
+    for (uint32_t index : matches) {
+        result.push_back(m_instructions[index]);
     }
 
     return result;
@@ -313,13 +2936,27 @@ std::vector<AssemblyParser::Instruction> AssemblyParser::findInstructions(
 
 std::vector<AssemblyParser::BasicBlock> AssemblyParser::getBasicBlocks() {
     std::vector<BasicBlock> blocks;
+    blocks.reserve(m_cfg.blocks.size());
 
-    // 简化实现：将所有指令作为一个基本块
-    BasicBlock block;
-    block.label = "entry";
-    block.instructions = m_instructions;
+    auto blockName = [this](size_t b) {
+        SymbolId label = m_cfg.blocks[b].label;
+        if (label != kNoSymbol) {
+            return std::string(symbolName(label));
+        }
+        return b == 0 ? std::string("entry") : "bb" + std::to_string(b);
+    };
 
-    blocks.push_back(block);
+    for (size_t b = 0; b < m_cfg.blocks.size(); ++b) {
+        const ControlFlowGraph::Block& cfgBlock = m_cfg.blocks[b];
+        BasicBlock block;
+        block.label = blockName(b);
+        block.instructions.assign(m_instructions.begin() + cfgBlock.firstInstruction,
+                                  m_instructions.begin() + cfgBlock.endInstruction);
+        for (uint32_t succ : m_cfg.successorsOf(b)) {
+            block.successors.push_back(blockName(succ));
+        }
+        blocks.push_back(std::move(block));
+    }
 
     return blocks;
 }
@@ -328,16 +2965,22 @@ std::vector<size_t> AssemblyParser::findJumpTargets() {
     std::vector<size_t> targets;
 
     for (const auto& instr : m_instructions) {
-        if (isJumpInstruction(instr.mnemonic)) {
-            // 尝试从操作数中提取目标地址
-            if (!instr.operands.empty()) {
-                std::string target = instr.operands[0];
-
-                // 如果是标签，查找对应地址
-                if (m_labels.find(target) != m_labels.end()) {
-                    targets.push_back(m_labels[target]);
-                }
-            }
+        if (branchKind(instr) == BranchKind::NONE || instr.operandCount == 0) {
+            continue;
+        }
+
+        // 直接跳转的目标是标签时，取标签处的地址
+        const Operand& target = m_operands[instr.firstOperand];
+        SymbolId symbol = operandSymbol(target);
+        if (target.kind != OperandKind::TARGET || symbol >= m_labelTargets.size() ||
+            m_labelTargets[symbol] == UINT32_MAX) {
+            continue;
+        }
+        uint32_t index = m_labelTargets[symbol];
+        if (index < m_instructions.size()) {
+            targets.push_back(m_instructions[index].address);
+        } else {
+            targets.push_back(m_instructions.back().address + m_instructions.back().size);
         }
     }
 
@@ -345,52 +2988,265 @@ std::vector<size_t> AssemblyParser::findJumpTargets() {
 }
 
 std::vector<AssemblyParser::FunctionBoundary> AssemblyParser::findFunctionBoundaries() {
-    std::vector<FunctionBoundary> boundaries;
+    return m_functionBounds;
+}
+
+AssemblyParser::Instruction AssemblyParser::parseInstruction(const std::string& line,
+                                                             bool intelSyntax) {
+    Instruction instr;
+    instr.intelSyntax = intelSyntax;
+
+    // 去掉行尾注释
+    std::string text = trimAsm(line.substr(0, line.find('#')));
+
+    // 助记符，rep/lock 等前缀记为位
+    std::string mnemonic;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find_first_of(" \t", pos);
+        std::string word = text.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        pos = end == std::string::npos ? text.size() : text.find_first_not_of(" \t", end);
+        if (pos == std::string::npos) {
+            pos = text.size();
+        }
+        uint8_t prefix = instructionPrefix(word);
+        if (prefix && pos < text.size()) {
+            instr.prefixes |= prefix;
+            continue;
+        }
+        mnemonic = word;
+        break;
+    }
+    instr.opcode = internOpcode(mnemonic);
+
+    // 解析操作数：按不在括号内的逗号切分，之后只保留描述符
+    std::vector<std::string> texts;
+    std::string operand;
+    int depth = 0;
+    for (; pos < text.size(); ++pos) {
+        char c = text[pos];
+        if (c == '(' || c == '[') {
+            ++depth;
+        } else if (c == ')' || c == ']') {
+            --depth;
+        } else if (c == ',' && depth == 0) {
+            texts.push_back(trimAsm(operand));
+            operand.clear();
+            continue;
+        }
+        operand += c;
+    }
+    operand = trimAsm(operand);
+    if (!operand.empty()) {
+        texts.push_back(operand);
+    }
 
-    // 简化实现：查找标签作为函数边界
-    for (const auto& [label, address] : m_labels) {
-        FunctionBoundary boundary;
-        boundary.name = label;
-        boundary.startAddr = address;
-        boundary.endAddr = address + 100; // 简化
+    const size_t maxOperands = 7;
+    instr.firstOperand = static_cast<uint32_t>(m_operands.size());
+    instr.operandCount = static_cast<uint8_t>(std::min(texts.size(), maxOperands));
+    for (size_t k = 0; k < instr.operandCount; ++k) {
+        m_operands.push_back(parseOperand(texts[k], intelSyntax));
+    }
+    if (texts.size() > maxOperands) {
+        m_operands.back().kind = OperandKind::UNKNOWN;
+    }
 
-        boundaries.push_back(boundary);
+    // 跳转/调用的第一个操作数是不带寄存器的地址时为直接目标
+    if (branchKind(instr) != BranchKind::NONE && instr.operandCount > 0) {
+        Operand& target = m_operands[instr.firstOperand];
+        if (target.kind == OperandKind::MEMORY && !target.hasBase() && !target.hasIndex() &&
+            !target.indirect && target.segment == 0 && target.widthLog == 0) {
+            target.kind = OperandKind::TARGET;
+        }
     }
 
-    return boundaries;
+    return instr;
 }
 
-AssemblyParser::Instruction AssemblyParser::parseInstruction(const std::string& line) {
-    Instruction instr;
+AssemblyParser::Operand AssemblyParser::parseOperand(std::string text, bool intelSyntax) {
+    Operand operand;
+    if (!text.empty() && text[0] == '*') {
+        operand.indirect = 1;
+        text = trimAsm(text.substr(1));
+    }
 
-    std::istringstream iss(line);
-    iss >> instr.mnemonic;
+    // 段前缀 %fs:/fs:
+    auto takeSegment = [&]() {
+        size_t colon = text.find(':');
+        if (colon == std::string::npos || colon == 0 || colon > 3) {
+            return;
+        }
+        std::string name = lowered(text.substr(text[0] == '%' ? 1 : 0, colon - (text[0] == '%' ? 1 : 0)));
+        unsigned segment = segmentIndex(name);
+        if (segment) {
+            operand.segment = segment;
+            text = trimAsm(text.substr(colon + 1));
+        }
+    };
+    auto unknown = [&operand]() {
+        operand.kind = OperandKind::UNKNOWN;
+        return operand;
+    };
 
-    // 解析操作数
-    std::string operand;
-    while (iss >> operand) {
-        // 移除逗号
-        if (!operand.empty() && operand.back() == ',') {
-            operand.pop_back();
+    if (!intelSyntax) {
+        takeSegment();
+        if (text.empty()) {
+            return unknown();
+        }
+        if (text[0] == '$') {
+            operand.kind = OperandKind::IMMEDIATE;
+            setOperandValue(operand, text.substr(1));
+            return operand;
+        }
+        if (text[0] == '%') {
+            return setRegister(operand, text.substr(1)) ? operand : unknown();
+        }
+
+        // disp(base,index,scale)，没有括号时为绝对地址或跳转目标
+        operand.kind = OperandKind::MEMORY;
+        size_t open = text.find('(');
+        if (open == std::string::npos) {
+            setOperandValue(operand, text);
+            return operand;
+        }
+        size_t close = text.find(')', open);
+        if (close == std::string::npos) {
+            return unknown();
+        }
+        setOperandValue(operand, text.substr(0, open));
+        std::istringstream parts(text.substr(open + 1, close - open - 1));
+        std::string part;
+        for (size_t i = 0; std::getline(parts, part, ','); ++i) {
+            part = trimAsm(part);
+            if (part.empty() && i < 2) {
+                continue;
+            }
+            int reg = i < 2 ? addressRegister(part) : scaleLog(part);
+            if (reg < 0 || i > 2) {
+                return unknown();
+            }
+            if (i == 0) {
+                operand.base = static_cast<unsigned>(reg);
+            } else if (i == 1) {
+                operand.index = static_cast<unsigned>(reg);
+            } else {
+                operand.scale = static_cast<unsigned>(reg);
+            }
         }
-        instr.operands.push_back(operand);
+        return operand;
     }
 
-    return instr;
-}
+    // Intel：BYTE/WORD/DWORD/QWORD/XMMWORD... PTR 标注位宽
+    size_t space = text.find(' ');
+    if (space != std::string::npos) {
+        std::string keyword = text.substr(0, space);
+        std::string rest = trimAsm(text.substr(space + 1));
+        std::transform(keyword.begin(), keyword.end(), keyword.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+        if ((rest.compare(0, 3, "PTR") == 0 || rest.compare(0, 3, "ptr") == 0) &&
+            (rest.size() == 3 || rest[3] == ' ')) {
+            static const std::unordered_map<std::string, int> widths = {
+                {"BYTE", 8}, {"WORD", 16}, {"DWORD", 32}, {"QWORD", 64},
+                {"XMMWORD", 128}, {"YMMWORD", 256}, {"ZMMWORD", 512},
+            };
+            auto it = widths.find(keyword);
+            operand.widthLog = it != widths.end() ? widthLog(it->second) : 0;
+            text = trimAsm(rest.substr(3));
+        }
+    }
+    takeSegment();
+    if (text.empty()) {
+        return unknown();
+    }
 
-bool AssemblyParser::isLabel(const std::string& line) {
-    return line.find(':') != std::string::npos;
+    size_t open = text.find('[');
+    if (open == std::string::npos) {
+        if (setRegister(operand, text)) {
+            return operand;
+        }
+        long long number = 0;
+        if (operand.widthLog == 0 && operand.segment == 0 && parseInteger(text, number)) {
+            operand.kind = OperandKind::IMMEDIATE;
+            setOperandValue(operand, text);
+            return operand;
+        }
+        if (text.compare(0, 6, "OFFSET") == 0 || text.compare(0, 6, "offset") == 0) {
+            std::string symbol = trimAsm(text.substr(6));
+            if (symbol.compare(0, 5, "FLAT:") == 0) {
+                symbol = symbol.substr(5);
+            }
+            operand.kind = OperandKind::IMMEDIATE;
+            setOperandValue(operand, symbol);
+            return operand;
+        }
+        operand.kind = OperandKind::MEMORY;     // 绝对地址或跳转目标
+        setOperandValue(operand, text);
+        return operand;
+    }
+
+    // [base+index*scale+disp]，方括号前的符号与数字也算位移
+    size_t close = text.find(']', open);
+    if (close == std::string::npos) {
+        return unknown();
+    }
+    operand.kind = OperandKind::MEMORY;
+    std::string disp = trimAsm(text.substr(0, open));
+    std::string inner = text.substr(open + 1, close - open - 1);
+    size_t pos = 0;
+    while (pos < inner.size()) {
+        size_t next = inner.find_first_of("+-", pos + 1);
+        std::string term = trimAsm(inner.substr(pos, next == std::string::npos ? next : next - pos));
+        pos = next == std::string::npos ? inner.size() : next;
+        if (term.empty()) {
+            continue;
+        }
+        bool negative = term[0] == '-';
+        std::string bare = term[0] == '+' || negative ? trimAsm(term.substr(1)) : term;
+        size_t star = bare.find('*');
+        std::string reg = star == std::string::npos ? bare : trimAsm(bare.substr(0, star));
+        std::string factor = star == std::string::npos ? "1" : trimAsm(bare.substr(star + 1));
+        int index = addressRegister(reg);
+        if (index < 0 && star != std::string::npos && addressRegister(factor) >= 0) {
+            std::swap(reg, factor);     // scale*reg
+            index = addressRegister(reg);
+        }
+        if (index < 0 || negative) {
+            if (!disp.empty() && term[0] != '+' && term[0] != '-') {
+                disp += '+';
+            }
+            disp += term;
+        } else if (star == std::string::npos && !operand.hasBase()) {
+            operand.base = static_cast<unsigned>(index);
+        } else if (!operand.hasIndex() && scaleLog(factor) >= 0) {
+            operand.index = static_cast<unsigned>(index);
+            operand.scale = static_cast<unsigned>(scaleLog(factor));
+        } else {
+            return unknown();
+        }
+    }
+    setOperandValue(operand, disp);
+    return operand;
 }
 
-bool AssemblyParser::isJumpInstruction(const std::string& mnemonic) {
-    static const std::vector<std::string> jumpInstructions = {
-        "jmp", "je", "jne", "jz", "jnz", "jl", "jle", "jg", "jge",
-        "ja", "jae", "jb", "jbe", "call", "ret"
-    };
+void AssemblyParser::setOperandValue(Operand& operand, const std::string& text) {
+    std::string value = trimAsm(text);
+    long long number = 0;
+    if (value.empty()) {
+        operand.value = 0;
+    } else if (!parseInteger(value, number)) {
+        operand.symbolic = 1;
+        operand.value = static_cast<int32_t>(internSymbol(value));
+    } else if (number >= INT32_MIN && number <= INT32_MAX) {
+        operand.value = static_cast<int32_t>(number);
+    } else {
+        operand.wide = 1;
+        operand.value = static_cast<int32_t>(m_wideValues.size());
+        m_wideValues.push_back(number);
+    }
+}
 
-    return std::find(jumpInstructions.begin(), jumpInstructions.end(), mnemonic)
-           != jumpInstructions.end();
+bool AssemblyParser::isLabel(const std::string& line) {
+    return line.find(':') != std::string::npos;
 }
 
 // ============================================================================
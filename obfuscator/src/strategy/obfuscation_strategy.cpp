@@ -1,9 +1,15 @@
 #include "strategy/obfuscation_strategy.h"
 #include "utils/random_utils.h"
 #include "utils/logger.h"
+#include "parser/code_parser.h"
+#include "engine/obfuscation_engine.h"
 #include <sstream>
 #include <regex>
 #include <algorithm>
+#include <unordered_map>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 
 namespace obfuscator {
 
@@ -125,101 +131,319 @@ std::vector<std::string> JunkInstructionStrategy::generateJunkInstructions(int c
 // OpaquePredicateStrategy Implementation
 // ============================================================================
 
+namespace {
+
+// 正则匹配也会命中函数体内的 "else if (...) {" 等结构
+bool isControlKeyword(const std::string& name) {
+    static const char* keywords[] = {
+        "if", "else", "while", "for", "switch", "do", "return", "sizeof"
+    };
+    return std::find(std::begin(keywords), std::end(keywords), name) != std::end(keywords);
+}
+
+std::string hexWord(uint32_t v) {
+    std::stringstream ss;
+    ss << "0x" << std::hex << v << "u";
+    return ss.str();
+}
+
+// 读取数组声明 T name[N] = {...} 中的 N；[] 时为 0，N 不是整数字面量时返回 false
+bool declaredArraySize(const std::string& code, const DataArrayInfo& array, size_t& count) {
+    size_t open = code.find('[', array.declStart);
+    size_t close = code.find(']', open);
+    if (open == std::string::npos || close == std::string::npos || close > array.bodyStart ||
+        code.find('[', close) < code.rfind('=', array.bodyStart)) {
+        return false;
+    }
+
+    std::string size = code.substr(open + 1, close - open - 1);
+    size.erase(std::remove_if(size.begin(), size.end(),
+                              [](char c) { return std::isspace(static_cast<unsigned char>(c)); }),
+               size.end());
+    while (!size.empty() && std::strchr("uUlL", size.back())) {
+        size.pop_back();
+    }
+    count = 0;
+    if (size.empty()) {
+        return true;
+    }
+    char* end = nullptr;
+    unsigned long long value = std::strtoull(size.c_str(), &end, 0);
+    if (*end != '\0' || !std::isdigit(static_cast<unsigned char>(size[0]))) {
+        return false;
+    }
+    count = static_cast<size_t>(value);
+    return true;
+}
+
+// 匹配 pos 处的 OBF_RESOURCE_PLAIN ( name ) ;，成功时 end 为分号之后的位置
+bool matchPlainResource(const std::string& code, size_t pos, const std::string& name,
+                        size_t& end) {
+    auto skipSpace = [&](size_t p) {
+        p = code.find_first_not_of(" \t\r\n", p);
+        return (p == std::string::npos) ? code.size() : p;
+    };
+    size_t p = skipSpace(pos + std::strlen("OBF_RESOURCE_PLAIN"));
+    if (p >= code.size() || code[p] != '(') {
+        return false;
+    }
+    p = skipSpace(p + 1);
+    if (code.compare(p, name.size(), name) != 0) {
+        return false;
+    }
+    p = skipSpace(p + name.size());
+    if (p >= code.size() || code[p] != ')') {
+        return false;
+    }
+    p = skipSpace(p + 1);
+    if (p >= code.size() || code[p] != ';') {
+        return false;
+    }
+    end = p + 1;
+    return true;
+}
+
+uint32_t randomWord() {
+    auto& rng = RandomGenerator::getInstance();
+    return (static_cast<uint32_t>(rng.randomInt(0, 0xFFFF)) << 16) |
+           static_cast<uint32_t>(rng.randomInt(0, 0xFFFF));
+}
+
+// 谓词模板。周期数是 x86-64（-O2）上一次求值的延迟，包括从 L1 中的不变量表
+// 读取输入：在依赖链中循环求值 1e8 次，用 rdtsc 计时并减去空循环的开销
+struct PredicateTemplate {
+    const char* name;
+    int cycles;
+    bool aliasing;      // 需要 --pointer-aliasing
+};
+
+const PredicateTemplate kPredicates[] = {
+    {"xor_eq",    5,  false},   // (a ^ K1) == K2
+    {"rotate",    5,  false},   // rotl(a, R) == K
+    {"alias_ptr", 6,  true},    // alias[j] == &tbl[i]
+    {"add_pair",  8,  false},   // a + b == K
+    {"range",     8,  false},   // a - LO < SPAN
+    {"mask_pair", 9,  false},   // ((a ^ b) & M) == K
+    {"mul_hash",  10, false},   // (a * M) >> S == K
+    {"alias_val", 10, true},    // *alias[j] == tbl[i]
+};
+
+// 一次使用（测试寄存器中的谓词值并跳过冷调用）的开销
+constexpr int kUseCycles = 1;
+// 每个语句位置插入谓词使用的概率
+constexpr double kSiteProbability = 0.25;
+
+} // namespace
+
 bool OpaquePredicateStrategy::apply(const std::string& input, std::string& output) {
     LOG_INFO("Applying Opaque Predicate Strategy");
 
-    std::vector<std::string> lines;
-    std::stringstream ss(input);
-    std::string line;
-
-    while (std::getline(ss, line)) {
-        lines.push_back(line);
+    CodeParser parser;
+    if (!parser.parse(input)) {
+        output = input;
+        return true;
     }
 
-    std::stringstream result;
     auto& rng = RandomGenerator::getInstance();
+    m_id = rng.randomHexString(4);
+    for (size_t i = 0; i < kTableSize; ++i) {
+        // 值互不相同，"不相等"的谓词才能成立
+        do {
+            m_table[i] = randomWord();
+        } while (std::find(m_table, m_table + i, m_table[i]) != m_table + i);
+    }
+    m_aliasIndex[0] = rng.randomInt(0, kTableSize - 1);
+    m_aliasIndex[1] = rng.randomInt(0, kTableSize - 1);
 
-    for (size_t i = 0; i < lines.size(); ++i) {
-        const auto& currentLine = lines[i];
+    int budgetPerFunction = m_costBudget;
+    if (budgetPerFunction <= 0) {
+        budgetPerFunction = m_complexity == Complexity::LOW ? 8 :
+                            m_complexity == Complexity::HIGH ? 32 : 16;
+    }
 
-        // 在函数体的开始处插入不透明谓词
-        if (currentLine.find("{") != std::string::npos &&
-            i > 0 &&
-            lines[i-1].find("(") != std::string::npos) {
+    const std::string prefix = "obf_op_" + m_id + "_";
+    std::string result;
+    result.reserve(input.size() + input.size() / 4);
+    size_t cursor = 0;
+    int predicateCount = 0;
+    int useCount = 0;
 
-            result << currentLine << "\n";
+    for (const auto& func : parser.getFunctions()) {
+        if (isControlKeyword(func.name) || func.startPos < cursor || func.body.empty()) {
+            continue;
+        }
 
-            if (rng.randomBool(0.4)) {  // 40% 概率
-                result << generateOpaquePredicate(true) << "\n";
+        // 谓词在函数入口求值一次，循环内的使用只是测试一个寄存器
+        struct Hoisted {
+            std::string name;
+            bool truth;
+        };
+        std::vector<Hoisted> hoisted;
+        std::string declarations;
+        std::string body;
+        size_t bodyCursor = 0;
+        int budget = budgetPerFunction;
+
+        for (const auto& slot : CodeParser::findStatementSlots(func.body)) {
+            if (budget < kUseCycles) {
+                break;
+            }
+            if (!rng.randomBool(kSiteProbability)) {
+                continue;
+            }
+            // 预算允许时以一定概率新建谓词，否则复用已求值的谓词
+            size_t pick = hoisted.size();
+            if (hoisted.empty() || rng.randomBool(0.3)) {
+                bool truth = rng.randomBool();
+                int cycles = 0;
+                std::string expr = generateOpaquePredicate(truth, budget - kUseCycles, cycles);
+                if (!expr.empty()) {
+                    hoisted.push_back({prefix + std::to_string(predicateCount++), truth});
+                    declarations += "    const int " + hoisted.back().name + " = " + expr + ";\n";
+                    budget -= cycles;
+                }
+            }
+            if (hoisted.empty()) {
+                break;
             }
-        } else {
-            result << currentLine << "\n";
+            if (pick == hoisted.size()) {
+                pick = rng.randomInt(0, static_cast<int>(hoisted.size()) - 1);
+            }
+
+            const Hoisted& h = hoisted[pick];
+            body.append(func.body, bodyCursor, slot.offset - bodyCursor);
+            bodyCursor = slot.offset;
+            body += slot.indent + "if (OBF_FB_UNLIKELY(" + (h.truth ? "!" : "") + h.name +
+                    ")) OBF_FB_UNLIKELY_ATTR { " + prefix + "cold(" +
+                    std::to_string(rng.randomInt(1, 0xFFFF)) + "u); }\n";
+            budget -= kUseCycles;
+            ++useCount;
         }
+        if (hoisted.empty()) {
+            continue;
+        }
+        body.append(func.body, bodyCursor, std::string::npos);
+        body.insert(body.compare(0, 1, "\n") == 0 ? 1 : 0,
+                    body.compare(0, 1, "\n") == 0 ? declarations : "\n" + declarations);
+
+        result.append(input, cursor, func.startPos - cursor);
+        result += body;
+        cursor = func.endPos;
     }
+    result.append(input, cursor, std::string::npos);
 
-    output = result.str();
-    LOG_INFO("Opaque Predicate Strategy completed");
+    if (predicateCount > 0) {
+        result.insert(0, generateSupportCode());
+    }
+
+    output = std::move(result);
+    LOG_INFO("Opaque Predicate Strategy completed, " + std::to_string(predicateCount) +
+             " predicates, " + std::to_string(useCount) + " uses");
     return true;
 }
 
-std::string OpaquePredicateStrategy::generateOpaquePredicate(bool alwaysTrue) {
+std::string OpaquePredicateStrategy::generateOpaquePredicate(bool alwaysTrue, int maxCycles,
+                                                             int& cycles) {
     auto& rng = RandomGenerator::getInstance();
-    std::stringstream ss;
 
-    int type = rng.randomInt(0, 4);
+    std::vector<const PredicateTemplate*> affordable;
+    for (const auto& t : kPredicates) {
+        if (t.cycles <= maxCycles && (m_pointerAliasing || !t.aliasing)) {
+            affordable.push_back(&t);
+        }
+    }
+    if (affordable.empty()) {
+        return "";
+    }
+    const PredicateTemplate& t = *affordable[rng.randomInt(0, affordable.size() - 1)];
+    cycles = t.cycles;
+
+    const std::string tbl = "obf_op_" + m_id + "_tbl";
+    const std::string alias = "obf_op_" + m_id + "_alias";
+    const size_t ia = rng.randomInt(0, kTableSize - 1);
+    const size_t ib = (ia + rng.randomInt(1, kTableSize - 1)) % kTableSize;
+    const uint32_t a = m_table[ia];
+    const uint32_t b = m_table[ib];
+    const std::string ea = tbl + "[" + std::to_string(ia) + "]";
+    const std::string eb = tbl + "[" + std::to_string(ib) + "]";
+
+    // 永假版本把比较常量换成一个不同的值
+    auto target = [&](uint32_t value) {
+        if (alwaysTrue) {
+            return value;
+        }
+        uint32_t other = randomWord();
+        while (other == value) {
+            other = randomWord();
+        }
+        return other;
+    };
 
-    switch (type) {
-    case 0: {
-        // x^2 >= 0 (永远为真)
-        int var = rng.randomInt(0, 999);
-        ss << "    int __op_" << var << " = " << rng.randomInt(-100, 100) << ";\n";
-        ss << "    if (__op_" << var << " * __op_" << var << " >= 0) {\n";
-        ss << "        /* always true path */\n";
-        ss << "    }";
-        break;
+    const std::string name = t.name;
+    if (name == "xor_eq") {
+        uint32_t k = randomWord();
+        return "(" + ea + " ^ " + hexWord(k) + ") == " + hexWord(target(a ^ k));
     }
-    case 1: {
-        // (x | 0) == x (永远为真)
-        int var = rng.randomInt(0, 999);
-        int val = rng.randomInt(1, 100);
-        ss << "    int __op_" << var << " = " << val << ";\n";
-        ss << "    if ((__op_" << var << " | 0) == __op_" << var << ") {\n";
-        ss << "        /* always true path */\n";
-        ss << "    }";
-        break;
+    if (name == "rotate") {
+        int r = rng.randomInt(1, 31);
+        uint32_t rotated = (a << r) | (a >> (32 - r));
+        return "((" + ea + " << " + std::to_string(r) + ") | (" + ea + " >> " +
+               std::to_string(32 - r) + ")) == " + hexWord(target(rotated));
     }
-    case 2: {
-        // 2x mod 2 == 0 (永远为真)
-        int var = rng.randomInt(0, 999);
-        int val = rng.randomInt(1, 50);
-        ss << "    int __op_" << var << " = " << val << ";\n";
-        ss << "    if ((2 * __op_" << var << ") % 2 == 0) {\n";
-        ss << "        /* always true path */\n";
-        ss << "    }";
-        break;
+    if (name == "add_pair") {
+        return "(unsigned)(" + ea + " + " + eb + ") == " + hexWord(target(a + b));
     }
-    case 3: {
-        // abs(x) >= 0 (永远为真)
-        int var = rng.randomInt(0, 999);
-        int val = rng.randomInt(-100, 100);
-        ss << "    int __op_" << var << " = " << val << ";\n";
-        ss << "    if ((__op_" << var << " < 0 ? -__op_" << var << " : __op_" << var << ") >= 0) {\n";
-        ss << "        /* always true path */\n";
-        ss << "    }";
-        break;
+    if (name == "range") {
+        // 区间 [lo, lo + span) 包含 a（永假时不包含）
+        uint32_t span = (randomWord() >> 4) + 1;
+        uint32_t lo = alwaysTrue ? a - rng.randomInt(0, static_cast<int>(std::min<uint32_t>(span - 1, 0xFFFF)))
+                                 : a + 1;
+        return "(unsigned)(" + ea + " - " + hexWord(lo) + ") < " + hexWord(span);
     }
-    case 4: {
-        // (x + 1) > x (对于非溢出情况永远为真)
-        int var = rng.randomInt(0, 999);
-        int val = rng.randomInt(1, 1000);
-        ss << "    int __op_" << var << " = " << val << ";\n";
-        ss << "    if ((__op_" << var << " + 1) > __op_" << var << ") {\n";
-        ss << "        /* always true path */\n";
-        ss << "    }";
-        break;
+    if (name == "mask_pair") {
+        uint32_t mask = randomWord() | 0x00010001u;
+        return "((" + ea + " ^ " + eb + ") & " + hexWord(mask) + ") == " +
+               hexWord(alwaysTrue ? (a ^ b) & mask : ((a ^ b) & mask) ^ 0x00010000u);
+    }
+    if (name == "mul_hash") {
+        uint32_t m = randomWord() | 1u;
+        int shift = rng.randomInt(8, 20);
+        uint32_t h = (a * m) >> shift;
+        return "(unsigned)(" + ea + " * " + hexWord(m) + ") >> " + std::to_string(shift) +
+               " == " + hexWord(alwaysTrue ? h : h ^ 1u);
     }
+
+    // 别名类：两个别名槽在生成时指向已知元素，只有冷函数会改写它们
+    const size_t j = rng.randomInt(0, 1);
+    const std::string slot = alias + "[" + std::to_string(j) + "]";
+    size_t pointee = m_aliasIndex[j];
+    size_t compared = alwaysTrue ? pointee : (pointee + rng.randomInt(1, kTableSize - 1)) % kTableSize;
+    if (name == "alias_ptr") {
+        return slot + " == &" + tbl + "[" + std::to_string(compared) + "]";
     }
+    return "*" + slot + " == " + tbl + "[" + std::to_string(compared) + "]";
+}
 
+std::string OpaquePredicateStrategy::generateSupportCode() const {
+    const std::string prefix = "obf_op_" + m_id + "_";
+    std::stringstream ss;
+    ss << ControlFlowRewriter::branchHintMacros();
+    ss << "static unsigned " << prefix << "tbl[" << kTableSize << "] = {";
+    for (size_t i = 0; i < kTableSize; ++i) {
+        ss << (i ? ", " : " ") << hexWord(m_table[i]);
+    }
+    ss << " };\n";
+    if (m_pointerAliasing) {
+        ss << "static unsigned* " << prefix << "alias[2] = { &" << prefix << "tbl["
+           << m_aliasIndex[0] << "], &" << prefix << "tbl[" << m_aliasIndex[1] << "] };\n";
+    }
+    ss << "static OBF_FB_COLD void " << prefix << "cold(unsigned k) {\n";
+    ss << "    " << prefix << "tbl[k & " << (kTableSize - 1) << "u] ^= k * 0x9e3779b1u;\n";
+    if (m_pointerAliasing) {
+        ss << "    " << prefix << "alias[k & 1u] = &" << prefix << "tbl[(k >> 3) & "
+           << (kTableSize - 1) << "u];\n";
+    }
+    ss << "}\n\n";
     return ss.str();
 }
 
@@ -230,52 +454,314 @@ std::string OpaquePredicateStrategy::generateOpaquePredicate(bool alwaysTrue) {
 bool StringEncryptionStrategy::apply(const std::string& input, std::string& output) {
     LOG_INFO("Applying String Encryption Strategy");
 
-    std::regex stringPattern("\"([^\"]+)\"");
-    std::string result = input;
-    std::smatch match;
+    // 词法扫描出可安全替换的字面量，每个替换为访问函数调用
+    auto literals = CodeParser::scanStringLiterals(input);
 
-    auto& rng = RandomGenerator::getInstance();
-    std::string::const_iterator searchStart(result.cbegin());
+    // 相同内容的字面量只保留一份密文和一个解密缓存
+    std::vector<const StringLiteralInfo*> targets;
+    std::vector<size_t> slotOf;
+    std::vector<std::string> values;
+    std::unordered_map<std::string, size_t> interned;
+    for (const auto& literal : literals) {
+        // 只加密长度大于等于 minLength 的字符串
+        if (literal.rewritable &&
+            literal.value.length() >= static_cast<size_t>(m_minLength)) {
+            auto inserted = interned.emplace(literal.value, values.size());
+            if (inserted.second) {
+                values.push_back(literal.value);
+            }
+            targets.push_back(&literal);
+            slotOf.push_back(inserted.first->second);
+        }
+    }
+
+    // 待替换的源码区间 [start, end) 及替换文本，按位置排序后一次拼接
+    struct Edit {
+        size_t start;
+        size_t end;
+        std::string text;
+    };
+    std::vector<Edit> edits;
+    size_t insertPos = input.size();
+
+    size_t resourceCount = 0;
+    if (m_encryptResources) {
+        static const char* byteTypes[] = {
+            "char", "unsigned char", "signed char", "uint8_t", "int8_t", "std::uint8_t"
+        };
+        for (const auto& array : CodeParser::scanDataArrays(input, m_resourceMinSize)) {
+            std::string bytes;
+            bool isByteArray = std::find(std::begin(byteTypes), std::end(byteTypes),
+                                         array.elementType) != std::end(byteTypes);
+            size_t semicolon = input.find_first_not_of(" \t\r\n", array.bodyEnd);
+            if (!isByteArray || semicolon == std::string::npos || input[semicolon] != ';' ||
+                !CodeParser::decodeByteList(input, array, bytes)) {
+                LOG_WARNING("Skipping data array " + array.name + " (not a plain byte array)");
+                continue;
+            }
+            // 原数组名不再存在：外部链接的数组可能被其他文件引用，本文件内的引用也无法改写。
+            // OBF_RESOURCE_PLAIN(name); 是混淆前的明文回退，随数组一起删除，不算引用
+            std::vector<std::pair<size_t, size_t>> fallbacks;
+            for (size_t at : CodeParser::findIdentifier(input, "OBF_RESOURCE_PLAIN", semicolon + 1)) {
+                size_t end = 0;
+                if (matchPlainResource(input, at, array.name, end)) {
+                    fallbacks.emplace_back(at, end);
+                }
+            }
+            if (!array.isStatic ||
+                CodeParser::countIdentifier(input, array.name, 0, array.declStart) +
+                CodeParser::countIdentifier(input, array.name, semicolon + 1) > fallbacks.size()) {
+                LOG_WARNING("Skipping data array " + array.name +
+                            " (only static arrays referenced through OBF_RESOURCE_PLAIN become resources)");
+                continue;
+            }
+            // 声明的元素数多于初始化列表时，补零部分一起加密
+            size_t declaredCount = 0;
+            if (!declaredArraySize(input, array, declaredCount)) {
+                LOG_WARNING("Skipping data array " + array.name + " (array size is not a literal)");
+                continue;
+            }
+            if (declaredCount > bytes.size()) {
+                bytes.resize(declaredCount, '\0');
+            }
+            edits.push_back({array.declStart, semicolon + 1,
+                             generateResourceCode(array.name, bytes)});
+            for (const auto& fallback : fallbacks) {
+                edits.push_back({fallback.first, fallback.second, ""});
+            }
+            insertPos = std::min(insertPos, array.declInsertPos);
+            ++resourceCount;
+        }
+    }
 
-    std::vector<std::pair<std::string, std::string>> replacements;
+    if (targets.empty() && edits.empty()) {
+        output = input;
+        LOG_INFO("String Encryption Strategy completed (no eligible literals)");
+        return true;
+    }
 
-    while (std::regex_search(searchStart, result.cend(), match, stringPattern)) {
-        std::string originalString = match[1].str();
+    // 辅助声明放在第一个被替换位置之前的顶层安全位置
+    if (!targets.empty()) {
+        insertPos = std::min(insertPos, targets.front()->declInsertPos);
+    }
 
-        // 只加密长度大于等于 minLength 的字符串
-        if (originalString.length() >= static_cast<size_t>(m_minLength)) {
-            // 生成密钥
-            uint8_t key = CryptoUtils::generateKey8();
+    std::string preamble;
+    if (resourceCount > 0) {
+        preamble += "#include " + m_resourceHeader + "\n";
+    }
+
+    if (m_compileTime) {
+        // 只做记号替换，加密由头文件中的 constexpr 模板在编译期完成
+        if (!targets.empty()) {
+            preamble += "#include " + m_runtimeHeader + "\n";
+        }
+        for (const auto* target : targets) {
+            edits.push_back({target->startPos, target->endPos,
+                             "OBF_STR(" + input.substr(target->startPos,
+                                                       target->endPos - target->startPos) + ")"});
+        }
+    } else if (!targets.empty()) {
+        std::string tag = RandomGenerator::getInstance().randomHexString(4);
+        std::vector<std::string> accessors;
+        preamble += CryptoUtils::generateDecryptionRuntime();
+        preamble += (m_storage == Storage::POOLED)
+            ? generatePooledCode(values, tag, accessors)
+            : generatePerStringCode(values, tag, accessors);
+
+        for (size_t i = 0; i < targets.size(); ++i) {
+            edits.push_back({targets[i]->startPos, targets[i]->endPos,
+                             accessors[slotOf[i]] + "()"});
+        }
+    }
+
+    std::sort(edits.begin(), edits.end(),
+              [](const Edit& a, const Edit& b) { return a.start < b.start; });
+
+    size_t growth = preamble.size();
+    for (const auto& edit : edits) {
+        growth += edit.text.size();
+    }
+
+    std::string result;
+    result.reserve(input.size() + growth);
+    result.append(input, 0, insertPos);
+    result += preamble;
+
+    size_t cursor = insertPos;
+    for (const auto& edit : edits) {
+        result.append(input, cursor, edit.start - cursor);
+        result += edit.text;
+        cursor = edit.end;
+    }
+    result.append(input, cursor, std::string::npos);
+
+    output = std::move(result);
+    if (m_compileTime) {
+        LOG_INFO("String Encryption Strategy completed, wrapped " +
+                 std::to_string(targets.size()) + " literals for compile-time encryption, " +
+                 std::to_string(resourceCount) + " resources encrypted");
+    } else {
+        LOG_INFO("String Encryption Strategy completed, encrypted " +
+                 std::to_string(targets.size()) + " literals (" +
+                 std::to_string(values.size()) + " unique), " +
+                 std::to_string(resourceCount) + " resources");
+    }
+    return true;
+}
+
+std::string StringEncryptionStrategy::encryptString(const std::string& str,
+                                                    const std::vector<uint8_t>& key) {
+    return CryptoUtils::xorEncrypt(str, key);
+}
+
+std::string StringEncryptionStrategy::generatePerStringCode(
+    const std::vector<std::string>& values,
+    const std::string& tag,
+    std::vector<std::string>& accessors) {
+
+    std::stringstream decls;
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        std::string varName = "obf_str_" + tag + "_" + std::to_string(i);
+        auto key = CryptoUtils::generateKeyN(CryptoUtils::kDecryptBlockSize);
+        std::string encrypted = encryptString(CryptoUtils::padToBlock(values[i]), key);
+        decls << CryptoUtils::generateDecryptionCode(encrypted, key, varName);
+        accessors.push_back(varName);
+    }
 
-            // 加密字符串
-            std::string encrypted = CryptoUtils::xorEncrypt(originalString, key);
+    return decls.str();
+}
 
-            // 生成解密代码
-            std::string varName = "__enc_str_" + std::to_string(rng.randomInt(0, 9999));
-            std::string decryptCode = CryptoUtils::generateDecryptionCode(
-                encrypted, key, varName);
+std::string StringEncryptionStrategy::generatePooledCode(
+    const std::vector<std::string>& values,
+    const std::string& tag,
+    std::vector<std::string>& accessors) {
 
-            replacements.push_back({match[0].str(), "/* encrypted */ \"" + originalString + "\""});
+    const size_t block = CryptoUtils::kDecryptBlockSize;
+    const std::string pool = "obf_pool_" + tag;
+    auto& rng = RandomGenerator::getInstance();
+
+    // 布局：每个字符串按分块对齐连续存放；按页解密时尽量不跨页
+    std::string blob;
+    std::vector<size_t> offsets;
+    std::vector<size_t> lengths;
+    for (const auto& value : values) {
+        std::string padded = CryptoUtils::padToBlock(value);
+
+        if (m_decryptPolicy == DecryptPolicy::LAZY_PAGE) {
+            size_t used = blob.size() % kPoolPageSize;
+            if (used != 0 && padded.size() <= kPoolPageSize &&
+                used + padded.size() > kPoolPageSize) {
+                auto fill = rng.randomBytes(kPoolPageSize - used);
+                blob.append(fill.begin(), fill.end());
+            }
         }
 
-        searchStart = match.suffix().first;
+        offsets.push_back(blob.size());
+        lengths.push_back(padded.size());
+        blob += padded;
+    }
+
+    auto key = CryptoUtils::generateKeyN(block);
+    std::string encrypted = encryptString(blob, key);
+    size_t size = encrypted.size();
+    size_t pageCount = (size + kPoolPageSize - 1) / kPoolPageSize;
+
+    std::stringstream decls;
+    decls << "static const unsigned char " << pool << "_enc[" << size << "] OBF_ALIGN16 = {\n    "
+          << CryptoUtils::formatByteList(encrypted) << "\n};\n";
+    decls << "static const unsigned char " << pool << "_key[" << block << "] = {\n    "
+          << CryptoUtils::formatByteList(std::string(key.begin(), key.end())) << "\n};\n";
+    decls << "static unsigned char " << pool << "_buf[" << size << "] OBF_ALIGN16;\n";
+
+    switch (m_decryptPolicy) {
+    case DecryptPolicy::EAGER:
+        // 整个池共用一个解密标志；构造函数只是提前解密，访问函数仍检查标志，
+        // 没有 constructor 属性的编译器和更早运行的静态初始化也能拿到明文
+        decls << "static int " << pool << "_state;\n";
+        decls << "static inline void " << pool << "_all(void) {\n";
+        decls << "    obf_lazy_str(&" << pool << "_state, " << pool << "_buf, " << pool << "_enc, "
+              << pool << "_key, " << size << ");\n";
+        decls << "}\n";
+        decls << "static OBF_CONSTRUCTOR OBF_UNUSED void " << pool << "_init(void) {\n";
+        decls << "    " << pool << "_all();\n";
+        decls << "}\n";
+        break;
+    case DecryptPolicy::LAZY_STRING:
+        decls << "static int " << pool << "_state[" << values.size() << "];\n";
+        break;
+    case DecryptPolicy::LAZY_PAGE:
+        decls << "static int " << pool << "_state[" << pageCount << "];\n";
+        decls << "static inline void " << pool << "_page(unsigned long p, unsigned long n) {\n";
+        decls << "    obf_lazy_str(&" << pool << "_state[p], " << pool << "_buf + p * "
+              << kPoolPageSize << ", " << pool << "_enc + p * " << kPoolPageSize << ", "
+              << pool << "_key, n);\n";
+        decls << "}\n";
+        break;
     }
 
-    // 应用替换（这里简化处理，实际应该在合适的位置插入解密代码）
-    for (const auto& [oldStr, newStr] : replacements) {
-        size_t pos = result.find(oldStr);
-        if (pos != std::string::npos) {
-            result.replace(pos, oldStr.length(), newStr);
+    for (size_t i = 0; i < values.size(); ++i) {
+        std::string varName = pool + "_" + std::to_string(i);
+        size_t offset = offsets[i];
+        size_t length = lengths[i];
+
+        decls << "static inline const char* " << varName << "(void) {\n";
+        switch (m_decryptPolicy) {
+        case DecryptPolicy::EAGER:
+            decls << "    " << pool << "_all();\n";
+            break;
+        case DecryptPolicy::LAZY_STRING:
+            decls << "    return obf_lazy_str(&" << pool << "_state[" << i << "], "
+                  << pool << "_buf + " << offset << ", " << pool << "_enc + " << offset
+                  << ", " << pool << "_key, " << length << ");\n";
+            break;
+        case DecryptPolicy::LAZY_PAGE: {
+            size_t first = offset / kPoolPageSize;
+            size_t last = (offset + length - 1) / kPoolPageSize;
+            for (size_t p = first; p <= last; ++p) {
+                size_t pageBytes = std::min(kPoolPageSize, size - p * kPoolPageSize);
+                decls << "    " << pool << "_page(" << p << ", " << pageBytes << ");\n";
+            }
+            break;
+        }
         }
+        if (m_decryptPolicy != DecryptPolicy::LAZY_STRING) {
+            decls << "    return (const char*)(" << pool << "_buf + " << offset << ");\n";
+        }
+        decls << "}\n";
+
+        accessors.push_back(varName);
     }
 
-    output = result;
-    LOG_INFO("String Encryption Strategy completed");
-    return true;
+    return decls.str();
 }
 
-std::string StringEncryptionStrategy::encryptString(const std::string& str, uint8_t key) {
-    return CryptoUtils::xorEncrypt(str, key);
+std::string StringEncryptionStrategy::generateResourceCode(const std::string& name,
+                                                           const std::string& bytes) {
+    auto raw = CryptoUtils::generateKeyN(20);
+    uint32_t words[5];
+    for (size_t w = 0; w < 5; ++w) {
+        words[w] = static_cast<uint32_t>(raw[4 * w]) |
+                   static_cast<uint32_t>(raw[4 * w + 1]) << 8 |
+                   static_cast<uint32_t>(raw[4 * w + 2]) << 16 |
+                   static_cast<uint32_t>(raw[4 * w + 3]) << 24;
+    }
+    const uint32_t* key = words;
+    uint32_t nonce = words[4];
+
+    std::string dataName = "obf_res_" + name + "_data";
+    std::string encrypted = CryptoUtils::streamEncrypt(bytes, key, nonce);
+
+    std::stringstream decl;
+    decl << "static const unsigned char " << dataName << "[" << bytes.size() << "] = {\n    "
+         << CryptoUtils::formatByteList(encrypted) << "\n};\n";
+    decl << "static const obf_resource " << name << "_resource = {\n    " << dataName << ", " << bytes.size() << ", {";
+    for (size_t w = 0; w < 4; ++w) {
+        decl << (w ? ", " : "") << "0x" << std::hex << key[w] << "u";
+    }
+    decl << "}, 0x" << nonce << "u, 0u\n};" << std::dec;
+
+    return decl.str();
 }
 
 // ============================================================================
@@ -307,15 +793,47 @@ std::string SymbolObfuscationStrategy::generateRandomName(int length) {
 bool ControlFlowFlatteningStrategy::apply(const std::string& input, std::string& output) {
     LOG_INFO("Applying Control Flow Flattening Strategy");
 
-    // 控制流平坦化的简化实现
-    // 实际应该在LLVM IR级别进行
+    CodeParser parser;
+    if (!parser.parse(input)) {
+        output = input;
+        return true;
+    }
 
-    std::stringstream result;
-    result << "/* Control Flow Flattening Applied */\n";
-    result << input;
+    ControlFlowRewriter rewriter;
+    rewriter.setLayoutLocality(m_layoutLocality);
+    std::string result;
+    result.reserve(input.size() * 2);
+    size_t cursor = 0;
+    int flattened = 0;
 
-    output = result.str();
-    LOG_INFO("Control Flow Flattening Strategy completed");
+    for (const auto& func : parser.getFunctions()) {
+        if (isControlKeyword(func.name) || func.startPos < cursor || func.body.empty()) {
+            continue;
+        }
+
+        std::string body = rewriter.flattenControlFlow(func.body);
+        if (body != func.body) {
+            ++flattened;
+        }
+        if (m_addFakeBranches) {
+            body = rewriter.addFakeBranches(body, m_fakeBranchProbability);
+        }
+        if (body == func.body) {
+            continue;
+        }
+
+        result.append(input, cursor, func.startPos - cursor);
+        result += body;
+        cursor = func.endPos;
+    }
+    result.append(input, cursor, std::string::npos);
+
+    // 虚假分支的辅助定义只依赖编译器内建功能，放在文件开头即可
+    result.insert(0, rewriter.fakeBranchSupport());
+
+    output = std::move(result);
+    LOG_INFO("Control Flow Flattening Strategy completed, flattened " +
+             std::to_string(flattened) + " functions");
     return true;
 }
 
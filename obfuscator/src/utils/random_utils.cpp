@@ -212,27 +212,167 @@ std::string CryptoUtils::substitutionEncrypt(const std::string& data, int shift)
     return result;
 }
 
+std::string CryptoUtils::padToBlock(const std::string& data) {
+    std::string padded = data;
+    padded += '\0';
+
+    size_t remainder = padded.size() % kDecryptBlockSize;
+    if (remainder != 0) {
+        auto fill = RandomGenerator::getInstance().randomBytes(kDecryptBlockSize - remainder);
+        padded.append(fill.begin(), fill.end());
+    }
+
+    return padded;
+}
+
+std::string CryptoUtils::formatByteList(const std::string& data) {
+    // 资源数组可达数MB，直接查表拼接，避免逐字节的流格式化
+    static const char hexDigits[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(data.size() * 6 + data.size() / 16 * 4);
+
+    for (size_t i = 0; i < data.size(); ++i) {
+        if (i > 0) {
+            out += (i % 16 == 0) ? ",\n    " : ", ";
+        }
+        uint8_t byte = static_cast<uint8_t>(data[i]);
+        out += '0';
+        out += 'x';
+        out += hexDigits[byte >> 4];
+        out += hexDigits[byte & 0xF];
+    }
+
+    return out;
+}
+
+void CryptoUtils::streamKeystream(const uint32_t key[4], uint32_t nonce, uint64_t chunk,
+                                  uint8_t out[kStreamChunkSize]) {
+    // 与 runtime/obf_resource.h 中的 obf_resource_keystream 保持一致
+    auto mix = [](uint32_t h) {
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    };
+
+    uint32_t base = static_cast<uint32_t>(chunk * 16u);
+    for (uint32_t j = 0; j < 16; ++j) {
+        uint32_t x = (base + j) ^ key[j & 3];
+        x = mix(x + nonce);
+        x ^= key[(j + 1) & 3];
+        x = mix(x);
+        out[4 * j + 0] = static_cast<uint8_t>(x);
+        out[4 * j + 1] = static_cast<uint8_t>(x >> 8);
+        out[4 * j + 2] = static_cast<uint8_t>(x >> 16);
+        out[4 * j + 3] = static_cast<uint8_t>(x >> 24);
+    }
+}
+
+std::string CryptoUtils::streamEncrypt(const std::string& data, const uint32_t key[4],
+                                       uint32_t nonce) {
+    std::string result(data.size(), '\0');
+    uint8_t ks[kStreamChunkSize];
+
+    for (size_t pos = 0; pos < data.size(); pos += kStreamChunkSize) {
+        streamKeystream(key, nonce, pos / kStreamChunkSize, ks);
+        size_t take = std::min(kStreamChunkSize, data.size() - pos);
+        for (size_t j = 0; j < take; ++j) {
+            result[pos + j] = static_cast<char>(static_cast<uint8_t>(data[pos + j]) ^ ks[j]);
+        }
+    }
+
+    return result;
+}
+
+std::string CryptoUtils::generateDecryptionRuntime() {
+    // 状态: 0=未解密, 1=解密中, 2=已解密
+    // 快速路径只有一次 acquire 读和一次分支；首次访问通过CAS选出唯一的解密线程
+    return R"(#ifndef OBF_STRING_RUNTIME
+#define OBF_STRING_RUNTIME
+#if defined(__GNUC__) || defined(__clang__)
+#define OBF_ALIGN16 __attribute__((aligned(16)))
+#define OBF_RESTRICT __restrict
+#define OBF_NOINLINE __attribute__((noinline))
+#define OBF_UNUSED __attribute__((unused))
+#define OBF_CONSTRUCTOR __attribute__((constructor))
+#define OBF_LIKELY(x) __builtin_expect(!!(x), 1)
+#define OBF_LOAD_ACQ(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define OBF_STORE_REL(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define OBF_CAS(p, e, d) __atomic_compare_exchange_n((p), (e), (d), 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)
+#else
+/* 其他编译器退化为非原子实现，仅保证单线程正确 */
+#define OBF_ALIGN16
+#define OBF_RESTRICT
+#define OBF_NOINLINE
+#define OBF_UNUSED
+#define OBF_CONSTRUCTOR
+#define OBF_LIKELY(x) (x)
+#define OBF_LOAD_ACQ(p) (*(volatile int*)(p))
+#define OBF_STORE_REL(p, v) (*(volatile int*)(p) = (v))
+#define OBF_CAS(p, e, d) (*(p) == *(e) ? (*(p) = (d), 1) : (*(e) = *(p), 0))
+#endif
+/* 按16字节分块异或：块内循环次数固定且无别名，可被编译为单条向量异或 */
+static OBF_UNUSED void obf_xor_blocks(unsigned char* OBF_RESTRICT dst,
+                                      const unsigned char* OBF_RESTRICT src,
+                                      const unsigned char* OBF_RESTRICT key,
+                                      unsigned long n) {
+    unsigned long c;
+    int j;
+    for (c = 0; c < n; c += 16) {
+        unsigned char* d = dst + c;
+        const unsigned char* s = src + c;
+        for (j = 0; j < 16; j++) {
+            d[j] = (unsigned char)(s[j] ^ key[j]);
+        }
+    }
+}
+static OBF_NOINLINE OBF_UNUSED const char* obf_decrypt_once(int* state, unsigned char* dst,
+                                                            const unsigned char* src,
+                                                            const unsigned char* key,
+                                                            unsigned long n) {
+    int expected = 0;
+    if (OBF_CAS(state, &expected, 1)) {
+        obf_xor_blocks(dst, src, key, n);
+        OBF_STORE_REL(state, 2);
+    } else {
+        while (OBF_LOAD_ACQ(state) != 2) {
+        }
+    }
+    return (const char*)dst;
+}
+static inline OBF_UNUSED const char* obf_lazy_str(int* state, unsigned char* dst,
+                                                  const unsigned char* src,
+                                                  const unsigned char* key,
+                                                  unsigned long n) {
+    if (OBF_LIKELY(OBF_LOAD_ACQ(state) == 2)) {
+        return (const char*)dst;
+    }
+    return obf_decrypt_once(state, dst, src, key, n);
+}
+#endif /* OBF_STRING_RUNTIME */
+)";
+}
+
 std::string CryptoUtils::generateDecryptionCode(const std::string& encryptedData,
-                                                uint8_t key,
+                                                const std::vector<uint8_t>& key,
                                                 const std::string& varName) {
     std::stringstream ss;
+    size_t size = encryptedData.size();
 
-    // 生成加密后的字节数组
-    ss << "unsigned char " << varName << "_enc[] = {";
-    for (size_t i = 0; i < encryptedData.size(); ++i) {
-        if (i > 0) ss << ", ";
-        ss << "0x" << std::hex << std::setw(2) << std::setfill('0')
-           << (static_cast<unsigned int>(static_cast<uint8_t>(encryptedData[i])));
-    }
-    ss << "};\n";
+    ss << "static const unsigned char " << varName << "_enc[" << size << "] OBF_ALIGN16 = {\n    "
+       << formatByteList(encryptedData) << "\n};\n";
+    ss << "static const unsigned char " << varName << "_key[" << key.size() << "] = {\n    "
+       << formatByteList(std::string(key.begin(), key.end())) << "\n};\n";
+
+    ss << "static unsigned char " << varName << "_buf[" << size << "] OBF_ALIGN16;\n";
+    ss << "static int " << varName << "_state;\n";
 
-    // 生成解密代码
-    ss << "char " << varName << "[" << (encryptedData.size() + 1) << "];\n";
-    ss << "for (int i = 0; i < " << std::dec << encryptedData.size() << "; i++) {\n";
-    ss << "    " << varName << "[i] = " << varName << "_enc[i] ^ 0x"
-       << std::hex << static_cast<int>(key) << ";\n";
+    ss << "static inline const char* " << varName << "(void) {\n";
+    ss << "    return obf_lazy_str(&" << varName << "_state, " << varName << "_buf, "
+       << varName << "_enc, " << varName << "_key, " << size << ");\n";
     ss << "}\n";
-    ss << varName << "[" << std::dec << encryptedData.size() << "] = '\\0';\n";
 
     return ss.str();
 }
@@ -0,0 +1,65 @@
+; 每个 Pass 的随机数流只由 -obf-seed、Pass 名和函数名（模块 Pass 为源文件名）决定：
+; 同一种子两次运行的输出逐字节相同，不同种子的输出不同（DETERMINISTIC）
+
+; CHECK-NOT: n = %d
+; CHECK: @{{[a-z]+}} = private constant [8 x i8] c"
+; CHECK-LABEL: define internal i32 @{{[a-z]+}}(i32 %0) {
+; CHECK: switch i32
+; CHECK: call void asm sideeffect
+; CHECK-LABEL: define i32 @main(i32 %0) {
+; CHECK: switch i32
+; CHECK: !{i32 {{[0-9]+}}, !"obf.stage", i32 2}
+
+source_filename = "determinism.c"
+
+@.str = private unnamed_addr constant [8 x i8] c"n = %d\0A\00", align 1
+
+define internal i32 @collatz(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %x = phi i32 [ %n, %entry ], [ %x.next, %latch ]
+  %steps = phi i32 [ 0, %entry ], [ %steps.next, %latch ]
+  %done = icmp ule i32 %x, 1
+  br i1 %done, label %exit, label %body
+
+body:
+  %odd = and i32 %x, 1
+  %is.odd = icmp ne i32 %odd, 0
+  br i1 %is.odd, label %up, label %down
+
+up:
+  %t = mul i32 %x, 3
+  %u = add i32 %t, 1
+  br label %latch
+
+down:
+  %d = lshr i32 %x, 1
+  br label %latch
+
+latch:
+  %x.next = phi i32 [ %u, %up ], [ %d, %down ]
+  %steps.next = add i32 %steps, 1
+  br label %loop
+
+exit:
+  ret i32 %steps
+}
+
+define i32 @main(i32 %argc) {
+entry:
+  %s = call i32 @collatz(i32 %argc)
+  %big = icmp sgt i32 %s, 10
+  br i1 %big, label %print, label %exit
+
+print:
+  %f = getelementptr inbounds [8 x i8], [8 x i8]* @.str, i64 0, i64 0
+  %c = call i32 (i8*, ...) @printf(i8* %f, i32 %s)
+  br label %exit
+
+exit:
+  ret i32 %s
+}
+
+declare i32 @printf(i8*, ...)
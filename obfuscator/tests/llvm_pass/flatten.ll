@@ -0,0 +1,132 @@
+; 平坦化后被分发的块都经由 obf.dispatch 的稠密 switch 互相跳转，default 不可达；
+; 条件跳转改为 select 选出下一个状态，分发目标的 PHI 降级到栈上。
+; 含 EH pad 的函数和只有两个块的函数保持原样；-obf-cff-skip-inner-loops 保留最内层循环
+
+; CHECK-LABEL: define i32 @loops(
+; CHECK: entry:
+; CHECK-NOT: phi
+; CHECK: %obf.next = select i1 %pos, i32 {{[0-3]}}, i32 {{[0-3]}}
+; CHECK-NEXT: br label %obf.dispatch
+; CHECK: obf.dispatch:
+; CHECK-NEXT: %obf.state = phi i32
+; CHECK-NEXT: switch i32 %obf.state, label %obf.default [
+; CHECK-NEXT: i32 0, label
+; CHECK-NEXT: i32 1, label
+; CHECK-NEXT: i32 2, label
+; CHECK-NEXT: i32 3, label
+; CHECK-NEXT: ]
+; CHECK-NOT: phi
+; CHECK: select i1 %inner.done, i32 {{[0-3]}}, i32 {{[0-3]}}
+; CHECK-NEXT: br label %obf.dispatch
+; CHECK-NOT: phi
+; CHECK: select i1 %outer.done, i32 {{[0-3]}}, i32 {{[0-3]}}
+; CHECK-NEXT: br label %obf.dispatch
+; CHECK-NOT: phi
+; CHECK: obf.default:
+; CHECK-NEXT: unreachable
+
+; INNER-LABEL: define i32 @loops(
+; INNER: obf.dispatch:
+; INNER-NEXT: %obf.state = phi i32
+; INNER-NEXT: switch i32 %obf.state, label %obf.default [
+; INNER-NEXT: i32 0, label
+; INNER-NEXT: i32 1, label
+; INNER-NEXT: i32 2, label
+; INNER-NEXT: ]
+; INNER: inner:
+; INNER-NEXT: %j = phi i32
+; INNER: br i1 %inner.done, label %obf.edge, label %inner
+; INNER: obf.edge:
+; INNER-NEXT: br label %obf.dispatch
+define i32 @loops(i32 %n, i32 %m) {
+entry:
+  %pos = icmp sgt i32 %n, 0
+  br i1 %pos, label %outer, label %exit
+
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.inner, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner ]
+  %acc.inner = phi i32 [ %acc, %outer ], [ %acc.add, %inner ]
+  %acc.add = add i32 %acc.inner, %j
+  %j.next = add i32 %j, 1
+  %inner.done = icmp eq i32 %j.next, %m
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add i32 %i, 1
+  %outer.done = icmp eq i32 %i.next, %n
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %acc.add, %outer.latch ]
+  ret i32 %r
+}
+
+; switch 的每条边经由各自的中转块进入分发块
+; CHECK-LABEL: define i32 @pick(
+; CHECK: switch i32 %x, label %obf.edge [
+; CHECK-NEXT: i32 1, label %obf.edge1
+; CHECK-NEXT: i32 2, label %obf.edge2
+; CHECK: obf.dispatch:
+; CHECK-NEXT: %obf.state = phi i32
+; CHECK-NOT: phi
+; CHECK: exit:
+; CHECK-NEXT: %r.reload = load i32, i32* %r.reg2mem
+; CHECK: obf.edge:
+; CHECK-NEXT: br label %obf.dispatch
+define i32 @pick(i32 %x) {
+entry:
+  switch i32 %x, label %other [ i32 1, label %one
+                                i32 2, label %two ]
+one:
+  br label %exit
+two:
+  br label %exit
+other:
+  br label %exit
+exit:
+  %r = phi i32 [ 10, %one ], [ 20, %two ], [ 30, %other ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @invoke_result(
+; CHECK-NOT: obf.dispatch
+; CHECK: lpad:
+; CHECK-NEXT: landingpad
+; CHECK: exit:
+; CHECK-NEXT: %v = phi i32 [ 0, %entry ], [ %r, %call ]
+define i32 @invoke_result(i32 %x) personality i8* bitcast (i32 (...)* @__gxx_personality_v0 to i8*) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %call, label %exit
+
+call:
+  %r = invoke i32 @callee(i32 %x) to label %exit unwind label %lpad
+
+lpad:
+  %lp = landingpad { i8*, i32 } cleanup
+  resume { i8*, i32 } %lp
+
+exit:
+  %v = phi i32 [ 0, %entry ], [ %r, %call ]
+  ret i32 %v
+}
+
+; CHECK-LABEL: define i32 @straight(
+; CHECK-NOT: obf.dispatch
+; CHECK: ret i32
+define i32 @straight(i32 %x) {
+entry:
+  %y = add i32 %x, 1
+  br label %exit
+
+exit:
+  ret i32 %y
+}
+
+declare i32 @callee(i32)
+declare i32 @__gxx_personality_v0(...)
@@ -0,0 +1,39 @@
+; 已经混淆（obf.stage = 2）的模块在函数级扩展点上不再混淆
+
+; CHECK-LABEL: define i32 @f(
+; CHECK-NOT: obf.
+; CHECK: !{i32 7, !"obf.stage", i32 2}
+; CHECK-NOT: obf.
+
+define i32 @f(i32 %n) {
+entry:
+  %start = icmp sgt i32 %n, 0
+  br i1 %start, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %latch ]
+  %v = call i32 @g(i32 %i)
+  %s1 = add i32 %s, %v
+  %big = icmp sgt i32 %s1, 100
+  br i1 %big, label %dec, label %latch
+
+dec:
+  %s2 = sub i32 %s1, 7
+  br label %latch
+
+latch:
+  %s.next = phi i32 [ %s2, %dec ], [ %s1, %loop ]
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %s.next, %latch ]
+  ret i32 %r
+}
+
+declare i32 @g(i32)
+
+!llvm.module.flags = !{!0}
+!0 = !{i32 7, !"obf.stage", i32 2}
@@ -0,0 +1,40 @@
+; 函数级扩展点上的混淆 Pass 遵循 obf.stage：默认在本流水线中混淆并标记为 2，
+; -obf-lto 时只标记为 1，留给链接期
+
+; OBF-LABEL: define i32 @f(
+; OBF: obf.dispatch
+; OBF: !{i32 7, !"obf.stage", i32 2}
+
+; DEFER-NOT: obf.
+; DEFER: !{i32 7, !"obf.stage", i32 1}
+; DEFER-NOT: obf.
+
+define i32 @f(i32 %n) {
+entry:
+  %start = icmp sgt i32 %n, 0
+  br i1 %start, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %latch ]
+  %v = call i32 @g(i32 %i)
+  %s1 = add i32 %s, %v
+  %big = icmp sgt i32 %s1, 100
+  br i1 %big, label %dec, label %latch
+
+dec:
+  %s2 = sub i32 %s1, 7
+  br label %latch
+
+latch:
+  %s.next = phi i32 [ %s2, %dec ], [ %s1, %loop ]
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %s.next, %latch ]
+  ret i32 %r
+}
+
+declare i32 @g(i32)
@@ -0,0 +1,76 @@
+; 垃圾指令只读取插入点之前定义的值；invoke/callbr/catchswitch 结束的块
+; 和以 musttail 调用返回的块不插入
+
+; CHECK-LABEL: define i32 @invoke_result(
+; CHECK: entry:
+; CHECK-NOT: obf.junk
+; CHECK: invoke i32 @callee(
+; CHECK: ok:
+; CHECK: obf.junk
+; CHECK: ret i32
+define i32 @invoke_result(i32 %x) personality i8* bitcast (i32 (...)* @__gxx_personality_v0 to i8*) {
+entry:
+  %a = add i32 %x, 1
+  %r = invoke i32 @callee(i32 %a) to label %ok unwind label %lpad
+
+ok:
+  %s = add i32 %r, %a
+  %t = mul i32 %s, %r
+  %u = xor i32 %t, %x
+  %v = sub i32 %u, %s
+  ret i32 %v
+
+lpad:
+  %lp = landingpad { i8*, i32 } cleanup
+  resume { i8*, i32 } %lp
+}
+
+; CHECK-LABEL: define i32 @tail(
+; CHECK-NOT: obf.junk
+; CHECK: musttail call i32 @callee(
+; CHECK-NEXT: ret i32
+define i32 @tail(i32 %x) {
+entry:
+  %a = mul i32 %x, 3
+  %r = musttail call i32 @callee(i32 %a)
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @asm_goto(
+; CHECK: entry:
+; CHECK-NOT: obf.junk
+; CHECK: callbr void asm
+define i32 @asm_goto(i32 %x) {
+entry:
+  %a = add i32 %x, 1
+  callbr void asm "", "r,X"(i32 %a, i8* blockaddress(@asm_goto, %target)) to label %fall [label %target]
+
+fall:
+  ret i32 %a
+
+target:
+  ret i32 0
+}
+
+; CHECK-LABEL: define void @funclets(
+; CHECK: dispatch:
+; CHECK-NEXT: catchswitch
+define void @funclets(i32 %x) personality i8* bitcast (i32 (...)* @__CxxFrameHandler3 to i8*) {
+entry:
+  invoke void @thrower(i32 %x) to label %exit unwind label %dispatch
+
+dispatch:
+  %cs = catchswitch within none [label %handler] unwind to caller
+
+handler:
+  %cp = catchpad within %cs [i8* null, i32 64, i8* null]
+  catchret from %cp to label %exit
+
+exit:
+  ret void
+}
+
+declare i32 @callee(i32)
+declare void @thrower(i32)
+declare i32 @__gxx_personality_v0(...)
+declare i32 @__CxxFrameHandler3(...)
@@ -0,0 +1,84 @@
+; 不透明谓词是读取 @obf.opaque 的真实条件跳转，伪分支写回该全局变量；
+; 入口块的 alloca、EH pad 和 musttail 调用之后的 ret 保持原位
+
+; CHECK: @obf.opaque = internal global i32
+
+; CHECK-LABEL: define i32 @sum(
+; CHECK: entry:
+; CHECK-NEXT: %slot = alloca i32
+; CHECK: %obf.x{{[0-9]*}} = load i32, i32* @obf.opaque
+; CHECK: %obf.pred{{[0-9]*}} = icmp eq i32 %obf.low{{[0-9]*}}, 0
+; CHECK-NEXT: br i1 %obf.pred{{[0-9]*}}, label %obf.cont{{[0-9]*}}, label %obf.bogus{{[0-9]*}}, !prof
+; CHECK: obf.bogus{{[0-9]*}}:
+; CHECK-NEXT: %obf.bogus.x{{[0-9]*}} = xor i32 %obf.x
+; CHECK-NEXT: store i32 %obf.bogus.x{{[0-9]*}}, i32* @obf.opaque
+; CHECK-NEXT: br label %obf.cont
+; CHECK: ret i32
+define i32 @sum(i32 %n) {
+entry:
+  %slot = alloca i32
+  store i32 0, i32* %slot
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %v = mul i32 %i, 3
+  %s.next = add i32 %s, %v
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %s.next
+}
+
+; CHECK-LABEL: define i32 @invoke_result(
+; CHECK: lpad:
+; CHECK-NEXT: landingpad
+define i32 @invoke_result(i32 %x) personality i8* bitcast (i32 (...)* @__gxx_personality_v0 to i8*) {
+entry:
+  %r = invoke i32 @callee(i32 %x) to label %ok unwind label %lpad
+
+ok:
+  ret i32 %r
+
+lpad:
+  %lp = landingpad { i8*, i32 } cleanup
+  resume { i8*, i32 } %lp
+}
+
+; CHECK-LABEL: define i32 @tail(
+; CHECK: musttail call i32 @callee(
+; CHECK-NEXT: ret i32
+define i32 @tail(i32 %x) {
+entry:
+  %a = mul i32 %x, 3
+  %r = musttail call i32 @callee(i32 %a)
+  ret i32 %r
+}
+
+; CHECK-LABEL: define void @funclets(
+; CHECK: dispatch:
+; CHECK-NEXT: catchswitch
+; CHECK: handler:
+; CHECK-NEXT: catchpad
+define void @funclets(i32 %x) personality i8* bitcast (i32 (...)* @__CxxFrameHandler3 to i8*) {
+entry:
+  invoke void @thrower(i32 %x) to label %exit unwind label %dispatch
+
+dispatch:
+  %cs = catchswitch within none [label %handler] unwind to caller
+
+handler:
+  %cp = catchpad within %cs [i8* null, i32 64, i8* null]
+  catchret from %cp to label %exit
+
+exit:
+  ret void
+}
+
+declare i32 @callee(i32)
+declare void @thrower(i32)
+declare i32 @__gxx_personality_v0(...)
+declare i32 @__CxxFrameHandler3(...)
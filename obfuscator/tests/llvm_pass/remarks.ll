@@ -0,0 +1,60 @@
+; 每个修改了函数的 Pass 发出一条 Passed 备注，-pass-remarks-output 写入 YAML，
+; 参数为新增指令数、估计周期数、平坦化的块数和代码大小的变化；未被选中的函数没有备注
+
+; CHECK-LABEL: define i32 @sum(
+; CHECK: obf.dispatch:
+; CHECK-LABEL: define i32 @skipped(
+; CHECK-NOT: obf.
+
+; REMARK: --- !Passed
+; REMARK-NEXT: Pass: obf-opaque-pred
+; REMARK-NEXT: Name: Obfuscated
+; REMARK-NEXT: Function: sum
+; REMARK: - InstructionsInserted: '{{[1-9][0-9]*}}'
+; REMARK: - EstimatedCycles: '{{[1-9][0-9]*}}'
+; REMARK: - BlocksFlattened: '0'
+; REMARK: - SizeDelta: '{{-?[0-9]+}}'
+; REMARK: --- !Passed
+; REMARK-NEXT: Pass: obf-flatten
+; REMARK-NEXT: Name: Obfuscated
+; REMARK-NEXT: Function: sum
+; REMARK: - InstructionsInserted: '{{[1-9][0-9]*}}'
+; REMARK: - EstimatedCycles: '{{[1-9][0-9]*}}'
+; REMARK: - BlocksFlattened: '{{[1-9][0-9]*}}'
+; REMARK: - SizeDelta: '{{-?[0-9]+}}'
+; REMARK: --- !Passed
+; REMARK-NEXT: Pass: obf-junk
+; REMARK-NEXT: Name: Obfuscated
+; REMARK-NEXT: Function: sum
+; REMARK: - InstructionsInserted: '{{[1-9][0-9]*}}'
+; REMARK: - EstimatedCycles: '{{[1-9][0-9]*}}'
+; REMARK: - BlocksFlattened: '0'
+; REMARK-NOT: Function: skipped
+define i32 @sum(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %v = mul i32 %i, 3
+  %s.next = add i32 %s, %v
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %s.next
+}
+
+define i32 @skipped(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %a, label %b
+
+a:
+  ret i32 1
+
+b:
+  ret i32 2
+}
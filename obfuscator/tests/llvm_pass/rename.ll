@@ -0,0 +1,69 @@
+; 内部链接的函数、全局变量和别名改为短名（a, b, c, ...），所有基本块、参数和指令名
+; 被清除；外部符号、comdat 中的符号和模块级内联汇编引用的符号保持原名。
+; -obf-rename-map 写出"新名字 原名字"的映射（MAP）
+
+; CHECK: module asm ".symver asm_named, asm_named@V1"
+; CHECK: $comdat_helper = comdat any
+; CHECK: @[[COUNTER:[a-d]]] = internal global i32 0, align 4
+; CHECK-NEXT: @[[TABLE:[a-d]]] = private constant [2 x i32] [i32 1, i32 2]
+; CHECK-NEXT: @asm_named = internal global i32 0
+; CHECK-NEXT: @exported_data = global i32 7
+; CHECK: @[[ALIAS:[a-d]]] = internal alias i32, i32* @[[COUNTER]]
+
+; CHECK: define internal i32 @[[HELPER:[a-d]]](i32 %0) {
+; CHECK-NEXT: %2 = load i32, i32* @[[COUNTER]]
+; CHECK-NEXT: %3 = add i32 %2, %0
+; CHECK-NEXT: store i32 %3, i32* @[[ALIAS]]
+; CHECK: define internal i32 @comdat_helper() comdat {
+; CHECK: define i32 @api(i32 %0) {
+; CHECK-NEXT: %2 = getelementptr [2 x i32], [2 x i32]* @[[TABLE]], i32 0, i32 1
+; CHECK: call i32 @[[HELPER]](
+; CHECK-NEXT: call i32 @comdat_helper()
+; CHECK-NEXT: call i32 @external(
+; CHECK-NEXT: load i32, i32* @asm_named
+; CHECK: declare i32 @external(i32)
+; CHECK-NOT: {{@helper|@counter|@table|@alias_internal}}
+
+; MAP: # rename.c
+; MAP-DAG: {{^[a-d]}} alias_internal{{$}}
+; MAP-DAG: {{^[a-d]}} helper{{$}}
+; MAP-DAG: {{^[a-d]}} counter{{$}}
+; MAP-DAG: {{^[a-d]}} table{{$}}
+; MAP-NOT: {{comdat_helper|asm_named|exported_data|api|external}}
+
+source_filename = "rename.c"
+
+module asm ".symver asm_named, asm_named@V1"
+
+$comdat_helper = comdat any
+
+@counter = internal global i32 0, align 4
+@table = private constant [2 x i32] [i32 1, i32 2]
+@asm_named = internal global i32 0
+@exported_data = global i32 7
+@alias_internal = internal alias i32, i32* @counter
+
+define internal i32 @helper(i32 %x) {
+entry:
+  %v = load i32, i32* @counter
+  %sum = add i32 %v, %x
+  store i32 %sum, i32* @alias_internal
+  ret i32 %sum
+}
+
+define internal i32 @comdat_helper() comdat {
+  ret i32 1
+}
+
+define i32 @api(i32 %arg) {
+entry:
+  %p = getelementptr [2 x i32], [2 x i32]* @table, i32 0, i32 1
+  %t = load i32, i32* %p
+  %r = call i32 @helper(i32 %t)
+  %c = call i32 @comdat_helper()
+  %e = call i32 @external(i32 %r)
+  %a = load i32, i32* @asm_named
+  ret i32 %e
+}
+
+declare i32 @external(i32)
@@ -0,0 +1,85 @@
+# 用 opt 加载插件对 INPUT 运行 ARGS 指定的 Pass，每个种子运行一次：
+# opt 自带的校验器检查输出 IR，再用 FileCheck 按 INPUT 中的 CHECK 行检查
+#
+#   cmake -DOPT=... -DFILECHECK=... -DPLUGIN=... -DINPUT=... -DOUTPUT_DIR=...
+#         -DARGS="-passes=obf-junk ..." [-DSEEDS=1,2,3] [-DPREFIX=CHECK]
+#         [-DCHECK_FILES=yaml:REMARK,map:MAP] [-DDETERMINISTIC=ON] -P run_opt_test.cmake
+#
+# ARGS 中的 %t 替换为本次运行的输出路径前缀（不含扩展名），Pass 写出的附带文件
+# （备注 YAML、重命名映射等）放在 %t.<后缀>；CHECK_FILES 中的每一项 <后缀>:<前缀>
+# 用 FileCheck 的该前缀检查 %t.<后缀>。DETERMINISTIC 时同一种子再运行一次，
+# 两次输出必须逐字节相同，且不同种子的输出不能全部相同。
+
+if(NOT SEEDS)
+    set(SEEDS 1,2,3,4,5,6,7,8,9,10)
+endif()
+if(NOT PREFIX)
+    set(PREFIX CHECK)
+endif()
+string(REPLACE "," ";" SEEDS "${SEEDS}")
+string(REPLACE "," ";" CHECK_FILES "${CHECK_FILES}")
+get_filename_component(NAME "${INPUT}" NAME_WE)
+file(MAKE_DIRECTORY "${OUTPUT_DIR}")
+
+function(run_opt SEED BASE OUTPUT)
+    # 附带文件可能以追加方式写入，每次运行前清掉上一次的结果
+    file(GLOB STALE "${BASE}.*")
+    if(STALE)
+        file(REMOVE ${STALE})
+    endif()
+    string(REPLACE "%t" "${BASE}" SEED_ARGS "${ARGS}")
+    separate_arguments(SEED_ARGS UNIX_COMMAND "${SEED_ARGS}")
+    execute_process(
+        COMMAND "${OPT}" -load "${PLUGIN}" -load-pass-plugin "${PLUGIN}" ${SEED_ARGS}
+                -obf-seed=${SEED} -S "${INPUT}" -o "${OUTPUT}"
+        RESULT_VARIABLE RESULT
+        ERROR_VARIABLE ERRORS)
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "opt failed on ${NAME} with -obf-seed=${SEED}:\n${ERRORS}")
+    endif()
+endfunction()
+
+function(file_check SEED FILE CHECK_PREFIX)
+    execute_process(
+        COMMAND "${FILECHECK}" "${INPUT}" --check-prefix=${CHECK_PREFIX} --input-file "${FILE}"
+        RESULT_VARIABLE RESULT
+        ERROR_VARIABLE ERRORS)
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "FileCheck ${CHECK_PREFIX} failed on ${NAME} with -obf-seed=${SEED}:\n${ERRORS}")
+    endif()
+endfunction()
+
+set(HASHES)
+foreach(SEED IN LISTS SEEDS)
+    set(BASE "${OUTPUT_DIR}/${NAME}.seed${SEED}")
+    set(OUTPUT "${BASE}.ll")
+    run_opt(${SEED} "${BASE}" "${OUTPUT}")
+    file_check(${SEED} "${OUTPUT}" ${PREFIX})
+    foreach(ENTRY IN LISTS CHECK_FILES)
+        string(REPLACE ":" ";" ENTRY "${ENTRY}")
+        list(GET ENTRY 0 SUFFIX)
+        list(GET ENTRY 1 FILE_PREFIX)
+        file_check(${SEED} "${BASE}.${SUFFIX}" ${FILE_PREFIX})
+    endforeach()
+
+    if(DETERMINISTIC)
+        file(SHA256 "${OUTPUT}" HASH)
+        set(RERUN_BASE "${OUTPUT_DIR}/${NAME}.rerun${SEED}")
+        run_opt(${SEED} "${RERUN_BASE}" "${RERUN_BASE}.ll")
+        file(SHA256 "${RERUN_BASE}.ll" RERUN_HASH)
+        if(NOT HASH STREQUAL RERUN_HASH)
+            message(FATAL_ERROR "${NAME}: two runs with -obf-seed=${SEED} differ "
+                                "(${OUTPUT} vs ${RERUN_BASE}.ll)")
+        endif()
+        list(APPEND HASHES ${HASH})
+    endif()
+endforeach()
+
+if(DETERMINISTIC)
+    list(REMOVE_DUPLICATES HASHES)
+    list(LENGTH HASHES DISTINCT)
+    list(LENGTH SEEDS RUNS)
+    if(RUNS GREATER 1 AND DISTINCT EQUAL 1)
+        message(FATAL_ERROR "${NAME}: output does not depend on -obf-seed")
+    endif()
+endif()
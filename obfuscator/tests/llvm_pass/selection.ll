@@ -0,0 +1,111 @@
+; 函数选择：带 obf: 注解的函数只运行注解列出的 Pass（obf:none 不混淆，忽略命令行的
+; 通配符）；未注解的函数先排除匹配 -obf-exclude 的，再只保留匹配 -obf-functions 的。
+; 以 -obf-functions=hot_* -obf-exclude=hot_skip* 运行平坦化（CHECK）和垃圾指令（JUNK）
+
+@.str.flatten = private unnamed_addr constant [12 x i8] c"obf:flatten\00", section "llvm.metadata"
+@.str.none = private unnamed_addr constant [9 x i8] c"obf:none\00", section "llvm.metadata"
+@.str.junk = private unnamed_addr constant [11 x i8] c"obf:junk=2\00", section "llvm.metadata"
+@.str.file = private unnamed_addr constant [12 x i8] c"selection.c\00", section "llvm.metadata"
+@llvm.global.annotations = appending global [3 x { i8*, i8*, i8*, i32, i8* }] [
+  { i8*, i8*, i8*, i32, i8* } { i8* bitcast (i32 (i32)* @annotated_flatten to i8*), i8* getelementptr inbounds ([12 x i8], [12 x i8]* @.str.flatten, i32 0, i32 0), i8* getelementptr inbounds ([12 x i8], [12 x i8]* @.str.file, i32 0, i32 0), i32 1, i8* null },
+  { i8*, i8*, i8*, i32, i8* } { i8* bitcast (i32 (i32)* @hot_annotated_none to i8*), i8* getelementptr inbounds ([9 x i8], [9 x i8]* @.str.none, i32 0, i32 0), i8* getelementptr inbounds ([12 x i8], [12 x i8]* @.str.file, i32 0, i32 0), i32 2, i8* null },
+  { i8*, i8*, i8*, i32, i8* } { i8* bitcast (i32 (i32)* @annotated_junk to i8*), i8* getelementptr inbounds ([11 x i8], [11 x i8]* @.str.junk, i32 0, i32 0), i8* getelementptr inbounds ([12 x i8], [12 x i8]* @.str.file, i32 0, i32 0), i32 3, i8* null }
+], section "llvm.metadata"
+
+; CHECK-LABEL: define i32 @hot_path(
+; CHECK: obf.dispatch:
+; JUNK-LABEL: define i32 @hot_path(
+; JUNK: call void asm sideeffect
+define i32 @hot_path(i32 %x) {
+entry:
+  %c = icmp sgt i32 %x, 0
+  br i1 %c, label %pos, label %neg
+pos:
+  %a = mul i32 %x, 3
+  ret i32 %a
+neg:
+  %b = sub i32 0, %x
+  ret i32 %b
+}
+
+; CHECK-LABEL: define i32 @hot_skip_path(
+; CHECK-NOT: obf.dispatch
+; JUNK-LABEL: define i32 @hot_skip_path(
+; JUNK-NOT: asm sideeffect
+define i32 @hot_skip_path(i32 %x) {
+entry:
+  %c = icmp sgt i32 %x, 0
+  br i1 %c, label %pos, label %neg
+pos:
+  %a = mul i32 %x, 3
+  ret i32 %a
+neg:
+  %b = sub i32 0, %x
+  ret i32 %b
+}
+
+; CHECK-LABEL: define i32 @cold_path(
+; CHECK-NOT: obf.dispatch
+; JUNK-LABEL: define i32 @cold_path(
+; JUNK-NOT: asm sideeffect
+define i32 @cold_path(i32 %x) {
+entry:
+  %c = icmp sgt i32 %x, 0
+  br i1 %c, label %pos, label %neg
+pos:
+  %a = mul i32 %x, 3
+  ret i32 %a
+neg:
+  %b = sub i32 0, %x
+  ret i32 %b
+}
+
+; 注解选中平坦化，名字不匹配 -obf-functions 也运行；注解没有列出 junk
+; CHECK-LABEL: define i32 @annotated_flatten(
+; CHECK: obf.dispatch:
+; JUNK-LABEL: define i32 @annotated_flatten(
+; JUNK-NOT: asm sideeffect
+define i32 @annotated_flatten(i32 %x) {
+entry:
+  %c = icmp sgt i32 %x, 0
+  br i1 %c, label %pos, label %neg
+pos:
+  %a = mul i32 %x, 3
+  ret i32 %a
+neg:
+  %b = sub i32 0, %x
+  ret i32 %b
+}
+
+; 名字匹配 -obf-functions，但 obf:none 优先
+; CHECK-LABEL: define i32 @hot_annotated_none(
+; CHECK-NOT: obf.dispatch
+; JUNK-LABEL: define i32 @hot_annotated_none(
+; JUNK-NOT: asm sideeffect
+define i32 @hot_annotated_none(i32 %x) {
+entry:
+  %c = icmp sgt i32 %x, 0
+  br i1 %c, label %pos, label %neg
+pos:
+  %a = mul i32 %x, 3
+  ret i32 %a
+neg:
+  %b = sub i32 0, %x
+  ret i32 %b
+}
+
+; CHECK-LABEL: define i32 @annotated_junk(
+; CHECK-NOT: obf.dispatch
+; JUNK-LABEL: define i32 @annotated_junk(
+; JUNK: call void asm sideeffect
+define i32 @annotated_junk(i32 %x) {
+entry:
+  %c = icmp sgt i32 %x, 0
+  br i1 %c, label %pos, label %neg
+pos:
+  %a = mul i32 %x, 3
+  ret i32 %a
+neg:
+  %b = sub i32 0, %x
+  ret i32 %b
+}
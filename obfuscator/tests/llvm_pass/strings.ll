@@ -0,0 +1,74 @@
+; 内部常量字符串合并为一段密文 @obf.str.enc，使用前检查 @obf.str.ready 中该字符串的
+; 状态（0 未解密、1 解密中、2 已解密），不等于 2 时走冷路径调用 @obf.str.decrypt。
+; 被已有检查支配的使用不再检查；外部可见和未使用的字符串保持原样
+
+; CHECK-NOT: {{hello|goodbye}}
+; CHECK: @exported = constant [9 x i8] c"exported\00"
+; CHECK: @.str.unused = private unnamed_addr constant [7 x i8] c"unused\00"
+; CHECK-NOT: {{hello|goodbye}}
+; CHECK: @obf.str.enc = private constant [20 x i8] c"
+; CHECK-NOT: {{hello|goodbye}}
+; CHECK: @obf.str.data = internal global [20 x i8] zeroinitializer
+; CHECK: @obf.str.ready = internal global [2 x i8] zeroinitializer
+; CHECK: @obf.str.table = private constant [2 x { i32, i32, i32 }] [{ i32, i32, i32 } { i32 0, i32 12, i32 {{-?[0-9]+}} }, { i32, i32, i32 } { i32 12, i32 8, i32 {{-?[0-9]+}} }]
+; CHECK-NOT: {{hello|goodbye}}
+source_filename = "strings.c"
+
+@.str.hello = private unnamed_addr constant [12 x i8] c"hello world\00", align 1
+@.str.bye = private unnamed_addr constant [8 x i8] c"goodbye\00", align 1
+@exported = constant [9 x i8] c"exported\00", align 1
+@.str.unused = private unnamed_addr constant [7 x i8] c"unused\00", align 1
+
+; CHECK-LABEL: define void @greet(
+; CHECK: %obf.str.ready = load atomic i8, i8* getelementptr inbounds ([2 x i8], [2 x i8]* @obf.str.ready, i32 0, i32 0) acquire, align 1
+; CHECK-NEXT: [[COLD:%[0-9]+]] = icmp ne i8 %obf.str.ready, 2
+; CHECK-NEXT: br i1 [[COLD]], label %[[DECRYPT:[0-9]+]], label %{{[0-9]+}}, !prof [[UNLIKELY:![0-9]+]]
+; CHECK: [[DECRYPT]]:
+; CHECK-NEXT: call void @obf.str.decrypt(i32 0)
+; CHECK: %h = getelementptr inbounds [12 x i8], [12 x i8]* bitcast ([20 x i8]* @obf.str.data to [12 x i8]*)
+; CHECK-NEXT: call i32 @puts(i8* %h)
+; CHECK-NEXT: call i32 @puts(i8* %h)
+; CHECK: then:
+; CHECK-NEXT: %obf.str.ready1 = load atomic i8, {{.*}} @obf.str.ready, i32 0, i32 1) acquire
+; CHECK: call void @obf.str.decrypt(i32 1)
+; CHECK-NOT: @obf.str.ready
+; CHECK: exit:
+; CHECK-NEXT: %p = phi i8* [ {{.*}} @obf.str.data, i32 0, i32 12) {{.*}} ], [ getelementptr inbounds ([9 x i8], [9 x i8]* @exported, i64 0, i64 0), %{{[0-9]+}} ]
+define void @greet(i1 %c) {
+entry:
+  %h = getelementptr inbounds [12 x i8], [12 x i8]* @.str.hello, i64 0, i64 0
+  call i32 @puts(i8* %h)
+  call i32 @puts(i8* %h)
+  br i1 %c, label %then, label %exit
+
+then:
+  call i32 @puts(i8* getelementptr inbounds ([8 x i8], [8 x i8]* @.str.bye, i64 0, i64 0))
+  br label %exit
+
+exit:
+  %p = phi i8* [ getelementptr inbounds ([8 x i8], [8 x i8]* @.str.bye, i64 0, i64 0), %then ], [ getelementptr inbounds ([9 x i8], [9 x i8]* @exported, i64 0, i64 0), %entry ]
+  call i32 @puts(i8* %p)
+  ret void
+}
+
+; 解密桩：cmpxchg 0->1 抢到的线程解密后以 release 写入 2，其余线程等待 2
+; CHECK-LABEL: define internal void @obf.str.decrypt(
+; CHECK-SAME: i32 %0) #[[ATTRS:[0-9]+]] {
+; CHECK: entry:
+; CHECK: [[CLAIM:%[0-9]+]] = cmpxchg i8* [[STATE:%[0-9]+]], i8 0, i8 1 acquire acquire
+; CHECK-NEXT: [[WON:%[0-9]+]] = extractvalue { i8, i1 } [[CLAIM]], 1
+; CHECK-NEXT: br i1 [[WON]], label %claimed, label %wait
+; CHECK: loop:
+; CHECK: xor i8
+; CHECK: mul i32 %k, 1103515245
+; CHECK: exit:
+; CHECK-NEXT: store atomic i8 2, i8* [[STATE]] release
+; CHECK: wait:
+; CHECK-NEXT: [[SEEN:%[0-9]+]] = load atomic i8, i8* [[STATE]] acquire
+; CHECK-NEXT: [[READY:%[0-9]+]] = icmp eq i8 [[SEEN]], 2
+; CHECK-NEXT: br i1 [[READY]], label %done, label %wait
+
+; CHECK: attributes #[[ATTRS]] = { cold noinline nounwind }
+; CHECK: [[UNLIKELY]] = !{!"branch_weights", i32 1, i32 1048576}
+
+declare i32 @puts(i8*)
@@ -0,0 +1,285 @@
+/*
+ * 汇编解析器测试 (Google Test)
+ */
+
+#include <gtest/gtest.h>
+#include "parser/code_parser.h"
+#include <algorithm>
+
+using namespace obfuscator;
+
+namespace {
+
+const char* kLoopAssembly =
+    "\t.text\n"
+    "\t.globl\tsum\n"
+    "\t.type\tsum, @function\n"
+    "sum:\n"
+    "\t.cfi_startproc\n"
+    "\ttestl\t%esi, %esi\n"
+    "\tjle\t.L4\n"
+    "\txorl\t%eax, %eax\n"
+    "\t.p2align 4\n"
+    ".L3:\n"
+    "\taddl\t(%rdi), %eax\n"
+    "\taddq\t$4, %rdi\n"
+    "\tsubl\t$1, %esi\n"
+    "\tjne\t.L3\n"
+    "\tret\n"
+    ".L4:\n"
+    "\txorl\t%eax, %eax\n"
+    "\tjmp\tother@PLT\n"
+    "\t.cfi_endproc\n"
+    "\t.size\tsum, .-sum\n"
+    "\t.type\tdispatch, @function\n"
+    "dispatch:\n"
+    "\tjmp\t*.L9(,%rdi,8)\n"
+    "\t.size\tdispatch, .-dispatch\n";
+
+std::vector<uint32_t> toVector(AssemblyParser::ControlFlowGraph::Range range) {
+    return std::vector<uint32_t>(range.begin(), range.end());
+}
+
+} // namespace
+
+// 块首来自函数入口、标签和跳转之后的指令；后继与前驱互为转置
+TEST(AssemblyParserTest, BuildsLeaderBasedCFG) {
+    AssemblyParser parser;
+    ASSERT_TRUE(parser.parse(kLoopAssembly));
+    const auto& cfg = parser.getCFG();
+
+    // sum: [test,jle] [xor] [.L3 循环] [ret] [.L4 尾调用]；dispatch: [jmp*]
+    ASSERT_EQ(cfg.blocks.size(), 6u);
+    EXPECT_EQ(parser.symbolName(cfg.blocks[0].label), "sum");
+    EXPECT_EQ(parser.symbolName(cfg.blocks[2].label), ".L3");
+    EXPECT_EQ(parser.symbolName(cfg.blocks[4].label), ".L4");
+    EXPECT_EQ(parser.symbolName(cfg.blocks[5].label), "dispatch");
+    EXPECT_EQ(cfg.blocks[1].label, AssemblyParser::kNoSymbol);
+
+    EXPECT_EQ(toVector(cfg.successorsOf(0)), (std::vector<uint32_t>{4, 1}));
+    EXPECT_EQ(toVector(cfg.successorsOf(1)), (std::vector<uint32_t>{2}));
+    EXPECT_EQ(toVector(cfg.successorsOf(2)), (std::vector<uint32_t>{2, 3}));
+    EXPECT_TRUE(cfg.successorsOf(3).size() == 0 && !cfg.blocks[3].unknownSuccessors);
+    EXPECT_TRUE(cfg.successorsOf(4).size() == 0 && cfg.blocks[4].unknownSuccessors);
+    EXPECT_TRUE(cfg.successorsOf(5).size() == 0 && cfg.blocks[5].unknownSuccessors);
+
+    EXPECT_EQ(toVector(cfg.predecessorsOf(2)), (std::vector<uint32_t>{1, 2}));
+    EXPECT_EQ(toVector(cfg.predecessorsOf(4)), (std::vector<uint32_t>{0}));
+    EXPECT_EQ(cfg.predecessorsOf(0).size(), 0u);
+}
+
+// 函数边界取自 .type/.size，而不是固定长度
+TEST(AssemblyParserTest, FunctionBoundariesFollowTypeAndSize) {
+    AssemblyParser parser;
+    ASSERT_TRUE(parser.parse(kLoopAssembly));
+    auto functions = parser.findFunctionBoundaries();
+
+    ASSERT_EQ(functions.size(), 2u);
+    EXPECT_EQ(functions[0].name, "sum");
+    EXPECT_EQ(functions[0].firstInstruction, 0u);
+    EXPECT_EQ(functions[0].endInstruction, 10u);
+    EXPECT_EQ(functions[1].name, "dispatch");
+    EXPECT_EQ(functions[1].endInstruction, 11u);
+    EXPECT_EQ(parser.getCFG().blocks[5].function, 1);
+}
+
+// 前缀记为位，助记符驻留为操作码，操作数解析为定长描述符
+TEST(AssemblyParserTest, ParsesPrefixesAndOperands) {
+    using Kind = AssemblyParser::OperandKind;
+    AssemblyParser parser;
+    ASSERT_TRUE(parser.parse("f:\n\trep stosb\n\t.intel_syntax noprefix\n"
+                             "\tmov\teax, DWORD PTR [rbp-4]\n\t.att_syntax\n"
+                             "\tlock xaddl\t%eax, (%rdi) # atomic\n\trep ret\n"
+                             "\tmovl\t.LC0+8(,%rcx,4), %edx\n\tjmp\tf\n"));
+    auto instructions = parser.getInstructions();
+
+    ASSERT_EQ(instructions.size(), 6u);
+    EXPECT_EQ(instructions[0].prefixes, AssemblyParser::PREFIX_REP);
+    EXPECT_EQ(AssemblyParser::opcodeName(instructions[0].opcode), "stosb");
+    EXPECT_EQ(instructions[2].prefixes, AssemblyParser::PREFIX_LOCK);
+    EXPECT_EQ(instructions[3].opcode, AssemblyParser::findOpcode("RET"));
+
+    auto mov = parser.operands(instructions[1]);
+    ASSERT_EQ(mov.size(), 2u);
+    EXPECT_EQ(mov[0].kind, Kind::REGISTER);
+    EXPECT_EQ(mov[0].base, 0u);
+    EXPECT_EQ(mov[0].width(), 32);
+    EXPECT_EQ(mov[1].kind, Kind::MEMORY);
+    EXPECT_EQ(mov[1].base, 5u);
+    EXPECT_FALSE(mov[1].hasIndex());
+    EXPECT_EQ(mov[1].width(), 32);
+    EXPECT_EQ(parser.operandValue(mov[1]), -4);
+
+    auto xadd = parser.operands(instructions[2]);
+    ASSERT_EQ(xadd.size(), 2u);
+    EXPECT_EQ(xadd[1].kind, Kind::MEMORY);
+    EXPECT_EQ(xadd[1].base, 7u);
+
+    auto table = parser.operands(instructions[4]);
+    EXPECT_FALSE(table[0].hasBase());
+    EXPECT_EQ(table[0].index, 1u);
+    EXPECT_EQ(table[0].scale, 2u);
+    EXPECT_EQ(parser.symbolName(parser.operandSymbol(table[0])), ".LC0+8");
+
+    auto jump = parser.operands(instructions[5]);
+    EXPECT_EQ(jump[0].kind, Kind::TARGET);
+    EXPECT_EQ(parser.operandSymbol(jump[0]), parser.findSymbol("f"));
+
+    // 按操作码的索引
+    EXPECT_EQ(parser.findInstructions("STOSB").size(), 1u);
+    EXPECT_EQ(parser.instructionsWithOpcode(instructions[5].opcode).size(), 1u);
+    EXPECT_TRUE(parser.findInstructions("no-such-mnemonic").empty());
+
+    // 没有 .type 时以非局部标签为函数
+    auto functions = parser.findFunctionBoundaries();
+    ASSERT_EQ(functions.size(), 1u);
+    EXPECT_EQ(functions[0].endInstruction, 6u);
+}
+
+// 读取与完整改写的寄存器：清零惯用法不读取，8 位写入只算读取，不认识的指令读取全部
+TEST(AssemblyParserTest, RegisterEffects) {
+    using RM = AssemblyParser::RegisterMask;
+    const RM rax = 1u << 0, rcx = 1u << 1, rdx = 1u << 2, rbx = 1u << 3;
+    AssemblyParser parser;
+    ASSERT_TRUE(parser.parse("f:\n\txorl\t%eax, %eax\n\tmovb\t$1, %al\n\tshlq\t%cl, %rdx\n"
+                             "\tcpuid\n\t.intel_syntax noprefix\n"
+                             "\tadd\teax, DWORD PTR [rbx+rcx*4]\n"));
+    const auto& instructions = parser.getInstructions();
+    ASSERT_EQ(instructions.size(), 5u);
+
+    auto xorEffects = parser.registerEffects(instructions[0]);
+    EXPECT_EQ(xorEffects.uses, 0u);
+    EXPECT_EQ(xorEffects.defs, rax | AssemblyParser::kFlagsMask);
+
+    auto movEffects = parser.registerEffects(instructions[1]);
+    EXPECT_EQ(movEffects.uses, rax);
+    EXPECT_EQ(movEffects.defs, 0u);
+
+    auto shiftEffects = parser.registerEffects(instructions[2]);
+    EXPECT_EQ(shiftEffects.uses, rcx | rdx);
+    EXPECT_EQ(shiftEffects.defs, rdx);
+
+    EXPECT_EQ(parser.registerEffects(instructions[3]).uses,
+              AssemblyParser::kAllRegisters);
+
+    auto addEffects = parser.registerEffects(instructions[4]);
+    EXPECT_EQ(addEffects.uses, rax | rbx | rcx);
+    EXPECT_EQ(addEffects.defs, rax | AssemblyParser::kFlagsMask);
+}
+
+// 逆向活跃性：cmp 定义的标志位活跃到 jne，rax 在被 movl 改写之前是死的
+TEST(AssemblyParserTest, ComputesLiveness) {
+    using RM = AssemblyParser::RegisterMask;
+    const RM rax = 1u << 0, rsi = 1u << 6, rdi = 1u << 7;
+    AssemblyParser parser;
+    ASSERT_TRUE(parser.parse("\t.type\tf, @function\nf:\n\tcmpl\t$1, %edi\n\tmovl\t$0, %eax\n"
+                             "\tjne\t.L2\n\tmovl\t%esi, %eax\n.L2:\n\tret\n\t.size\tf, .-f\n"));
+    auto live = parser.computeLiveness();
+    ASSERT_EQ(live.size(), 5u);
+
+    EXPECT_TRUE(live[0] & rdi);
+    EXPECT_TRUE(live[0] & rsi);
+    EXPECT_FALSE(live[0] & rax);
+    EXPECT_FALSE(live[0] & AssemblyParser::kFlagsMask);
+
+    EXPECT_TRUE(live[1] & AssemblyParser::kFlagsMask);
+    EXPECT_FALSE(live[1] & rax);
+
+    EXPECT_FALSE(live[3] & rax);
+
+    // ret 处保守地视为全部寄存器活跃
+    EXPECT_EQ(live[4], AssemblyParser::kAllRegisters);
+}
+
+// 对齐伪指令：.p2align 以 2 的幂计，.balign/.align 以字节计；第三个参数是填充上限
+TEST(AssemblyParserTest, ParsesAlignmentDirectives) {
+    unsigned boundary = 0;
+    unsigned maxSkip = 0;
+    ASSERT_TRUE(AssemblyParser::parseAlignment("\t.p2align 4,,10", boundary, maxSkip));
+    EXPECT_EQ(boundary, 16u);
+    EXPECT_EQ(maxSkip, 10u);
+    ASSERT_TRUE(AssemblyParser::parseAlignment("\t.p2align 3", boundary, maxSkip));
+    EXPECT_EQ(boundary, 8u);
+    EXPECT_EQ(maxSkip, 7u);
+    ASSERT_TRUE(AssemblyParser::parseAlignment(".balign 32", boundary, maxSkip));
+    EXPECT_EQ(boundary, 32u);
+    ASSERT_TRUE(AssemblyParser::parseAlignment("\t.align 16", boundary, maxSkip));
+    EXPECT_EQ(boundary, 16u);
+    EXPECT_FALSE(AssemblyParser::parseAlignment("\t.type\tf, @function", boundary, maxSkip));
+
+    // 跳转表所在的 .rodata 里的 .align 不影响代码地址
+    AssemblyParser parser;
+    ASSERT_TRUE(parser.parse("\t.type\tf, @function\nf:\n\tmovl\t%edi, %eax\n\tjmp\t.L2\n"
+                             "\t.section\t.rodata\n\t.align 4\n.L5:\n\t.long\t0\n\t.text\n"
+                             "\t.p2align 4,,10\n\t.p2align 3\n.L2:\n\tret\n\t.size\tf, .-f\n"));
+    const auto& alignments = parser.getAlignments();
+    ASSERT_EQ(alignments.size(), 2u);
+    EXPECT_EQ(alignments[0].address, 4u);
+    EXPECT_EQ(alignments[0].padding, 0u);      // 需要 12 字节，超过上限 10
+    EXPECT_EQ(alignments[1].padding, 4u);
+    EXPECT_EQ(alignments[1].nextInstruction, 2u);
+    EXPECT_EQ(parser.getInstructions()[2].address, 8u);
+}
+
+// 长度估计：与 GNU as 的编码一致
+TEST(AssemblyParserTest, EstimatesInstructionSizes) {
+    const std::pair<const char*, unsigned> att[] = {
+        {"movl\t%edi, %eax", 2}, {"addq\t$1, %rax", 4}, {"movq\t8(%rsp), %rax", 5},
+        {"movl\t$5, %r8d", 6}, {"leaq\t.LC0(%rip), %rdi", 7}, {"ret", 1},
+        {"call\tfoo", 5}, {"pushq\t%rbp", 1}, {"pushq\t%r12", 2},
+        {"movzbl\t(%rdi,%rcx), %eax", 4}, {"movl\t%eax, -4(%rbp)", 3},
+        {"imull\t$100, %esi, %eax", 3}, {"cmpb\t$0, (%rdi)", 3}, {"jmp\t*%rax", 2},
+        {"cmpq\t$1000, %rax", 6}, {"testb\t$1, %al", 2}, {"andl\t$255, %eax", 5},
+        {"cmpb\t$1, %ah", 3}, {"movslq\t%edi, %rax", 3}, {"pushq\t$1", 2}, {"rep stosq", 3},
+        {"xorps\t%xmm0, %xmm0", 3}, {"movq\t%rax, %xmm0", 5}, {"vpxor\t%xmm8, %xmm1, %xmm0", 5},
+        {"vmovaps\t%xmm8, %xmm0", 4}, {"pshufb\t%xmm1, %xmm0", 5}, {"popcntq\t%rdi, %rax", 5},
+        {"xchgq\t%rax, %rax", 1}, {"fldz", 2}, {"je\tfoo", 6},
+    };
+    for (const auto& [text, size] : att) {
+        AssemblyParser parser;
+        ASSERT_TRUE(parser.parse(std::string("\t") + text + "\n"));
+        EXPECT_EQ(parser.getInstructions()[0].size, size) << text;
+    }
+
+    const std::pair<const char*, unsigned> intel[] = {
+        {"mov\trax, QWORD PTR [rsp+8]", 5}, {"movdqu\txmm1, XMMWORD PTR [rdi]", 4},
+        {"lea\tr12, 880[rsp]", 8}, {"add\teax, 1", 3}, {"mov\tQWORD PTR fs:40, rax", 9},
+        {"movsx\trax, edx", 3}, {"movsd\txmm0, QWORD PTR [rsp+8]", 6},
+        {"fstp\tQWORD PTR [rsp]", 3}, {"movhps\txmm0, QWORD PTR .LC0[rip]", 7},
+    };
+    for (const auto& [text, size] : intel) {
+        AssemblyParser parser;
+        parser.setIntelSyntax(true);
+        ASSERT_TRUE(parser.parse(std::string("\t") + text + "\n"));
+        EXPECT_EQ(parser.getInstructions()[0].size, size) << text;
+    }
+}
+
+// 直接跳转按目标距离选择 rel8/rel32；其他节、弱符号与未定义的目标总是 rel32；
+// 每个节单独计算地址；gcc 在另一节中的 f.cold 属于 f，不结束 f
+TEST(AssemblyParserTest, RelaxesBranchesPerSection) {
+    std::string text = "\t.weak\tw\n\t.type\tf, @function\nf:\n\tjne\t.L3\n\tjmp\t.L2\n.L2:\n";
+    for (int i = 0; i < 13; ++i) {
+        text += "\tmovabsq\t$1, %rax\n";     // 10 字节
+    }
+    text += ".L3:\n\tret\n\t.section\t.text.unlikely\n\t.type\tf.cold, @function\nf.cold:\n\tjmp\t.L2\n"
+            "\t.text\n\tjmp\tg\nw:\n\tjmp\tw\n\t.set\tg, .L3\n\t.size\tf, .-f\n";
+
+    AssemblyParser parser;
+    ASSERT_TRUE(parser.parse(text));
+    const auto& instructions = parser.getInstructions();
+    ASSERT_EQ(instructions.size(), 19u);
+    EXPECT_EQ(instructions[0].size, 6u);        // 越过 130 字节
+    EXPECT_EQ(instructions[1].size, 2u);
+    EXPECT_EQ(instructions[15].address, 138u);
+    EXPECT_EQ(instructions[16].address, 0u);    // .text.unlikely 从 0 开始
+    EXPECT_EQ(instructions[16].size, 5u);
+    EXPECT_EQ(instructions[17].address, 139u);
+    EXPECT_EQ(instructions[17].size, 2u);       // .set 别名按目标 .L3 处理
+    EXPECT_EQ(instructions[18].size, 5u);       // 弱符号
+    auto functions = parser.findFunctionBoundaries();
+    ASSERT_EQ(functions.size(), 1u);
+    EXPECT_EQ(functions[0].startAddr, 0u);
+    EXPECT_EQ(functions[0].endAddr, 146u);
+    EXPECT_EQ(parser.findJumpTargets()[1], 8u);
+}
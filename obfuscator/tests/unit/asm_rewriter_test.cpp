@@ -0,0 +1,238 @@
+/*
+ * 汇编重写器测试 (Google Test)
+ */
+
+#include <gtest/gtest.h>
+#include "asm_rewriter/asm_rewriter.h"
+#include "parser/code_parser.h"
+#include <algorithm>
+#include <sstream>
+
+using namespace obfuscator;
+
+namespace {
+
+// 生成含若干函数与数据段的 AT&T 汇编
+std::string sampleAssembly(int functions) {
+    std::ostringstream out;
+    out << "\t.file\t\"t.c\"\n\t.text\n";
+    for (int i = 0; i < functions; ++i) {
+        std::string name = "f" + std::to_string(i);
+        out << "\t.globl\t" << name << "\n";
+        out << "\t.type\t" << name << ", @function\n";
+        out << name << ":\n";
+        out << "\t.cfi_startproc\n";
+        out << "\tmovl\t%edi, %eax\n";
+        out << "\taddl\t$" << i << ", %eax\n";
+        out << "\trep\n\tstosb\n";
+        out << ".L" << i << ":\n";
+        out << "\tret\n";
+        out << "\t.cfi_endproc\n";
+        out << "\t.size\t" << name << ", .-" << name << "\n";
+    }
+    out << "\t.section\t.rodata\n.LC0:\n\t.string\t\"movl %eax, %ebx\"\n";
+    return out.str();
+}
+
+std::string rewrite(const std::string& input, unsigned threads, size_t batchBytes,
+                    AsmRewriter::Statistics* stats = nullptr) {
+    AsmRewriter rewriter(42);
+    rewriter.setDensity(1.0f);
+    rewriter.setThreads(threads);
+    rewriter.setBatchBytes(batchBytes);
+    std::istringstream in(input);
+    std::ostringstream out;
+    EXPECT_TRUE(rewriter.rewriteStream(in, out));
+    if (stats) {
+        *stats = rewriter.getStatistics();
+    }
+    return out.str();
+}
+
+} // namespace
+
+// 原有的每一行都按顺序保留，花指令只出现在函数内部，且不插在前缀与指令之间
+TEST(AsmRewriterTest, PreservesLinesAndOnlyTouchesFunctions) {
+    std::string input = sampleAssembly(3);
+    AsmRewriter::Statistics stats;
+    std::string output = rewrite(input, 1, 64, &stats);
+
+    std::istringstream original(input);
+    std::istringstream rewritten(output);
+    std::string expected;
+    std::string line;
+    std::string previous;
+    bool inFunction = false;
+    size_t junk = 0;
+    while (std::getline(rewritten, line)) {
+        std::streampos mark = original.tellg();
+        if (std::getline(original, expected) && expected == line) {
+            if (line.rfind("f", 0) == 0 && line.back() == ':') {
+                inFunction = true;
+            } else if (line.rfind("\t.size", 0) == 0) {
+                inFunction = false;
+            }
+            previous = line;
+            continue;
+        }
+        original.clear();
+        original.seekg(mark);
+        EXPECT_TRUE(inFunction) << line;
+        EXPECT_NE(previous, "\trep");
+        ++junk;
+        previous = line;
+    }
+    EXPECT_FALSE(std::getline(original, expected));
+    EXPECT_EQ(stats.functions, 3u);
+    EXPECT_EQ(stats.inserted, junk);
+    EXPECT_GT(junk, 0u);
+}
+
+// 输出只由种子决定，与线程数和批次大小无关
+TEST(AsmRewriterTest, OutputIndependentOfThreads) {
+    std::string input = sampleAssembly(50);
+    AsmRewriter::Statistics stats;
+    std::string serial = rewrite(input, 1, 1 << 16);
+    std::string parallel = rewrite(input, 4, 256, &stats);
+    EXPECT_EQ(serial, parallel);
+    EXPECT_GT(stats.peakPendingBytes, 0u);
+    EXPECT_LT(stats.peakPendingBytes, input.size());
+}
+
+// Intel 语法下生成的花指令不带 AT&T 的寄存器前缀
+TEST(AsmRewriterTest, FollowsIntelSyntax) {
+    std::string input =
+        "\t.intel_syntax noprefix\n\t.type\tg, @function\ng:\n\tmov\teax, edi\n\tret\n"
+        "\t.size\tg, .-g\n";
+    std::string output = rewrite(input, 1, 64);
+    EXPECT_EQ(output.find('%'), std::string::npos);
+    EXPECT_GT(output.size(), input.size());
+}
+
+// 标志位活跃时不插入改写标志位的花指令，只改写死寄存器，不访问栈
+TEST(AsmRewriterTest, JunkRespectsLiveness) {
+    std::string input =
+        "\t.type\tf, @function\nf:\n\tcmpl\t$1, %edi\n\tmovl\t$0, %eax\n\tjne\t.L2\n"
+        "\tmovl\t%esi, %eax\n.L2:\n\tret\n\t.size\tf, .-f\n";
+    const std::vector<std::string> flagWriters = {"xorl", "addl", "imull", "testq", "cmpl"};
+
+    for (uint32_t seed = 1; seed <= 50; ++seed) {
+        AsmRewriter rewriter(seed);
+        rewriter.setDensity(1.0f);
+        rewriter.setThreads(1);
+        std::istringstream in(input);
+        std::ostringstream out;
+        ASSERT_TRUE(rewriter.rewriteStream(in, out));
+
+        std::istringstream lines(out.str());
+        std::string line;
+        bool betweenCmpAndJne = false;
+        while (std::getline(lines, line)) {
+            EXPECT_EQ(line.find("push"), std::string::npos);
+            EXPECT_EQ(line.find("pop"), std::string::npos);
+            if (line == "\tcmpl\t$1, %edi") {
+                betweenCmpAndJne = true;
+                continue;
+            }
+            if (line == "\tjne\t.L2") {
+                betweenCmpAndJne = false;
+            }
+            if (!betweenCmpAndJne || line == "\tmovl\t$0, %eax") {
+                continue;
+            }
+            std::string mnemonic = line.substr(1, line.find('\t', 1) - 1);
+            EXPECT_EQ(std::count(flagWriters.begin(), flagWriters.end(), mnemonic), 0) << line;
+            // 此处只有 rax 是死的（寄存器移到自身的中性形式除外）
+            size_t comma = line.rfind(", ");
+            if (mnemonic == "movl" || mnemonic == "movq" || mnemonic == "leaq") {
+                std::string dest = line.substr(comma + 2);
+                std::string source = line.substr(line.find('\t', 1) + 1);
+                source = source.substr(0, source.find(','));
+                EXPECT_TRUE(dest == "%eax" || dest == "%rax" || dest == source ||
+                            source == "(" + dest + ")") << line;
+            }
+        }
+    }
+}
+
+// 每个基本块的花指令不超过周期与字节预算；预算为 0 时不插入
+TEST(AsmRewriterTest, RespectsBlockBudget) {
+    std::string input = sampleAssembly(3);     // 每个函数两个基本块
+    for (CpuModel cpu : {CpuModel::GENERIC, CpuModel::SKYLAKE, CpuModel::ZEN3}) {
+        AsmRewriter rewriter(7);
+        rewriter.setDensity(1.0f);
+        rewriter.setThreads(1);
+        rewriter.setCpuModel(cpu);
+        rewriter.setBlockBudget(0.5, 4);
+        std::istringstream in(input);
+        std::ostringstream out;
+        ASSERT_TRUE(rewriter.rewriteStream(in, out));
+        EXPECT_GT(rewriter.getStatistics().inserted, 0u);
+        EXPECT_LE(rewriter.getStatistics().bytes, 6u * 4);
+        EXPECT_LE(rewriter.getStatistics().cycles, 6 * 0.5 + 1e-9);
+    }
+
+    AsmRewriter rewriter(7);
+    rewriter.setDensity(1.0f);
+    rewriter.setBlockBudget(0.0, 0);
+    std::istringstream in(input);
+    std::ostringstream out;
+    ASSERT_TRUE(rewriter.rewriteStream(in, out));
+    EXPECT_EQ(out.str(), input);
+}
+
+// 原来对齐的循环头去掉填充上限后仍然对齐；循环体内的花指令不超过 32 字节窗口的余量；
+// 开启对齐填充时，花指令恰好占满原来的 NOP 填充
+TEST(AsmRewriterTest, KeepsAlignedLoopHeaders) {
+    std::string input =
+        "\t.p2align 4\n\t.type\tloop, @function\nloop:\n"
+        "\tmovl\t%edi, %ecx\n\tmovl\t%esi, %edx\n\txorl\t%eax, %eax\n\tjmp\t.L2\n"
+        "\t.p2align 4,,10\n\t.p2align 3\n"
+        ".L3:\n\taddl\t%edx, %eax\n\tsubl\t$1, %ecx\n"
+        ".L2:\n\ttestl\t%ecx, %ecx\n\tjne\t.L3\n\tret\n\t.size\tloop, .-loop\n";
+
+    for (uint32_t seed = 1; seed <= 20; ++seed) {
+        AsmRewriter rewriter(seed);
+        rewriter.setDensity(1.0f);
+        rewriter.setThreads(1);
+        rewriter.setBlockBudget(10.0, 64);
+        std::istringstream in(input);
+        std::ostringstream out;
+        ASSERT_TRUE(rewriter.rewriteStream(in, out));
+        EXPECT_NE(out.str().find("\t.p2align 4\n\t.p2align 3\n.L3:"), std::string::npos);
+
+        // 循环 9 字节，以 16 字节对齐起步时最多再放 7 字节
+        AssemblyParser parser;
+        ASSERT_TRUE(parser.parse(out.str()));
+        const auto& instructions = parser.getInstructions();
+        const auto& blocks = parser.getCFG().blocks;
+        auto header = std::find_if(blocks.begin(), blocks.end(),
+                                   [&](const auto& block) { return parser.symbolName(block.label) == ".L3"; });
+        ASSERT_NE(header, blocks.end());
+        unsigned loopBytes = 0;
+        for (size_t i = header->firstInstruction; i < instructions.size(); ++i) {
+            loopBytes += instructions[i].size;
+            if (AssemblyParser::opcodeName(instructions[i].opcode) == "jne" &&
+                parser.operandSymbol(parser.operands(instructions[i])[0]) == header->label) {
+                break;
+            }
+        }
+        EXPECT_GE(loopBytes, 9u);
+        EXPECT_LE(loopBytes, 9u + 7u);
+    }
+
+    // 只有对齐填充：jmp 之后到 .L3 的 8 字节全部换成花指令
+    AsmRewriter rewriter(3);
+    rewriter.setDensity(1.0f);
+    rewriter.setBlockBudget(0.0, 0);
+    rewriter.setAlignmentPadding(true);
+    std::istringstream in(input);
+    std::ostringstream out;
+    ASSERT_TRUE(rewriter.rewriteStream(in, out));
+    EXPECT_EQ(rewriter.getStatistics().paddingBytes, 8u);
+    EXPECT_EQ(rewriter.getStatistics().bytes, 8u);
+    size_t jump = out.str().find("\tjmp\t.L2\n");
+    size_t align = out.str().find("\t.p2align 4\n\t.p2align 3\n.L3:");
+    ASSERT_LT(jump, align);
+    EXPECT_GT(align - jump, std::string("\tjmp\t.L2\n").size());
+}
@@ -0,0 +1,152 @@
+/*
+ * 混淆引擎测试 (Google Test)
+ */
+
+#include <gtest/gtest.h>
+#include "engine/obfuscation_engine.h"
+#include "strategy/obfuscation_strategy.h"
+#include "parser/code_parser.h"
+#include <fstream>
+
+using namespace obfuscator;
+
+TEST(ObfuscationEngineTest, AppliesEnabledStrategies) {
+    ObfuscationEngine engine;
+    engine.addStrategy(std::make_unique<StringEncryptionStrategy>());
+
+    std::string output;
+    ASSERT_TRUE(engine.obfuscate("void f(void) { puts(\"hello world\"); }\n", output));
+
+    EXPECT_EQ(engine.getStatistics().strategiesApplied, 1);
+    EXPECT_EQ(output.find("hello world"), std::string::npos);
+}
+
+TEST(ObfuscationEngineTest, RejectsEmptyInput) {
+    ObfuscationEngine engine;
+    std::string output;
+    EXPECT_FALSE(engine.obfuscate("", output));
+}
+
+// 合并模式：跨文件的相同字符串只加密一次
+TEST(ObfuscationEngineTest, AmalgamatedBatchSharesStrings) {
+    const std::string dir = ::testing::TempDir();
+    const std::vector<std::string> inputs = { dir + "amalg_a.c", dir + "amalg_b.c" };
+    std::ofstream(inputs[0]) << "void a(void) { puts(\"shared message\"); }\n";
+    std::ofstream(inputs[1]) << "void b(void) { puts(\"shared message\"); }\n";
+
+    ObfuscationEngine engine;
+    engine.addStrategy(std::make_unique<StringEncryptionStrategy>());
+    const std::string outputFile = dir + "amalg_out.c";
+    ASSERT_TRUE(engine.obfuscateAmalgamated(inputs, outputFile));
+
+    std::ifstream in(outputFile);
+    std::string output((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    EXPECT_NE(output.find("#line 1 \"" + inputs[1] + "\""), std::string::npos);
+    EXPECT_EQ(output.find("shared message"), std::string::npos);
+    EXPECT_EQ(output.find("_enc["), output.rfind("_enc["));
+}
+
+// 合并模式：各文件的 static 名字冲突时失败；文件名中的引号和反斜杠被转义
+TEST(ObfuscationEngineTest, AmalgamateRejectsStaticCollisions) {
+    const std::string dir = ::testing::TempDir();
+    const std::vector<std::string> inputs = {
+        dir + "amalg_static_a.c", dir + "amalg_static_b.c", dir + "amalg \"q\".c"
+    };
+    std::ofstream(inputs[0]) << "static int helper = 1, other = helper;\n"
+                                "int shared(void);\n"
+                                "struct S { int helper2; };\n"
+                                "int A_f(void) { return helper; }\n";
+    std::ofstream(inputs[1]) << "int shared(void) { return 0; }\n"
+                                "static void helper2(void) {}\n"
+                                "static int B_x __attribute__((unused)) = 2;\n";
+    std::ofstream(inputs[2]) << "static int helper(void) { return 2; }\n";
+
+    std::string combined;
+    EXPECT_TRUE(ObfuscationEngine::amalgamate({inputs[0], inputs[1]}, combined));
+    EXPECT_FALSE(ObfuscationEngine::amalgamate(inputs, combined));
+    EXPECT_NE(combined.find("#line 1 \"" + dir + "amalg \\\"q\\\".c\""), std::string::npos);
+
+    auto names = CodeParser::scanFileScopeNames("static int a = b, c;\nint f(int x) { return x; }\n");
+    ASSERT_EQ(names.size(), 3u);
+    EXPECT_EQ(names[0].name, "a");
+    EXPECT_TRUE(names[0].isStatic);
+    EXPECT_EQ(names[1].name, "c");
+    EXPECT_EQ(names[2].name, "f");
+    EXPECT_FALSE(names[2].isStatic);
+}
+
+// 源码级平坦化：语句切分为基本块，经由标签地址表分发
+TEST(ControlFlowRewriterTest, FlattensLoopBody) {
+    ControlFlowRewriter rewriter;
+    const std::string body =
+        "{\n"
+        "    int s = 0;\n"
+        "    for (int i = 0; i < n; i++) {\n"
+        "        if (i % 3 == 0) continue;\n"
+        "        s += i;\n"
+        "    }\n"
+        "    return s;\n"
+        "}";
+    const std::string output = rewriter.flattenControlFlow(body);
+
+    EXPECT_NE(output, body);
+    EXPECT_NE(output.find("goto *"), std::string::npos);
+    EXPECT_NE(output.find("switch ("), std::string::npos);   // 非 GNU 编译器的回退分发
+    EXPECT_NE(output.find("    int i;\n"), std::string::npos);  // 块内声明被提升
+    EXPECT_EQ(output.find("for ("), std::string::npos);
+}
+
+TEST(ControlFlowRewriterTest, LeavesUnsupportedBodiesUnchanged) {
+    ControlFlowRewriter rewriter;
+    const std::string withGoto = "{\n    if (x) goto out;\n    x++;\nout:\n    return x;\n}";
+    const std::string withPreprocessor = "{\n#ifdef DEBUG\n    log();\n#endif\n    while (x) x--;\n}";
+
+    EXPECT_EQ(rewriter.flattenControlFlow(withGoto), withGoto);
+    EXPECT_EQ(rewriter.flattenControlFlow(withPreprocessor), withPreprocessor);
+}
+
+// 热度感知布局：热块保持落空顺序连续排布，冷块被打散
+TEST(ControlFlowRewriterTest, ShuffleKeepsHotChainsContiguous) {
+    ControlFlowRewriter rewriter;
+    rewriter.setLayoutLocality(1.0f);
+    const std::vector<std::string> blocks = {"A", "B", "C", "D", "E", "F", "G", "H"};
+    const std::vector<uint64_t> profile = {1, 1, 900, 1000, 950, 1, 1, 1};
+
+    for (int round = 0; round < 20; ++round) {
+        const std::string output = rewriter.shuffleBasicBlocks(blocks, profile);
+        EXPECT_NE(output.find("C\nD\nE\n"), std::string::npos) << output;
+        EXPECT_EQ(output.size(), blocks.size() * 2);
+    }
+
+    rewriter.setLayoutLocality(0.0f);
+    const std::string uniform = rewriter.shuffleBasicBlocks(blocks, profile);
+    for (const auto& block : blocks) {
+        EXPECT_NE(uniform.find(block + "\n"), std::string::npos);
+    }
+}
+
+// 虚假分支：条件读取 volatile 状态，分支体调用冷函数，不拆开无花括号的 if-else
+TEST(ControlFlowRewriterTest, FakeBranchesSurviveFolding) {
+    ControlFlowRewriter rewriter;
+    EXPECT_EQ(rewriter.fakeBranchSupport(), "");
+
+    const std::string body =
+        "    int x = 0;\n"
+        "    if (x)\n"
+        "        x--;\n"
+        "    else\n"
+        "        x++;\n"
+        "    return x;\n";
+    const std::string output = rewriter.addFakeBranches(body, 1.0f);
+
+    EXPECT_EQ(output.find("if (0)"), std::string::npos);
+    EXPECT_NE(output.find("int x = 0;\n    if (OBF_FB_UNLIKELY("), std::string::npos);
+    EXPECT_NE(output.find("x--;\n    else\n"), std::string::npos);
+    EXPECT_NE(output.find("return x;\n"), std::string::npos);
+
+    const std::string support = rewriter.fakeBranchSupport();
+    EXPECT_NE(support.find("static volatile unsigned"), std::string::npos);
+    EXPECT_NE(support.find("__attribute__((cold, noinline))"), std::string::npos);
+    EXPECT_NE(support.find("__builtin_expect"), std::string::npos);
+}
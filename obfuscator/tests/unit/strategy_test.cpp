@@ -0,0 +1,416 @@
+/*
+ * 混淆策略测试 (Google Test)
+ */
+
+#include <gtest/gtest.h>
+#include "strategy/obfuscation_strategy.h"
+#include "parser/code_parser.h"
+#include "utils/random_utils.h"
+#include "runtime/obf_string.h"
+#include "runtime/obf_resource.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+using namespace obfuscator;
+using namespace obfuscator::utils;
+
+namespace {
+
+const StringLiteralInfo* findLiteral(const std::vector<StringLiteralInfo>& literals,
+                                     const std::string& value) {
+    for (const auto& literal : literals) {
+        if (literal.value == value) {
+            return &literal;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+// 词法扫描：按上下文区分可替换与不可替换的字面量
+TEST(LiteralScannerTest, ClassifiesContexts) {
+    const std::string code =
+        "#include \"local.h\"\n"
+        "#define LOG(m) puts(\"[log] \" m)\n"
+        "#define WRAP (x)\n"
+        "static const char* g = \"global\";\n"
+        "void f(void) {\n"
+        "    static const char* s = \"static local\";\n"
+        "    char buf[] = \"array init\";\n"
+        "    /* \"in comment\" */\n"
+        "    char q = '\"';\n"
+        "    puts(\"call arg\");\n"
+        "    puts(\"concat \" \"pair\");\n"
+        "    puts(sizeof(\"sized\") > 1 ? \"yes\" : \"no\");\n"
+        "    LOG(\"starting up\");\n"
+        "    WRAP(\"object macro\");\n"
+        "}\n";
+
+    auto literals = CodeParser::scanStringLiterals(code);
+
+    EXPECT_EQ(findLiteral(literals, "in comment"), nullptr);
+    ASSERT_NE(findLiteral(literals, "local.h"), nullptr);
+    EXPECT_FALSE(findLiteral(literals, "local.h")->rewritable);
+    EXPECT_FALSE(findLiteral(literals, "global")->rewritable);
+    EXPECT_FALSE(findLiteral(literals, "static local")->rewritable);
+    EXPECT_FALSE(findLiteral(literals, "array init")->rewritable);
+    EXPECT_FALSE(findLiteral(literals, "concat ")->rewritable);
+    EXPECT_FALSE(findLiteral(literals, "pair")->rewritable);
+    EXPECT_FALSE(findLiteral(literals, "sized")->rewritable);
+    EXPECT_FALSE(findLiteral(literals, "starting up")->rewritable);
+    EXPECT_TRUE(findLiteral(literals, "object macro")->rewritable);
+    EXPECT_TRUE(findLiteral(literals, "call arg")->rewritable);
+    EXPECT_TRUE(findLiteral(literals, "yes")->rewritable);
+    EXPECT_TRUE(findLiteral(literals, "no")->rewritable);
+
+    // 辅助声明放在 #include 之后
+    EXPECT_EQ(findLiteral(literals, "call arg")->declInsertPos, code.find("static const"));
+}
+
+TEST(LiteralScannerTest, DecodesEscapes) {
+    auto literals = CodeParser::scanStringLiterals(
+        "void f(void) { g(\"a\\tb\\x41\\101\\n\"); }\n");
+
+    ASSERT_EQ(literals.size(), 1u);
+    EXPECT_EQ(literals[0].value, "a\tbAA\n");
+    EXPECT_TRUE(literals[0].rewritable);
+}
+
+// 大型数值数组走快速路径，不影响之后的字面量识别
+TEST(LiteralScannerTest, SkipsLargeDataArrays) {
+    std::string code = "static const unsigned char blob[] = {\n";
+    std::string expected;
+    for (int i = 0; i < 300; ++i) {
+        code += (i % 3 == 0) ? "0x" + std::to_string(10 + i % 90) + ", "
+                             : std::to_string(i) + "u, ";
+        expected += static_cast<char>((i % 3 == 0) ? std::stoi(std::to_string(10 + i % 90), nullptr, 16)
+                                                   : i);
+    }
+    code += "'A', '\\n', -1 /* tail */};\n"
+            "int main(void) { puts(\"after blob\"); return 0; }\n";
+    expected += "A\n\xff";
+
+    auto arrays = CodeParser::scanDataArrays(code, 256);
+    ASSERT_EQ(arrays.size(), 1u);
+    EXPECT_EQ(arrays[0].name, "blob");
+    EXPECT_EQ(arrays[0].elementType, "unsigned char");
+    EXPECT_TRUE(arrays[0].isStatic);
+    EXPECT_EQ(arrays[0].elementCount, 303u);
+
+    std::string bytes;
+    ASSERT_TRUE(CodeParser::decodeByteList(code, arrays[0], bytes));
+    EXPECT_EQ(bytes, expected);
+
+    auto literals = CodeParser::scanStringLiterals(code);
+    ASSERT_EQ(literals.size(), 1u);
+    EXPECT_TRUE(literals[0].rewritable);
+
+    CodeParser parser;
+    ASSERT_TRUE(parser.parse(code));
+    ASSERT_NE(parser.getFunction("main"), nullptr);
+    EXPECT_NE(parser.getFunction("main")->body.find("after blob"), std::string::npos);
+}
+
+TEST(CryptoUtilsTest, BlockPaddingRoundTrip) {
+    const std::string plain = "Hello World";
+    std::string padded = CryptoUtils::padToBlock(plain);
+
+    ASSERT_EQ(padded.size() % CryptoUtils::kDecryptBlockSize, 0u);
+    EXPECT_EQ(padded.substr(0, plain.size() + 1), std::string(plain.c_str(), plain.size() + 1));
+
+    auto key = CryptoUtils::generateKeyN(CryptoUtils::kDecryptBlockSize);
+    std::string encrypted = CryptoUtils::xorEncrypt(padded, key);
+    EXPECT_EQ(CryptoUtils::xorEncrypt(encrypted, key), padded);
+}
+
+// 流密码与运行时头文件一致，任意偏移和长度都能正确解密
+TEST(CryptoUtilsTest, StreamCipherMatchesRuntime) {
+    auto raw = CryptoUtils::generateKeyN(1000);
+    std::string plain(raw.begin(), raw.end());
+    const uint32_t key[4] = {0x01234567u, 0x89abcdefu, 0xdeadbeefu, 0x0badf00du};
+    const uint32_t nonce = 0x5a5a1234u;
+
+    std::string encrypted = CryptoUtils::streamEncrypt(plain, key, nonce);
+    ASSERT_EQ(encrypted.size(), plain.size());
+    EXPECT_NE(encrypted, plain);
+
+    obf_resource resource = {
+        reinterpret_cast<const unsigned char*>(encrypted.data()), encrypted.size(),
+        {key[0], key[1], key[2], key[3]}, nonce, 0u
+    };
+    for (size_t step : {1u, 7u, 64u, 100u, 4096u}) {
+        std::string decrypted;
+        unsigned char buf[4096];
+        size_t offset = 0;
+        size_t n;
+        while ((n = obf_resource_read(&resource, offset, buf, step)) > 0) {
+            decrypted.append(reinterpret_cast<const char*>(buf), n);
+            offset += n;
+        }
+        EXPECT_EQ(decrypted, plain) << "step " << step;
+    }
+}
+
+// 字符串加密：字面量替换为解密一次的访问函数
+TEST(StringEncryptionStrategyTest, RewritesLiteralsToLazyAccessors) {
+    const std::string code =
+        "#include <stdio.h>\n"
+        "int main(void) {\n"
+        "    char name[] = \"keep me\";\n"
+        "    printf(\"secret message %s\\n\", name);\n"
+        "    return 0;\n"
+        "}\n";
+
+    StringEncryptionStrategy strategy;
+    std::string output;
+    ASSERT_TRUE(strategy.apply(code, output));
+
+    EXPECT_EQ(output.find("secret message"), std::string::npos);
+    EXPECT_NE(output.find("\"keep me\""), std::string::npos);
+    EXPECT_NE(output.find("obf_lazy_str"), std::string::npos);
+    EXPECT_EQ(output.find("#include <stdio.h>\n"), 0u);
+    EXPECT_LT(output.find("OBF_STRING_RUNTIME"), output.find("int main"));
+}
+
+TEST(StringEncryptionStrategyTest, RespectsMinLength) {
+    const std::string code = "void f(void) { puts(\"abc\"); }\n";
+
+    StringEncryptionStrategy strategy;
+    strategy.setMinLength(4);
+    std::string output;
+    ASSERT_TRUE(strategy.apply(code, output));
+    EXPECT_EQ(output, code);
+}
+
+// 字符串池：所有密文存放在一个连续数组中
+TEST(StringEncryptionStrategyTest, PooledStorageSharesOneBlob) {
+    const std::string code =
+        "void f(void) {\n"
+        "    puts(\"first string\");\n"
+        "    puts(\"second string\");\n"
+        "}\n";
+
+    using Policy = StringEncryptionStrategy::DecryptPolicy;
+    for (Policy policy : { Policy::EAGER, Policy::LAZY_STRING, Policy::LAZY_PAGE }) {
+        StringEncryptionStrategy strategy;
+        strategy.setStorage(StringEncryptionStrategy::Storage::POOLED);
+        strategy.setDecryptPolicy(policy);
+
+        std::string output;
+        ASSERT_TRUE(strategy.apply(code, output));
+        EXPECT_EQ(output.find("first string"), std::string::npos);
+        EXPECT_EQ(output.find("_enc["), output.rfind("_enc["));
+        EXPECT_EQ(output.find("OBF_CONSTRUCTOR OBF_UNUSED void") != std::string::npos,
+                  policy == Policy::EAGER);
+    }
+}
+
+// 相同字面量共享一份密文和一个访问函数
+TEST(StringEncryptionStrategyTest, DeduplicatesIdenticalLiterals) {
+    const std::string code =
+        "void f(int x) {\n"
+        "    if (x) puts(\"out of memory\");\n"
+        "    else puts(\"out of memory\");\n"
+        "    puts(\"different text\");\n"
+        "}\n";
+
+    StringEncryptionStrategy strategy;
+    std::string output;
+    ASSERT_TRUE(strategy.apply(code, output));
+
+    size_t first = output.find("_0()");
+    ASSERT_NE(first, std::string::npos);
+    EXPECT_NE(output.find("_0()", first + 1), std::string::npos);
+    EXPECT_NE(output.find("_1()"), std::string::npos);
+    EXPECT_EQ(output.find("_2()"), std::string::npos);
+}
+
+// C++ 目标：只做记号替换，加密在编译期完成
+TEST(StringEncryptionStrategyTest, CompileTimeModeWrapsLiterals) {
+    const std::string code =
+        "#include <cstdio>\n"
+        "int main() { std::puts(\"compile time\"); return 0; }\n";
+
+    StringEncryptionStrategy strategy;
+    strategy.setCompileTimeEncryption(true);
+    strategy.setRuntimeHeader("\"runtime/obf_string.h\"");
+
+    std::string output;
+    ASSERT_TRUE(strategy.apply(code, output));
+    EXPECT_NE(output.find("#include <cstdio>\n#include \"runtime/obf_string.h\"\n"),
+              std::string::npos);
+    EXPECT_NE(output.find("std::puts(OBF_STR(\"compile time\"))"), std::string::npos);
+}
+
+#ifdef OBF_TEST_CXX
+// constexpr/consteval 函数体中的字面量保持原样（if constexpr 不算），
+// 三种字符串模式的输出都能用 C++ 编译器编译
+TEST(StringEncryptionStrategyTest, KeepsConstexprBodiesCompilable) {
+    const std::string code =
+        "#include <cstdio>\n"
+        "constexpr const char* name() { return \"constexpr name\"; }\n"
+        "consteval char first() { return \"consteval text\"[0]; }\n"
+        "struct S {\n"
+        "    static constexpr const char* tag() { if (true) { return \"member tag\"; } return nullptr; }\n"
+        "};\n"
+        "int main() {\n"
+        "    if constexpr (sizeof(int) > 1) { std::puts(\"runtime text\"); }\n"
+        "    std::puts(name());\n"
+        "    return first() == 'c' && S::tag()[0] == 'm' ? 0 : 1;\n"
+        "}\n";
+
+    auto literals = CodeParser::scanStringLiterals(code);
+    EXPECT_FALSE(findLiteral(literals, "constexpr name")->rewritable);
+    EXPECT_FALSE(findLiteral(literals, "consteval text")->rewritable);
+    EXPECT_FALSE(findLiteral(literals, "member tag")->rewritable);
+    EXPECT_TRUE(findLiteral(literals, "runtime text")->rewritable);
+
+    const std::string source = ::testing::TempDir() + "obf_constexpr_test.cpp";
+    for (int mode = 0; mode < 3; ++mode) {
+        StringEncryptionStrategy strategy;
+        strategy.setRuntimeHeader("\"runtime/obf_string.h\"");
+        if (mode == 1) {
+            strategy.setStorage(StringEncryptionStrategy::Storage::POOLED);
+        } else if (mode == 2) {
+            strategy.setCompileTimeEncryption(true);
+        }
+
+        std::string output;
+        ASSERT_TRUE(strategy.apply(code, output));
+        EXPECT_NE(output.find("return \"constexpr name\";"), std::string::npos);
+        EXPECT_EQ(output.find("std::puts(\"runtime text\")"), std::string::npos);
+
+        std::ofstream(source) << output;
+        const std::string command = std::string(OBF_TEST_CXX) + " -std=c++20 -fsyntax-only -I\"" +
+                                    OBF_TEST_INCLUDE_DIR + "\" \"" + source + "\"";
+        EXPECT_EQ(std::system(command.c_str()), 0) << "mode " << mode << ":\n" << output;
+    }
+    std::remove(source.c_str());
+}
+#endif
+
+// 资源模式：未被引用的 static 字节数组替换为密文和 obf_resource 描述符，
+// OBF_RESOURCE_PLAIN 回退随之删除；外部链接或仍被引用的数组保持不变，声明的元素数保留
+TEST(StringEncryptionStrategyTest, EncryptsResourceArrays) {
+    std::string list;
+    for (int i = 0; i < 64; ++i) {
+        list += std::to_string(i) + ",";
+    }
+    std::string code = "#include <stdio.h>\n"
+                       "/* model: weights */\n"
+                       "static unsigned char model[] = {" + list + "};\n"
+                       "static const unsigned char padded[0x50] = {" + list + "};\n"
+                       "unsigned char exported[] = {" + list + "};\n"
+                       "static unsigned char used[] = {" + list + "};\n"
+                       "static const unsigned char blob[] = {" + list + "};\n"
+                       "OBF_RESOURCE_PLAIN( blob ) ;\n"
+                       "int small[] = {1, 2, 3};\n"
+                       "int main(void) { puts(\"resource test\"); return used[0] + (int)blob_resource.size; }\n";
+
+    StringEncryptionStrategy strategy;
+    strategy.setResourceEncryption(true);
+    strategy.setResourceMinSize(32);
+
+    std::string output;
+    ASSERT_TRUE(strategy.apply(code, output));
+    EXPECT_NE(output.find("#include <obfuscator/runtime/obf_resource.h>"), std::string::npos);
+    EXPECT_NE(output.find("static const unsigned char obf_res_model_data[64]"), std::string::npos);
+    EXPECT_NE(output.find("static const obf_resource model_resource"), std::string::npos);
+    EXPECT_EQ(output.find("unsigned char model[]"), std::string::npos);
+    EXPECT_NE(output.find("static const unsigned char obf_res_padded_data[80]"), std::string::npos);
+    EXPECT_NE(output.find("unsigned char exported[] = {"), std::string::npos);
+    EXPECT_NE(output.find("static unsigned char used[] = {"), std::string::npos);
+    EXPECT_NE(output.find("int small[] = {1, 2, 3};"), std::string::npos);
+    EXPECT_NE(output.find("static const obf_resource blob_resource"), std::string::npos);
+    EXPECT_EQ(output.find("OBF_RESOURCE_PLAIN"), std::string::npos);
+    EXPECT_EQ(output.find("resource test"), std::string::npos);
+}
+
+#ifdef OBF_TEST_CXX
+// 同一份源码混淆前走 OBF_RESOURCE_PLAIN 明文回退，混淆后走密文描述符，
+// 两者从不同偏移分块读取的内容一致
+TEST(StringEncryptionStrategyTest, ResourceFallbackMatchesEncryption) {
+    std::string list;
+    for (int i = 0; i < 300; ++i) {
+        list += std::to_string((i * 7 + 3) & 0xff) + ",";
+    }
+    const std::string code =
+        "#include \"runtime/obf_resource.h\"\n"
+        "static const unsigned char blob[] = {" + list + "};\n"
+        "OBF_RESOURCE_PLAIN(blob);\n"
+        "int main() {\n"
+        "    unsigned char buf[50];\n"
+        "    size_t off = 5, n;\n"
+        "    if (obf_resource_size(&blob_resource) != 300) { return 1; }\n"
+        "    while ((n = obf_resource_read(&blob_resource, off, buf, sizeof(buf))) > 0) {\n"
+        "        for (size_t j = 0; j < n; ++j) {\n"
+        "            if (buf[j] != (unsigned char)((off + j) * 7 + 3)) { return 2; }\n"
+        "        }\n"
+        "        off += n;\n"
+        "    }\n"
+        "    return off == 300 ? 0 : 3;\n"
+        "}\n";
+
+    StringEncryptionStrategy strategy;
+    strategy.setResourceEncryption(true);
+    strategy.setResourceMinSize(256);
+    strategy.setResourceHeader("\"runtime/obf_resource.h\"");
+    std::string output;
+    ASSERT_TRUE(strategy.apply(code, output));
+    ASSERT_NE(output.find("blob_resource = {"), std::string::npos);
+
+    const std::string source = ::testing::TempDir() + "obf_resource_test.cpp";
+    const std::string binary = ::testing::TempDir() + "obf_resource_test";
+    for (const std::string& text : {code, output}) {
+        std::ofstream(source) << text;
+        const std::string command = std::string(OBF_TEST_CXX) + " -std=c++17 -I\"" +
+                                    OBF_TEST_INCLUDE_DIR + "\" \"" + source + "\" -o \"" +
+                                    binary + "\" && \"" + binary + "\"";
+        EXPECT_EQ(std::system(command.c_str()), 0) << text;
+    }
+    std::remove(source.c_str());
+    std::remove(binary.c_str());
+}
+#endif
+
+// 谓词在函数入口求值一次，循环内只测试局部变量；输入来自文件作用域的不变量表
+TEST(OpaquePredicateStrategyTest, HoistsPredicatesWithinBudget) {
+    std::string code = "int sum(const int* a, int n) {\n"
+                       "    int s = 0;\n";
+    for (int i = 0; i < 40; ++i) {
+        code += "    s += a[" + std::to_string(i) + "];\n";
+    }
+    code += "    return s;\n}\n";
+
+    OpaquePredicateStrategy strategy;
+    strategy.setPointerAliasing(true);
+    strategy.setCostBudget(10);
+    std::string output;
+    ASSERT_TRUE(strategy.apply(code, output));
+
+    const size_t table = output.find("_tbl[8] = {");
+    const size_t decl = output.find("    const int obf_op_");
+    ASSERT_NE(table, std::string::npos);
+    ASSERT_NE(decl, std::string::npos);
+    EXPECT_LT(output.find("_alias[2] = {"), decl);
+    EXPECT_LT(decl, output.find("    int s = 0;"));
+    EXPECT_EQ(output.find("__op_"), std::string::npos);
+
+    // 10 周期的预算只容纳一个谓词（最便宜的5周期），其余用于1周期的使用
+    size_t uses = 0;
+    for (size_t p = output.find("_cold(", decl); p != std::string::npos; p = output.find("_cold(", p + 1)) {
+        ++uses;
+    }
+    EXPECT_EQ(output.find("const int obf_op_", decl + 1), output.rfind("const int obf_op_"));
+    EXPECT_GE(uses, 1u);
+    EXPECT_LE(uses, 5u);
+}
+
+TEST(CompileTimeStringTest, DecryptsLazily) {
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_STREQ(OBF_STR("compile-time encrypted"), "compile-time encrypted");
+    }
+    EXPECT_STREQ(OBF_STR("with\tescape\n"), "with\tescape\n");
+}